@@ -82,6 +82,21 @@ void Config::ReadValues() {
     // Renderer
     Settings::values.use_hw_renderer = sdl2_config->GetBoolean("Renderer", "use_hw_renderer", true);
     Settings::values.use_shader_jit = sdl2_config->GetBoolean("Renderer", "use_shader_jit", true);
+    Settings::values.use_async_shader_jit =
+        sdl2_config->GetBoolean("Renderer", "use_async_shader_jit", true);
+    Settings::values.shader_jit_cache_size =
+        static_cast<int>(sdl2_config->GetInteger("Renderer", "shader_jit_cache_size", 64));
+    Settings::values.sw_rasterizer_threads =
+        static_cast<int>(sdl2_config->GetInteger("Renderer", "sw_rasterizer_threads", 0));
+    Settings::values.use_async_gpu = sdl2_config->GetBoolean("Renderer", "use_async_gpu", false);
+    Settings::values.vertex_shader_threads =
+        static_cast<int>(sdl2_config->GetInteger("Renderer", "vertex_shader_threads", 0));
+    Settings::values.vertex_shader_parallel_threshold = static_cast<int>(
+        sdl2_config->GetInteger("Renderer", "vertex_shader_parallel_threshold", 1024));
+    Settings::values.texture_decode_threads =
+        static_cast<int>(sdl2_config->GetInteger("Renderer", "texture_decode_threads", 0));
+    Settings::values.use_fragment_jit =
+        sdl2_config->GetBoolean("Renderer", "use_fragment_jit", true);
     Settings::values.resolution_factor =
         (float)sdl2_config->GetReal("Renderer", "resolution_factor", 1.0);
     Settings::values.use_vsync = sdl2_config->GetBoolean("Renderer", "use_vsync", false);
@@ -70,6 +70,42 @@ use_hw_renderer =
 # 0: Interpreter (slow), 1 (default): JIT (fast)
 use_shader_jit =
 
+# Whether shaders are compiled on a background thread, running on the interpreter until they are
+# ready. This avoids stutter when new shaders are used.
+# 0: Compile on the emulation thread, 1 (default): Compile in the background
+use_async_shader_jit =
+
+# Maximum size of the memory reserved for compiled shader code, in megabytes. Every program takes up
+# to 1.25 megabytes. The least recently used shaders are freed when it is exceeded.
+# Default: 64
+shader_jit_cache_size =
+
+# Number of threads used by the software renderer to rasterize triangles
+# 0 (default): One per hardware thread, 1: Rasterize on the emulation thread only
+sw_rasterizer_threads =
+
+# Whether GPU commands are processed on a separate thread, in parallel with the emulated CPU.
+# Only takes effect with the software renderer (use_hw_renderer = 0), and never while the graphics
+# debugger is used.
+# 0 (default): Process GPU commands on the emulation thread, 1: Use a GPU thread
+use_async_gpu =
+
+# Number of threads used to load and shade the vertices of large draw calls
+# 0 (default): One per hardware thread, 1: Process vertices on the emulation thread only
+vertex_shader_threads =
+
+# Minimum number of vertices a draw call needs to have its vertices processed by multiple threads
+# Default: 1024
+vertex_shader_parallel_threshold =
+
+# Number of threads used by the OpenGL renderer to decode and swizzle large textures
+# 0 (default): One per hardware thread, 1: Decode on the emulation thread only
+texture_decode_threads =
+
+# Whether the software renderer compiles the texture combiner and blending stages to native code
+# 0: Interpreter (slow), 1 (default): JIT (fast)
+use_fragment_jit =
+
 # Resolution scale factor
 # 0: Auto (scales resolution to window size), 1: Native 3DS screen resolution, Otherwise a scale
 # factor for the 3DS resolution
@@ -66,6 +66,15 @@ void Config::ReadValues() {
     qt_config->beginGroup("Renderer");
     Settings::values.use_hw_renderer = qt_config->value("use_hw_renderer", true).toBool();
     Settings::values.use_shader_jit = qt_config->value("use_shader_jit", true).toBool();
+    Settings::values.use_async_shader_jit = qt_config->value("use_async_shader_jit", true).toBool();
+    Settings::values.shader_jit_cache_size = qt_config->value("shader_jit_cache_size", 64).toInt();
+    Settings::values.sw_rasterizer_threads = qt_config->value("sw_rasterizer_threads", 0).toInt();
+    Settings::values.use_async_gpu = qt_config->value("use_async_gpu", false).toBool();
+    Settings::values.vertex_shader_threads = qt_config->value("vertex_shader_threads", 0).toInt();
+    Settings::values.vertex_shader_parallel_threshold =
+        qt_config->value("vertex_shader_parallel_threshold", 1024).toInt();
+    Settings::values.texture_decode_threads = qt_config->value("texture_decode_threads", 0).toInt();
+    Settings::values.use_fragment_jit = qt_config->value("use_fragment_jit", true).toBool();
     Settings::values.resolution_factor = qt_config->value("resolution_factor", 1.0).toFloat();
     Settings::values.use_vsync = qt_config->value("use_vsync", false).toBool();
     Settings::values.toggle_framelimit = qt_config->value("toggle_framelimit", true).toBool();
@@ -212,6 +221,15 @@ void Config::SaveValues() {
     qt_config->beginGroup("Renderer");
     qt_config->setValue("use_hw_renderer", Settings::values.use_hw_renderer);
     qt_config->setValue("use_shader_jit", Settings::values.use_shader_jit);
+    qt_config->setValue("use_async_shader_jit", Settings::values.use_async_shader_jit);
+    qt_config->setValue("shader_jit_cache_size", Settings::values.shader_jit_cache_size);
+    qt_config->setValue("sw_rasterizer_threads", Settings::values.sw_rasterizer_threads);
+    qt_config->setValue("use_async_gpu", Settings::values.use_async_gpu);
+    qt_config->setValue("vertex_shader_threads", Settings::values.vertex_shader_threads);
+    qt_config->setValue("vertex_shader_parallel_threshold",
+                        Settings::values.vertex_shader_parallel_threshold);
+    qt_config->setValue("texture_decode_threads", Settings::values.texture_decode_threads);
+    qt_config->setValue("use_fragment_jit", Settings::values.use_fragment_jit);
     qt_config->setValue("resolution_factor", (double)Settings::values.resolution_factor);
     qt_config->setValue("use_vsync", Settings::values.use_vsync);
     qt_config->setValue("toggle_framelimit", Settings::values.toggle_framelimit);
@@ -62,6 +62,14 @@ void GraphicsTracingWidget::StartRecording() {
     if (!context)
         return;
 
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save CiTrace"), "citrace.ctf",
+                                                    tr("CiTrace File (*.ctf)"));
+
+    if (filename.isEmpty()) {
+        // If the user canceled the dialog, don't start recording
+        return;
+    }
+
     auto shader_binary = Pica::g_state.vs.program_code;
     auto swizzle_data = Pica::g_state.vs.swizzle_data;
 
@@ -69,7 +77,7 @@ void GraphicsTracingWidget::StartRecording() {
     // TODO: Drop this explicit conversion once we store float24 values bit-correctly internally.
     std::array<u32, 4 * 16> default_attributes;
     for (unsigned i = 0; i < 16; ++i) {
-        for (unsigned comp = 0; comp < 3; ++comp) {
+        for (unsigned comp = 0; comp < 4; ++comp) {
             default_attributes[4 * i + comp] = nihstro::to_float24(
                 Pica::g_state.input_default_attributes.attr[i][comp].ToFloat32());
         }
@@ -77,7 +85,7 @@ void GraphicsTracingWidget::StartRecording() {
 
     std::array<u32, 4 * 96> vs_float_uniforms;
     for (unsigned i = 0; i < 96; ++i)
-        for (unsigned comp = 0; comp < 3; ++comp)
+        for (unsigned comp = 0; comp < 4; ++comp)
             vs_float_uniforms[4 * i + comp] =
                 nihstro::to_float24(Pica::g_state.vs.uniforms.f[i][comp].ToFloat32());
 
@@ -96,7 +104,7 @@ void GraphicsTracingWidget::StartRecording() {
     // boost::copy(TODO: Not implemented, std::back_inserter(state.gs_swizzle_data));
     // boost::copy(TODO: Not implemented, std::back_inserter(state.gs_float_uniforms));
 
-    auto recorder = new CiTrace::Recorder(state);
+    auto recorder = new CiTrace::Recorder(filename.toStdString(), state);
     context->recorder = std::shared_ptr<CiTrace::Recorder>(recorder);
 
     emit SetStartTracingButtonEnabled(false);
@@ -109,15 +117,7 @@ void GraphicsTracingWidget::StopRecording() {
     if (!context)
         return;
 
-    QString filename = QFileDialog::getSaveFileName(this, tr("Save CiTrace"), "citrace.ctf",
-                                                    tr("CiTrace File (*.ctf)"));
-
-    if (filename.isEmpty()) {
-        // If the user canceled the dialog, keep recording
-        return;
-    }
-
-    context->recorder->Finish(filename.toStdString());
+    context->recorder->Finish();
     context->recorder = nullptr;
 
     emit SetStopTracingButtonEnabled(false);
@@ -130,6 +130,7 @@ void GraphicsTracingWidget::AbortRecording() {
     if (!context)
         return;
 
+    context->recorder->Abort();
     context->recorder = nullptr;
 
     emit SetStopTracingButtonEnabled(false);
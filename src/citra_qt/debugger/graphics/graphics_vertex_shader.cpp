@@ -513,10 +513,11 @@ void GraphicsVertexShaderWidget::Reload(bool replace_vertex_data, void* vertex_d
     u32 entry_point = Pica::g_state.regs.vs.main_offset;
     info.labels.insert({entry_point, "main"});
 
-    // Generate debug information
+    // Generate debug information. This runs while the emulated GPU is paused between setting up the
+    // shader and running it, so the setup must not be modified.
     Pica::Shader::InterpreterEngine shader_engine;
-    shader_engine.SetupBatch(shader_setup, entry_point);
-    debug_data = shader_engine.ProduceDebugInfo(shader_setup, input_vertex, shader_config);
+    debug_data =
+        shader_engine.ProduceDebugInfo(shader_setup, input_vertex, shader_config, entry_point);
 
     // Reload widget state
     for (int attr = 0; attr < num_attributes; ++attr) {
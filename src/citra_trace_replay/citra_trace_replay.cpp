@@ -0,0 +1,289 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// This needs to be included before getopt.h because the latter #defines symbols used by it
+#include "common/microprofile.h"
+
+#ifdef _MSC_VER
+#include <getopt.h>
+#else
+#include <getopt.h>
+#include <unistd.h>
+#endif
+
+#include "common/hash.h"
+#include "common/logging/backend.h"
+#include "common/logging/filter.h"
+#include "common/logging/log.h"
+#include "common/scm_rev.h"
+#include "common/scope_exit.h"
+#include "core/hle/kernel/process.h"
+#include "core/hle/kernel/vm_manager.h"
+#include "core/hw/gpu.h"
+#include "core/memory.h"
+#include "core/memory_setup.h"
+#include "core/settings.h"
+#include "core/tracer/player.h"
+#include "video_core/pica.h"
+#include "video_core/renderer_base.h"
+#include "video_core/video_core.h"
+
+/// Renderer that only provides the software rasterizer, frames are never presented
+class NullRenderer : public RendererBase {
+public:
+    void SwapBuffers() override {}
+    void SetWindow(EmuWindow*) override {}
+    bool Init() override {
+        RefreshRasterizerSetting();
+        return true;
+    }
+    void ShutDown() override {}
+};
+
+/// MicroProfile timers of the GPU emulation stages reported for every frame
+static constexpr std::array<const char*, 7> profiled_stages = {{
+    "Cmdlist Processing", "Drawing", "Shader", "Rasterization", "Binned Rasterization",
+    "Texture Decode", "DisplayTransfer",
+}};
+
+static void PrintHelp(const char* argv0) {
+    std::cout << "Usage: " << argv0
+              << " [options] <filename>\n"
+                 "Replays a CiTrace GPU command trace with the software renderer.\n\n"
+                 "-l, --loops=NUMBER    Replay the trace NUMBER times (default: 1)\n"
+                 "-t, --threads=NUMBER  Worker threads, 0 for one per hardware thread\n"
+                 "-i, --interpreter     Run shaders and fragment stages without the JITs\n"
+                 "-e, --expect=HASH     Fail unless the hash over all frames equals HASH\n"
+                 "-q, --quiet           Only print the summary\n"
+                 "-h, --help            Display this help and exit\n"
+                 "-v, --version         Output version information and exit\n";
+}
+
+static void PrintVersion() {
+    std::cout << "Citra " << Common::g_scm_branch << " " << Common::g_scm_desc << std::endl;
+}
+
+static u32 ParseNumber(const char* arg, const char* option) {
+    char* endarg;
+    errno = 0;
+    const unsigned long value = strtoul(arg, &endarg, 0);
+    if (endarg == arg)
+        errno = EINVAL;
+    if (errno != 0) {
+        perror(option);
+        exit(1);
+    }
+    return static_cast<u32>(value);
+}
+
+/// Hashes the framebuffer the given screen currently displays
+static u64 HashScreen(const GPU::Regs::FramebufferConfig& framebuffer) {
+    const PAddr address =
+        framebuffer.second_fb_active ? framebuffer.address_left2 : framebuffer.address_left1;
+    const u32 size = framebuffer.stride * framebuffer.height;
+    if (size == 0)
+        return 0;
+
+    Memory::RasterizerFlushRegion(address, size);
+    const u8* data = Memory::GetPhysicalPointer(address);
+    return data != nullptr ? Common::ComputeHash64(data, size) : 0;
+}
+
+/// Application entry point
+int main(int argc, char** argv) {
+    int option_index = 0;
+    u32 loops = 1;
+    u32 threads = 0;
+    bool use_jit = true;
+    bool quiet = false;
+    bool check_hash = false;
+    u64 expected_hash = 0;
+    std::string filepath;
+
+    static struct option long_options[] = {
+        {"loops", required_argument, 0, 'l'},  {"threads", required_argument, 0, 't'},
+        {"interpreter", no_argument, 0, 'i'},  {"expect", required_argument, 0, 'e'},
+        {"quiet", no_argument, 0, 'q'},        {"help", no_argument, 0, 'h'},
+        {"version", no_argument, 0, 'v'},      {0, 0, 0, 0},
+    };
+
+    while (optind < argc) {
+        char arg = getopt_long(argc, argv, "l:t:ie:qhv", long_options, &option_index);
+        if (arg != -1) {
+            switch (arg) {
+            case 'l':
+                loops = std::max(ParseNumber(optarg, "--loops"), 1u);
+                break;
+            case 't':
+                threads = ParseNumber(optarg, "--threads");
+                break;
+            case 'i':
+                use_jit = false;
+                break;
+            case 'e':
+                expected_hash = std::strtoull(optarg, nullptr, 16);
+                check_hash = true;
+                break;
+            case 'q':
+                quiet = true;
+                break;
+            case 'h':
+                PrintHelp(argv[0]);
+                return 0;
+            case 'v':
+                PrintVersion();
+                return 0;
+            default:
+                PrintHelp(argv[0]);
+                return 1;
+            }
+        } else {
+            filepath = argv[optind];
+            optind++;
+        }
+    }
+
+    Log::Filter log_filter(Log::Level::Info);
+    Log::SetFilter(&log_filter);
+
+    MicroProfileOnThreadCreate("ReplayThread");
+    MicroProfileSetEnableAllGroups(true);
+    SCOPE_EXIT({ MicroProfileShutdown(); });
+
+    if (filepath.empty()) {
+        LOG_CRITICAL(Frontend, "No trace file specified");
+        return -1;
+    }
+
+    CiTrace::Player player(filepath);
+    if (!player.IsValid())
+        return -1;
+
+    Settings::values.sw_rasterizer_threads = static_cast<int>(threads);
+    Settings::values.vertex_shader_threads = static_cast<int>(threads);
+    Settings::values.vertex_shader_parallel_threshold = 1024;
+    Settings::values.texture_decode_threads = static_cast<int>(threads);
+    Settings::values.shader_jit_cache_size = 64;
+    VideoCore::g_hw_renderer_enabled = false;
+    VideoCore::g_shader_jit_enabled = use_jit;
+    // Replays compile shaders and process commands synchronously, so every frame is rendered the
+    // same way
+    VideoCore::g_async_shader_jit_enabled = false;
+    VideoCore::g_async_gpu_enabled = false;
+    VideoCore::g_fragment_jit_enabled = use_jit;
+
+    // Physical memory is looked up through the virtual mappings of the current process, which the
+    // GPU expects to be set up like for an application with the old linear heap layout
+    Memory::InitMemoryMap();
+    Kernel::g_current_process =
+        Kernel::Process::Create(Kernel::CodeSet::Create("citra-trace-replay", 0));
+    SCOPE_EXIT({ Kernel::g_current_process = nullptr; });
+
+    std::vector<u8> fcram(Memory::FCRAM_SIZE);
+    std::vector<u8> vram(Memory::VRAM_SIZE);
+    auto& vm_manager = Kernel::g_current_process->vm_manager;
+    vm_manager.MapBackingMemory(Memory::LINEAR_HEAP_VADDR, fcram.data(), Memory::FCRAM_SIZE,
+                                Kernel::MemoryState::Continuous);
+    vm_manager.MapBackingMemory(Memory::VRAM_VADDR, vram.data(), Memory::VRAM_SIZE,
+                                Kernel::MemoryState::IO);
+
+    Pica::Init();
+    VideoCore::g_renderer = std::make_unique<NullRenderer>();
+    VideoCore::g_renderer->Init();
+    SCOPE_EXIT({
+        VideoCore::g_renderer.reset();
+        Pica::Shutdown();
+    });
+
+    using Clock = std::chrono::steady_clock;
+    std::vector<double> frame_times;
+    std::array<double, profiled_stages.size()> stage_totals{};
+    u64 trace_hash = 0;
+    bool diverged = false;
+
+    for (u32 loop = 0; loop < loops; ++loop) {
+        // Every loop starts out from the same memory contents
+        Memory::RasterizerFlushAndInvalidateRegion(Memory::FCRAM_PADDR, Memory::FCRAM_SIZE);
+        Memory::RasterizerFlushAndInvalidateRegion(Memory::VRAM_PADDR, Memory::VRAM_SIZE);
+        std::fill(fcram.begin(), fcram.end(), 0);
+        std::fill(vram.begin(), vram.end(), 0);
+
+        player.RestoreInitialState();
+        MicroProfileFlip();
+
+        u64 loop_hash = 0;
+        auto frame_start = Clock::now();
+        player.Replay([&](unsigned frame) {
+            // Triangles still queued in the rasterizer belong to this frame
+            VideoCore::g_renderer->Rasterizer()->FlushAll();
+            const std::chrono::duration<double, std::milli> frame_time = Clock::now() - frame_start;
+            frame_times.push_back(frame_time.count());
+
+            const u64 top_hash = HashScreen(GPU::g_regs.framebuffer_config[0]);
+            const u64 bottom_hash = HashScreen(GPU::g_regs.framebuffer_config[1]);
+            const u64 frame_hashes[] = {loop_hash, top_hash, bottom_hash};
+            loop_hash = Common::ComputeHash64(frame_hashes, sizeof(frame_hashes));
+
+            MicroProfileFlip();
+            if (!quiet) {
+                std::printf("loop %u frame %u: %.3f ms, top %016" PRIx64 ", bottom %016" PRIx64
+                            "\n",
+                            loop, frame, frame_time.count(), top_hash, bottom_hash);
+            }
+            for (size_t i = 0; i < profiled_stages.size(); ++i) {
+                const float stage_time = MicroProfileGetTime("GPU", profiled_stages[i]);
+                stage_totals[i] += stage_time;
+                if (!quiet && stage_time > 0.f)
+                    std::printf("    %-20s %.3f ms\n", profiled_stages[i], stage_time);
+            }
+
+            // Hashing and reporting do not count towards the next frame
+            frame_start = Clock::now();
+        });
+
+        if (loop == 0) {
+            trace_hash = loop_hash;
+        } else if (loop_hash != trace_hash) {
+            std::printf("loop %u diverged: trace hash %016" PRIx64 "\n", loop, loop_hash);
+            diverged = true;
+        }
+    }
+
+    if (frame_times.empty()) {
+        LOG_CRITICAL(Frontend, "The trace does not contain any frames");
+        return -1;
+    }
+
+    double total_time = 0;
+    for (double time : frame_times)
+        total_time += time;
+    const auto minmax = std::minmax_element(frame_times.begin(), frame_times.end());
+
+    std::printf("%zu frames in %.3f ms: average %.3f ms, min %.3f ms, max %.3f ms\n",
+                frame_times.size(), total_time, total_time / frame_times.size(), *minmax.first,
+                *minmax.second);
+    for (size_t i = 0; i < profiled_stages.size(); ++i) {
+        std::printf("    %-20s %.3f ms per frame\n", profiled_stages[i],
+                    stage_totals[i] / frame_times.size());
+    }
+    std::printf("trace hash %016" PRIx64 "\n", trace_hash);
+
+    if (check_hash && trace_hash != expected_hash) {
+        std::printf("expected trace hash %016" PRIx64 "\n", expected_hash);
+        return 1;
+    }
+    return diverged ? 1 : 0;
+}
@@ -0,0 +1,67 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <utility>
+#include "common/common_types.h"
+
+namespace Common {
+
+/**
+ * Unbounded lock-free queue with a single producer and a single consumer thread. Push may only be
+ * called by the producer, Pop and Empty only by the consumer.
+ */
+template <typename T>
+class SPSCQueue : NonCopyable {
+public:
+    SPSCQueue() : write_node(new Node), read_node(write_node) {}
+
+    ~SPSCQueue() {
+        while (read_node != nullptr) {
+            Node* next = read_node->next.load(std::memory_order_relaxed);
+            delete read_node;
+            read_node = next;
+        }
+    }
+
+    void Push(T value) {
+        // The producer fills the empty node at the end of the list and appends a new one, which
+        // publishes the value to the consumer.
+        Node* new_node = new Node;
+        write_node->value = std::move(value);
+        write_node->next.store(new_node, std::memory_order_release);
+        write_node = new_node;
+    }
+
+    /// Removes the oldest value and stores it in value. Returns false if the queue was empty.
+    bool Pop(T& value) {
+        Node* next = read_node->next.load(std::memory_order_acquire);
+        if (next == nullptr)
+            return false;
+
+        value = std::move(read_node->value);
+        delete read_node;
+        read_node = next;
+        return true;
+    }
+
+    bool Empty() const {
+        return read_node->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    struct Node {
+        T value;
+        std::atomic<Node*> next{nullptr};
+    };
+
+    /// Empty node at the end of the list, only accessed by the producer
+    Node* write_node;
+    /// Node holding the oldest value, only accessed by the consumer
+    Node* read_node;
+};
+
+} // namespace Common
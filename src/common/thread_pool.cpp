@@ -0,0 +1,87 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include "common/thread.h"
+#include "common/thread_pool.h"
+
+namespace Common {
+
+ThreadPool::ThreadPool(size_t num_threads, const char* name) : name(name) {
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    workers.reserve(num_threads - 1);
+    for (size_t i = 1; i < num_threads; ++i)
+        workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        shutting_down = true;
+    }
+    work_available.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& func) {
+    if (count == 0)
+        return;
+
+    // Not worth waking up the workers for a single job
+    if (workers.empty() || count == 1) {
+        for (size_t i = 0; i < count; ++i)
+            func(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current_func = &func;
+        job_count = count;
+        next_job = 0;
+        busy_workers = workers.size();
+        ++generation;
+    }
+    work_available.notify_all();
+
+    RunJobs();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    work_done.wait(lock, [this] { return busy_workers == 0; });
+    current_func = nullptr;
+}
+
+void ThreadPool::RunJobs() {
+    size_t index;
+    while ((index = next_job.fetch_add(1)) < job_count)
+        (*current_func)(index);
+}
+
+void ThreadPool::WorkerLoop() {
+    SetCurrentThreadName(name);
+
+    size_t last_generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_available.wait(
+                lock, [&] { return shutting_down || generation != last_generation; });
+            if (shutting_down)
+                return;
+            last_generation = generation;
+        }
+
+        RunJobs();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busy_workers == 0)
+            work_done.notify_one();
+    }
+}
+
+} // namespace Common
@@ -0,0 +1,66 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "common/common_types.h"
+
+namespace Common {
+
+/**
+ * A fixed-size pool of worker threads used to split data-parallel work into independent jobs.
+ * Work is always submitted from a single owner thread, which also takes part in processing the
+ * jobs and blocks until all of them have completed.
+ */
+class ThreadPool : NonCopyable {
+public:
+    /**
+     * Creates a pool of threads.
+     * @param num_threads Total number of threads that process jobs, including the calling thread.
+     *                    0 selects the number of hardware threads.
+     * @param name Name given to the worker threads, for debugging purposes.
+     */
+    explicit ThreadPool(size_t num_threads, const char* name = "WorkerThread");
+    ~ThreadPool();
+
+    /// Returns the number of threads (including the calling thread) that process jobs.
+    size_t GetThreadCount() const {
+        return workers.size() + 1;
+    }
+
+    /**
+     * Calls func(index) for every index in [0, count), spread across all threads of the pool.
+     * The order in which the jobs are processed is unspecified. Returns once every job completed.
+     */
+    void ParallelFor(size_t count, const std::function<void(size_t)>& func);
+
+private:
+    void WorkerLoop();
+    void RunJobs();
+
+    std::vector<std::thread> workers;
+    const char* name;
+
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable work_done;
+
+    const std::function<void(size_t)>* current_func = nullptr;
+    size_t job_count = 0;
+    std::atomic<size_t> next_job{0};
+    /// Number of workers that have not yet finished with the current generation of jobs
+    size_t busy_workers = 0;
+    /// Incremented every time a new set of jobs is submitted
+    size_t generation = 0;
+    bool shutting_down = false;
+};
+
+} // namespace Common
@@ -15,6 +15,7 @@
 #include "core/hle/kernel/kernel.h"
 #include "core/hle/kernel/thread.h"
 #include "core/hle/service/service.h"
+#include "core/hw/gpu.h"
 #include "core/hw/hw.h"
 #include "core/loader/loader.h"
 #include "core/memory_setup.h"
@@ -50,6 +51,8 @@ System::ResultStatus System::RunLoop(int tight_loop) {
     // instead advance to the next event and try to yield to the next thread
     if (Kernel::GetCurrentThread() == nullptr) {
         LOG_TRACE(Core_ARM11, "Idling");
+        // Threads may be waiting for interrupts raised by work still running on the GPU thread
+        GPU::Synchronize();
         CoreTiming::Idle();
         CoreTiming::Advance();
         PrepareReschedule();
@@ -180,6 +183,8 @@ void System::Shutdown() {
     // Shutdown emulation session
     GDBStub::Shutdown();
     AudioCore::Shutdown();
+    // GPU work that is still queued uses the renderer
+    GPU::Synchronize();
     VideoCore::Shutdown();
     Service::Shutdown();
     Kernel::Shutdown();
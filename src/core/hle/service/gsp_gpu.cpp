@@ -420,6 +420,11 @@ static void UnregisterInterruptRelayQueue(Interface* self) {
  * @todo This probably does not belong in the GSP module, instead move to video_core
  */
 void SignalInterrupt(InterruptId interrupt_id) {
+    // Interrupts raised by the GPU thread are delivered by the emulation thread, which owns the
+    // shared memory interrupt queue and the kernel state
+    if (GPU::DeferInterrupt(interrupt_id)) {
+        return;
+    }
     if (!gpu_right_acquired) {
         return;
     }
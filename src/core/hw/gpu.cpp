@@ -2,9 +2,16 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <array>
 #include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <numeric>
 #include <type_traits>
+#include <utility>
+#include <vector>
 #include "common/alignment.h"
 #include "common/color.h"
 #include "common/common_types.h"
@@ -14,13 +21,16 @@
 #include "core/core_timing.h"
 #include "core/hle/service/gsp_gpu.h"
 #include "core/hw/gpu.h"
+#include "core/hw/gpu_thread.h"
 #include "core/hw/hw.h"
 #include "core/memory.h"
 #include "core/tracer/recorder.h"
 #include "video_core/command_processor.h"
 #include "video_core/debug_utils/debug_utils.h"
+#include "video_core/morton.h"
 #include "video_core/rasterizer_interface.h"
 #include "video_core/renderer_base.h"
+#include "video_core/texture/texture_decode.h"
 #include "video_core/utils.h"
 #include "video_core/video_core.h"
 
@@ -33,8 +43,74 @@ const u64 frame_ticks = BASE_CLOCK_RATE_ARM11 / SCREEN_REFRESH_RATE;
 /// Event id for CoreTiming
 static int vblank_event;
 
+/// Runs GPU work while asynchronous GPU emulation is in use, created on first use
+static std::unique_ptr<GPUThread> gpu_thread;
+
+/// Interrupts raised on the GPU thread that the emulation thread has not delivered yet
+static std::vector<Service::GSP::InterruptId> pending_interrupts;
+static std::mutex pending_interrupts_mutex;
+
+static void DeliverPendingInterrupts() {
+    std::vector<Service::GSP::InterruptId> interrupts;
+    {
+        std::lock_guard<std::mutex> lock(pending_interrupts_mutex);
+        interrupts.swap(pending_interrupts);
+    }
+    for (Service::GSP::InterruptId interrupt_id : interrupts)
+        Service::GSP::SignalInterrupt(interrupt_id);
+}
+
+void Synchronize() {
+    if (gpu_thread == nullptr || gpu_thread->IsCurrentThread())
+        return;
+
+    gpu_thread->WaitIdle();
+    Memory::RasterizerApplyDeferredMarks();
+    if (VideoCore::g_renderer != nullptr)
+        VideoCore::g_renderer->Rasterizer()->NotifyGPUThreadIdle();
+    DeliverPendingInterrupts();
+}
+
+bool IsGPUThread() {
+    return gpu_thread != nullptr && gpu_thread->IsCurrentThread();
+}
+
+bool DeferInterrupt(Service::GSP::InterruptId interrupt_id) {
+    if (!IsGPUThread())
+        return false;
+
+    std::lock_guard<std::mutex> lock(pending_interrupts_mutex);
+    pending_interrupts.push_back(interrupt_id);
+    return true;
+}
+
+void Update() {
+    if (gpu_thread != nullptr)
+        DeliverPendingInterrupts();
+}
+
+/// Runs the given GPU work, on the GPU thread if asynchronous GPU emulation is usable
+static void RunGPUWork(std::function<void()> work) {
+    // The graphics debugger inspects the state while the work is running, and the OpenGL
+    // rasterizer can only be used on the emulation thread, which owns its context.
+    const bool use_gpu_thread = VideoCore::g_async_gpu_enabled && !Pica::g_debug_context &&
+                                VideoCore::g_renderer->Rasterizer()->SupportsGPUThread();
+    if (!use_gpu_thread) {
+        Synchronize();
+        work();
+        return;
+    }
+
+    if (gpu_thread == nullptr)
+        gpu_thread = std::make_unique<GPUThread>();
+    gpu_thread->Submit(std::move(work));
+}
+
 template <typename T>
 inline void Read(T& var, const u32 raw_addr) {
+    // Registers are updated by GPU work when it completes
+    Synchronize();
+
     u32 addr = raw_addr - HW::VADDR_GPU;
     u32 index = addr / 4;
 
@@ -47,32 +123,27 @@ inline void Read(T& var, const u32 raw_addr) {
     var = g_regs[addr / 4];
 }
 
-static Math::Vec4<u8> DecodePixel(Regs::PixelFormat input_format, const u8* src_pixel) {
-    switch (input_format) {
-    case Regs::PixelFormat::RGBA8:
-        return Color::DecodeRGBA8(src_pixel);
-
-    case Regs::PixelFormat::RGB8:
-        return Color::DecodeRGB8(src_pixel);
-
-    case Regs::PixelFormat::RGB565:
-        return Color::DecodeRGB565(src_pixel);
-
-    case Regs::PixelFormat::RGB5A1:
-        return Color::DecodeRGB5A1(src_pixel);
-
-    case Regs::PixelFormat::RGBA4:
-        return Color::DecodeRGBA4(src_pixel);
+MICROPROFILE_DEFINE(GPU_DisplayTransfer, "GPU", "DisplayTransfer", MP_RGB(100, 100, 255));
+MICROPROFILE_DEFINE(GPU_CmdlistProcessing, "GPU", "Cmdlist Processing", MP_RGB(100, 255, 100));
 
-    default:
-        LOG_ERROR(HW_GPU, "Unknown source framebuffer format %x", input_format);
-        return {0, 0, 0, 0};
+/// Fills size bytes at dest by repeating the pattern, which has to divide size
+static void FillPattern(u8* dest, size_t size, const void* pattern, size_t pattern_size) {
+    // Copy the pattern once and then repeat the filled part, doubling it each time until it reaches
+    // a block size that stays in cache, so that the fill runs at memcpy speed
+    constexpr size_t max_block_size = 4096;
+
+    size_t block_size = std::min(size, pattern_size);
+    std::memcpy(dest, pattern, block_size);
+    size_t filled = block_size;
+    while (filled < size) {
+        const size_t copy_size = std::min(block_size, size - filled);
+        std::memcpy(dest + filled, dest, copy_size);
+        filled += copy_size;
+        if (filled <= max_block_size)
+            block_size = filled;
     }
 }
 
-MICROPROFILE_DEFINE(GPU_DisplayTransfer, "GPU", "DisplayTransfer", MP_RGB(100, 100, 255));
-MICROPROFILE_DEFINE(GPU_CmdlistProcessing, "GPU", "Cmdlist Processing", MP_RGB(100, 255, 100));
-
 static void MemoryFill(const Regs::MemoryFillConfig& config) {
     const PAddr start_addr = config.GetStartAddress();
     const PAddr end_addr = config.GetEndAddress();
@@ -111,26 +182,242 @@ static void MemoryFill(const Regs::MemoryFillConfig& config) {
     Memory::RasterizerFlushAndInvalidateRegion(config.GetStartAddress(),
                                                config.GetEndAddress() - config.GetStartAddress());
 
+    PerformMemoryFill(config, start, end);
+}
+
+void PerformMemoryFill(const Regs::MemoryFillConfig& config, u8* start, u8* end) {
     if (config.fill_24bit) {
-        // fill with 24-bit values
-        for (u8* ptr = start; ptr < end; ptr += 3) {
-            ptr[0] = config.value_24bit_r;
-            ptr[1] = config.value_24bit_g;
-            ptr[2] = config.value_24bit_b;
-        }
+        // The last pixel is written in full even if it extends past the end address
+        const u8 value[3] = {static_cast<u8>(config.value_24bit_r),
+                             static_cast<u8>(config.value_24bit_g),
+                             static_cast<u8>(config.value_24bit_b)};
+        FillPattern(start, (end - start + 2) / 3 * 3, value, sizeof(value));
     } else if (config.fill_32bit) {
-        // fill with 32-bit values
-        if (end > start) {
-            u32 value = config.value_32bit;
-            size_t len = (end - start) / sizeof(u32);
-            for (size_t i = 0; i < len; ++i)
-                memcpy(&start[i * sizeof(u32)], &value, sizeof(u32));
-        }
+        const u32 value = config.value_32bit;
+        FillPattern(start, (end - start) / sizeof(u32) * sizeof(u32), &value, sizeof(value));
     } else {
-        // fill with 16-bit values
-        u16 value_16bit = config.value_16bit.Value();
-        for (u8* ptr = start; ptr < end; ptr += sizeof(u16))
-            memcpy(ptr, &value_16bit, sizeof(u16));
+        const u16 value = config.value_16bit.Value();
+        FillPattern(start, (end - start + 1) / sizeof(u16) * sizeof(u16), &value, sizeof(value));
+    }
+}
+
+using TextureFormat = Pica::TexturingRegs::TextureFormat;
+
+/**
+ * Decodes and encodes pixels in one of the framebuffer formats supported by display transfers.
+ * texture_format is the texture format with the same pixel layout.
+ */
+template <Regs::PixelFormat format>
+struct PixelCodec;
+
+template <>
+struct PixelCodec<Regs::PixelFormat::RGBA8> {
+    static constexpr u32 bytes_per_pixel = 4;
+    static constexpr TextureFormat texture_format = TextureFormat::RGBA8;
+    static Math::Vec4<u8> Decode(const u8* bytes) {
+        return Color::DecodeRGBA8(bytes);
+    }
+    static void Encode(const Math::Vec4<u8>& color, u8* bytes) {
+        Color::EncodeRGBA8(color, bytes);
+    }
+};
+
+template <>
+struct PixelCodec<Regs::PixelFormat::RGB8> {
+    static constexpr u32 bytes_per_pixel = 3;
+    static constexpr TextureFormat texture_format = TextureFormat::RGB8;
+    static Math::Vec4<u8> Decode(const u8* bytes) {
+        return Color::DecodeRGB8(bytes);
+    }
+    static void Encode(const Math::Vec4<u8>& color, u8* bytes) {
+        Color::EncodeRGB8(color, bytes);
+    }
+};
+
+template <>
+struct PixelCodec<Regs::PixelFormat::RGB565> {
+    static constexpr u32 bytes_per_pixel = 2;
+    static constexpr TextureFormat texture_format = TextureFormat::RGB565;
+    static Math::Vec4<u8> Decode(const u8* bytes) {
+        return Color::DecodeRGB565(bytes);
+    }
+    static void Encode(const Math::Vec4<u8>& color, u8* bytes) {
+        Color::EncodeRGB565(color, bytes);
+    }
+};
+
+template <>
+struct PixelCodec<Regs::PixelFormat::RGB5A1> {
+    static constexpr u32 bytes_per_pixel = 2;
+    static constexpr TextureFormat texture_format = TextureFormat::RGB5A1;
+    static Math::Vec4<u8> Decode(const u8* bytes) {
+        return Color::DecodeRGB5A1(bytes);
+    }
+    static void Encode(const Math::Vec4<u8>& color, u8* bytes) {
+        Color::EncodeRGB5A1(color, bytes);
+    }
+};
+
+template <>
+struct PixelCodec<Regs::PixelFormat::RGBA4> {
+    static constexpr u32 bytes_per_pixel = 2;
+    static constexpr TextureFormat texture_format = TextureFormat::RGBA4;
+    static Math::Vec4<u8> Decode(const u8* bytes) {
+        return Color::DecodeRGBA4(bytes);
+    }
+    static void Encode(const Math::Vec4<u8>& color, u8* bytes) {
+        Color::EncodeRGBA4(color, bytes);
+    }
+};
+
+/// Calls func with a PixelCodec object for the format, or logs an error if it is not supported
+template <typename Func>
+static void DispatchPixelFormat(Regs::PixelFormat format, Func&& func) {
+    switch (format) {
+    case Regs::PixelFormat::RGBA8:
+        return func(PixelCodec<Regs::PixelFormat::RGBA8>{});
+    case Regs::PixelFormat::RGB8:
+        return func(PixelCodec<Regs::PixelFormat::RGB8>{});
+    case Regs::PixelFormat::RGB565:
+        return func(PixelCodec<Regs::PixelFormat::RGB565>{});
+    case Regs::PixelFormat::RGB5A1:
+        return func(PixelCodec<Regs::PixelFormat::RGB5A1>{});
+    case Regs::PixelFormat::RGBA4:
+        return func(PixelCodec<Regs::PixelFormat::RGBA4>{});
+    default:
+        LOG_ERROR(HW_GPU, "Unknown framebuffer format %x", static_cast<u32>(format));
+    }
+}
+
+/**
+ * Where the pixels of a display transfer buffer are stored. The offset of a pixel is the sum of a
+ * part that only depends on its row and a part that only depends on its column. This also holds
+ * for tiled buffers, as the bits that the Morton order takes from x and y never overlap.
+ */
+struct BufferLayout {
+    bool tiled;
+    u32 width;
+    u32 bytes_per_pixel;
+
+    u32 RowOffset(u32 y) const {
+        if (!tiled)
+            return y * width * bytes_per_pixel;
+        return (VideoCore::MortonInterleave(0, y) + (y & ~7) * width) * bytes_per_pixel;
+    }
+
+    u32 ColumnOffset(u32 x) const {
+        if (!tiled)
+            return x * bytes_per_pixel;
+        return (VideoCore::MortonInterleave(x, 0) + (x & ~7) * 8) * bytes_per_pixel;
+    }
+
+    /// Returns the column offsets of the first count columns
+    std::vector<u32> ColumnOffsets(u32 count) const {
+        std::vector<u32> offsets(count);
+        for (u32 x = 0; x < count; ++x)
+            offsets[x] = ColumnOffset(x);
+        return offsets;
+    }
+};
+
+struct DisplayTransferParams {
+    const u8* src;
+    u8* dst;
+    BufferLayout src_layout;
+    BufferLayout dst_layout;
+    /// Size of the output image, after scaling
+    u32 output_width;
+    u32 output_height;
+    bool flip_vertically;
+
+    /// Returns the offset of the output row that receives the given row of the image
+    u32 DestinationRowOffset(u32 y) const {
+        return dst_layout.RowOffset(flip_vertically ? output_height - y - 1 : y);
+    }
+};
+
+/// Copies the pixels of a transfer that neither converts, scales nor swizzles them
+template <u32 bytes_per_pixel>
+static void CopyPixels(const DisplayTransferParams& params) {
+    const bool contiguous_rows = !params.src_layout.tiled && !params.dst_layout.tiled;
+    const std::vector<u32> src_columns = params.src_layout.ColumnOffsets(params.output_width);
+    const std::vector<u32> dst_columns = params.dst_layout.ColumnOffsets(params.output_width);
+
+    for (u32 y = 0; y < params.output_height; ++y) {
+        const u8* src_row = params.src + params.src_layout.RowOffset(y);
+        u8* dst_row = params.dst + params.DestinationRowOffset(y);
+
+        if (contiguous_rows) {
+            std::memcpy(dst_row, src_row, params.output_width * bytes_per_pixel);
+            continue;
+        }
+
+        for (u32 x = 0; x < params.output_width; ++x)
+            std::memcpy(dst_row + dst_columns[x], src_row + src_columns[x], bytes_per_pixel);
+    }
+}
+
+/// Converts the pixels of a transfer from a linear input image, which is never scaled
+template <typename InputCodec, typename OutputCodec>
+static void ConvertLinearPixels(const DisplayTransferParams& params) {
+    const std::vector<u32> dst_columns = params.dst_layout.ColumnOffsets(params.output_width);
+
+    for (u32 y = 0; y < params.output_height; ++y) {
+        const u8* src_pixel = params.src + params.src_layout.RowOffset(y);
+        u8* dst_row = params.dst + params.DestinationRowOffset(y);
+
+        for (u32 x = 0; x < params.output_width; ++x, src_pixel += InputCodec::bytes_per_pixel)
+            OutputCodec::Encode(InputCodec::Decode(src_pixel), dst_row + dst_columns[x]);
+    }
+}
+
+/**
+ * Averages the input pixels that make up one output pixel.
+ * @param texel Decoded pixel at the input position in a tile of 8x8 decoded pixels. The other
+ *              pixels are taken from its right and from the row above it, which is where the
+ *              following pixels in Morton order are.
+ */
+template <u32 horizontal_scale, u32 vertical_scale>
+static Math::Vec4<u8> SampleTile(const Math::Vec4<u8>* texel) {
+    if (horizontal_scale == 0)
+        return texel[0];
+    if (vertical_scale == 0)
+        return ((texel[0] + texel[1]) / 2).Cast<u8>();
+    return (((texel[0] + texel[1]) + (texel[8] + texel[9])) / 4).Cast<u8>();
+}
+
+/**
+ * Converts the pixels of a transfer from a tiled input image one 8x8 tile at a time. Each tile is
+ * decoded at once by the texture tile decoders, which use vector instructions when available.
+ */
+template <typename OutputCodec, u32 horizontal_scale, u32 vertical_scale>
+static void ConvertTiledPixels(const DisplayTransferParams& params, TextureFormat input_format) {
+    const std::vector<u32> dst_columns = params.dst_layout.ColumnOffsets(params.output_width);
+    const u32 input_width = params.output_width << horizontal_scale;
+    const u32 input_height = params.output_height << vertical_scale;
+    const u32 tile_size = 64 * params.src_layout.bytes_per_pixel;
+
+    std::array<Math::Vec4<u8>, 64> texels;
+    for (u32 tile_y = 0; tile_y < input_height; tile_y += 8) {
+        const u8* src_tile = params.src + params.src_layout.RowOffset(tile_y);
+        const u32 tile_height = std::min(input_height - tile_y, 8u);
+
+        for (u32 tile_x = 0; tile_x < input_width; tile_x += 8, src_tile += tile_size) {
+            Pica::Texture::DecodeTile8x8(input_format, src_tile, texels.data());
+            const u32 tile_width = std::min(input_width - tile_x, 8u);
+
+            for (u32 y = 0; y < tile_height; y += 1 << vertical_scale) {
+                const u32 output_y = (tile_y + y) >> vertical_scale;
+                u8* dst_row = params.dst + params.DestinationRowOffset(output_y);
+                const u32* dst_column = &dst_columns[tile_x >> horizontal_scale];
+
+                for (u32 x = 0; x < tile_width; x += 1 << horizontal_scale, ++dst_column) {
+                    OutputCodec::Encode(
+                        SampleTile<horizontal_scale, vertical_scale>(&texels[x + y * 8]),
+                        dst_row + *dst_column);
+                }
+            }
+        }
     }
 }
 
@@ -201,112 +488,88 @@ static void DisplayTransfer(const Regs::DisplayTransferConfig& config) {
     Memory::RasterizerFlushRegion(config.GetPhysicalInputAddress(), input_size);
     Memory::RasterizerFlushAndInvalidateRegion(config.GetPhysicalOutputAddress(), output_size);
 
-    for (u32 y = 0; y < output_height; ++y) {
-        for (u32 x = 0; x < output_width; ++x) {
-            Math::Vec4<u8> src_color;
-
-            // Calculate the [x,y] position of the input image
-            // based on the current output position and the scale
-            u32 input_x = x << horizontal_scale;
-            u32 input_y = y << vertical_scale;
-
-            u32 output_y;
-            if (config.flip_vertically) {
-                // Flip the y value of the output data,
-                // we do this after calculating the [x,y] position of the input image
-                // to account for the scaling options.
-                output_y = output_height - y - 1;
-            } else {
-                output_y = y;
-            }
-
-            u32 dst_bytes_per_pixel = GPU::Regs::BytesPerPixel(config.output_format);
-            u32 src_bytes_per_pixel = GPU::Regs::BytesPerPixel(config.input_format);
-            u32 src_offset;
-            u32 dst_offset;
-
-            if (config.input_linear) {
-                if (!config.dont_swizzle) {
-                    // Interpret the input as linear and the output as tiled
-                    u32 coarse_y = output_y & ~7;
-                    u32 stride = output_width * dst_bytes_per_pixel;
-
-                    src_offset = (input_x + input_y * config.input_width) * src_bytes_per_pixel;
-                    dst_offset = VideoCore::GetMortonOffset(x, output_y, dst_bytes_per_pixel) +
-                                 coarse_y * stride;
-                } else {
-                    // Both input and output are linear
-                    src_offset = (input_x + input_y * config.input_width) * src_bytes_per_pixel;
-                    dst_offset = (x + output_y * output_width) * dst_bytes_per_pixel;
-                }
-            } else {
-                if (!config.dont_swizzle) {
-                    // Interpret the input as tiled and the output as linear
-                    u32 coarse_y = input_y & ~7;
-                    u32 stride = config.input_width * src_bytes_per_pixel;
-
-                    src_offset = VideoCore::GetMortonOffset(input_x, input_y, src_bytes_per_pixel) +
-                                 coarse_y * stride;
-                    dst_offset = (x + output_y * output_width) * dst_bytes_per_pixel;
-                } else {
-                    // Both input and output are tiled
-                    u32 out_coarse_y = output_y & ~7;
-                    u32 out_stride = output_width * dst_bytes_per_pixel;
-
-                    u32 in_coarse_y = input_y & ~7;
-                    u32 in_stride = config.input_width * src_bytes_per_pixel;
-
-                    src_offset = VideoCore::GetMortonOffset(input_x, input_y, src_bytes_per_pixel) +
-                                 in_coarse_y * in_stride;
-                    dst_offset = VideoCore::GetMortonOffset(x, output_y, dst_bytes_per_pixel) +
-                                 out_coarse_y * out_stride;
-                }
-            }
-
-            const u8* src_pixel = src_pointer + src_offset;
-            src_color = DecodePixel(config.input_format, src_pixel);
-            if (config.scaling == config.ScaleX) {
-                Math::Vec4<u8> pixel =
-                    DecodePixel(config.input_format, src_pixel + src_bytes_per_pixel);
-                src_color = ((src_color + pixel) / 2).Cast<u8>();
-            } else if (config.scaling == config.ScaleXY) {
-                Math::Vec4<u8> pixel1 =
-                    DecodePixel(config.input_format, src_pixel + 1 * src_bytes_per_pixel);
-                Math::Vec4<u8> pixel2 =
-                    DecodePixel(config.input_format, src_pixel + 2 * src_bytes_per_pixel);
-                Math::Vec4<u8> pixel3 =
-                    DecodePixel(config.input_format, src_pixel + 3 * src_bytes_per_pixel);
-                src_color = (((src_color + pixel1) + (pixel2 + pixel3)) / 4).Cast<u8>();
-            }
-
-            u8* dst_pixel = dst_pointer + dst_offset;
-            switch (config.output_format) {
-            case Regs::PixelFormat::RGBA8:
-                Color::EncodeRGBA8(src_color, dst_pixel);
-                break;
-
-            case Regs::PixelFormat::RGB8:
-                Color::EncodeRGB8(src_color, dst_pixel);
-                break;
-
-            case Regs::PixelFormat::RGB565:
-                Color::EncodeRGB565(src_color, dst_pixel);
-                break;
-
-            case Regs::PixelFormat::RGB5A1:
-                Color::EncodeRGB5A1(src_color, dst_pixel);
-                break;
-
-            case Regs::PixelFormat::RGBA4:
-                Color::EncodeRGBA4(src_color, dst_pixel);
-                break;
+    PerformDisplayTransfer(config, src_pointer, dst_pointer);
+}
 
-            default:
-                LOG_ERROR(HW_GPU, "Unknown destination framebuffer format %x",
-                          config.output_format.Value());
-                break;
-            }
+void PerformDisplayTransfer(const Regs::DisplayTransferConfig& config, const u8* src_pointer,
+                            u8* dst_pointer) {
+    const u32 horizontal_scale = config.scaling != config.NoScale ? 1 : 0;
+    const u32 vertical_scale = config.scaling == config.ScaleXY ? 1 : 0;
+    const u32 output_width = config.output_width >> horizontal_scale;
+    const u32 output_height = config.output_height >> vertical_scale;
+
+    DisplayTransferParams params;
+    params.src = src_pointer;
+    params.dst = dst_pointer;
+    // Unless dont_swizzle is set, the transfer converts between the tiled and the linear layout
+    const bool input_tiled = !config.input_linear;
+    const bool output_tiled = config.dont_swizzle ? input_tiled : !input_tiled;
+    params.src_layout = {input_tiled, config.input_width,
+                         static_cast<u32>(GPU::Regs::BytesPerPixel(config.input_format))};
+    params.dst_layout = {output_tiled, output_width,
+                         static_cast<u32>(GPU::Regs::BytesPerPixel(config.output_format))};
+    params.output_width = output_width;
+    params.output_height = output_height;
+    params.flip_vertically = config.flip_vertically != 0;
+
+    // Each combination of formats and scaling has its own loop, so that no per-pixel decisions are
+    // left to make
+    const bool plain_copy =
+        config.input_format == config.output_format && config.scaling == config.NoScale;
+    if (plain_copy && input_tiled != output_tiled) {
+        // Only swizzles or unswizzles the pixels
+        const BufferLayout& tiled_layout = input_tiled ? params.src_layout : params.dst_layout;
+        const BufferLayout& linear_layout = input_tiled ? params.dst_layout : params.src_layout;
+        VideoCore::MortonCopyInfo copy_info;
+        copy_info.width = output_width;
+        copy_info.height = output_height;
+        copy_info.bytes_per_pixel = tiled_layout.bytes_per_pixel;
+        copy_info.morton_stride = 8 * tiled_layout.width * tiled_layout.bytes_per_pixel;
+        copy_info.linear_pixel_stride = linear_layout.bytes_per_pixel;
+        copy_info.linear_stride = linear_layout.width * linear_layout.bytes_per_pixel;
+        copy_info.flip_vertically = params.flip_vertically;
+        if (input_tiled) {
+            VideoCore::MortonToLinear(copy_info, src_pointer, dst_pointer);
+        } else {
+            VideoCore::LinearToMorton(copy_info, dst_pointer, src_pointer);
         }
+    } else if (plain_copy) {
+        switch (params.src_layout.bytes_per_pixel) {
+        case 2:
+            CopyPixels<2>(params);
+            break;
+        case 3:
+            CopyPixels<3>(params);
+            break;
+        case 4:
+            CopyPixels<4>(params);
+            break;
+        }
+    } else if (input_tiled) {
+        const auto scaling = config.scaling.Value();
+        DispatchPixelFormat(config.input_format, [&](auto input_codec) {
+            const TextureFormat input_format = decltype(input_codec)::texture_format;
+            DispatchPixelFormat(config.output_format, [&](auto output_codec) {
+                using OutputCodec = decltype(output_codec);
+                switch (scaling) {
+                case Regs::DisplayTransferConfig::NoScale:
+                    ConvertTiledPixels<OutputCodec, 0, 0>(params, input_format);
+                    break;
+                case Regs::DisplayTransferConfig::ScaleX:
+                    ConvertTiledPixels<OutputCodec, 1, 0>(params, input_format);
+                    break;
+                case Regs::DisplayTransferConfig::ScaleXY:
+                    ConvertTiledPixels<OutputCodec, 1, 1>(params, input_format);
+                    break;
+                }
+            });
+        });
+    } else {
+        DispatchPixelFormat(config.input_format, [&](auto input_codec) {
+            DispatchPixelFormat(config.output_format, [&](auto output_codec) {
+                ConvertLinearPixels<decltype(input_codec), decltype(output_codec)>(params);
+            });
+        });
     }
 }
 
@@ -412,19 +675,22 @@ inline void Write(u32 addr, const T data) {
         auto& config = g_regs.memory_fill_config[is_second_filler];
 
         if (config.trigger) {
-            MemoryFill(config);
-            LOG_TRACE(HW_GPU, "MemoryFill from 0x%08x to 0x%08x", config.GetStartAddress(),
-                      config.GetEndAddress());
-
-            // It seems that it won't signal interrupt if "address_start" is zero.
-            // TODO: hwtest this
-            if (config.GetStartAddress() != 0) {
-                if (!is_second_filler) {
-                    Service::GSP::SignalInterrupt(Service::GSP::InterruptId::PSC0);
-                } else {
-                    Service::GSP::SignalInterrupt(Service::GSP::InterruptId::PSC1);
+            const Regs::MemoryFillConfig fill_config = config;
+            RunGPUWork([fill_config, is_second_filler] {
+                MemoryFill(fill_config);
+                LOG_TRACE(HW_GPU, "MemoryFill from 0x%08x to 0x%08x",
+                          fill_config.GetStartAddress(), fill_config.GetEndAddress());
+
+                // It seems that it won't signal interrupt if "address_start" is zero.
+                // TODO: hwtest this
+                if (fill_config.GetStartAddress() != 0) {
+                    if (!is_second_filler) {
+                        Service::GSP::SignalInterrupt(Service::GSP::InterruptId::PSC0);
+                    } else {
+                        Service::GSP::SignalInterrupt(Service::GSP::InterruptId::PSC1);
+                    }
                 }
-            }
+            });
 
             // Reset "trigger" flag and set the "finish" flag
             // NOTE: This was confirmed to happen on hardware even if "address_start" is zero.
@@ -435,8 +701,6 @@ inline void Write(u32 addr, const T data) {
     }
 
     case GPU_REG_INDEX(display_transfer_config.trigger): {
-        MICROPROFILE_SCOPE(GPU_DisplayTransfer);
-
         const auto& config = g_regs.display_transfer_config;
         if (config.trigger & 1) {
 
@@ -444,26 +708,35 @@ inline void Write(u32 addr, const T data) {
                 Pica::g_debug_context->OnEvent(Pica::DebugContext::Event::IncomingDisplayTransfer,
                                                nullptr);
 
-            if (config.is_texture_copy) {
-                TextureCopy(config);
-                LOG_TRACE(HW_GPU, "TextureCopy: 0x%X bytes from 0x%08X(%u+%u)-> "
-                                  "0x%08X(%u+%u), flags 0x%08X",
-                          config.texture_copy.size, config.GetPhysicalInputAddress(),
-                          config.texture_copy.input_width * 16, config.texture_copy.input_gap * 16,
-                          config.GetPhysicalOutputAddress(), config.texture_copy.output_width * 16,
-                          config.texture_copy.output_gap * 16, config.flags);
-            } else {
-                DisplayTransfer(config);
-                LOG_TRACE(HW_GPU, "DisplayTransfer: 0x%08x(%ux%u)-> "
-                                  "0x%08x(%ux%u), dst format %x, flags 0x%08X",
-                          config.GetPhysicalInputAddress(), config.input_width.Value(),
-                          config.input_height.Value(), config.GetPhysicalOutputAddress(),
-                          config.output_width.Value(), config.output_height.Value(),
-                          config.output_format.Value(), config.flags);
-            }
+            const Regs::DisplayTransferConfig transfer_config = config;
+            RunGPUWork([transfer_config] {
+                MICROPROFILE_SCOPE(GPU_DisplayTransfer);
+                const auto& config = transfer_config;
+
+                if (config.is_texture_copy) {
+                    TextureCopy(config);
+                    LOG_TRACE(HW_GPU, "TextureCopy: 0x%X bytes from 0x%08X(%u+%u)-> "
+                                      "0x%08X(%u+%u), flags 0x%08X",
+                              config.texture_copy.size, config.GetPhysicalInputAddress(),
+                              config.texture_copy.input_width * 16,
+                              config.texture_copy.input_gap * 16,
+                              config.GetPhysicalOutputAddress(),
+                              config.texture_copy.output_width * 16,
+                              config.texture_copy.output_gap * 16, config.flags);
+                } else {
+                    DisplayTransfer(config);
+                    LOG_TRACE(HW_GPU, "DisplayTransfer: 0x%08x(%ux%u)-> "
+                                      "0x%08x(%ux%u), dst format %x, flags 0x%08X",
+                              config.GetPhysicalInputAddress(), config.input_width.Value(),
+                              config.input_height.Value(), config.GetPhysicalOutputAddress(),
+                              config.output_width.Value(), config.output_height.Value(),
+                              config.output_format.Value(), config.flags);
+                }
+
+                Service::GSP::SignalInterrupt(Service::GSP::InterruptId::PPF);
+            });
 
             g_regs.display_transfer_config.trigger = 0;
-            Service::GSP::SignalInterrupt(Service::GSP::InterruptId::PPF);
         }
         break;
     }
@@ -472,8 +745,6 @@ inline void Write(u32 addr, const T data) {
     case GPU_REG_INDEX(command_processor_config.trigger): {
         const auto& config = g_regs.command_processor_config;
         if (config.trigger & 1) {
-            MICROPROFILE_SCOPE(GPU_CmdlistProcessing);
-
             u32* buffer = (u32*)Memory::GetPhysicalPointer(config.GetPhysicalAddress());
 
             if (Pica::g_debug_context && Pica::g_debug_context->recorder) {
@@ -481,7 +752,12 @@ inline void Write(u32 addr, const T data) {
                                                                 config.GetPhysicalAddress());
             }
 
-            Pica::CommandProcessor::ProcessCommandList(buffer, config.size);
+            const PAddr address = config.GetPhysicalAddress();
+            const u32 size = config.size;
+            RunGPUWork([address, size] {
+                MICROPROFILE_SCOPE(GPU_CmdlistProcessing);
+                Pica::CommandProcessor::ProcessCommandList(address, size);
+            });
 
             g_regs.command_processor_config.trigger = 0;
         }
@@ -515,6 +791,8 @@ template void Write<u8>(u32 addr, const u8 data);
 
 /// Update hardware
 static void VBlankCallback(u64 userdata, int cycles_late) {
+    // Present the frame once all work submitted before the VBlank has finished
+    Synchronize();
     VideoCore::g_renderer->SwapBuffers();
 
     // Signal to GSP that GPU interrupt has occurred
@@ -567,6 +845,9 @@ void Init() {
 
 /// Shutdown hardware
 void Shutdown() {
+    gpu_thread.reset();
+    pending_interrupts.clear();
+
     LOG_DEBUG(HW_GPU, "shutdown OK");
 }
 
@@ -11,6 +11,12 @@
 #include "common/common_funcs.h"
 #include "common/common_types.h"
 
+namespace Service {
+namespace GSP {
+enum class InterruptId : u8;
+}
+}
+
 namespace GPU {
 
 constexpr float SCREEN_REFRESH_RATE = 60;
@@ -325,6 +331,38 @@ void Read(T& var, const u32 addr);
 template <typename T>
 void Write(u32 addr, const T data);
 
+/**
+ * Waits until the GPU thread has completed all submitted work, applies the changes to the page
+ * table it deferred and delivers the interrupts it raised. This has to be called before the
+ * emulation thread observes the results of GPU work. Has no effect when called on the GPU thread.
+ */
+void Synchronize();
+
+/// Returns whether the calling thread is the GPU thread, which runs asynchronous GPU work
+bool IsGPUThread();
+
+/**
+ * Holds back an interrupt raised on the GPU thread until the emulation thread delivers it.
+ * @return Whether the interrupt was deferred, false if the caller is not the GPU thread
+ */
+bool DeferInterrupt(Service::GSP::InterruptId interrupt_id);
+
+/// Delivers the interrupts raised by GPU work that has completed so far, without waiting
+void Update();
+
+/**
+ * Fills the memory from start to end as configured, without going through the rasterizer.
+ * @note Exposed for testing, the configured addresses are not used
+ */
+void PerformMemoryFill(const Regs::MemoryFillConfig& config, u8* start, u8* end);
+
+/**
+ * Transfers the pixels of a display transfer from src to dst, without going through the
+ * rasterizer. The configuration has to be one that DisplayTransfer accepts.
+ * @note Exposed for testing, the configured addresses are not used
+ */
+void PerformDisplayTransfer(const Regs::DisplayTransferConfig& config, const u8* src, u8* dst);
+
 /// Initialize hardware
 void Init();
 
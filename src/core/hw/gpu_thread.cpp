@@ -0,0 +1,79 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <utility>
+#include "common/microprofile.h"
+#include "common/thread.h"
+#include "core/hw/gpu_thread.h"
+
+namespace GPU {
+
+MICROPROFILE_DEFINE(GPU_ThreadWait, "GPU", "Wait For GPU Thread", MP_RGB(255, 100, 100));
+
+GPUThread::GPUThread() : thread(&GPUThread::ThreadLoop, this) {}
+
+GPUThread::~GPUThread() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        shutting_down = true;
+    }
+    work_available.notify_one();
+    thread.join();
+}
+
+void GPUThread::Submit(std::function<void()> work) {
+    queue.Push(std::move(work));
+    ++submitted;
+
+    // Pairs with the fence in ThreadLoop: either the GPU thread sees the new work when checking
+    // the queue a last time, or this sees that it is going to sleep and wakes it up.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_for_work.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(mutex);
+        work_available.notify_one();
+    }
+}
+
+void GPUThread::WaitIdle() {
+    if (completed.load(std::memory_order_acquire) == submitted)
+        return;
+
+    MICROPROFILE_SCOPE(GPU_ThreadWait);
+    std::unique_lock<std::mutex> lock(mutex);
+    waiting_for_idle.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    work_done.wait(lock, [this] { return completed.load(std::memory_order_acquire) == submitted; });
+    waiting_for_idle.store(false, std::memory_order_relaxed);
+}
+
+void GPUThread::ThreadLoop() {
+    Common::SetCurrentThreadName("GPU");
+
+    std::function<void()> work;
+    while (true) {
+        while (queue.Pop(work)) {
+            work();
+            work = nullptr;
+
+            completed.fetch_add(1, std::memory_order_release);
+            // Pairs with the fence in WaitIdle, as with waiting_for_work in Submit
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (waiting_for_idle.load(std::memory_order_relaxed)) {
+                std::lock_guard<std::mutex> lock(mutex);
+                work_done.notify_all();
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        waiting_for_work.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        work_available.wait(lock, [this] { return shutting_down || !queue.Empty(); });
+        waiting_for_work.store(false, std::memory_order_relaxed);
+        // Work submitted before shutting down is still run
+        if (shutting_down && queue.Empty())
+            return;
+    }
+}
+
+} // namespace GPU
@@ -0,0 +1,63 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "common/common_types.h"
+#include "common/spsc_queue.h"
+
+namespace GPU {
+
+/**
+ * Runs GPU work (command lists, memory fills and display transfers) submitted by the emulation
+ * thread on a dedicated thread, in submission order, so that CPU and GPU emulation overlap.
+ */
+class GPUThread : NonCopyable {
+public:
+    GPUThread();
+
+    /// Finishes all submitted work before stopping the thread
+    ~GPUThread();
+
+    /// Queues work to run on the GPU thread. May only be called from the emulation thread.
+    void Submit(std::function<void()> work);
+
+    /// Blocks until all submitted work has completed
+    void WaitIdle();
+
+    /// Returns whether the calling thread is the GPU thread
+    bool IsCurrentThread() const {
+        return std::this_thread::get_id() == thread.get_id();
+    }
+
+private:
+    void ThreadLoop();
+
+    Common::SPSCQueue<std::function<void()>> queue;
+
+    /// Number of work items submitted, only accessed by the emulation thread
+    u64 submitted = 0;
+    /// Number of work items completed, written by the GPU thread
+    std::atomic<u64> completed{0};
+
+    // The threads only take the mutex to go to sleep and to wake each other up. Whether the GPU
+    // thread is waiting for work, or the emulation thread for the work to complete, is published
+    // before the sleeping thread checks the queue or the counters a last time. The other thread
+    // checks these flags after pushing work or completing it, and only then takes the mutex.
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable work_done;
+    std::atomic<bool> waiting_for_work{false};
+    std::atomic<bool> waiting_for_idle{false};
+    std::atomic<bool> shutting_down{false};
+
+    std::thread thread;
+};
+
+} // namespace GPU
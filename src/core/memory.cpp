@@ -4,14 +4,17 @@
 
 #include <array>
 #include <cstring>
+#include <vector>
 #include "common/assert.h"
 #include "common/common_types.h"
 #include "common/logging/log.h"
 #include "common/swap.h"
 #include "core/hle/kernel/process.h"
+#include "core/hw/gpu.h"
 #include "core/memory.h"
 #include "core/memory_setup.h"
 #include "core/mmio.h"
+#include "video_core/command_processor.h"
 #include "video_core/renderer_base.h"
 #include "video_core/video_core.h"
 
@@ -304,11 +307,26 @@ u8* GetPhysicalPointer(PAddr address) {
     return vaddr ? GetPointer(*vaddr) : nullptr;
 }
 
+/// A call to RasterizerMarkRegionCached made on the GPU thread
+struct DeferredMark {
+    PAddr start;
+    u32 size;
+    int count_delta;
+};
+
+/// Only accessed by the GPU thread while it runs, and by the emulation thread while it is idle
+static std::vector<DeferredMark> deferred_marks;
+
 void RasterizerMarkRegionCached(PAddr start, u32 size, int count_delta) {
     if (start == 0) {
         return;
     }
 
+    if (GPU::IsGPUThread()) {
+        deferred_marks.push_back({start, size, count_delta});
+        return;
+    }
+
     u32 num_pages = ((start + size - 1) >> PAGE_BITS) - (start >> PAGE_BITS) + 1;
     PAddr paddr = start;
 
@@ -368,21 +386,34 @@ void RasterizerMarkRegionCached(PAddr start, u32 size, int count_delta) {
     }
 }
 
+void RasterizerApplyDeferredMarks() {
+    for (const DeferredMark& mark : deferred_marks)
+        RasterizerMarkRegionCached(mark.start, mark.size, mark.count_delta);
+    deferred_marks.clear();
+}
+
 void RasterizerFlushRegion(PAddr start, u32 size) {
+    // GPU work that is still running may write to the region
+    GPU::Synchronize();
     if (VideoCore::g_renderer != nullptr) {
         VideoCore::g_renderer->Rasterizer()->FlushRegion(start, size);
     }
 }
 
 void RasterizerFlushAndInvalidateRegion(PAddr start, u32 size) {
+    GPU::Synchronize();
+
     // Since pages are unmapped on shutdown after video core is shutdown, the renderer may be
     // null here
     if (VideoCore::g_renderer != nullptr) {
         VideoCore::g_renderer->Rasterizer()->FlushAndInvalidateRegion(start, size);
+        Pica::CommandProcessor::InvalidateRegion(start, size);
     }
 }
 
 void RasterizerFlushVirtualRegion(VAddr start, u32 size, FlushMode mode) {
+    GPU::Synchronize();
+
     // Since pages are unmapped on shutdown after video core is shutdown, the renderer may be
     // null here
     if (VideoCore::g_renderer != nullptr) {
@@ -407,6 +438,7 @@ void RasterizerFlushVirtualRegion(VAddr start, u32 size, FlushMode mode) {
                 break;
             case FlushMode::FlushAndInvalidate:
                 rasterizer->FlushAndInvalidateRegion(physical_start, overlap_size);
+                Pica::CommandProcessor::InvalidateRegion(physical_start, overlap_size);
                 break;
             }
         };
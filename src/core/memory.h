@@ -176,10 +176,17 @@ u8* GetPhysicalPointer(PAddr address);
 
 /**
  * Adds the supplied value to the rasterizer resource cache counter of each
- * page touching the region.
+ * page touching the region. When called on the GPU thread, the change is deferred until
+ * RasterizerApplyDeferredMarks, as the emulation thread may be using the page table.
  */
 void RasterizerMarkRegionCached(PAddr start, u32 size, int count_delta);
 
+/**
+ * Applies the changes of RasterizerMarkRegionCached deferred by the GPU thread, in the order they
+ * were requested. Must be called on the emulation thread while the GPU thread is idle.
+ */
+void RasterizerApplyDeferredMarks();
+
 /**
  * Flushes any externally cached rasterizer resources touching the given region.
  */
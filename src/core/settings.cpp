@@ -22,6 +22,9 @@ void Apply() {
 
     VideoCore::g_hw_renderer_enabled = values.use_hw_renderer;
     VideoCore::g_shader_jit_enabled = values.use_shader_jit;
+    VideoCore::g_async_shader_jit_enabled = values.use_async_shader_jit;
+    VideoCore::g_async_gpu_enabled = values.use_async_gpu;
+    VideoCore::g_fragment_jit_enabled = values.use_fragment_jit;
     VideoCore::g_toggle_framelimit_enabled = values.toggle_framelimit;
 
     if (VideoCore::g_emu_window) {
@@ -92,6 +92,14 @@ struct Values {
     // Renderer
     bool use_hw_renderer;
     bool use_shader_jit;
+    bool use_async_shader_jit;
+    int shader_jit_cache_size;
+    int sw_rasterizer_threads;
+    bool use_async_gpu;
+    int vertex_shader_threads;
+    int vertex_shader_parallel_threshold;
+    int texture_decode_threads;
+    bool use_fragment_jit;
     float resolution_factor;
     bool use_vsync;
     bool toggle_framelimit;
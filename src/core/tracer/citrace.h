@@ -17,8 +17,12 @@ struct CTHeader {
         return "CiTr";
     }
 
+    /**
+     * Version written by the recorder. Version 1 files, which store the stream uncompressed and
+     * refer to memory data by file offset, can still be read.
+     */
     static u32 ExpectedVersion() {
-        return 1;
+        return 2;
     }
 
     char magic[4];
@@ -56,23 +60,44 @@ struct CTHeader {
         // - Lookup tables for procedural textures
     } initial_state_offsets;
 
+    // Version 1: Offset of the stream elements and their number
+    // Version 2: Offset of the first chunk and the number of chunks, updated after every chunk
     u32 stream_offset;
     u32 stream_size;
 };
 
+/**
+ * Since version 2, the stream is written as consecutive zlib-compressed chunks, each prefixed by
+ * this header. The uncompressed data of a chunk is a sequence of stream elements, where
+ * MemoryPage elements are directly followed by the page data.
+ */
+struct CTChunkHeader {
+    u32 compressed_size;
+    u32 uncompressed_size;
+};
+
 enum CTStreamElementType : u32 {
     FrameMarker = 0xE1,
     MemoryLoad = 0xE2,
     RegisterWrite = 0xE3,
+    MemoryPage = 0xE4, // Version 2 only
 };
 
 struct CTMemoryLoad {
+    // Version 1: Offset of the data in the file
+    // Version 2: Index of the MemoryPage holding the data, counting from the start of the stream
     u32 file_offset;
     u32 size;
     u32 physical_address;
     u32 pad;
 };
 
+/// Data of at most one page of memory, loads that refer to it never cross a page boundary
+struct CTMemoryPage {
+    u32 size;
+    u32 pad[3];
+};
+
 struct CTRegisterWrite {
     u32 physical_address;
 
@@ -93,6 +118,7 @@ struct CTStreamElement {
     union {
         CTMemoryLoad memory_load;
         CTRegisterWrite register_write;
+        CTMemoryPage memory_page;
     };
 };
 
@@ -0,0 +1,311 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <cryptopp/zlib.h>
+#include "common/file_util.h"
+#include "common/logging/log.h"
+#include "core/hw/gpu.h"
+#include "core/hw/hw.h"
+#include "core/hw/lcd.h"
+#include "core/memory.h"
+#include "core/tracer/player.h"
+#include "video_core/command_processor.h"
+#include "video_core/pica.h"
+#include "video_core/pica_state.h"
+#include "video_core/pica_types.h"
+
+namespace CiTrace {
+
+Player::Player(const std::string& filename) {
+    FileUtil::IOFile file(filename, "rb");
+    if (!file.IsOpen()) {
+        LOG_ERROR(HW_GPU, "Could not open CiTrace file %s", filename.c_str());
+        return;
+    }
+
+    data.resize(file.GetSize());
+    if (data.size() < sizeof(CTHeader) || !file.ReadBytes(data.data(), data.size())) {
+        LOG_ERROR(HW_GPU, "Could not read CiTrace file %s", filename.c_str());
+        return;
+    }
+
+    std::memcpy(&header, data.data(), sizeof(CTHeader));
+    if (std::memcmp(header.magic, CTHeader::ExpectedMagicWord(), 4) != 0 || header.version < 1 ||
+        header.version > CTHeader::ExpectedVersion()) {
+        LOG_ERROR(HW_GPU, "%s is not a CiTrace file of a supported version", filename.c_str());
+        return;
+    }
+
+    // Offsets and sizes of all data the header refers to, in bytes
+    const auto& initial = header.initial_state_offsets;
+    const std::pair<u64, u64> ranges[] = {
+        {initial.gpu_registers, initial.gpu_registers_size * 4ull},
+        {initial.lcd_registers, initial.lcd_registers_size * 4ull},
+        {initial.pica_registers, initial.pica_registers_size * 4ull},
+        {initial.default_attributes, initial.default_attributes_size * 4ull},
+        {initial.vs_program_binary, initial.vs_program_binary_size * 4ull},
+        {initial.vs_swizzle_data, initial.vs_swizzle_data_size * 4ull},
+        {initial.vs_float_uniforms, initial.vs_float_uniforms_size * 4ull},
+        {initial.gs_program_binary, initial.gs_program_binary_size * 4ull},
+        {initial.gs_swizzle_data, initial.gs_swizzle_data_size * 4ull},
+        {initial.gs_float_uniforms, initial.gs_float_uniforms_size * 4ull},
+        {header.stream_offset, 0},
+    };
+    for (const auto& range : ranges) {
+        if (range.first + range.second > data.size()) {
+            LOG_ERROR(HW_GPU, "CiTrace file %s is truncated", filename.c_str());
+            return;
+        }
+    }
+
+    valid = header.version == 1 ? LoadUncompressedStream() : LoadChunkedStream();
+    if (!valid)
+        LOG_ERROR(HW_GPU, "CiTrace file %s has an invalid stream", filename.c_str());
+}
+
+bool Player::LoadUncompressedStream() {
+    const u64 stream_end =
+        header.stream_offset + header.stream_size * static_cast<u64>(sizeof(CTStreamElement));
+    if (stream_end > data.size())
+        return false;
+
+    stream.resize(header.stream_size);
+    std::memcpy(stream.data(), &data[header.stream_offset],
+                stream.size() * sizeof(CTStreamElement));
+
+    for (const auto& element : stream) {
+        if (element.type == MemoryLoad &&
+            static_cast<u64>(element.memory_load.file_offset) + element.memory_load.size >
+                data.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Player::LoadChunkedStream() {
+    std::vector<u8> pages;
+    std::vector<u32> page_offsets;
+    std::vector<u8> chunk;
+
+    u64 offset = header.stream_offset;
+    for (u32 chunk_index = 0; chunk_index < header.stream_size; ++chunk_index) {
+        CTChunkHeader chunk_header;
+        if (offset + sizeof(chunk_header) > data.size())
+            return false;
+        std::memcpy(&chunk_header, &data[offset], sizeof(chunk_header));
+        offset += sizeof(chunk_header);
+        if (offset + chunk_header.compressed_size > data.size())
+            return false;
+
+        try {
+            CryptoPP::ZlibDecompressor decompressor;
+            decompressor.Put(&data[offset], chunk_header.compressed_size);
+            decompressor.MessageEnd();
+            chunk.resize(static_cast<size_t>(decompressor.MaxRetrievable()));
+            decompressor.Get(chunk.data(), chunk.size());
+        } catch (const CryptoPP::Exception& e) {
+            LOG_ERROR(HW_GPU, "Failed to decompress chunk %u: %s", chunk_index, e.what());
+            return false;
+        }
+        if (chunk.size() != chunk_header.uncompressed_size)
+            return false;
+        offset += chunk_header.compressed_size;
+
+        for (size_t pos = 0; pos < chunk.size();) {
+            CTStreamElement element;
+            if (pos + sizeof(element) > chunk.size())
+                return false;
+            std::memcpy(&element, &chunk[pos], sizeof(element));
+            pos += sizeof(element);
+
+            if (element.type == MemoryPage) {
+                const u32 size = element.memory_page.size;
+                if (size > Memory::PAGE_SIZE || pos + size > chunk.size())
+                    return false;
+                page_offsets.push_back(static_cast<u32>(pages.size()));
+                pages.insert(pages.end(), &chunk[pos], &chunk[pos] + size);
+                pos += size;
+                continue;
+            }
+
+            if (element.type == MemoryLoad) {
+                // Refer to the page data by its offset in the final data, like version 1 does
+                CTMemoryLoad& load = element.memory_load;
+                if (load.file_offset >= page_offsets.size() || load.size > Memory::PAGE_SIZE)
+                    return false;
+                const u32 page_offset = page_offsets[load.file_offset];
+                if (page_offset + static_cast<u64>(load.size) > pages.size())
+                    return false;
+                load.file_offset = header.stream_offset + page_offset;
+            }
+            stream.push_back(element);
+        }
+    }
+
+    if (header.stream_offset + static_cast<u64>(pages.size()) > UINT32_MAX) {
+        LOG_ERROR(HW_GPU, "Memory data of the trace exceeds 4 GiB");
+        return false;
+    }
+
+    data.resize(header.stream_offset);
+    data.insert(data.end(), pages.begin(), pages.end());
+    data.shrink_to_fit();
+    return true;
+}
+
+unsigned Player::GetFrameCount() const {
+    return static_cast<unsigned>(std::count_if(
+        stream.begin(), stream.end(),
+        [](const CTStreamElement& element) { return element.type == FrameMarker; }));
+}
+
+const u32* Player::GetInitialState(u32 offset) const {
+    return reinterpret_cast<const u32*>(data.data() + offset);
+}
+
+/// Copies up to sizeof(T) bytes of raw register values to the given register block
+template <typename T>
+static void RestoreRegisters(T& regs, const u32* values, u32 size) {
+    std::memcpy(&regs, values, std::min<size_t>(sizeof(T), size * sizeof(u32)));
+}
+
+/// Restores vectors of float24 values stored in the lower 24 bits of four u32 each
+static void RestoreFloat24Vectors(Math::Vec4<Pica::float24>* dest, size_t count, const u32* values,
+                                  u32 size) {
+    count = std::min<size_t>(count, size / 4);
+    for (size_t i = 0; i < count; ++i)
+        for (unsigned comp = 0; comp < 4; ++comp)
+            dest[i][comp] = Pica::float24::FromRaw(values[4 * i + comp] & 0xFFFFFF);
+}
+
+template <size_t N>
+static void RestoreShaderData(std::array<u32, N>& dest, const u32* values, u32 size) {
+    std::copy_n(values, std::min<size_t>(N, size), dest.begin());
+}
+
+/// Updates the boolean and integer uniforms, which the trace stores as register values only
+static void RestoreUniformsFromRegisters(Pica::Shader::ShaderSetup& setup,
+                                         const Pica::ShaderRegs& config) {
+    for (unsigned i = 0; i < setup.uniforms.b.size(); ++i)
+        setup.uniforms.b[i] = (config.bool_uniforms.Value() & (1 << i)) != 0;
+
+    for (unsigned i = 0; i < setup.uniforms.i.size(); ++i) {
+        const auto& values = config.int_uniforms[i];
+        setup.uniforms.i[i] = Math::Vec4<u8>(values.x, values.y, values.z, values.w);
+    }
+}
+
+void Player::RestoreInitialState() const {
+    using namespace Pica;
+
+    const auto& initial = header.initial_state_offsets;
+
+    // The rasterizer still holds the state derived from the registers that are replaced
+    CommandProcessor::MarkAllRegistersDirty();
+    g_state.Reset();
+
+    RestoreRegisters(GPU::g_regs, GetInitialState(initial.gpu_registers),
+                     initial.gpu_registers_size);
+    RestoreRegisters(LCD::g_regs, GetInitialState(initial.lcd_registers),
+                     initial.lcd_registers_size);
+    RestoreRegisters(g_state.regs, GetInitialState(initial.pica_registers),
+                     initial.pica_registers_size);
+    RestoreFloat24Vectors(g_state.input_default_attributes.attr, 16,
+                          GetInitialState(initial.default_attributes),
+                          initial.default_attributes_size);
+
+    RestoreShaderData(g_state.vs.program_code, GetInitialState(initial.vs_program_binary),
+                      initial.vs_program_binary_size);
+    RestoreShaderData(g_state.vs.swizzle_data, GetInitialState(initial.vs_swizzle_data),
+                      initial.vs_swizzle_data_size);
+    RestoreFloat24Vectors(g_state.vs.uniforms.f, 96, GetInitialState(initial.vs_float_uniforms),
+                          initial.vs_float_uniforms_size);
+    RestoreUniformsFromRegisters(g_state.vs, g_state.regs.vs);
+    g_state.vs.MarkShaderDataDirty();
+
+    RestoreShaderData(g_state.gs.program_code, GetInitialState(initial.gs_program_binary),
+                      initial.gs_program_binary_size);
+    RestoreShaderData(g_state.gs.swizzle_data, GetInitialState(initial.gs_swizzle_data),
+                      initial.gs_swizzle_data_size);
+    RestoreFloat24Vectors(g_state.gs.uniforms.f, 96, GetInitialState(initial.gs_float_uniforms),
+                          initial.gs_float_uniforms_size);
+    RestoreUniformsFromRegisters(g_state.gs, g_state.regs.gs);
+    g_state.gs.MarkShaderDataDirty();
+}
+
+void Player::Replay(const std::function<void(unsigned)>& frame_finished) const {
+    unsigned frame = 0;
+
+    for (size_t i = 0; i < stream.size(); ++i) {
+        const CTStreamElement& element = stream[i];
+
+        switch (element.type) {
+        case FrameMarker:
+            frame_finished(frame++);
+            break;
+
+        case MemoryLoad: {
+            const CTMemoryLoad& load = element.memory_load;
+            if (load.size == 0)
+                break;
+
+            // Both ends of the load being mapped contiguously is taken as proof that it lies
+            // within one memory region
+            const u32 last_address = load.physical_address + (load.size - 1);
+            u8* dest = Memory::GetPhysicalPointer(load.physical_address);
+            const u8* last = last_address >= load.physical_address
+                                 ? Memory::GetPhysicalPointer(last_address)
+                                 : nullptr;
+            if (dest == nullptr || last == nullptr ||
+                last - dest != static_cast<ptrdiff_t>(load.size - 1)) {
+                LOG_ERROR(HW_GPU,
+                          "Memory load %zu of 0x%X bytes at 0x%08X exceeds the mapped memory", i,
+                          load.size, load.physical_address);
+                break;
+            }
+
+            // Cached copies of the old contents, e.g. decoded textures, must not survive the load
+            Memory::RasterizerFlushAndInvalidateRegion(load.physical_address, load.size);
+            std::memcpy(dest, GetMemoryLoadData(load), load.size);
+            break;
+        }
+
+        case RegisterWrite: {
+            const CTRegisterWrite& write = element.register_write;
+            const VAddr vaddr =
+                write.physical_address - Memory::IO_AREA_PADDR + Memory::IO_AREA_VADDR;
+
+            switch (write.size) {
+            case CTRegisterWrite::SIZE_8:
+                HW::Write<u8>(vaddr, static_cast<u8>(write.value));
+                break;
+            case CTRegisterWrite::SIZE_16:
+                HW::Write<u16>(vaddr, static_cast<u16>(write.value));
+                break;
+            case CTRegisterWrite::SIZE_32:
+                HW::Write<u32>(vaddr, static_cast<u32>(write.value));
+                break;
+            case CTRegisterWrite::SIZE_64:
+                HW::Write<u64>(vaddr, write.value);
+                break;
+            default:
+                LOG_ERROR(HW_GPU, "Register write %zu has invalid size 0x%X", i,
+                          static_cast<u32>(write.size));
+                break;
+            }
+            break;
+        }
+
+        default:
+            LOG_ERROR(HW_GPU, "Unknown stream element type 0x%X at index %zu",
+                      static_cast<u32>(element.type), i);
+            break;
+        }
+    }
+}
+
+} // namespace CiTrace
@@ -0,0 +1,75 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "common/common_types.h"
+#include "core/tracer/citrace.h"
+
+namespace CiTrace {
+
+/**
+ * Replays a CiTrace recording against the emulated GPU.
+ *
+ * Memory loads are copied to their physical address, register writes go through the regular MMIO
+ * handlers, hence command lists, memory fills and display transfers run just like they did while
+ * recording. The caller is responsible for providing a renderer and a memory map that covers the
+ * physical memory used by the trace.
+ */
+class Player {
+public:
+    /// Loads the given trace file into memory. Use IsValid to check whether that succeeded.
+    explicit Player(const std::string& filename);
+
+    /// Whether the trace was loaded and its header and initial state are consistent
+    bool IsValid() const {
+        return valid;
+    }
+
+    /// Number of frame markers in the command stream
+    unsigned GetFrameCount() const;
+
+    /// Stream elements in the version 1 layout, i.e. without MemoryPage elements
+    const std::vector<CTStreamElement>& GetStream() const {
+        return stream;
+    }
+
+    /// Returns the data the given memory load of the stream copies
+    const u8* GetMemoryLoadData(const CTMemoryLoad& load) const {
+        return &data[load.file_offset];
+    }
+
+    /// Resets the Pica state and restores the register, shader and uniform state of the recording
+    void RestoreInitialState() const;
+
+    /**
+     * Replays the command stream from its beginning.
+     * @param frame_finished Called at every frame marker, with the index of the finished frame
+     */
+    void Replay(const std::function<void(unsigned)>& frame_finished) const;
+
+private:
+    /// Returns the u32 values of the initial state entry at the given file offset
+    const u32* GetInitialState(u32 offset) const;
+
+    /// Reads the stream of a version 1 trace, which refers to memory data in the file itself
+    bool LoadUncompressedStream();
+
+    /**
+     * Decompresses the stream chunks of a trace. The chunks are replaced by the data of all memory
+     * pages, which memory loads then refer to like in version 1 traces.
+     */
+    bool LoadChunkedStream();
+
+    bool valid = false;
+    /// The file up to the stream, followed by memory load data
+    std::vector<u8> data;
+    CTHeader header;
+    std::vector<CTStreamElement> stream;
+};
+
+} // namespace CiTrace
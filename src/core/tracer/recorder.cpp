@@ -2,19 +2,33 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <cstddef>
 #include <cstring>
+#include <cryptopp/zlib.h>
 #include "common/assert.h"
 #include "common/file_util.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
+#include "common/thread.h"
+#include "core/memory.h"
 #include "core/tracer/recorder.h"
 
 namespace CiTrace {
 
-Recorder::Recorder(const InitialState& initial_state) : initial_state(initial_state) {}
+/// Uncompressed size after which a chunk is handed over for compression
+constexpr size_t CHUNK_SIZE = 1024 * 1024;
 
-void Recorder::Finish(const std::string& filename) {
+/// Number of chunks that may wait for compression before recording blocks
+constexpr size_t MAX_QUEUED_CHUNKS = 16;
+
+/// zlib compression level, favoring speed as most redundancy is removed by page deduplication
+constexpr unsigned int COMPRESSION_LEVEL = 1;
+
+Recorder::Recorder(const std::string& filename, const InitialState& initial_state)
+    : filename(filename) {
     // Setup CiTrace header
-    CTHeader header;
+    std::memset(&header, 0, sizeof(header));
     std::memcpy(header.magic, CTHeader::ExpectedMagicWord(), 4);
     header.version = CTHeader::ExpectedVersion();
     header.header_size = sizeof(CTHeader);
@@ -32,12 +46,10 @@ void Recorder::Finish(const std::string& filename) {
     initial.gs_program_binary_size = static_cast<u32>(initial_state.gs_program_binary.size());
     initial.gs_swizzle_data_size = static_cast<u32>(initial_state.gs_swizzle_data.size());
     initial.gs_float_uniforms_size = static_cast<u32>(initial_state.gs_float_uniforms.size());
-    header.stream_size = static_cast<u32>(stream.size());
 
     initial.gpu_registers = sizeof(header);
     initial.lcd_registers = initial.gpu_registers + initial.gpu_registers_size * sizeof(u32);
     initial.pica_registers = initial.lcd_registers + initial.lcd_registers_size * sizeof(u32);
-    ;
     initial.default_attributes = initial.pica_registers + initial.pica_registers_size * sizeof(u32);
     initial.vs_program_binary =
         initial.default_attributes + initial.default_attributes_size * sizeof(u32);
@@ -51,31 +63,16 @@ void Recorder::Finish(const std::string& filename) {
         initial.gs_program_binary + initial.gs_program_binary_size * sizeof(u32);
     initial.gs_float_uniforms =
         initial.gs_swizzle_data + initial.gs_swizzle_data_size * sizeof(u32);
-    header.stream_offset = initial.gs_float_uniforms + initial.gs_float_uniforms_size * sizeof(u32);
 
-    // Iterate through stream elements, update relevant stream element data
-    for (auto& stream_element : stream) {
-        switch (stream_element.data.type) {
-        case MemoryLoad: {
-            auto& file_offset = memory_regions[stream_element.hash];
-            if (!stream_element.uses_existing_data) {
-                file_offset = header.stream_offset;
-            }
-            stream_element.data.memory_load.file_offset = file_offset;
-            break;
-        }
-
-        default:
-            // Other commands don't use any extra data
-            DEBUG_ASSERT(stream_element.extra_data.size() == 0);
-            break;
-        }
-        header.stream_offset += static_cast<u32>(stream_element.extra_data.size());
-    }
+    // Chunks are appended as they are recorded, the header tells how many are complete
+    header.stream_offset = initial.gs_float_uniforms + initial.gs_float_uniforms_size * sizeof(u32);
+    header.stream_size = 0;
 
     try {
         // Open file and write header
-        FileUtil::IOFile file(filename, "wb");
+        if (!file.Open(filename, "wb"))
+            throw "Failed to open file";
+
         size_t written = file.WriteObject(header);
         if (written != 1 || file.Tell() != initial.gpu_registers)
             throw "Failed to write header";
@@ -139,70 +136,187 @@ void Recorder::Finish(const std::string& filename) {
             file.Tell() != initial.gs_float_uniforms + sizeof(u32) * initial.gs_float_uniforms_size)
             throw "Failed to write geometry shader float uniforms";
 
-        // Iterate through stream elements, write "extra data"
-        for (const auto& stream_element : stream) {
-            if (stream_element.extra_data.size() == 0)
-                continue;
+    } catch (const char* str) {
+        LOG_ERROR(HW_GPU, "Writing CiTrace file failed: %s", str);
+        file.Close();
+        return;
+    }
+
+    chunk.reserve(CHUNK_SIZE);
+    compression_thread = std::thread(&Recorder::CompressionLoop, this);
+}
 
-            written =
-                file.WriteBytes(stream_element.extra_data.data(), stream_element.extra_data.size());
-            if (written != stream_element.extra_data.size())
-                throw "Failed to write extra data";
-        }
+Recorder::~Recorder() {
+    Finish();
+}
 
-        if (file.Tell() != header.stream_offset)
-            throw "Unexpected end of extra data";
+void Recorder::Finish() {
+    if (finished)
+        return;
+    finished = true;
 
-        // Write actual stream elements
-        for (const auto& stream_element : stream) {
-            if (1 != file.WriteObject(stream_element.data))
-                throw "Failed to write stream element";
+    SubmitChunk();
+    if (compression_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            stop_compression = true;
         }
-    } catch (const char* str) {
-        LOG_ERROR(HW_GPU, "Writing CiTrace file failed: %s", str);
+        queue_changed.notify_all();
+        compression_thread.join();
     }
+    file.Close();
+}
+
+void Recorder::Abort() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        queue.clear();
+    }
+    chunk.clear();
+    Finish();
+    FileUtil::Delete(filename);
 }
 
 void Recorder::FrameFinished() {
-    stream.push_back({{FrameMarker}});
+    CTStreamElement element{};
+    element.type = FrameMarker;
+    AppendElement(element);
 }
 
 void Recorder::MemoryAccessed(const u8* data, u32 size, u32 physical_address) {
-    StreamElement element = {{MemoryLoad}};
-    element.data.memory_load.size = size;
-    element.data.memory_load.physical_address = physical_address;
-
-    // Compute hash over given memory region to check if the contents are already stored internally
-    boost::crc_32_type result;
-    result.process_bytes(data, size);
-    element.hash = result.checksum();
-
-    element.uses_existing_data = (memory_regions.find(element.hash) != memory_regions.end());
-    if (!element.uses_existing_data) {
-        element.extra_data.resize(size);
-        memcpy(element.extra_data.data(), data, size);
-        memory_regions.insert({element.hash, 0}); // file offset will be initialized in Finish()
-    }
+    // Split the range at page boundaries, so that the same data is found again when the range
+    // it is part of changes elsewhere
+    while (size != 0) {
+        const u32 page_offset = physical_address & Memory::PAGE_MASK;
+        const u32 piece_size = std::min<u32>(size, Memory::PAGE_SIZE - page_offset);
+
+        // Ranges are accessed over and over, but mostly hold the same data as the last time
+        const u32 page_index = GetPageIndex(data, piece_size);
+        auto last_load = last_loads.find(physical_address);
+        if (last_load == last_loads.end() || last_load->second != page_index) {
+            last_loads[physical_address] = page_index;
+
+            CTStreamElement element{};
+            element.type = MemoryLoad;
+            element.memory_load.file_offset = page_index;
+            element.memory_load.size = piece_size;
+            element.memory_load.physical_address = physical_address;
+            AppendElement(element);
+        }
 
-    stream.push_back(element);
+        data += piece_size;
+        size -= piece_size;
+        physical_address += piece_size;
+    }
 }
 
 template <typename T>
 void Recorder::RegisterWritten(u32 physical_address, T value) {
-    StreamElement element = {{RegisterWrite}};
-    element.data.register_write.size =
+    CTStreamElement element{};
+    element.type = RegisterWrite;
+    element.register_write.size =
         (sizeof(T) == 1) ? CTRegisterWrite::SIZE_8
                          : (sizeof(T) == 2) ? CTRegisterWrite::SIZE_16
                                             : (sizeof(T) == 4) ? CTRegisterWrite::SIZE_32
                                                                : CTRegisterWrite::SIZE_64;
-    element.data.register_write.physical_address = physical_address;
-    element.data.register_write.value = value;
+    element.register_write.physical_address = physical_address;
+    element.register_write.value = value;
 
-    stream.push_back(element);
+    AppendElement(element);
 }
 
 template void Recorder::RegisterWritten(u32, u8);
 template void Recorder::RegisterWritten(u32, u16);
 template void Recorder::RegisterWritten(u32, u32);
 template void Recorder::RegisterWritten(u32, u64);
+
+void Recorder::AppendElement(const CTStreamElement& element, const u8* extra_data,
+                             u32 extra_size) {
+    const u8* element_data = reinterpret_cast<const u8*>(&element);
+    chunk.insert(chunk.end(), element_data, element_data + sizeof(element));
+    chunk.insert(chunk.end(), extra_data, extra_data + extra_size);
+
+    if (chunk.size() >= CHUNK_SIZE)
+        SubmitChunk();
 }
+
+u32 Recorder::GetPageIndex(const u8* data, u32 size) {
+    PageKey key;
+    Common::MurmurHash3_128(data, size, 0, key.hash);
+    key.size = size;
+
+    auto it = pages.find(key);
+    if (it != pages.end())
+        return it->second;
+
+    const u32 index = static_cast<u32>(pages.size());
+    pages.emplace(key, index);
+
+    CTStreamElement element{};
+    element.type = MemoryPage;
+    element.memory_page.size = size;
+    AppendElement(element, data, size);
+    return index;
+}
+
+void Recorder::SubmitChunk() {
+    if (chunk.empty())
+        return;
+
+    // Without a file to write to, the data is dropped
+    if (compression_thread.joinable()) {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        // Don't let chunks pile up if compression can't keep up with recording
+        queue_changed.wait(lock, [this] { return queue.size() < MAX_QUEUED_CHUNKS; });
+        queue.push_back(std::move(chunk));
+    }
+    queue_changed.notify_all();
+
+    chunk = std::vector<u8>();
+    chunk.reserve(CHUNK_SIZE);
+}
+
+void Recorder::CompressionLoop() {
+    Common::SetCurrentThreadName("CiTraceRecorder");
+
+    bool failed = false;
+    while (true) {
+        std::vector<u8> data;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_changed.wait(lock, [this] { return stop_compression || !queue.empty(); });
+            if (queue.empty())
+                return;
+            data = std::move(queue.front());
+            queue.pop_front();
+        }
+        queue_changed.notify_all();
+
+        if (failed)
+            continue;
+
+        CryptoPP::ZlibCompressor compressor(nullptr, COMPRESSION_LEVEL);
+        compressor.Put(data.data(), data.size());
+        compressor.MessageEnd();
+        std::vector<u8> compressed(static_cast<size_t>(compressor.MaxRetrievable()));
+        compressor.Get(compressed.data(), compressed.size());
+
+        const CTChunkHeader chunk_header = {static_cast<u32>(compressed.size()),
+                                            static_cast<u32>(data.size())};
+        if (file.WriteObject(chunk_header) != 1 ||
+            file.WriteBytes(compressed.data(), compressed.size()) != compressed.size()) {
+            LOG_ERROR(HW_GPU, "Writing CiTrace chunk failed, dropping the remaining stream");
+            failed = true;
+            continue;
+        }
+
+        // Only count the chunk once it is complete, so that an interrupted recording stays
+        // readable up to the last chunk
+        ++header.stream_size;
+        file.Seek(offsetof(CTHeader, stream_size), SEEK_SET);
+        file.WriteObject(header.stream_size);
+        file.Seek(0, SEEK_END);
+    }
+}
+
+} // namespace
@@ -4,15 +4,27 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
-#include <boost/crc.hpp>
 #include "common/common_types.h"
+#include "common/file_util.h"
 #include "core/tracer/citrace.h"
 
 namespace CiTrace {
 
+/**
+ * Records a CiTrace while the emulated GPU runs.
+ *
+ * The stream is written to the file as it is recorded: elements are collected in fixed-size
+ * chunks, which a background thread compresses and appends to the file. Memory loads are split
+ * into pages, and the data of each distinct page is stored only once. A page is only loaded again
+ * once its contents have changed.
+ */
 class Recorder {
 public:
     struct InitialState {
@@ -29,13 +41,20 @@ public:
     };
 
     /**
-     * Recorder constructor
+     * Recorder constructor, writes the initial state to the given file
+     * @param filename File to record to
      * @param initial_state Initial recorder state
      */
-    Recorder(const InitialState& initial_state);
+    Recorder(const std::string& filename, const InitialState& initial_state);
 
-    /// Finish recording of this Citrace and save it using the given filename.
-    void Finish(const std::string& filename);
+    /// Finishes the recording if that has not happened yet
+    ~Recorder();
+
+    /// Finish recording of this Citrace, writing all outstanding data to the file.
+    void Finish();
+
+    /// Stop recording and delete the file.
+    void Abort();
 
     /// Mark end of a frame
     void FrameFinished();
@@ -55,33 +74,53 @@ public:
     void RegisterWritten(u32 physical_address, T value);
 
 private:
-    // Initial state of recording start
-    InitialState initial_state;
+    /// Appends an element, and the data that follows it, to the current chunk
+    void AppendElement(const CTStreamElement& element, const u8* extra_data = nullptr,
+                       u32 extra_size = 0);
+
+    /// Returns the index of the MemoryPage element holding the given data, recording it if new
+    u32 GetPageIndex(const u8* data, u32 size);
+
+    /// Hands the current chunk over to the compression thread
+    void SubmitChunk();
+
+    /// Compresses queued chunks and appends them to the file, run by compression_thread
+    void CompressionLoop();
 
-    // Command stream
-    struct StreamElement {
-        CTStreamElement data;
+    std::string filename;
+    FileUtil::IOFile file;
+    CTHeader header;
+    bool finished = false;
 
-        /**
-          * Extra data to store along "core" data.
-          * This is e.g. used for data used in MemoryUpdates.
-          */
-        std::vector<u8> extra_data;
+    /// Uncompressed data of the chunk being recorded
+    std::vector<u8> chunk;
 
-        /// Optional CRC hash (e.g. for hashing memory regions)
-        boost::crc_32_type::value_type hash;
+    std::mutex queue_mutex;
+    std::condition_variable queue_changed;
+    std::deque<std::vector<u8>> queue;
+    bool stop_compression = false;
+    std::thread compression_thread;
 
-        /// If true, refer to data already written to the output file instead of extra_data
-        bool uses_existing_data;
+    struct PageKey {
+        u64 hash[2];
+        u32 size;
+
+        bool operator==(const PageKey& other) const {
+            return hash[0] == other.hash[0] && hash[1] == other.hash[1] && size == other.size;
+        }
     };
 
-    std::vector<StreamElement> stream;
+    struct PageKeyHash {
+        size_t operator()(const PageKey& key) const {
+            return static_cast<size_t>(key.hash[0]);
+        }
+    };
 
-    /**
-     * Internal cache which maps hashes of memory contents to file offsets at which those memory
-     * contents are stored.
-     */
-    std::unordered_map<boost::crc_32_type::value_type /*hash*/, u32 /*file_offset*/> memory_regions;
+    /// Maps the contents of every page recorded so far to the index of its MemoryPage element
+    std::unordered_map<PageKey, u32, PageKeyHash> pages;
+
+    /// Maps the address of every memory load recorded so far to the page it loaded last
+    std::unordered_map<u32, u32> last_loads;
 };
 
 } // namespace
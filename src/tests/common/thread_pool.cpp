@@ -0,0 +1,28 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <atomic>
+#include <vector>
+#include <catch.hpp>
+#include "common/thread_pool.h"
+
+namespace Common {
+
+TEST_CASE("ThreadPool::ParallelFor", "[common]") {
+    ThreadPool pool(4);
+    REQUIRE(pool.GetThreadCount() == 4);
+
+    for (size_t count : {0, 1, 3, 1000}) {
+        std::vector<std::atomic<int>> hits(count);
+        for (auto& hit : hits)
+            hit = 0;
+
+        pool.ParallelFor(count, [&hits](size_t index) { ++hits[index]; });
+
+        for (auto& hit : hits)
+            REQUIRE(hit == 1);
+    }
+}
+
+} // namespace Common
@@ -0,0 +1,132 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+#include "common/file_util.h"
+#include "common/scope_exit.h"
+#include "core/memory.h"
+#include "core/tracer/player.h"
+#include "core/tracer/recorder.h"
+
+namespace CiTrace {
+
+static std::vector<u8> CollectMemoryLoads(const Player& player, size_t first, size_t count) {
+    std::vector<u8> result;
+    for (size_t i = first; i < first + count; ++i) {
+        const auto& element = player.GetStream()[i];
+        REQUIRE(element.type == MemoryLoad);
+        const u8* data = player.GetMemoryLoadData(element.memory_load);
+        result.insert(result.end(), data, data + element.memory_load.size);
+    }
+    return result;
+}
+
+TEST_CASE("Player reads back what Recorder streamed", "[core][tracer]") {
+    const std::string filename = "citrace_test.ctf";
+    SCOPE_EXIT({ FileUtil::Delete(filename); });
+
+    std::vector<u8> memory(3 * Memory::PAGE_SIZE);
+    for (size_t i = 0; i < memory.size(); ++i)
+        memory[i] = static_cast<u8>(i * 7 + i / 251);
+    const std::vector<u8> expected(memory.begin() + 0x100,
+                                   memory.begin() + 0x300 + 2 * Memory::PAGE_SIZE);
+
+    // Enough register writes to fill several chunks
+    constexpr u32 num_writes = 200000;
+
+    Recorder::InitialState state;
+    state.gpu_registers = {1, 2, 3};
+    state.pica_registers = {4, 5};
+    {
+        Recorder recorder(filename, state);
+        // All ranges start and end in the middle of a page
+        recorder.MemoryAccessed(memory.data() + 0x100, 2 * Memory::PAGE_SIZE + 0x200, 0x20000100);
+        recorder.MemoryAccessed(memory.data() + 0x100, 2 * Memory::PAGE_SIZE + 0x200, 0x20000100);
+        recorder.MemoryAccessed(memory.data() + 0x100, 2 * Memory::PAGE_SIZE + 0x200, 0x20100100);
+        memory[Memory::PAGE_SIZE + 5] ^= 0xFF;
+        recorder.MemoryAccessed(memory.data() + 0x100, 2 * Memory::PAGE_SIZE + 0x200, 0x20000100);
+        recorder.FrameFinished();
+        for (u32 i = 0; i < num_writes; ++i)
+            recorder.RegisterWritten<u32>(0x10400100, i);
+        recorder.FrameFinished();
+        recorder.Finish();
+    }
+
+    Player player(filename);
+    REQUIRE(player.IsValid());
+    REQUIRE(player.GetFrameCount() == 2);
+
+    const auto& stream = player.GetStream();
+    // The repeated access with unchanged data loads nothing
+    REQUIRE(stream.size() == 3 + 3 + 1 + 1 + num_writes + 1);
+
+    // Loads are split at page boundaries
+    REQUIRE(stream[0].memory_load.physical_address == 0x20000100);
+    REQUIRE(stream[1].memory_load.physical_address == 0x20001000);
+    REQUIRE(stream[2].memory_load.physical_address == 0x20002000);
+    REQUIRE(stream[3].memory_load.physical_address == 0x20100100);
+
+    REQUIRE(CollectMemoryLoads(player, 0, 3) == expected);
+    REQUIRE(CollectMemoryLoads(player, 3, 3) == expected);
+
+    // The load of the same data elsewhere refers to the data of the first one
+    for (size_t i = 0; i < 3; ++i)
+        REQUIRE(stream[i].memory_load.file_offset == stream[i + 3].memory_load.file_offset);
+
+    // Only the modified page is loaded again
+    REQUIRE(stream[6].memory_load.physical_address == 0x20001000);
+    REQUIRE(CollectMemoryLoads(player, 6, 1) ==
+            std::vector<u8>(memory.begin() + Memory::PAGE_SIZE,
+                            memory.begin() + 2 * Memory::PAGE_SIZE));
+
+    REQUIRE(stream[7].type == FrameMarker);
+    for (u32 i = 0; i < num_writes; ++i) {
+        const auto& element = stream[8 + i];
+        REQUIRE(element.type == RegisterWrite);
+        REQUIRE(element.register_write.size == CTRegisterWrite::SIZE_32);
+        REQUIRE(element.register_write.physical_address == 0x10400100);
+        REQUIRE(element.register_write.value == i);
+    }
+    REQUIRE(stream.back().type == FrameMarker);
+}
+
+TEST_CASE("Player reads version 1 traces", "[core][tracer]") {
+    const std::string filename = "citrace_v1_test.ctf";
+    SCOPE_EXIT({ FileUtil::Delete(filename); });
+
+    const u8 memory_data[] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+    CTHeader header{};
+    std::memcpy(header.magic, CTHeader::ExpectedMagicWord(), 4);
+    header.version = 1;
+    header.header_size = sizeof(CTHeader);
+    header.stream_offset = sizeof(CTHeader) + sizeof(memory_data);
+    header.stream_size = 2;
+
+    CTStreamElement elements[2]{};
+    elements[0].type = MemoryLoad;
+    elements[0].memory_load.file_offset = sizeof(CTHeader);
+    elements[0].memory_load.size = sizeof(memory_data);
+    elements[0].memory_load.physical_address = 0x18000000;
+    elements[1].type = FrameMarker;
+
+    {
+        FileUtil::IOFile file(filename, "wb");
+        file.WriteObject(header);
+        file.WriteBytes(memory_data, sizeof(memory_data));
+        file.WriteArray(elements, 2);
+    }
+
+    Player player(filename);
+    REQUIRE(player.IsValid());
+    REQUIRE(player.GetFrameCount() == 1);
+    REQUIRE(player.GetStream().size() == 2);
+    REQUIRE(std::memcmp(player.GetMemoryLoadData(player.GetStream()[0].memory_load), memory_data,
+                        sizeof(memory_data)) == 0);
+}
+
+} // namespace CiTrace
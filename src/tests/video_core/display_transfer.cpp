@@ -0,0 +1,208 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <catch.hpp>
+#include "common/color.h"
+#include "core/hw/gpu.h"
+#include "video_core/utils.h"
+
+namespace GPU {
+
+static Math::Vec4<u8> DecodePixel(Regs::PixelFormat format, const u8* pixel) {
+    switch (format) {
+    case Regs::PixelFormat::RGBA8:
+        return Color::DecodeRGBA8(pixel);
+    case Regs::PixelFormat::RGB8:
+        return Color::DecodeRGB8(pixel);
+    case Regs::PixelFormat::RGB565:
+        return Color::DecodeRGB565(pixel);
+    case Regs::PixelFormat::RGB5A1:
+        return Color::DecodeRGB5A1(pixel);
+    case Regs::PixelFormat::RGBA4:
+        return Color::DecodeRGBA4(pixel);
+    default:
+        return {0, 0, 0, 0};
+    }
+}
+
+static void EncodePixel(Regs::PixelFormat format, const Math::Vec4<u8>& color, u8* pixel) {
+    switch (format) {
+    case Regs::PixelFormat::RGBA8:
+        return Color::EncodeRGBA8(color, pixel);
+    case Regs::PixelFormat::RGB8:
+        return Color::EncodeRGB8(color, pixel);
+    case Regs::PixelFormat::RGB565:
+        return Color::EncodeRGB565(color, pixel);
+    case Regs::PixelFormat::RGB5A1:
+        return Color::EncodeRGB5A1(color, pixel);
+    case Regs::PixelFormat::RGBA4:
+        return Color::EncodeRGBA4(color, pixel);
+    default:
+        return;
+    }
+}
+
+/// Performs the display transfer one pixel at a time
+static void ReferenceDisplayTransfer(const Regs::DisplayTransferConfig& config, const u8* src,
+                                     u8* dst) {
+    const u32 horizontal_scale = config.scaling != config.NoScale ? 1 : 0;
+    const u32 vertical_scale = config.scaling == config.ScaleXY ? 1 : 0;
+    const u32 output_width = config.output_width >> horizontal_scale;
+    const u32 output_height = config.output_height >> vertical_scale;
+    const u32 src_bytes_per_pixel = Regs::BytesPerPixel(config.input_format);
+    const u32 dst_bytes_per_pixel = Regs::BytesPerPixel(config.output_format);
+
+    // Unless dont_swizzle is set, the transfer converts between the tiled and the linear layout
+    const bool input_tiled = !config.input_linear;
+    const bool output_tiled = config.dont_swizzle ? input_tiled : !input_tiled;
+
+    for (u32 y = 0; y < output_height; ++y) {
+        for (u32 x = 0; x < output_width; ++x) {
+            const u32 input_x = x << horizontal_scale;
+            const u32 input_y = y << vertical_scale;
+            const u32 output_y = config.flip_vertically ? output_height - y - 1 : y;
+
+            u32 src_offset;
+            if (input_tiled) {
+                src_offset = VideoCore::GetMortonOffset(input_x, input_y, src_bytes_per_pixel) +
+                             (input_y & ~7) * config.input_width * src_bytes_per_pixel;
+            } else {
+                src_offset = (input_x + input_y * config.input_width) * src_bytes_per_pixel;
+            }
+
+            u32 dst_offset;
+            if (output_tiled) {
+                dst_offset = VideoCore::GetMortonOffset(x, output_y, dst_bytes_per_pixel) +
+                             (output_y & ~7) * output_width * dst_bytes_per_pixel;
+            } else {
+                dst_offset = (x + output_y * output_width) * dst_bytes_per_pixel;
+            }
+
+            // The pixels that are averaged follow each other in Morton order
+            const u8* src_pixel = src + src_offset;
+            Math::Vec4<u8> color = DecodePixel(config.input_format, src_pixel);
+            if (config.scaling == config.ScaleX) {
+                const auto pixel =
+                    DecodePixel(config.input_format, src_pixel + src_bytes_per_pixel);
+                color = ((color + pixel) / 2).Cast<u8>();
+            } else if (config.scaling == config.ScaleXY) {
+                const auto pixel1 =
+                    DecodePixel(config.input_format, src_pixel + 1 * src_bytes_per_pixel);
+                const auto pixel2 =
+                    DecodePixel(config.input_format, src_pixel + 2 * src_bytes_per_pixel);
+                const auto pixel3 =
+                    DecodePixel(config.input_format, src_pixel + 3 * src_bytes_per_pixel);
+                color = (((color + pixel1) + (pixel2 + pixel3)) / 4).Cast<u8>();
+            }
+
+            EncodePixel(config.output_format, color, dst + dst_offset);
+        }
+    }
+}
+
+/// Performs the memory fill one value at a time
+static void ReferenceMemoryFill(const Regs::MemoryFillConfig& config, u8* start, u8* end) {
+    if (config.fill_24bit) {
+        for (u8* ptr = start; ptr < end; ptr += 3) {
+            ptr[0] = config.value_24bit_r;
+            ptr[1] = config.value_24bit_g;
+            ptr[2] = config.value_24bit_b;
+        }
+    } else if (config.fill_32bit) {
+        const u32 value = config.value_32bit;
+        for (u8* ptr = start; end - ptr >= static_cast<ptrdiff_t>(sizeof(u32)); ptr += sizeof(u32))
+            std::memcpy(ptr, &value, sizeof(u32));
+    } else {
+        const u16 value = config.value_16bit.Value();
+        for (u8* ptr = start; ptr < end; ptr += sizeof(u16))
+            std::memcpy(ptr, &value, sizeof(u16));
+    }
+}
+
+TEST_CASE("Display transfers match the per-pixel transfer", "[video_core]") {
+    std::mt19937 rng(0);
+
+    const Regs::PixelFormat formats[] = {Regs::PixelFormat::RGBA8, Regs::PixelFormat::RGB8,
+                                         Regs::PixelFormat::RGB565, Regs::PixelFormat::RGB5A1,
+                                         Regs::PixelFormat::RGBA4};
+    const Regs::DisplayTransferConfig::ScalingMode scaling_modes[] = {
+        Regs::DisplayTransferConfig::NoScale, Regs::DisplayTransferConfig::ScaleX,
+        Regs::DisplayTransferConfig::ScaleXY};
+
+    for (Regs::PixelFormat input_format : formats) {
+        for (Regs::PixelFormat output_format : formats) {
+            for (int iteration = 0; iteration < 48; ++iteration) {
+                Regs::DisplayTransferConfig config{};
+                config.input_format.Assign(input_format);
+                config.output_format.Assign(output_format);
+                config.input_linear.Assign(iteration % 2);
+                config.dont_swizzle.Assign((iteration / 2) % 2);
+                config.flip_vertically.Assign((iteration / 4) % 2);
+                // Scaling is only supported on tiled input
+                const auto scaling = config.input_linear ? Regs::DisplayTransferConfig::NoScale
+                                                         : scaling_modes[(iteration / 8) % 3];
+                config.scaling.Assign(scaling);
+
+                // Tiled images are made up of whole tiles, the output is at most as large as the
+                // input and may cut off partial tiles when it is linear
+                const u32 input_width = 8 * (1 + rng() % 12);
+                const u32 input_height = 8 * (1 + rng() % 12);
+                const bool output_tiled = config.dont_swizzle ? !config.input_linear
+                                                              : config.input_linear != 0;
+                u32 output_width = input_width - (rng() % 2) * (rng() % 8);
+                u32 output_height = input_height - (rng() % 2) * (rng() % 8);
+                if (output_tiled)
+                    output_width = std::max(output_width & ~7u, 8u);
+                config.input_width.Assign(input_width);
+                config.input_height.Assign(input_height);
+                config.output_width.Assign(output_width);
+                config.output_height.Assign(output_height);
+
+                std::vector<u8> src(input_width * input_height * 4);
+                for (u8& byte : src)
+                    byte = static_cast<u8>(rng());
+                // Tiled output is written in whole rows of tiles
+                std::vector<u8> expected(input_width * (input_height + 8) * 4, 0xCD);
+                std::vector<u8> actual = expected;
+
+                ReferenceDisplayTransfer(config, src.data(), expected.data());
+                PerformDisplayTransfer(config, src.data(), actual.data());
+                REQUIRE(actual == expected);
+            }
+        }
+    }
+}
+
+TEST_CASE("Memory fills match the per-value fill", "[video_core]") {
+    std::mt19937 rng(0);
+
+    for (int iteration = 0; iteration < 300; ++iteration) {
+        Regs::MemoryFillConfig config{};
+        config.value_32bit = static_cast<u32>(rng());
+        switch (iteration % 3) {
+        case 0:
+            config.fill_24bit.Assign(1);
+            break;
+        case 1:
+            config.fill_32bit.Assign(1);
+            break;
+        }
+
+        // Sizes that are not multiples of the value size, as the end address is only 8 byte
+        // aligned, as well as fills larger than the block that is repeated
+        const u32 size = 8 * (1 + rng() % (iteration % 10 == 0 ? 4096 : 64));
+        std::vector<u8> expected(size + 16, 0xAB);
+        std::vector<u8> actual = expected;
+
+        ReferenceMemoryFill(config, expected.data() + 8, expected.data() + 8 + size);
+        PerformMemoryFill(config, actual.data() + 8, actual.data() + 8 + size);
+        REQUIRE(actual == expected);
+    }
+}
+
+} // namespace GPU
@@ -0,0 +1,109 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <random>
+#include <vector>
+#include <catch.hpp>
+#include "common/thread_pool.h"
+#include "video_core/morton.h"
+#include "video_core/utils.h"
+
+namespace VideoCore {
+
+/// Returns the offset of a pixel of the Morton-ordered image, computed one pixel at a time
+static size_t MortonPixelOffset(const MortonCopyInfo& info, u32 x, u32 y) {
+    return GetMortonOffset(x, y, info.bytes_per_pixel) + (y / 8) * info.morton_stride;
+}
+
+static size_t LinearPixelOffset(const MortonCopyInfo& info, u32 x, u32 y) {
+    const u32 linear_y = info.flip_vertically ? info.height - 1 - y : y;
+    return x * info.linear_pixel_stride + linear_y * info.linear_stride;
+}
+
+static u32 Rotate(u32 value, bool to_linear) {
+    return to_linear ? (value << 8) | (value >> 24) : (value >> 8) | (value << 24);
+}
+
+/// Copies the image one pixel at a time
+static void ReferenceCopy(const MortonCopyInfo& info, u8* morton_data, u8* linear_data,
+                          bool to_linear) {
+    for (u32 y = 0; y < info.height; ++y) {
+        for (u32 x = 0; x < info.width; ++x) {
+            u8* morton_pixel = morton_data + MortonPixelOffset(info, x, y);
+            u8* linear_pixel = linear_data + LinearPixelOffset(info, x, y);
+            u8* src = to_linear ? morton_pixel : linear_pixel;
+            u8* dst = to_linear ? linear_pixel : morton_pixel;
+
+            if (info.rotate_pixels) {
+                u32 value;
+                std::memcpy(&value, src, sizeof(u32));
+                value = Rotate(value, to_linear);
+                std::memcpy(dst, &value, sizeof(u32));
+            } else {
+                std::memcpy(dst, src, info.bytes_per_pixel);
+            }
+        }
+    }
+}
+
+TEST_CASE("Morton copies match the per-pixel copy", "[video_core]") {
+    std::mt19937 rng(0);
+    Common::ThreadPool pool(4);
+
+    struct PixelLayout {
+        u32 bytes_per_pixel;
+        u32 linear_pixel_stride;
+        bool rotate_pixels;
+    };
+    const PixelLayout layouts[] = {
+        {2, 2, false}, {3, 3, false}, {4, 4, false}, {4, 4, true}, {3, 4, false}, {2, 4, false},
+    };
+
+    for (const PixelLayout& layout : layouts) {
+        for (int iteration = 0; iteration < 40; ++iteration) {
+            // Includes sizes that are not multiples of the tile size, images with more Morton
+            // columns than are copied, and images large enough to be split across threads
+            const bool large = iteration % 10 == 0;
+            const u32 width = large ? 256 : 1 + rng() % 48;
+            const u32 height = large ? 136 : 1 + rng() % 48;
+            const u32 morton_width = (width + 7) / 8 * 8 + 8 * (rng() % 2);
+
+            MortonCopyInfo info;
+            info.width = width;
+            info.height = height;
+            info.bytes_per_pixel = layout.bytes_per_pixel;
+            info.morton_stride = 8 * morton_width * layout.bytes_per_pixel;
+            info.linear_pixel_stride = layout.linear_pixel_stride;
+            info.linear_stride = width * layout.linear_pixel_stride + 4 * (rng() % 2);
+            info.flip_vertically = rng() % 2 == 0;
+            info.rotate_pixels = layout.rotate_pixels;
+
+            const size_t morton_size = info.morton_stride * ((height + 7) / 8);
+            const size_t linear_size = info.linear_stride * height;
+            std::vector<u8> morton(morton_size);
+            std::vector<u8> linear(linear_size);
+            for (u8& byte : morton)
+                byte = static_cast<u8>(rng());
+            for (u8& byte : linear)
+                byte = static_cast<u8>(rng());
+
+            Common::ThreadPool* const copy_pool = iteration % 2 == 0 ? &pool : nullptr;
+
+            std::vector<u8> expected_linear = linear;
+            std::vector<u8> actual_linear = linear;
+            ReferenceCopy(info, morton.data(), expected_linear.data(), true);
+            MortonToLinear(info, morton.data(), actual_linear.data(), copy_pool);
+            REQUIRE(actual_linear == expected_linear);
+
+            std::vector<u8> expected_morton = morton;
+            std::vector<u8> actual_morton = morton;
+            ReferenceCopy(info, expected_morton.data(), linear.data(), false);
+            LinearToMorton(info, actual_morton.data(), linear.data(), copy_pool);
+            REQUIRE(actual_morton == expected_morton);
+        }
+    }
+}
+
+} // namespace VideoCore
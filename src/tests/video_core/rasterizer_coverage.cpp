@@ -0,0 +1,136 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <catch.hpp>
+#include "video_core/swrasterizer/coverage.h"
+
+namespace Pica {
+namespace Rasterizer {
+
+constexpr int FRAMEBUFFER_SIZE = 96;
+
+/// Stores an RGBA8 color for every pixel covered by a triangle
+using TestFramebuffer = std::vector<u8>;
+
+/// Blends a color derived from the barycentric coordinates into the pixel, so that the result
+/// depends on both the set of covered pixels and the coordinates they were shaded with
+static void DrawPixel(TestFramebuffer& framebuffer, int x, int y, int w0, int w1, int w2) {
+    REQUIRE(x % 0x10 == 8);
+    REQUIRE(y % 0x10 == 8);
+    u8* pixel = &framebuffer[((y >> 4) * FRAMEBUFFER_SIZE + (x >> 4)) * 4];
+    const int color[] = {w0, w1, w2, w0 + w1 + w2};
+    for (int i = 0; i < 4; ++i)
+        pixel[i] = static_cast<u8>(pixel[i] * 31 + color[i] + (color[i] >> 8));
+}
+
+/// Rasterizes the triangle one pixel at a time, evaluating the edge functions for each pixel
+static void ReferenceRasterize(const TriangleCoverage& triangle, TestFramebuffer& framebuffer) {
+    const auto& vtx = triangle.vtx;
+    for (int y = triangle.min_py * 0x10 + 8; y < triangle.max_py * 0x10; y += 0x10) {
+        for (int x = triangle.min_px * 0x10 + 8; x < triangle.max_px * 0x10; x += 0x10) {
+            const int w0 = triangle.bias[0] + EdgeFunction(vtx[1], vtx[2], {x, y});
+            const int w1 = triangle.bias[1] + EdgeFunction(vtx[2], vtx[0], {x, y});
+            const int w2 = triangle.bias[2] + EdgeFunction(vtx[0], vtx[1], {x, y});
+            if (w0 < 0 || w1 < 0 || w2 < 0)
+                continue;
+            DrawPixel(framebuffer, x, y, w0, w1, w2);
+        }
+    }
+}
+
+static bool IsRightSideOrFlatBottomEdge(const Math::Vec2<int>& vtx, const Math::Vec2<int>& line1,
+                                        const Math::Vec2<int>& line2) {
+    if (line1.y == line2.y)
+        return vtx.y < line1.y;
+    return vtx.x < line1.x + (line2.x - line1.x) * (vtx.y - line1.y) / (line2.y - line1.y);
+}
+
+/// Sets up a triangle the way ProcessTriangle does, with the given bounds in whole pixels
+static TriangleCoverage MakeTriangle(Math::Vec2<int> v0, Math::Vec2<int> v1, Math::Vec2<int> v2,
+                                     int tile_row_phase) {
+    // The rasterizer only handles counter-clockwise triangles
+    if (EdgeFunction(v0, v1, v2) < 0)
+        std::swap(v1, v2);
+
+    TriangleCoverage triangle;
+    triangle.vtx[0] = v0;
+    triangle.vtx[1] = v1;
+    triangle.vtx[2] = v2;
+    triangle.bias[0] = IsRightSideOrFlatBottomEdge(v0, v1, v2) ? -1 : 0;
+    triangle.bias[1] = IsRightSideOrFlatBottomEdge(v1, v2, v0) ? -1 : 0;
+    triangle.bias[2] = IsRightSideOrFlatBottomEdge(v2, v0, v1) ? -1 : 0;
+
+    const int min_x = std::min({v0.x, v1.x, v2.x}) & ~0xF;
+    const int min_y = std::min({v0.y, v1.y, v2.y}) & ~0xF;
+    const int max_x = (std::max({v0.x, v1.x, v2.x}) + 0xF) & ~0xF;
+    const int max_y = (std::max({v0.y, v1.y, v2.y}) + 0xF) & ~0xF;
+    triangle.min_px = std::max(min_x >> 4, 0);
+    triangle.min_py = std::max(min_y >> 4, 0);
+    triangle.max_px = std::min(max_x >> 4, FRAMEBUFFER_SIZE);
+    triangle.max_py = std::min(max_y >> 4, FRAMEBUFFER_SIZE);
+    triangle.tile_row_phase = tile_row_phase;
+    return triangle;
+}
+
+static void CompareRasterization(const std::vector<TriangleCoverage>& triangles) {
+    TestFramebuffer expected(FRAMEBUFFER_SIZE * FRAMEBUFFER_SIZE * 4);
+    TestFramebuffer actual(expected.size());
+    for (const TriangleCoverage& triangle : triangles) {
+        ReferenceRasterize(triangle, expected);
+        ForEachCoveredPixel(triangle, [&](int x, int y, int w0, int w1, int w2) {
+            DrawPixel(actual, x, y, w0, w1, w2);
+        });
+    }
+    REQUIRE(actual == expected);
+}
+
+TEST_CASE("Quad coverage matches per-pixel rasterization of fixed triangles", "[video_core]") {
+    // Axis-aligned edges, shared edges, vertices on pixel centers and degenerate triangles
+    const int tile_row_phase = 3;
+    std::vector<TriangleCoverage> triangles = {
+        MakeTriangle({0x088, 0x088}, {0x488, 0x088}, {0x088, 0x488}, tile_row_phase),
+        MakeTriangle({0x488, 0x088}, {0x488, 0x488}, {0x088, 0x488}, tile_row_phase),
+        MakeTriangle({0x100, 0x100}, {0x580, 0x133}, {0x2F7, 0x5A1}, tile_row_phase),
+        MakeTriangle({0x000, 0x000}, {0x600, 0x000}, {0x300, 0x600}, tile_row_phase),
+        MakeTriangle({0x010, 0x020}, {0x010, 0x5F0}, {0x5F0, 0x300}, tile_row_phase),
+        MakeTriangle({0x123, 0x234}, {0x345, 0x456}, {0x567, 0x678}, tile_row_phase),
+        MakeTriangle({0x200, 0x200}, {0x200, 0x200}, {0x200, 0x200}, tile_row_phase),
+        MakeTriangle({0x0C8, 0x5E8}, {0x298, 0x018}, {0x4D8, 0x5F8}, tile_row_phase),
+    };
+    CompareRasterization(triangles);
+}
+
+TEST_CASE("Quad coverage matches per-pixel rasterization of random triangles", "[video_core]") {
+    std::mt19937 rng(0);
+    // Vertices may lie outside of the framebuffer, whose bounds then clip the bounding box
+    std::uniform_int_distribution<int> coordinate(0, (FRAMEBUFFER_SIZE + 16) * 0x10);
+    std::uniform_int_distribution<int> offset(-0x80, 0x80);
+
+    for (int iteration = 0; iteration < 200; ++iteration) {
+        const int tile_row_phase = iteration % 8;
+        std::vector<TriangleCoverage> triangles;
+        for (int i = 0; i < 8; ++i) {
+            // Mix large triangles with small ones, which are often covered by a single quad
+            const Math::Vec2<int> v0 = {coordinate(rng), coordinate(rng)};
+            if (i % 2 == 0) {
+                triangles.push_back(MakeTriangle(v0, {coordinate(rng), coordinate(rng)},
+                                                 {coordinate(rng), coordinate(rng)},
+                                                 tile_row_phase));
+            } else {
+                const auto Near = [&] {
+                    return Math::Vec2<int>{std::max(0, v0.x + offset(rng)),
+                                           std::max(0, v0.y + offset(rng))};
+                };
+                triangles.push_back(MakeTriangle(v0, Near(), Near(), tile_row_phase));
+            }
+        }
+        CompareRasterization(triangles);
+    }
+}
+
+} // namespace Rasterizer
+} // namespace Pica
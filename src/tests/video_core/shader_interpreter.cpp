@@ -0,0 +1,79 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#ifdef ARCHITECTURE_x86_64
+
+#include <cstring>
+#include <random>
+#include <vector>
+#include <catch.hpp>
+#include "video_core/shader/shader.h"
+#include "video_core/shader/shader_interpreter.h"
+#include "video_core/shader/shader_jit_x64_compiler.h"
+#include "tests/video_core/shader_test_common.h"
+
+namespace Pica {
+namespace Shader {
+
+/// Operand descriptor that writes yw, negates src1 and reverses the components of src2
+constexpr u32 MIXED_SWIZZLE = 0x5 | (1 << 4) | (0x39 << 5) | (0xE4 << 14) | (0x1B << 23);
+
+TEST_CASE("InterpreterEngine matches JitShader", "[video_core][shader]") {
+    // Registers: 0x00 inputs, 0x10 temporaries, 0x20 float uniforms; outputs are dest 0x00
+    const std::vector<u32> code = {
+        Compare(0x20, 0x00, CompareOp::LessThan, CompareOp::GreaterEqual),
+        ConditionalFlowControl(OpCode::Id::IFC, 5, 2, ConditionOp::JustX, true, false),
+        Arithmetic(OpCode::Id::DP4, 0x00, 0x01, 0x02),
+        Arithmetic(OpCode::Id::MUL, 0x01, 0x21, 0x02, 0, 1),
+        Arithmetic(OpCode::Id::EX2, 0x11, 0x01, 0x00),
+        Mad(OpCode::Id::MAD, 0x00, 0x02, 0x22, 0x11),
+        Arithmetic(OpCode::Id::MAX, 0x01, 0x23, 0x01),
+        Arithmetic(OpCode::Id::MOVA, 0x00, 0x03, 0x00),
+        Arithmetic(OpCode::Id::MOV, 0x02, 0x24, 0x00, 1),
+        UniformFlowControl(OpCode::Id::LOOP, 10, 0, 0),
+        Arithmetic(OpCode::Id::ADD, 0x10, 0x30, 0x10, 3),
+        Arithmetic(OpCode::Id::MOV, 0x03, 0x10, 0x00),
+        UniformFlowControl(OpCode::Id::CALLU, 15, 2, 1),
+        Arithmetic(OpCode::Id::SLTI, 0x06, 0x02, 0x21),
+        FlowControl(OpCode::Id::END, 0),
+        Arithmetic(OpCode::Id::RCP, 0x04, 0x01, 0x00),
+        Mad(OpCode::Id::MADI, 0x05, 0x03, 0x02, 0x25),
+    };
+
+    std::mt19937 rng(0);
+    auto setup = MakeTestSetup(code, rng);
+    setup->WriteSwizzleData(1, MIXED_SWIZZLE);
+    setup->uniforms.b[1] = true;
+
+    const ShaderRegs config = MakeTestConfig();
+
+    JitShader shader;
+    shader.Compile(&setup->program_code, &setup->swizzle_data, 0xFFFF);
+    InterpreterEngine interpreter;
+    interpreter.SetupBatch(*setup, 0, 0xFFFF);
+
+    for (int iteration = 0; iteration < 100; ++iteration) {
+        AttributeBuffer input;
+        RandomTestInputs(&input, 1, rng);
+
+        AttributeBuffer expected{};
+        UnitState jit_state{};
+        jit_state.LoadInput(config, input);
+        shader.Run(*setup, jit_state, 0);
+        jit_state.WriteOutput(config, expected);
+
+        AttributeBuffer output{};
+        UnitState interpreter_state{};
+        interpreter_state.LoadInput(config, input);
+        interpreter.Run(*setup, interpreter_state);
+        interpreter_state.WriteOutput(config, output);
+
+        REQUIRE(std::memcmp(&output, &expected, sizeof(AttributeBuffer)) == 0);
+    }
+}
+
+} // namespace Shader
+} // namespace Pica
+
+#endif // ARCHITECTURE_x86_64
@@ -0,0 +1,110 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#ifdef ARCHITECTURE_x86_64
+
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+#include <catch.hpp>
+#include "video_core/shader/shader.h"
+#include "video_core/shader/shader_jit_x64_batch_compiler.h"
+#include "video_core/shader/shader_jit_x64_compiler.h"
+#include "tests/video_core/shader_test_common.h"
+
+namespace Pica {
+namespace Shader {
+
+/// Runs the program with the scalar and the batch JIT and compares the outputs bit for bit
+static bool RunBoth(const ShaderSetup& setup, const AttributeBuffer* inputs, unsigned count) {
+    const ShaderRegs config = MakeTestConfig();
+
+    JitShader shader;
+    shader.Compile(&setup.program_code, &setup.swizzle_data, 0xFFFF);
+    std::vector<AttributeBuffer> expected(count);
+    for (unsigned i = 0; i < count; ++i) {
+        UnitState state{};
+        state.LoadInput(config, inputs[i]);
+        shader.Run(setup, state, 0);
+        state.WriteOutput(config, expected[i]);
+    }
+
+    auto batch_shader = std::make_unique<JitBatchShader>();
+    REQUIRE(batch_shader->Compile(&setup.program_code, &setup.swizzle_data, 0, 0xFFFF));
+    auto batch_state = std::make_unique<BatchUnitState>();
+    batch_state->LoadInput(config, inputs, count);
+    if (!batch_shader->Run(setup, *batch_state, 0))
+        return false;
+
+    std::vector<AttributeBuffer> outputs(count);
+    batch_state->WriteOutput(config, outputs.data(), count);
+    for (unsigned i = 0; i < count; ++i)
+        REQUIRE(std::memcmp(&outputs[i], &expected[i], sizeof(AttributeBuffer)) == 0);
+    return true;
+}
+
+TEST_CASE("JitBatchShader matches JitShader", "[video_core][shader]") {
+    if (!JitBatchShader::IsSupported())
+        return;
+
+    // Registers: 0x00 inputs, 0x10 temporaries, 0x20 float uniforms; outputs are dest 0x00
+    const std::vector<u32> code = {
+        Compare(0x20, 0x00, CompareOp::LessThan, CompareOp::GreaterEqual),
+        ConditionalFlowControl(OpCode::Id::IFC, 5, 2, ConditionOp::JustX, true, false),
+        Arithmetic(OpCode::Id::DP4, 0x00, 0x01, 0x02),
+        Arithmetic(OpCode::Id::MUL, 0x01, 0x21, 0x02),
+        Arithmetic(OpCode::Id::EX2, 0x11, 0x01, 0x00),
+        Mad(OpCode::Id::MAD, 0x00, 0x02, 0x22, 0x11),
+        Arithmetic(OpCode::Id::MAX, 0x01, 0x23, 0x01),
+        Arithmetic(OpCode::Id::MOVA, 0x00, 0x03, 0x00),
+        Arithmetic(OpCode::Id::MOV, 0x02, 0x24, 0x00, 1),
+        UniformFlowControl(OpCode::Id::LOOP, 10, 0, 0),
+        Arithmetic(OpCode::Id::ADD, 0x10, 0x30, 0x10, 3),
+        Arithmetic(OpCode::Id::MOV, 0x03, 0x10, 0x00),
+        FlowControl(OpCode::Id::CALL, 14, 2),
+        FlowControl(OpCode::Id::END, 0),
+        Arithmetic(OpCode::Id::RCP, 0x04, 0x01, 0x00),
+        Arithmetic(OpCode::Id::RSQ, 0x05, 0x02, 0x00),
+    };
+
+    std::mt19937 rng(0);
+    auto setup = MakeTestSetup(code, rng);
+    for (int iteration = 0; iteration < 100; ++iteration) {
+        AttributeBuffer inputs[BatchUnitState::NUM_LANES];
+        const unsigned count = 1 + rng() % BatchUnitState::NUM_LANES;
+        RandomTestInputs(inputs, count, rng);
+        REQUIRE(RunBoth(*setup, inputs, count));
+    }
+}
+
+TEST_CASE("JitBatchShader bails out of divergent jumps", "[video_core][shader]") {
+    if (!JitBatchShader::IsSupported())
+        return;
+
+    const std::vector<u32> code = {
+        Compare(0x20, 0x00, CompareOp::LessThan, CompareOp::LessThan),
+        ConditionalFlowControl(OpCode::Id::JMPC, 3, 0, ConditionOp::JustX, true, false),
+        Arithmetic(OpCode::Id::MOV, 0x00, 0x01, 0x00),
+        FlowControl(OpCode::Id::END, 0),
+    };
+
+    std::mt19937 rng(0);
+    auto setup = MakeTestSetup(code, rng);
+    setup->uniforms.f[0][0] = float24::FromFloat32(1.0f);
+
+    AttributeBuffer inputs[2];
+    RandomTestInputs(inputs, 2, rng);
+    inputs[0].attr[0][0] = float24::FromFloat32(0.0f);
+    inputs[1].attr[0][0] = float24::FromFloat32(0.5f);
+    REQUIRE(RunBoth(*setup, inputs, 2));
+
+    inputs[1].attr[0][0] = float24::FromFloat32(2.0f);
+    REQUIRE(!RunBoth(*setup, inputs, 2));
+}
+
+} // namespace Shader
+} // namespace Pica
+
+#endif // ARCHITECTURE_x86_64
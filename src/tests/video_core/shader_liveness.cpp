@@ -0,0 +1,93 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <memory>
+#include <vector>
+#include <catch.hpp>
+#include "video_core/shader/shader.h"
+#include "video_core/shader/shader_liveness.h"
+#include "tests/video_core/shader_test_common.h"
+
+namespace Pica {
+namespace Shader {
+
+/// Operand descriptor that only writes the x component
+constexpr u32 WRITE_X_SWIZZLE = 0x8 | (0x1B << 5) | (0x1B << 14) | (0x1B << 23);
+
+static std::bitset<MAX_PROGRAM_CODE_LENGTH> Analyze(const std::vector<u32>& code,
+                                                    u32 output_mask) {
+    auto program_code = std::make_unique<std::array<u32, MAX_PROGRAM_CODE_LENGTH>>();
+    auto swizzle_data = std::make_unique<std::array<u32, MAX_SWIZZLE_DATA_LENGTH>>();
+    program_code->fill(FlowControl(OpCode::Id::END, 0));
+    std::copy(code.begin(), code.end(), program_code->begin());
+    swizzle_data->fill(0);
+    (*swizzle_data)[0] = IDENTITY_SWIZZLE;
+    (*swizzle_data)[1] = WRITE_X_SWIZZLE;
+    return FindDeadInstructions(*program_code, *swizzle_data, output_mask);
+}
+
+// Registers: 0x00 inputs, 0x10 temporaries, 0x20 float uniforms; outputs are dest 0x00
+
+TEST_CASE("FindDeadInstructions removes unused outputs", "[video_core][shader]") {
+    const auto dead = Analyze(
+        {
+            Arithmetic(OpCode::Id::MUL, 0x10, 0x00, 0x20), // Only feeds o1
+            Arithmetic(OpCode::Id::MOV, 0x01, 0x10, 0x00), // o1 is not read
+            Arithmetic(OpCode::Id::ADD, 0x11, 0x00, 0x21), // Feeds o0
+            Arithmetic(OpCode::Id::MOV, 0x00, 0x11, 0x00),
+            FlowControl(OpCode::Id::END, 0),
+        },
+        0x1);
+
+    REQUIRE(dead[0]);
+    REQUIRE(dead[1]);
+    REQUIRE(!dead[2]);
+    REQUIRE(!dead[3]);
+}
+
+TEST_CASE("FindDeadInstructions tracks components", "[video_core][shader]") {
+    const auto dead = Analyze(
+        {
+            Arithmetic(OpCode::Id::MOV, 0x10, 0x00, 0x00),       // Overwritten before being read
+            Arithmetic(OpCode::Id::MOV, 0x10, 0x01, 0x00),       // Only x is overwritten
+            Arithmetic(OpCode::Id::MOV, 0x10, 0x02, 0x00, 0, 1), // Writes x
+            Arithmetic(OpCode::Id::MOV, 0x00, 0x10, 0x00),
+            FlowControl(OpCode::Id::END, 0),
+        },
+        0x1);
+
+    REQUIRE(dead[0]);
+    REQUIRE(!dead[1]);
+    REQUIRE(!dead[2]);
+    REQUIRE(!dead[3]);
+}
+
+TEST_CASE("FindDeadInstructions follows flow control", "[video_core][shader]") {
+    const auto dead = Analyze(
+        {
+            Arithmetic(OpCode::Id::MOV, 0x11, 0x00, 0x00),
+            FlowControl(OpCode::Id::LOOP, 3),
+            Arithmetic(OpCode::Id::ADD, 0x00, 0x11, 0x20), // Reads t1 of the previous iteration
+            Arithmetic(OpCode::Id::MUL, 0x11, 0x11, 0x21),
+            Arithmetic(OpCode::Id::MOV, 0x11, 0x01, 0x00),
+            FlowControl(OpCode::Id::CALL, 7, 2),
+            FlowControl(OpCode::Id::END, 0),
+            Arithmetic(OpCode::Id::MOV, 0x01, 0x12, 0x00), // Reads t2 of the previous invocation
+            Arithmetic(OpCode::Id::MOV, 0x12, 0x00, 0x00),
+        },
+        0x3);
+
+    REQUIRE(!dead[0]);
+    REQUIRE(!dead[2]);
+    REQUIRE(!dead[3]);
+    REQUIRE(!dead[4]);
+    REQUIRE(!dead[7]);
+    REQUIRE(!dead[8]);
+}
+
+} // namespace Shader
+} // namespace Pica
@@ -0,0 +1,103 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <memory>
+#include <random>
+#include <vector>
+#include <nihstro/shader_bytecode.h>
+#include "common/common_types.h"
+#include "video_core/shader/shader.h"
+
+namespace Pica {
+namespace Shader {
+
+using nihstro::Instruction;
+using nihstro::OpCode;
+
+using CompareOp = Instruction::Common::CompareOpType::Op;
+using ConditionOp = Instruction::FlowControlType::Op;
+
+/// Operand descriptor that enables all components and passes the sources through unswizzled
+constexpr u32 IDENTITY_SWIZZLE = 0xF | (0x1B << 5) | (0x1B << 14) | (0x1B << 23);
+
+/// Encodes an instruction of the arithmetic formats, whose sources are addressed by src1 and src2
+inline u32 Arithmetic(OpCode::Id op, u32 dest, u32 src1, u32 src2, u32 address_index = 0,
+                      u32 operand_desc = 0) {
+    return (static_cast<u32>(op) << 26) | (dest << 21) | (address_index << 19) | (src1 << 12) |
+           (src2 << 7) | operand_desc;
+}
+
+/// Encodes MAD or MADI
+inline u32 Mad(OpCode::Id op, u32 dest, u32 src1, u32 src2, u32 src3, u32 operand_desc = 0) {
+    return (static_cast<u32>(op) << 26) | (dest << 24) | (src1 << 17) | (src2 << 10) |
+           (src3 << 5) | operand_desc;
+}
+
+inline u32 Compare(u32 src1, u32 src2, CompareOp x, CompareOp y) {
+    return (static_cast<u32>(OpCode::Id::CMP) << 26) | (static_cast<u32>(x) << 24) |
+           (static_cast<u32>(y) << 21) | (src1 << 12) | (src2 << 7);
+}
+
+/// Encodes a flow control instruction that does not depend on a condition or a uniform, e.g. END,
+/// CALL or JMP
+inline u32 FlowControl(OpCode::Id op, u32 dest, u32 num = 0) {
+    return (static_cast<u32>(op) << 26) | (dest << 10) | num;
+}
+
+/// Encodes IFC, CALLC, JMPC or BREAKC, which test the conditional code against refx and refy
+inline u32 ConditionalFlowControl(OpCode::Id op, u32 dest, u32 num, ConditionOp condition,
+                                  bool refx, bool refy) {
+    return FlowControl(op, dest, num) | (static_cast<u32>(refx) << 25) |
+           (static_cast<u32>(refy) << 24) | (static_cast<u32>(condition) << 22);
+}
+
+/// Encodes IFU, CALLU or JMPU, which test a boolean uniform, or LOOP, which reads an integer one
+inline u32 UniformFlowControl(OpCode::Id op, u32 dest, u32 num, u32 uniform) {
+    return FlowControl(op, dest, num) | (uniform << 22);
+}
+
+/**
+ * Creates a setup running the given program, whose operand descriptor 0 is IDENTITY_SWIZZLE. The
+ * float uniforms are random, and integer uniform 0 makes a LOOP run four times.
+ */
+inline std::unique_ptr<ShaderSetup> MakeTestSetup(const std::vector<u32>& code,
+                                                  std::mt19937& rng) {
+    auto setup = std::make_unique<ShaderSetup>();
+    for (u32 offset = 0; offset < code.size(); ++offset)
+        setup->WriteProgramCode(offset, code[offset]);
+    setup->WriteSwizzleData(0, IDENTITY_SWIZZLE);
+    for (auto& uniform : setup->uniforms.f) {
+        for (unsigned comp = 0; comp < 4; ++comp)
+            uniform[comp] = float24::FromFloat32(static_cast<int>(rng() % 200) / 16.0f - 6.0f);
+    }
+    setup->uniforms.i[0] = Math::Vec4<u8>(3, 0, 1, 0);
+    return setup;
+}
+
+/// Fills the inputs with random values, those of attribute 3 being valid address offsets
+inline void RandomTestInputs(AttributeBuffer* inputs, unsigned count, std::mt19937& rng) {
+    for (unsigned i = 0; i < count; ++i) {
+        for (auto& attribute : inputs[i].attr) {
+            for (unsigned comp = 0; comp < 4; ++comp)
+                attribute[comp] = float24::FromFloat32(static_cast<int>(rng() % 200) / 16.0f);
+        }
+        for (unsigned comp = 0; comp < 4; ++comp)
+            inputs[i].attr[3][comp] = float24::FromFloat32(static_cast<float>(rng() % 4));
+    }
+}
+
+/// Configuration that loads input attribute n into input register n and writes all outputs
+inline ShaderRegs MakeTestConfig() {
+    ShaderRegs config{};
+    config.max_input_attribute_index.Assign(15);
+    config.input_attribute_to_register_map_low = 0x76543210;
+    config.input_attribute_to_register_map_high = 0xFEDCBA98;
+    config.output_mask.Assign(0xFFFF);
+    return config;
+}
+
+} // namespace Shader
+} // namespace Pica
@@ -0,0 +1,158 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <random>
+#include <vector>
+#include <catch.hpp>
+#include "common/thread_pool.h"
+#ifdef ARCHITECTURE_x86_64
+#include "common/x64/cpu_detect.h"
+#endif
+#include "video_core/texture/texture_decode.h"
+
+namespace Pica {
+namespace Texture {
+
+using TextureFormat = TexturingRegs::TextureFormat;
+
+static const TextureFormat all_formats[] = {
+    TextureFormat::RGBA8, TextureFormat::RGB8, TextureFormat::RGB5A1, TextureFormat::RGB565,
+    TextureFormat::RGBA4, TextureFormat::IA8,  TextureFormat::RG8,    TextureFormat::I8,
+    TextureFormat::A8,    TextureFormat::IA4,  TextureFormat::I4,     TextureFormat::A4,
+    TextureFormat::ETC1,  TextureFormat::ETC1A4,
+};
+
+/// Packs a texel into a single value, so that mismatches are printed legibly
+static u32 Pack(const Math::Vec4<u8>& texel) {
+    return texel.r() | (texel.g() << 8) | (texel.b() << 16) | (texel.a() << 24);
+}
+
+TEST_CASE("DecodeTile8x8 matches LookupTexelInTile", "[video_core]") {
+    std::mt19937 rng(0);
+
+    for (TextureFormat format : all_formats) {
+        TextureInfo info;
+        info.format = format;
+
+        for (int iteration = 0; iteration < 100; ++iteration) {
+            std::vector<u8> tile(CalculateTileSize(format));
+            for (u8& byte : tile)
+                byte = static_cast<u8>(rng());
+
+            Math::Vec4<u8> texels[64];
+            DecodeTile8x8(format, tile.data(), texels);
+
+            for (unsigned int y = 0; y < 8; ++y) {
+                for (unsigned int x = 0; x < 8; ++x) {
+                    const auto expected = LookupTexelInTile(tile.data(), x, y, info, false);
+                    REQUIRE(Pack(texels[x + 8 * y]) == Pack(expected));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Every tile decoder the host supports matches LookupTexelInTile", "[video_core]") {
+    std::mt19937 rng(0);
+
+    for (TileDecoderISA isa :
+         {TileDecoderISA::Generic, TileDecoderISA::SSE41, TileDecoderISA::AVX2}) {
+        unsigned int num_decoders = 0;
+        for (TextureFormat format : all_formats) {
+            TextureInfo info;
+            info.format = format;
+
+            for (int iteration = 0; iteration < 100; ++iteration) {
+                std::vector<u8> tile(CalculateTileSize(format));
+                for (u8& byte : tile)
+                    byte = static_cast<u8>(rng());
+
+                Math::Vec4<u8> texels[64];
+                if (!DecodeTile8x8(isa, format, tile.data(), texels))
+                    break;
+                if (iteration == 0)
+                    ++num_decoders;
+
+                for (unsigned int y = 0; y < 8; ++y) {
+                    for (unsigned int x = 0; x < 8; ++x) {
+                        const auto expected = LookupTexelInTile(tile.data(), x, y, info, false);
+                        REQUIRE(Pack(texels[x + 8 * y]) == Pack(expected));
+                    }
+                }
+            }
+        }
+
+        // Make sure that the vector decoders are not skipped on hosts that can run them
+        bool host_supports_isa = isa == TileDecoderISA::Generic;
+#ifdef ARCHITECTURE_x86_64
+        const auto& caps = Common::GetCPUCaps();
+        host_supports_isa |= (isa == TileDecoderISA::SSE41 && caps.sse4_1) ||
+                             (isa == TileDecoderISA::AVX2 && caps.avx2);
+#endif
+        if (isa == TileDecoderISA::Generic)
+            REQUIRE(num_decoders == sizeof(all_formats) / sizeof(all_formats[0]));
+        else if (host_supports_isa)
+            REQUIRE(num_decoders > 0);
+        else
+            REQUIRE(num_decoders == 0);
+    }
+}
+
+TEST_CASE("DecodeTexture matches LookupTexture", "[video_core]") {
+    std::mt19937 rng(0);
+
+    for (TextureFormat format : all_formats) {
+        TextureInfo info;
+        info.format = format;
+        info.width = 24;
+        info.height = 16;
+        info.SetDefaultStride();
+
+        std::vector<u8> data(info.stride * info.height / 8);
+        for (u8& byte : data)
+            byte = static_cast<u8>(rng());
+
+        // Store the rows upside down to cover negative strides
+        std::vector<Math::Vec4<u8>> texels(info.width * info.height);
+        DecodeTexture(info, data.data(), texels.data() + info.width * (info.height - 1),
+                      -static_cast<ptrdiff_t>(info.width));
+
+        for (unsigned int y = 0; y < info.height; ++y) {
+            for (unsigned int x = 0; x < info.width; ++x) {
+                const auto expected = LookupTexture(data.data(), x, y, info);
+                REQUIRE(Pack(texels[x + info.width * (info.height - 1 - y)]) == Pack(expected));
+            }
+        }
+    }
+}
+
+TEST_CASE("DecodeTexture with a thread pool matches LookupTexture", "[video_core]") {
+    std::mt19937 rng(0);
+    Common::ThreadPool pool(4);
+
+    for (TextureFormat format : {TextureFormat::RGBA8, TextureFormat::ETC1A4}) {
+        TextureInfo info;
+        info.format = format;
+        info.width = 256;
+        info.height = 128;
+        info.SetDefaultStride();
+
+        std::vector<u8> data(info.stride * info.height / 8);
+        for (u8& byte : data)
+            byte = static_cast<u8>(rng());
+
+        std::vector<Math::Vec4<u8>> texels(info.width * info.height);
+        DecodeTexture(info, data.data(), texels.data(), info.width, &pool);
+
+        for (unsigned int y = 0; y < info.height; ++y) {
+            for (unsigned int x = 0; x < info.width; ++x) {
+                const auto expected = LookupTexture(data.data(), x, y, info);
+                REQUIRE(Pack(texels[x + info.width * y]) == Pack(expected));
+            }
+        }
+    }
+}
+
+} // namespace Texture
+} // namespace Pica
@@ -0,0 +1,100 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#ifdef ARCHITECTURE_x86_64
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <catch.hpp>
+#include "core/memory.h"
+#include "core/memory_setup.h"
+#include "video_core/debug_utils/debug_utils.h"
+#include "video_core/pica_state.h"
+#include "video_core/regs.h"
+#include "video_core/shader/shader.h"
+#include "video_core/vertex_loader.h"
+#include "video_core/vertex_loader_jit_x64.h"
+#include "video_core/video_core.h"
+
+namespace Pica {
+
+TEST_CASE("VertexLoaderJit matches LoadVertex", "[video_core]") {
+    if (!VertexLoaderJit::IsSupported())
+        return;
+
+    // The vertex data is stored in VRAM, which LoadVertex reads from by physical address
+    std::mt19937 rng(0);
+    std::vector<u8> vram(Memory::VRAM_SIZE);
+    std::generate_n(vram.begin(), 0x8000, [&rng] { return static_cast<u8>(rng()); });
+    Memory::MapMemoryRegion(Memory::VRAM_VADDR, Memory::VRAM_SIZE, vram.data());
+
+    const bool shader_jit_enabled = VideoCore::g_shader_jit_enabled;
+    VideoCore::g_shader_jit_enabled = true;
+
+    for (int iteration = 0; iteration < 500; ++iteration) {
+        Regs regs{};
+        auto& attributes = regs.pipeline.vertex_attributes;
+
+        // Random formats and sizes of the attributes, four bits each
+        u32 format_words[2] = {};
+        for (unsigned i = 0; i < 12; ++i)
+            format_words[i / 8] |= (rng() % 16) << (4 * (i % 8));
+        regs.reg_array[PICA_REG_INDEX(pipeline.vertex_attributes.format0)] = format_words[0];
+        regs.reg_array[PICA_REG_INDEX(pipeline.vertex_attributes.format8)] = format_words[1];
+        attributes.attribute_mask.Assign(rng() % 0x1000);
+        attributes.max_attribute_index.Assign(rng() % 16);
+
+        for (unsigned i = 0; i < 16; ++i) {
+            for (unsigned comp = 0; comp < 4; ++comp) {
+                g_state.input_default_attributes.attr[i][comp] =
+                    float24::FromFloat32(static_cast<float>(rng() % 100));
+            }
+        }
+
+        // Loaders with several attributes, whose ids 12 to 15 insert padding, and unused loaders
+        for (auto& loader : attributes.attribute_loaders) {
+            if (rng() % 4 == 0)
+                continue;
+            loader.data_offset.Assign(rng() % 0x1000);
+            loader.byte_count.Assign(rng() % 64);
+            loader.component_count.Assign(1 + rng() % 3);
+            loader.comp0.Assign(rng() % 16);
+            loader.comp1.Assign(rng() % 16);
+            loader.comp2.Assign(rng() % 16);
+        }
+
+        std::vector<u32> vertices(1 + rng() % 32);
+        const u32 first_vertex = rng() % 64;
+        for (u32& vertex : vertices)
+            vertex = first_vertex + rng() % 128;
+        const auto range = std::minmax_element(vertices.begin(), vertices.end());
+
+        VertexLoader loader(regs.pipeline);
+        REQUIRE(loader.SetupCompiledLoader(Memory::VRAM_PADDR, *range.first, *range.second));
+
+        // Attributes that are neither loaded nor default must be left untouched
+        std::vector<Shader::AttributeBuffer> inputs(vertices.size()), expected(vertices.size());
+        std::memset(inputs.data(), 0x55, inputs.size() * sizeof(Shader::AttributeBuffer));
+        std::memset(expected.data(), 0x55, expected.size() * sizeof(Shader::AttributeBuffer));
+
+        loader.LoadVertices(vertices.data(), vertices.size(), inputs.data());
+
+        DebugUtils::MemoryAccessTracker memory_accesses;
+        for (size_t v = 0; v < vertices.size(); ++v) {
+            loader.LoadVertex(Memory::VRAM_PADDR, static_cast<int>(v), vertices[v], expected[v],
+                              memory_accesses);
+            REQUIRE(std::memcmp(&inputs[v], &expected[v], sizeof(Shader::AttributeBuffer)) == 0);
+        }
+    }
+
+    VertexLoader::ClearCompiledLoaders();
+    VideoCore::g_shader_jit_enabled = shader_jit_enabled;
+    Memory::UnmapRegion(Memory::VRAM_VADDR, Memory::VRAM_SIZE);
+}
+
+} // namespace Pica
+
+#endif // ARCHITECTURE_x86_64
@@ -2,20 +2,28 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstddef>
 #include <memory>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 #include "common/assert.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
 #include "common/microprofile.h"
+#include "common/thread_pool.h"
 #include "common/vector_math.h"
 #include "core/hle/service/gsp_gpu.h"
 #include "core/hw/gpu.h"
 #include "core/memory.h"
+#include "core/settings.h"
 #include "core/tracer/recorder.h"
 #include "video_core/command_processor.h"
 #include "video_core/debug_utils/debug_utils.h"
+#include "video_core/dirty_regs.h"
 #include "video_core/pica_state.h"
 #include "video_core/pica_types.h"
 #include "video_core/primitive_assembly.h"
@@ -49,6 +57,158 @@ static const u32 expand_bits_to_bytes[] = {
 
 MICROPROFILE_DEFINE(GPU_Drawing, "GPU", "Drawing", MP_RGB(50, 50, 240));
 
+/// Dirty group of each register, see DirtyGroup
+struct DirtyGroupTable {
+    u8 groups[Regs::NUM_REGS];
+};
+
+static constexpr void SetGroup(DirtyGroupTable& table, size_t first, size_t count, unsigned group) {
+    for (size_t i = 0; i < count; ++i)
+        table.groups[first + i] = static_cast<u8>(group);
+}
+
+static constexpr void SetGroup(DirtyGroupTable& table, size_t id, unsigned group) {
+    SetGroup(table, id, 1, group);
+}
+
+static constexpr DirtyGroupTable MakeDirtyGroupTable() {
+    using namespace DirtyGroup;
+
+    DirtyGroupTable table{};
+    SetGroup(table, 0, Regs::NUM_REGS, Other);
+
+    // Registers acted upon by WritePicaReg itself. The shader units don't affect the rasterizers.
+    SetGroup(table, PICA_REG_INDEX(trigger_irq), None);
+    SetGroup(table, PICA_REG_INDEX(pipeline.vs_default_attributes_setup.index), None);
+    SetGroup(table,
+             PICA_REG_INDEX_WORKAROUND(pipeline.vs_default_attributes_setup.set_value[0], 0x233),
+             3, None);
+    SetGroup(table, PICA_REG_INDEX(pipeline.gpu_mode), None);
+    SetGroup(table, PICA_REG_INDEX_WORKAROUND(pipeline.command_buffer.trigger[0], 0x23c), 2, None);
+    SetGroup(table, PICA_REG_INDEX(pipeline.trigger_draw), None);
+    SetGroup(table, PICA_REG_INDEX(pipeline.trigger_draw_indexed), None);
+    SetGroup(table, PICA_REG_INDEX(gs), Regs::NUM_REGS - PICA_REG_INDEX(gs), None);
+
+    SetGroup(table, PICA_REG_INDEX(rasterizer.cull_mode), CullMode);
+    SetGroup(table, PICA_REG_INDEX(rasterizer.viewport_depth_range), DepthScale);
+    SetGroup(table, PICA_REG_INDEX(rasterizer.viewport_depth_near_plane), DepthOffset);
+    SetGroup(table, PICA_REG_INDEX(rasterizer.depthmap_enable), ShaderConfig);
+    SetGroup(table, PICA_REG_INDEX(rasterizer.scissor_test.mode), ShaderConfig);
+
+    SetGroup(table, PICA_REG_INDEX(framebuffer.output_merger.alphablend_enable), BlendEnabled);
+    SetGroup(table, PICA_REG_INDEX(framebuffer.output_merger.alpha_blending), BlendFuncs);
+    SetGroup(table, PICA_REG_INDEX(framebuffer.output_merger.blend_const), BlendColor);
+    SetGroup(table, PICA_REG_INDEX(framebuffer.output_merger.alpha_test), AlphaTest);
+    SetGroup(table, PICA_REG_INDEX(framebuffer.output_merger.stencil_test.raw_func), StencilFunc);
+    SetGroup(table, PICA_REG_INDEX(framebuffer.output_merger.stencil_test.raw_op), StencilTest);
+    SetGroup(table, PICA_REG_INDEX(framebuffer.framebuffer.depth_format), StencilTest);
+    SetGroup(table, PICA_REG_INDEX(framebuffer.output_merger.depth_test_enable), DepthTest);
+    SetGroup(table, PICA_REG_INDEX(framebuffer.framebuffer.allow_depth_stencil_write),
+             DepthStencilWrite);
+    SetGroup(table, PICA_REG_INDEX(framebuffer.framebuffer.allow_color_write), ColorWrite);
+    SetGroup(table, PICA_REG_INDEX(framebuffer.output_merger.logic_op), LogicOp);
+
+    SetGroup(table, PICA_REG_INDEX(texturing.main_config), ShaderConfig);
+    SetGroup(table, PICA_REG_INDEX(texturing.texture0.type), ShaderConfig);
+    SetGroup(table, PICA_REG_INDEX(texturing.fog_color), FogColor);
+    SetGroup(table, PICA_REG_INDEX_WORKAROUND(texturing.fog_lut_data[0], 0xe8), 8, FogLUT);
+    SetGroup(table, PICA_REG_INDEX(texturing.proctex), ShaderConfig);
+    SetGroup(table, PICA_REG_INDEX(texturing.proctex_lut), ShaderConfig);
+    SetGroup(table, PICA_REG_INDEX(texturing.proctex_lut_offset), ShaderConfig);
+    SetGroup(table, PICA_REG_INDEX(texturing.proctex_noise_u), ProcTexNoise);
+    SetGroup(table, PICA_REG_INDEX(texturing.proctex_noise_v), ProcTexNoise);
+    SetGroup(table, PICA_REG_INDEX(texturing.proctex_noise_frequency), ProcTexNoise);
+    // The table written depends on proctex_lut_config, see MarkRegisterDirty
+    SetGroup(table, PICA_REG_INDEX_WORKAROUND(texturing.proctex_lut_data[0], 0xb0), 8, ProcTexLUT);
+
+    // TEV stages (this also covers fog_mode and fog_flip in tev_combiner_buffer_input)
+    const size_t tev_stages[] = {
+        PICA_REG_INDEX(texturing.tev_stage0), PICA_REG_INDEX(texturing.tev_stage1),
+        PICA_REG_INDEX(texturing.tev_stage2), PICA_REG_INDEX(texturing.tev_stage3),
+        PICA_REG_INDEX(texturing.tev_stage4), PICA_REG_INDEX(texturing.tev_stage5),
+    };
+    for (unsigned stage = 0; stage < 6; ++stage) {
+        SetGroup(table, tev_stages[stage], 5, ShaderConfig);
+        SetGroup(table, tev_stages[stage] + 3, TevConstColor + stage);
+    }
+    SetGroup(table, PICA_REG_INDEX(texturing.tev_combiner_buffer_input), ShaderConfig);
+    SetGroup(table, PICA_REG_INDEX(texturing.tev_combiner_buffer_color), CombinerColor);
+
+    for (unsigned light = 0; light < 8; ++light) {
+        const size_t base = PICA_REG_INDEX_WORKAROUND(lighting.light[0], 0x140) + light * 0x10;
+        SetGroup(table, base + 0x0, LightSpecular0 + light);
+        SetGroup(table, base + 0x1, LightSpecular1 + light);
+        SetGroup(table, base + 0x2, LightDiffuse + light);
+        SetGroup(table, base + 0x3, LightAmbient + light);
+        SetGroup(table, base + 0x4, 2, LightPosition + light);
+        SetGroup(table, base + 0x6, 2, LightSpotDirection + light);
+        SetGroup(table, base + 0x9, ShaderConfig);
+        SetGroup(table, base + 0xA, LightDistanceAttenuationBias + light);
+        SetGroup(table, base + 0xB, LightDistanceAttenuationScale + light);
+    }
+    SetGroup(table, PICA_REG_INDEX_WORKAROUND(lighting.global_ambient, 0x1c0), GlobalAmbient);
+    // The table written depends on lut_config, see MarkRegisterDirty
+    SetGroup(table, PICA_REG_INDEX_WORKAROUND(lighting.lut_data[0], 0x1c8), 8, LightingLUT);
+
+    return table;
+}
+
+static constexpr DirtyGroupTable dirty_group_table = MakeDirtyGroupTable();
+
+/// Register groups changed since the rasterizer was last synced
+static DirtyGroupSet dirty_groups;
+
+/**
+ * Records that the given register is about to be written. This has to happen before the write,
+ * as the rasterizer may still have to draw triangles queued with the previous configuration.
+ */
+static void MarkRegisterDirty(u32 id) {
+    const auto& regs = g_state.regs;
+    unsigned group = dirty_group_table.groups[id];
+    if (group == DirtyGroup::None)
+        return;
+
+    if (group == DirtyGroup::ProcTexLUT) {
+        switch (regs.texturing.proctex_lut_config.ref_table.Value()) {
+        case TexturingRegs::ProcTexLutTable::Noise:
+            group = DirtyGroup::ProcTexNoiseLUT;
+            break;
+        case TexturingRegs::ProcTexLutTable::ColorMap:
+            group = DirtyGroup::ProcTexColorMap;
+            break;
+        case TexturingRegs::ProcTexLutTable::AlphaMap:
+            group = DirtyGroup::ProcTexAlphaMap;
+            break;
+        case TexturingRegs::ProcTexLutTable::Color:
+            break;
+        case TexturingRegs::ProcTexLutTable::ColorDiff:
+            group = DirtyGroup::ProcTexDiffLUT;
+            break;
+        }
+    } else if (group == DirtyGroup::LightingLUT) {
+        const unsigned lut = regs.lighting.lut_config.type;
+        group = lut < LightingRegs::NumLightingSampler ? group + lut : DirtyGroup::Other;
+    }
+
+    if (dirty_groups.none())
+        VideoCore::g_renderer->Rasterizer()->NotifyPicaRegistersChanging();
+    dirty_groups.set(group);
+}
+
+void MarkAllRegistersDirty() {
+    if (dirty_groups.none())
+        VideoCore::g_renderer->Rasterizer()->NotifyPicaRegistersChanging();
+    dirty_groups.set();
+}
+
+/// Brings the rasterizer up to date with the registers changed since the last sync
+static void SyncRasterizer() {
+    if (dirty_groups.none())
+        return;
+    VideoCore::g_renderer->Rasterizer()->SyncPicaRegisters(dirty_groups);
+    dirty_groups.reset();
+}
+
 static const char* GetShaderSetupTypeName(Shader::ShaderSetup& setup) {
     if (&setup == &g_state.vs) {
         return "vertex shader";
@@ -119,6 +279,227 @@ static void WriteUniformFloatReg(ShaderRegs& config, Shader::ShaderSetup& setup,
     }
 }
 
+/// Number of vertices that are loaded and shaded together
+constexpr unsigned int VERTEX_BATCH_SIZE = 16;
+
+/// Number of vertices in each job of a draw call that is processed by multiple threads
+constexpr unsigned int VERTEX_JOB_SIZE = 128;
+
+/**
+ * Indexed draws whose vertex range spans at most this many vertices per index shade each unique
+ * vertex exactly once, using a table indexed by vertex. Sparser draws use the vertex cache.
+ */
+constexpr u32 MAX_VERTEX_RANGE_PER_INDEX = 4;
+
+/// Marks vertices of the range of an indexed draw that are not used by the draw
+constexpr u32 UNUSED_VERTEX_SLOT = 0xFFFFFFFF;
+
+/// Threads used to process the vertices of large draw calls, created on first use
+static std::unique_ptr<Common::ThreadPool> vertex_thread_pool;
+
+// Buffers reused across draw calls
+/// Slot in unique_vertices of each vertex in the range of an indexed draw
+static std::vector<u32> vertex_slots;
+/// Vertices used by an indexed draw, in order of their first use
+static std::vector<u32> unique_vertices;
+/// Shaded vertices of a draw call
+static std::vector<Shader::OutputVertex> shaded_vertices;
+
+/// Parameters of a draw call that are needed to load and shade its vertices
+struct DrawCall {
+    VertexLoader& loader;
+    u32 base_address;
+    bool is_indexed;
+    const u8* index_address_8;
+    const u16* index_address_16;
+    bool index_u16;
+    bool use_compiled_loader;
+    Shader::ShaderEngine* shader_engine;
+    /// If set, the vertices to process are read from this list instead of the draw's index array
+    const u32* vertex_list;
+};
+
+/**
+ * Loads and shades the vertices of a draw call in batches. Each thread processing vertices of a
+ * draw uses its own VertexProcessor.
+ */
+class VertexProcessor {
+public:
+    VertexProcessor() {
+        vertex_cache_ids.fill(-1);
+    }
+
+    /**
+     * Processes the vertices [first, first + count) of the draw call. The vertices of the batch
+     * that miss the vertex cache are loaded and shaded together.
+     * @param count Number of vertices to process, at most VERTEX_BATCH_SIZE
+     * @param out Array receiving the count output vertices
+     */
+    void ProcessBatch(const DrawCall& draw, unsigned int first, unsigned int count,
+                      Shader::OutputVertex* out, DebugUtils::MemoryAccessTracker& memory_accesses);
+
+    /// Returns the number of processed vertices that did not need to be shaded
+    unsigned int GetCacheHits() const {
+        return cache_hits;
+    }
+
+private:
+    // Direct-mapped vertex cache, indexed by the low bits of the vertex index. Unlike a searched
+    // cache, a lookup costs the same regardless of its size.
+    static constexpr size_t VERTEX_CACHE_SIZE = 256;
+    std::array<u32, VERTEX_CACHE_SIZE> vertex_cache_ids;
+    std::array<Shader::OutputVertex, VERTEX_CACHE_SIZE> vertex_cache;
+    unsigned int cache_hits = 0;
+
+    Shader::UnitState shader_unit;
+
+    static constexpr unsigned int CACHE_HIT = VERTEX_BATCH_SIZE;
+    std::array<unsigned int, VERTEX_BATCH_SIZE> batch_slots;
+    std::array<u32, VERTEX_BATCH_SIZE> batch_vertices;
+    std::array<unsigned int, VERTEX_BATCH_SIZE> batch_indices;
+    std::array<Shader::AttributeBuffer, VERTEX_BATCH_SIZE> batch_inputs;
+    std::array<Shader::AttributeBuffer, VERTEX_BATCH_SIZE> batch_outputs{};
+};
+
+void VertexProcessor::ProcessBatch(const DrawCall& draw, unsigned int first, unsigned int count,
+                                   Shader::OutputVertex* out,
+                                   DebugUtils::MemoryAccessTracker& memory_accesses) {
+    const auto& regs = g_state.regs;
+    unsigned int num_misses = 0;
+
+    for (unsigned int i = 0; i < count; ++i) {
+        const unsigned int index = first + i;
+
+        // Indexed rendering doesn't use the start offset
+        unsigned int vertex;
+        if (draw.vertex_list != nullptr) {
+            vertex = draw.vertex_list[index];
+        } else if (draw.is_indexed) {
+            vertex = draw.index_u16 ? draw.index_address_16[index] : draw.index_address_8[index];
+        } else {
+            vertex = index + regs.pipeline.vertex_offset;
+        }
+
+        // -1 is a common special value used for primitive restart. Since it's unknown if the PICA
+        // supports it, and it would mess up the caching, guard against it here.
+        ASSERT(vertex != -1);
+
+        batch_slots[i] = num_misses;
+
+        if (draw.is_indexed) {
+            const size_t cache_slot = vertex % VERTEX_CACHE_SIZE;
+            if (vertex == vertex_cache_ids[cache_slot]) {
+                out[i] = vertex_cache[cache_slot];
+                batch_slots[i] = CACHE_HIT;
+            }
+
+            // Vertices repeated within the batch are only shaded once
+            for (unsigned int j = 0; j < num_misses && batch_slots[i] == num_misses; ++j) {
+                if (vertex == batch_vertices[j])
+                    batch_slots[i] = j;
+            }
+        }
+
+        if (batch_slots[i] == num_misses) {
+            batch_vertices[num_misses] = vertex;
+            batch_indices[num_misses] = index;
+            ++num_misses;
+        }
+    }
+
+    cache_hits += count - num_misses;
+
+    // Initialize data for the missed vertices
+    if (draw.use_compiled_loader) {
+        draw.loader.LoadVertices(batch_vertices.data(), num_misses, batch_inputs.data());
+    } else {
+        for (unsigned int j = 0; j < num_misses; ++j) {
+            draw.loader.LoadVertex(draw.base_address, batch_indices[j], batch_vertices[j],
+                                   batch_inputs[j], memory_accesses);
+        }
+    }
+
+    // Send to vertex shader
+    if (g_debug_context) {
+        for (unsigned int j = 0; j < num_misses; ++j) {
+            g_debug_context->OnEvent(DebugContext::Event::VertexShaderInvocation,
+                                     (void*)&batch_inputs[j]);
+        }
+    }
+    draw.shader_engine->RunBatch(g_state.vs, shader_unit, regs.vs, batch_inputs.data(),
+                                 batch_outputs.data(), num_misses);
+
+    // Retrieve vertices from register data
+    for (unsigned int j = 0; j < num_misses; ++j) {
+        Shader::OutputVertex& shaded = out[batch_indices[j] - first];
+        shaded = Shader::OutputVertex::FromAttributeBuffer(regs.rasterizer, batch_outputs[j]);
+
+        if (draw.is_indexed) {
+            const size_t cache_slot = batch_vertices[j] % VERTEX_CACHE_SIZE;
+            vertex_cache[cache_slot] = shaded;
+            vertex_cache_ids[cache_slot] = batch_vertices[j];
+        }
+    }
+
+    for (unsigned int i = 0; i < count; ++i) {
+        const unsigned int slot = batch_slots[i];
+        if (slot != CACHE_HIT && batch_indices[slot] != first + i)
+            out[i] = out[batch_indices[slot] - first];
+    }
+}
+
+/**
+ * Loads and shades count vertices of a draw call. Large draws are split into jobs that are
+ * processed by multiple threads, each with its own vertex cache and shader unit.
+ * @param out Array receiving the count output vertices
+ * @return Number of vertices that were taken from the vertex cache instead of being shaded
+ */
+static unsigned int ProcessVertices(const DrawCall& draw, unsigned int count,
+                                    Shader::OutputVertex* out,
+                                    DebugUtils::MemoryAccessTracker& memory_accesses) {
+    // The debugger needs to see every vertex shader invocation in order, so vertices are only
+    // processed in parallel while it isn't observing them
+    const unsigned int parallel_threshold =
+        static_cast<unsigned int>(Settings::values.vertex_shader_parallel_threshold);
+    const bool parallel =
+        Settings::values.vertex_shader_threads != 1 && count >= parallel_threshold &&
+        !(g_debug_context &&
+          (g_debug_context->recorder ||
+           g_debug_context->breakpoints[(int)DebugContext::Event::VertexShaderInvocation].enabled));
+
+    if (!parallel) {
+        VertexProcessor processor;
+        for (unsigned int first = 0; first < count; first += VERTEX_BATCH_SIZE) {
+            const unsigned int batch_size = std::min(VERTEX_BATCH_SIZE, count - first);
+            processor.ProcessBatch(draw, first, batch_size, &out[first], memory_accesses);
+        }
+        return processor.GetCacheHits();
+    }
+
+    if (vertex_thread_pool == nullptr) {
+        vertex_thread_pool = std::make_unique<Common::ThreadPool>(
+            static_cast<size_t>(Settings::values.vertex_shader_threads), "VertexShader");
+    }
+
+    std::atomic<unsigned int> cache_hits{0};
+    const size_t num_jobs = (count + VERTEX_JOB_SIZE - 1) / VERTEX_JOB_SIZE;
+    vertex_thread_pool->ParallelFor(num_jobs, [&](size_t job) {
+        VertexProcessor processor;
+        DebugUtils::MemoryAccessTracker job_memory_accesses;
+        const unsigned int job_first = static_cast<unsigned int>(job) * VERTEX_JOB_SIZE;
+        const unsigned int job_end = std::min(job_first + VERTEX_JOB_SIZE, count);
+        for (unsigned int first = job_first; first < job_end; first += VERTEX_BATCH_SIZE) {
+            const unsigned int batch_size = std::min(VERTEX_BATCH_SIZE, job_end - first);
+            processor.ProcessBatch(draw, first, batch_size, &out[first], job_memory_accesses);
+        }
+        cache_hits += processor.GetCacheHits();
+    });
+    return cache_hits;
+}
+
+/// Physical address of the current command list
+static PAddr cmd_list_addr;
+
 static void WritePicaReg(u32 id, u32 value, u32 mask) {
     auto& regs = g_state.regs;
 
@@ -129,6 +510,8 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
         return;
     }
 
+    MarkRegisterDirty(id);
+
     // TODO: Figure out how register masking acts on e.g. vs.uniform_setup.set_value
     u32 old_value = regs.reg_array[id];
 
@@ -221,7 +604,7 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
                     immediate_attribute_id = 0;
 
                     auto* shader_engine = Shader::GetEngine();
-                    shader_engine->SetupBatch(g_state.vs, regs.vs.main_offset);
+                    shader_engine->SetupBatch(g_state.vs, regs.vs.main_offset, regs.vs.output_mask);
 
                     // Send to vertex shader
                     if (g_debug_context)
@@ -241,6 +624,7 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
                         VideoCore::g_renderer->Rasterizer()->AddTriangle(v0, v1, v2);
                     };
 
+                    SyncRasterizer();
                     g_state.primitive_assembler.SubmitVertex(
                         Shader::OutputVertex::FromAttributeBuffer(regs.rasterizer, output),
                         AddTriangle);
@@ -255,6 +639,7 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
             MICROPROFILE_SCOPE(GPU_Drawing);
 
             // Draw immediate mode triangles when GPU Mode is set to GPUMode::Configuring
+            SyncRasterizer();
             VideoCore::g_renderer->Rasterizer()->DrawTriangles();
 
             if (g_debug_context) {
@@ -267,8 +652,8 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
     case PICA_REG_INDEX_WORKAROUND(pipeline.command_buffer.trigger[1], 0x23d): {
         unsigned index =
             static_cast<unsigned>(id - PICA_REG_INDEX(pipeline.command_buffer.trigger[0]));
-        u32* head_ptr = (u32*)Memory::GetPhysicalPointer(
-            regs.pipeline.command_buffer.GetPhysicalAddress(index));
+        cmd_list_addr = regs.pipeline.command_buffer.GetPhysicalAddress(index);
+        u32* head_ptr = (u32*)Memory::GetPhysicalPointer(cmd_list_addr);
         g_state.cmd_list.head_ptr = g_state.cmd_list.current_ptr = head_ptr;
         g_state.cmd_list.length = regs.pipeline.command_buffer.GetSize(index) / sizeof(u32);
         break;
@@ -282,6 +667,7 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
 #if PICA_LOG_TEV
         DebugUtils::DumpTevStageConfig(regs.GetTevStages());
 #endif
+        SyncRasterizer();
         if (g_debug_context)
             g_debug_context->OnEvent(DebugContext::Event::IncomingPrimitiveBatch, nullptr);
 
@@ -317,80 +703,86 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
 
         DebugUtils::MemoryAccessTracker memory_accesses;
 
-        // Simple circular-replacement vertex cache
-        // The size has been tuned for optimal balance between hit-rate and the cost of lookup
-        const size_t VERTEX_CACHE_SIZE = 32;
-        std::array<u16, VERTEX_CACHE_SIZE> vertex_cache_ids;
-        std::array<Shader::OutputVertex, VERTEX_CACHE_SIZE> vertex_cache;
-        Shader::OutputVertex output_vertex;
-
-        unsigned int vertex_cache_pos = 0;
-        vertex_cache_ids.fill(-1);
-
         auto* shader_engine = Shader::GetEngine();
-        Shader::UnitState shader_unit;
-
-        shader_engine->SetupBatch(g_state.vs, regs.vs.main_offset);
+        shader_engine->SetupBatch(g_state.vs, regs.vs.main_offset, regs.vs.output_mask);
+
+        const unsigned int num_vertices = regs.pipeline.num_vertices;
+        u32 min_vertex = regs.pipeline.vertex_offset;
+        u32 max_vertex = regs.pipeline.vertex_offset + num_vertices - 1;
+        if (is_indexed && num_vertices != 0) {
+            min_vertex = 0xFFFF;
+            max_vertex = 0;
+            for (unsigned int index = 0; index < num_vertices; ++index) {
+                const u32 vertex = index_u16 ? index_address_16[index] : index_address_8[index];
+                min_vertex = std::min(min_vertex, vertex);
+                max_vertex = std::max(max_vertex, vertex);
+            }
 
-        for (unsigned int index = 0; index < regs.pipeline.num_vertices; ++index) {
-            // Indexed rendering doesn't use the start offset
-            unsigned int vertex =
-                is_indexed ? (index_u16 ? index_address_16[index] : index_address_8[index])
-                           : (index + regs.pipeline.vertex_offset);
+            if (g_debug_context && g_debug_context->recorder) {
+                memory_accesses.AddAccess(base_address + index_info.offset,
+                                          (index_u16 ? 2 : 1) * num_vertices);
+            }
+        }
 
-            // -1 is a common special value used for primitive restart. Since it's unknown if
-            // the PICA supports it, and it would mess up the caching, guard against it here.
-            ASSERT(vertex != -1);
+        // The compiled vertex loader needs to know the range of vertices the draw accesses. While
+        // recording, accesses are tracked by LoadVertex instead.
+        bool use_compiled_loader = false;
+        if (num_vertices != 0 && !(g_debug_context && g_debug_context->recorder))
+            use_compiled_loader = loader.SetupCompiledLoader(base_address, min_vertex, max_vertex);
+
+        DrawCall draw{loader, base_address, is_indexed, index_address_8, index_address_16,
+                      index_u16, use_compiled_loader, shader_engine, nullptr};
+
+        using Pica::Shader::OutputVertex;
+        auto AddTriangle = [](const OutputVertex& v0, const OutputVertex& v1,
+                              const OutputVertex& v2) {
+            VideoCore::g_renderer->Rasterizer()->AddTriangle(v0, v1, v2);
+        };
+
+        const u32 vertex_range = max_vertex - min_vertex + 1;
+        if (is_indexed && num_vertices != 0 &&
+            vertex_range <= num_vertices * MAX_VERTEX_RANGE_PER_INDEX) {
+            // Shade each vertex used by the draw exactly once, then look the results up by index
+            vertex_slots.assign(vertex_range, UNUSED_VERTEX_SLOT);
+            unique_vertices.clear();
+            for (unsigned int index = 0; index < num_vertices; ++index) {
+                const u32 vertex = index_u16 ? index_address_16[index] : index_address_8[index];
+                u32& slot = vertex_slots[vertex - min_vertex];
+                if (slot == UNUSED_VERTEX_SLOT) {
+                    slot = static_cast<u32>(unique_vertices.size());
+                    unique_vertices.push_back(vertex);
+                }
+            }
 
-            bool vertex_cache_hit = false;
+            const unsigned int num_unique = static_cast<unsigned int>(unique_vertices.size());
+            draw.is_indexed = false;
+            draw.vertex_list = unique_vertices.data();
+            shaded_vertices.resize(num_unique);
+            ProcessVertices(draw, num_unique, shaded_vertices.data(), memory_accesses);
 
-            if (is_indexed) {
-                if (g_debug_context && Pica::g_debug_context->recorder) {
-                    int size = index_u16 ? 2 : 1;
-                    memory_accesses.AddAccess(base_address + index_info.offset + size * index,
-                                              size);
-                }
+            MICROPROFILE_META_CPU("Vertex cache hits", num_vertices - num_unique);
+            MICROPROFILE_META_CPU("Vertex cache misses", num_unique);
 
-                for (unsigned int i = 0; i < VERTEX_CACHE_SIZE; ++i) {
-                    if (vertex == vertex_cache_ids[i]) {
-                        output_vertex = vertex_cache[i];
-                        vertex_cache_hit = true;
-                        break;
-                    }
-                }
+            // Send to renderer
+            for (unsigned int index = 0; index < num_vertices; ++index) {
+                const u32 vertex = index_u16 ? index_address_16[index] : index_address_8[index];
+                primitive_assembler.SubmitVertex(shaded_vertices[vertex_slots[vertex - min_vertex]],
+                                                 AddTriangle);
             }
+        } else {
+            shaded_vertices.resize(num_vertices);
+            const unsigned int cache_hits =
+                ProcessVertices(draw, num_vertices, shaded_vertices.data(), memory_accesses);
 
-            if (!vertex_cache_hit) {
-                // Initialize data for the current vertex
-                Shader::AttributeBuffer input, output{};
-                loader.LoadVertex(base_address, index, vertex, input, memory_accesses);
-
-                // Send to vertex shader
-                if (g_debug_context)
-                    g_debug_context->OnEvent(DebugContext::Event::VertexShaderInvocation,
-                                             (void*)&input);
-                shader_unit.LoadInput(regs.vs, input);
-                shader_engine->Run(g_state.vs, shader_unit);
-                shader_unit.WriteOutput(regs.vs, output);
-
-                // Retrieve vertex from register data
-                output_vertex = Shader::OutputVertex::FromAttributeBuffer(regs.rasterizer, output);
-
-                if (is_indexed) {
-                    vertex_cache[vertex_cache_pos] = output_vertex;
-                    vertex_cache_ids[vertex_cache_pos] = vertex;
-                    vertex_cache_pos = (vertex_cache_pos + 1) % VERTEX_CACHE_SIZE;
-                }
+            if (is_indexed) {
+                MICROPROFILE_META_CPU("Vertex cache hits", cache_hits);
+                MICROPROFILE_META_CPU("Vertex cache misses", num_vertices - cache_hits);
             }
 
             // Send to renderer
-            using Pica::Shader::OutputVertex;
-            auto AddTriangle = [](const OutputVertex& v0, const OutputVertex& v1,
-                                  const OutputVertex& v2) {
-                VideoCore::g_renderer->Rasterizer()->AddTriangle(v0, v1, v2);
-            };
-
-            primitive_assembler.SubmitVertex(output_vertex, AddTriangle);
+            for (unsigned int index = 0; index < num_vertices; ++index) {
+                primitive_assembler.SubmitVertex(shaded_vertices[index], AddTriangle);
+            }
         }
 
         for (auto& range : memory_accesses.ranges) {
@@ -441,7 +833,7 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
         if (offset >= 4096) {
             LOG_ERROR(HW_GPU, "Invalid GS program offset %u", offset);
         } else {
-            g_state.gs.program_code[offset] = value;
+            g_state.gs.WriteProgramCode(offset, value);
             offset++;
         }
         break;
@@ -459,7 +851,7 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
         if (offset >= g_state.gs.swizzle_data.size()) {
             LOG_ERROR(HW_GPU, "Invalid GS swizzle pattern offset %u", offset);
         } else {
-            g_state.gs.swizzle_data[offset] = value;
+            g_state.gs.WriteSwizzleData(offset, value);
             offset++;
         }
         break;
@@ -508,9 +900,9 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
         if (offset >= 512) {
             LOG_ERROR(HW_GPU, "Invalid VS program offset %u", offset);
         } else {
-            g_state.vs.program_code[offset] = value;
+            g_state.vs.WriteProgramCode(offset, value);
             if (!g_state.regs.pipeline.gs_unit_exclusive_configuration) {
-                g_state.gs.program_code[offset] = value;
+                g_state.gs.WriteProgramCode(offset, value);
             }
             offset++;
         }
@@ -529,9 +921,9 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
         if (offset >= g_state.vs.swizzle_data.size()) {
             LOG_ERROR(HW_GPU, "Invalid VS swizzle pattern offset %u", offset);
         } else {
-            g_state.vs.swizzle_data[offset] = value;
+            g_state.vs.WriteSwizzleData(offset, value);
             if (!g_state.regs.pipeline.gs_unit_exclusive_configuration) {
-                g_state.gs.swizzle_data[offset] = value;
+                g_state.gs.WriteSwizzleData(offset, value);
             }
             offset++;
         }
@@ -603,17 +995,182 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
         break;
     }
 
-    VideoCore::g_renderer->Rasterizer()->NotifyPicaRegisterChanged(id);
-
     if (g_debug_context)
         g_debug_context->OnEvent(DebugContext::Event::PicaCommandProcessed,
                                  reinterpret_cast<void*>(&id));
 }
 
-void ProcessCommandList(const u32* list, u32 size) {
-    g_state.cmd_list.head_ptr = g_state.cmd_list.current_ptr = list;
-    g_state.cmd_list.length = size / sizeof(u32);
+/// A register write performed by a command list
+struct CommandListWrite {
+    u16 id;
+    u8 mask;
+    /// Position of the command list read pointer while the write is performed, in words
+    u32 offset;
+    u32 value;
+};
+
+/**
+ * The register writes of a command list. The words of the list are registered with
+ * Memory::RasterizerMarkRegionCached while the writes are up to date, any write to them reaches
+ * InvalidateRegion through the memory flush hooks. An invalidated list keeps its writes along with
+ * a hash of the words they were decoded from, so that rewriting identical commands doesn't require
+ * decoding them again.
+ */
+struct DecodedCommandList {
+    u32 length;
+    u64 hash;
+    std::vector<CommandListWrite> writes;
+    /// Whether the memory region is registered as cached, i.e. the writes are up to date
+    bool valid;
+};
 
+/// Many titles submit the same command lists every frame, so their decoded writes are kept
+constexpr size_t MAX_CACHED_COMMAND_LISTS = 256;
+static std::unordered_map<PAddr, DecodedCommandList> command_list_cache;
+
+/**
+ * Addresses of the valid cached command lists on each page. Several lists often share a page, which
+ * is only registered with the memory system once so that its cache counter can't overflow. Writes
+ * to pages without lists are dismissed without looking at the cache.
+ */
+static std::unordered_map<u32, std::vector<PAddr>> cached_page_lists;
+
+static void MarkCommandListCached(PAddr addr, u32 length, bool cached) {
+    const u32 first_page = addr >> Memory::PAGE_BITS;
+    const u32 last_page = (addr + length * sizeof(u32) - 1) >> Memory::PAGE_BITS;
+    for (u32 page = first_page; page <= last_page; ++page) {
+        std::vector<PAddr>& lists = cached_page_lists[page];
+        if (cached) {
+            if (lists.empty())
+                Memory::RasterizerMarkRegionCached(page << Memory::PAGE_BITS, Memory::PAGE_SIZE, 1);
+            lists.push_back(addr);
+        } else {
+            lists.erase(std::find(lists.begin(), lists.end(), addr));
+            if (lists.empty()) {
+                Memory::RasterizerMarkRegionCached(page << Memory::PAGE_BITS, Memory::PAGE_SIZE,
+                                                   -1);
+                cached_page_lists.erase(page);
+            }
+        }
+    }
+}
+
+static void InvalidateCommandList(PAddr addr, DecodedCommandList& decoded) {
+    if (!decoded.valid)
+        return;
+
+    MarkCommandListCached(addr, decoded.length, false);
+    decoded.valid = false;
+}
+
+static void ClearCommandListCache() {
+    for (auto& pair : command_list_cache)
+        InvalidateCommandList(pair.first, pair.second);
+    command_list_cache.clear();
+}
+
+void InvalidateRegion(PAddr addr, u32 size) {
+    if (cached_page_lists.empty() || size == 0)
+        return;
+
+    const u32 first_page = addr >> Memory::PAGE_BITS;
+    const u32 last_page = (addr + size - 1) >> Memory::PAGE_BITS;
+    for (u32 page = first_page; page <= last_page; ++page) {
+        auto page_iter = cached_page_lists.find(page);
+        if (page_iter == cached_page_lists.end())
+            continue;
+
+        // Invalidating a list removes it from the lists of its pages
+        const std::vector<PAddr> lists = page_iter->second;
+        for (PAddr list_addr : lists) {
+            DecodedCommandList& decoded = command_list_cache.at(list_addr);
+            if (decoded.valid && addr < list_addr + decoded.length * sizeof(u32) &&
+                list_addr < addr + size) {
+                InvalidateCommandList(list_addr, decoded);
+            }
+        }
+    }
+}
+
+static bool IsCommandBufferJump(u32 id) {
+    return id == PICA_REG_INDEX_WORKAROUND(pipeline.command_buffer.trigger[0], 0x23c) ||
+           id == PICA_REG_INDEX_WORKAROUND(pipeline.command_buffer.trigger[1], 0x23d);
+}
+
+/**
+ * Decodes the register writes of a command list.
+ * @return False if the commands read past the end of the list, which is left to ProcessCommands
+ */
+static bool DecodeCommandList(const u32* list, u32 length, std::vector<CommandListWrite>& writes) {
+    writes.clear();
+
+    const u32* current_ptr = list;
+    const u32* const end_ptr = list + length;
+    const auto offset = [&] { return static_cast<u32>(current_ptr - list); };
+    while (current_ptr < end_ptr) {
+        // Align read pointer to 8 bytes
+        if ((list - current_ptr) % 2 != 0)
+            ++current_ptr;
+        if (end_ptr - current_ptr < 2)
+            return false;
+
+        u32 value = *current_ptr++;
+        const CommandHeader header = {*current_ptr++};
+        if (header.extra_data_length > static_cast<u32>(end_ptr - current_ptr))
+            return false;
+
+        const u16 id = static_cast<u16>(header.cmd_id);
+        const u8 mask = static_cast<u8>(header.parameter_mask);
+        writes.push_back({id, mask, offset(), value});
+        for (unsigned i = 0; i < header.extra_data_length; ++i) {
+            const u16 cmd = static_cast<u16>(id + (header.group_commands ? i + 1 : 0));
+            value = *current_ptr++;
+            writes.push_back({cmd, mask, offset(), value});
+        }
+    }
+    return true;
+}
+
+/// Returns the decoded writes of a command list, or nullptr if the list can't be decoded
+static const std::vector<CommandListWrite>* GetDecodedCommandList(PAddr addr, const u32* list,
+                                                                  u32 length) {
+    // Lists decoded on the GPU thread would not be protected from writes until the emulation
+    // thread applies the deferred marks of their pages
+    if (length == 0 || GPU::IsGPUThread())
+        return nullptr;
+
+    auto iter = command_list_cache.find(addr);
+    if (iter != command_list_cache.end() && iter->second.valid &&
+        iter->second.length == length) {
+        return &iter->second.writes;
+    }
+
+    if (iter == command_list_cache.end()) {
+        if (command_list_cache.size() >= MAX_CACHED_COMMAND_LISTS)
+            ClearCommandListCache();
+        iter = command_list_cache.emplace(addr, DecodedCommandList{}).first;
+    }
+
+    // Only lists that were written to since they were decoded are hashed
+    DecodedCommandList& decoded = iter->second;
+    InvalidateCommandList(addr, decoded);
+    const u64 hash = Common::ComputeHash64(list, length * sizeof(u32));
+    if (decoded.writes.empty() || decoded.length != length || decoded.hash != hash) {
+        if (!DecodeCommandList(list, length, decoded.writes)) {
+            command_list_cache.erase(iter);
+            return nullptr;
+        }
+        decoded.length = length;
+        decoded.hash = hash;
+    }
+
+    MarkCommandListCached(addr, length, true);
+    decoded.valid = true;
+    return &decoded.writes;
+}
+
+/// Processes the current command list from the current position, decoding each command
+static void ProcessCommands() {
     while (g_state.cmd_list.current_ptr < g_state.cmd_list.head_ptr + g_state.cmd_list.length) {
 
         // Align read pointer to 8 bytes
@@ -632,6 +1189,52 @@ void ProcessCommandList(const u32* list, u32 size) {
     }
 }
 
+void Shutdown() {
+    dirty_groups.reset();
+    ClearCommandListCache();
+    vertex_thread_pool = nullptr;
+    vertex_slots.clear();
+    vertex_slots.shrink_to_fit();
+    unique_vertices.clear();
+    unique_vertices.shrink_to_fit();
+    shaded_vertices.clear();
+    shaded_vertices.shrink_to_fit();
+}
+
+void ProcessCommandList(PAddr list, u32 size) {
+    cmd_list_addr = list;
+    g_state.cmd_list.head_ptr = g_state.cmd_list.current_ptr =
+        reinterpret_cast<const u32*>(Memory::GetPhysicalPointer(list));
+    g_state.cmd_list.length = size / sizeof(u32);
+
+    while (g_state.cmd_list.head_ptr != nullptr) {
+        const std::vector<CommandListWrite>* writes = GetDecodedCommandList(
+            cmd_list_addr, g_state.cmd_list.head_ptr, g_state.cmd_list.length);
+        if (writes == nullptr) {
+            ProcessCommands();
+            return;
+        }
+
+        // Writing a command buffer trigger continues with the start of that buffer
+        bool jumped = false;
+        for (const CommandListWrite& write : *writes) {
+            g_state.cmd_list.current_ptr = g_state.cmd_list.head_ptr + write.offset;
+            WritePicaReg(write.id, write.value, write.mask);
+            if (IsCommandBufferJump(write.id)) {
+                jumped = true;
+                break;
+            }
+        }
+
+        if (!jumped) {
+            g_state.cmd_list.current_ptr = g_state.cmd_list.head_ptr + g_state.cmd_list.length;
+            return;
+        }
+    }
+
+    LOG_ERROR(HW_GPU, "Command buffer jump to an invalid address");
+}
+
 } // namespace
 
 } // namespace
@@ -34,7 +34,20 @@ static_assert(std::is_standard_layout<CommandHeader>::value == true,
               "CommandHeader does not use standard layout");
 static_assert(sizeof(CommandHeader) == sizeof(u32), "CommandHeader has incorrect size!");
 
-void ProcessCommandList(const u32* list, u32 size);
+/// Processes the command list at the given physical address, reusing its decoded writes if cached
+void ProcessCommandList(PAddr list, u32 size);
+
+/// Notifies the command list cache that the given region of memory was modified
+void InvalidateRegion(PAddr addr, u32 size);
+
+/**
+ * Makes the rasterizer sync all register groups before the next draw. Call this before the
+ * registers are changed without going through the command processor, e.g. when they are restored.
+ */
+void MarkAllRegistersDirty();
+
+/// Frees the threads and buffers used to process the vertices of draw calls
+void Shutdown();
 
 } // namespace
 
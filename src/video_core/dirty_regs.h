@@ -0,0 +1,77 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <bitset>
+#include "common/common_types.h"
+#include "video_core/regs_lighting.h"
+
+namespace Pica {
+
+namespace DirtyGroup {
+
+/**
+ * Groups of PICA registers that the rasterizers bring up to date together. The command processor
+ * collects the groups changed by register writes and hands them to the rasterizer before it draws,
+ * so that registers written several times between two draws are only synced once.
+ */
+enum : u8 {
+    /// Registers that only the command processor acts upon, e.g. triggers and shader data ports
+    None,
+    /// Registers that affect rendering but are read by the rasterizers when drawing
+    Other,
+
+    CullMode,
+    DepthScale,
+    DepthOffset,
+    /// Registers that are part of the generated fragment shader configuration
+    ShaderConfig,
+    BlendEnabled,
+    BlendFuncs,
+    BlendColor,
+    FogColor,
+    FogLUT,
+    ProcTexNoise,
+    ProcTexNoiseLUT,
+    ProcTexColorMap,
+    ProcTexAlphaMap,
+    /// Procedural texture color table
+    ProcTexLUT,
+    ProcTexDiffLUT,
+    AlphaTest,
+    /// Stencil test function, which also contains the stencil write mask
+    StencilFunc,
+    StencilTest,
+    /// Depth test function, which also contains the depth and color write masks
+    DepthTest,
+    DepthStencilWrite,
+    ColorWrite,
+    LogicOp,
+    CombinerColor,
+    GlobalAmbient,
+
+    /// One group per TEV stage
+    TevConstColor,
+    /// One group per light source for each of the following
+    LightSpecular0 = TevConstColor + 6,
+    LightSpecular1 = LightSpecular0 + 8,
+    LightDiffuse = LightSpecular1 + 8,
+    LightAmbient = LightDiffuse + 8,
+    LightPosition = LightAmbient + 8,
+    LightSpotDirection = LightPosition + 8,
+    LightDistanceAttenuationBias = LightSpotDirection + 8,
+    LightDistanceAttenuationScale = LightDistanceAttenuationBias + 8,
+    /// One group per lighting lookup table
+    LightingLUT = LightDistanceAttenuationScale + 8,
+
+    NumGroups = LightingLUT + LightingRegs::NumLightingSampler,
+};
+
+} // namespace DirtyGroup
+
+/// Set of register groups changed since the rasterizer was last synced
+using DirtyGroupSet = std::bitset<DirtyGroup::NumGroups>;
+
+} // namespace Pica
@@ -0,0 +1,238 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include "common/thread_pool.h"
+#include "video_core/morton.h"
+#include "video_core/utils.h"
+
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
+
+namespace VideoCore {
+
+constexpr unsigned int MIN_PARALLEL_COPY_PIXELS = 128 * 128;
+
+MortonCopyInfo MortonCopyInfo::Packed(u32 width, u32 height, u32 bytes_per_pixel) {
+    MortonCopyInfo info;
+    info.width = width;
+    info.height = height;
+    info.bytes_per_pixel = bytes_per_pixel;
+    info.morton_stride = 8 * width * bytes_per_pixel;
+    info.linear_pixel_stride = bytes_per_pixel;
+    info.linear_stride = width * bytes_per_pixel;
+    return info;
+}
+
+namespace {
+
+/// Copies a 8x8 tile, given the distance between the rows of the linear image
+using TileCopyFunc = void (*)(u8* morton_tile, u8* linear_tile, ptrdiff_t row_step);
+
+template <bool to_linear>
+void CopyPixel(const MortonCopyInfo& info, u8* morton_pixel, u8* linear_pixel) {
+    if (!info.rotate_pixels) {
+        if (to_linear) {
+            std::memcpy(linear_pixel, morton_pixel, info.bytes_per_pixel);
+        } else {
+            std::memcpy(morton_pixel, linear_pixel, info.bytes_per_pixel);
+        }
+        return;
+    }
+
+    u32 value;
+    if (to_linear) {
+        std::memcpy(&value, morton_pixel, sizeof(u32));
+        value = (value << 8) | (value >> 24);
+        std::memcpy(linear_pixel, &value, sizeof(u32));
+    } else {
+        std::memcpy(&value, linear_pixel, sizeof(u32));
+        value = (value >> 8) | (value << 24);
+        std::memcpy(morton_pixel, &value, sizeof(u32));
+    }
+}
+
+/// Copies a tile in the pairs of horizontally adjacent pixels that Morton order keeps together
+template <u32 bytes_per_pixel, bool to_linear>
+void CopyTileGeneric(u8* morton_tile, u8* linear_tile, ptrdiff_t row_step) {
+    for (u32 y = 0; y < 8; ++y, linear_tile += row_step) {
+        for (u32 x = 0; x < 8; x += 2) {
+            u8* morton_pixels = morton_tile + MortonInterleave(x, y) * bytes_per_pixel;
+            u8* linear_pixels = linear_tile + x * bytes_per_pixel;
+            if (to_linear) {
+                std::memcpy(linear_pixels, morton_pixels, 2 * bytes_per_pixel);
+            } else {
+                std::memcpy(morton_pixels, linear_pixels, 2 * bytes_per_pixel);
+            }
+        }
+    }
+}
+
+#ifdef ARCHITECTURE_x86_64
+
+__m128i Load(const u8* source) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+}
+
+void Store(u8* dest, __m128i value) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), value);
+}
+
+/**
+ * Copies a tile of 2-byte pixels. Each vector of Morton-ordered pixels holds two 2x2 blocks, which
+ * cover four pixels of two rows. The pairs of pixels in them are sorted by row with a shuffle, and
+ * the halves of two such vectors then form a row of the tile.
+ */
+template <bool to_linear>
+void CopyTile2(u8* morton_tile, u8* linear_tile, ptrdiff_t row_step) {
+    for (u32 y = 0; y < 8; y += 2, linear_tile += 2 * row_step) {
+        u8* left = morton_tile + MortonInterleave(0, y) * 2;
+        u8* right = morton_tile + MortonInterleave(4, y) * 2;
+        u8* row0 = linear_tile;
+        u8* row1 = linear_tile + row_step;
+
+        if (to_linear) {
+            const __m128i l = _mm_shuffle_epi32(Load(left), _MM_SHUFFLE(3, 1, 2, 0));
+            const __m128i r = _mm_shuffle_epi32(Load(right), _MM_SHUFFLE(3, 1, 2, 0));
+            Store(row0, _mm_unpacklo_epi64(l, r));
+            Store(row1, _mm_unpackhi_epi64(l, r));
+        } else {
+            const __m128i r0 = Load(row0);
+            const __m128i r1 = Load(row1);
+            Store(left, _mm_shuffle_epi32(_mm_unpacklo_epi64(r0, r1), _MM_SHUFFLE(3, 1, 2, 0)));
+            Store(right, _mm_shuffle_epi32(_mm_unpackhi_epi64(r0, r1), _MM_SHUFFLE(3, 1, 2, 0)));
+        }
+    }
+}
+
+/**
+ * Copies a tile of 4-byte pixels. Each vector of Morton-ordered pixels holds a 2x2 block, the
+ * halves of two horizontally adjacent blocks form four pixels of each of their rows.
+ */
+template <bool to_linear, bool rotate>
+void CopyTile4(u8* morton_tile, u8* linear_tile, ptrdiff_t row_step) {
+    for (u32 y = 0; y < 8; y += 2, linear_tile += 2 * row_step) {
+        for (u32 x = 0; x < 8; x += 4) {
+            u8* left = morton_tile + MortonInterleave(x, y) * 4;
+            u8* right = morton_tile + MortonInterleave(x + 2, y) * 4;
+            u8* row0 = linear_tile + x * 4;
+            u8* row1 = linear_tile + row_step + x * 4;
+
+            if (to_linear) {
+                __m128i l = Load(left);
+                __m128i r = Load(right);
+                if (rotate) {
+                    l = _mm_or_si128(_mm_slli_epi32(l, 8), _mm_srli_epi32(l, 24));
+                    r = _mm_or_si128(_mm_slli_epi32(r, 8), _mm_srli_epi32(r, 24));
+                }
+                Store(row0, _mm_unpacklo_epi64(l, r));
+                Store(row1, _mm_unpackhi_epi64(l, r));
+            } else {
+                __m128i r0 = Load(row0);
+                __m128i r1 = Load(row1);
+                if (rotate) {
+                    r0 = _mm_or_si128(_mm_srli_epi32(r0, 8), _mm_slli_epi32(r0, 24));
+                    r1 = _mm_or_si128(_mm_srli_epi32(r1, 8), _mm_slli_epi32(r1, 24));
+                }
+                Store(left, _mm_unpacklo_epi64(r0, r1));
+                Store(right, _mm_unpackhi_epi64(r0, r1));
+            }
+        }
+    }
+}
+
+#endif // ARCHITECTURE_x86_64
+
+/// Returns the function that copies whole tiles, or nullptr if they have to be copied per pixel
+template <bool to_linear>
+TileCopyFunc GetTileCopyFunc(const MortonCopyInfo& info) {
+    if (info.linear_pixel_stride != info.bytes_per_pixel)
+        return nullptr;
+
+#ifdef ARCHITECTURE_x86_64
+    switch (info.bytes_per_pixel) {
+    case 2:
+        return info.rotate_pixels ? nullptr : CopyTile2<to_linear>;
+    case 3:
+        return info.rotate_pixels ? nullptr : CopyTileGeneric<3, to_linear>;
+    case 4:
+        return info.rotate_pixels ? CopyTile4<to_linear, true> : CopyTile4<to_linear, false>;
+    }
+#else
+    if (info.rotate_pixels)
+        return nullptr;
+    switch (info.bytes_per_pixel) {
+    case 2:
+        return CopyTileGeneric<2, to_linear>;
+    case 3:
+        return CopyTileGeneric<3, to_linear>;
+    case 4:
+        return CopyTileGeneric<4, to_linear>;
+    }
+#endif
+    return nullptr;
+}
+
+template <bool to_linear>
+void MortonCopy(const MortonCopyInfo& info, u8* morton_data, u8* linear_data,
+                Common::ThreadPool* pool) {
+    const TileCopyFunc copy_tile = GetTileCopyFunc<to_linear>(info);
+    const ptrdiff_t row_step = info.flip_vertically ? -static_cast<ptrdiff_t>(info.linear_stride)
+                                                    : static_cast<ptrdiff_t>(info.linear_stride);
+    const size_t tile_size = 64 * info.bytes_per_pixel;
+
+    const auto copy_row = [&](size_t row) {
+        const u32 y = static_cast<u32>(row * 8);
+        const u32 tile_height = std::min(8u, info.height - y);
+        const u32 linear_y = info.flip_vertically ? info.height - 1 - y : y;
+
+        u8* morton_tile = morton_data + row * info.morton_stride;
+        u8* linear_tile = linear_data + linear_y * info.linear_stride;
+        for (u32 x = 0; x < info.width;
+             x += 8, morton_tile += tile_size, linear_tile += 8 * info.linear_pixel_stride) {
+            if (copy_tile != nullptr && x + 8 <= info.width && tile_height == 8) {
+                copy_tile(morton_tile, linear_tile, row_step);
+                continue;
+            }
+
+            // Partial tile at the edge of the image, or a pixel layout without a tile function
+            for (u32 fine_y = 0; fine_y < tile_height; ++fine_y) {
+                for (u32 fine_x = 0; fine_x < std::min(8u, info.width - x); ++fine_x) {
+                    CopyPixel<to_linear>(
+                        info, morton_tile + MortonInterleave(fine_x, fine_y) * info.bytes_per_pixel,
+                        linear_tile + fine_y * row_step + fine_x * info.linear_pixel_stride);
+                }
+            }
+        }
+    };
+
+    // Rows of tiles are independent of each other, but handing them to other threads only pays off
+    // once there is enough work to outweigh waking them up
+    const size_t num_rows = (info.height + 7) / 8;
+    if (pool != nullptr && pool->GetThreadCount() > 1 &&
+        info.width * info.height >= MIN_PARALLEL_COPY_PIXELS) {
+        pool->ParallelFor(num_rows, copy_row);
+    } else {
+        for (size_t row = 0; row < num_rows; ++row)
+            copy_row(row);
+    }
+}
+
+} // namespace
+
+void MortonToLinear(const MortonCopyInfo& info, const u8* morton_data, u8* linear_data,
+                    Common::ThreadPool* pool) {
+    // The Morton-ordered image is only read from in this direction
+    MortonCopy<true>(info, const_cast<u8*>(morton_data), linear_data, pool);
+}
+
+void LinearToMorton(const MortonCopyInfo& info, u8* morton_data, const u8* linear_data,
+                    Common::ThreadPool* pool) {
+    // The linear image is only read from in this direction
+    MortonCopy<false>(info, morton_data, const_cast<u8*>(linear_data), pool);
+}
+
+} // namespace VideoCore
@@ -0,0 +1,53 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include "common/common_types.h"
+
+namespace Common {
+class ThreadPool;
+}
+
+namespace VideoCore {
+
+/// Describes an image that is copied between the Morton order used by the PICA and a linear layout
+struct MortonCopyInfo {
+    /// Size of the copied area in pixels
+    u32 width;
+    u32 height;
+    /// Size of a pixel in the Morton-ordered image. Must be 2, 3 or 4.
+    u32 bytes_per_pixel;
+    /// Distance in bytes between rows of 8x8 tiles in the Morton-ordered image
+    size_t morton_stride;
+    /// Distance in bytes between pixels of the linear image, at least bytes_per_pixel. Only
+    /// bytes_per_pixel bytes of each pixel are copied.
+    u32 linear_pixel_stride;
+    /// Distance in bytes between rows of the linear image
+    size_t linear_stride;
+    /// Stores the rows of the linear image bottom-up, as OpenGL expects them
+    bool flip_vertically = false;
+    /// Rotates each 4-byte pixel by 8 bits, left when copying to the linear image and right when
+    /// copying from it. This swaps the depth and stencil parts of D24S8 pixels.
+    bool rotate_pixels = false;
+
+    /// Sets up a copy of a whole image, with the pixels of the linear image tightly packed
+    static MortonCopyInfo Packed(u32 width, u32 height, u32 bytes_per_pixel);
+};
+
+/**
+ * Copies an image from Morton order to a linear layout, one 8x8 tile at a time and using vector
+ * instructions for the common pixel sizes when available.
+ * @param pool If given, large images are split across all threads of the pool. Must only be
+ *             passed from the thread that owns the pool.
+ */
+void MortonToLinear(const MortonCopyInfo& info, const u8* morton_data, u8* linear_data,
+                    Common::ThreadPool* pool = nullptr);
+
+/// Copies an image from a linear layout to Morton order, see MortonToLinear
+void LinearToMorton(const MortonCopyInfo& info, u8* morton_data, const u8* linear_data,
+                    Common::ThreadPool* pool = nullptr);
+
+} // namespace VideoCore
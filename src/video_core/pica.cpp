@@ -3,9 +3,11 @@
 // Refer to the license.txt file included.
 
 #include <cstring>
+#include "video_core/command_processor.h"
 #include "video_core/pica.h"
 #include "video_core/pica_state.h"
 #include "video_core/regs_pipeline.h"
+#include "video_core/vertex_loader.h"
 
 namespace Pica {
 
@@ -17,6 +19,8 @@ void Init() {
 
 void Shutdown() {
     Shader::Shutdown();
+    CommandProcessor::Shutdown();
+    VertexLoader::ClearCompiledLoaders();
 }
 
 template <typename T>
@@ -28,6 +32,8 @@ void State::Reset() {
     Zero(regs);
     Zero(vs);
     Zero(gs);
+    vs.MarkShaderDataDirty();
+    gs.MarkShaderDataDirty();
     Zero(cmd_list);
     Zero(immediate);
     primitive_assembler.Reconfigure(PipelineRegs::TriangleTopology::List);
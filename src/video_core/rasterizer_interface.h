@@ -6,6 +6,7 @@
 
 #include "common/common_types.h"
 #include "core/hw/gpu.h"
+#include "video_core/dirty_regs.h"
 
 struct ScreenInfo;
 
@@ -29,12 +30,33 @@ public:
     /// Draw the current batch of triangles
     virtual void DrawTriangles() = 0;
 
-    /// Notify rasterizer that the specified PICA register has been changed
-    virtual void NotifyPicaRegisterChanged(u32 id) = 0;
+    /// Notify rasterizer that PICA registers are about to be changed for the first time since the
+    /// last call to SyncPicaRegisters
+    virtual void NotifyPicaRegistersChanging() {}
+
+    /// Sync the rasterizer with the PICA registers in the given groups, which have been changed
+    /// since the last sync. This is called before triangles are added and drawn.
+    virtual void SyncPicaRegisters(const Pica::DirtyGroupSet& dirty) = 0;
 
     /// Notify rasterizer that all caches should be flushed to 3DS memory
     virtual void FlushAll() = 0;
 
+    /**
+     * Whether PICA commands may be processed with this rasterizer on the GPU thread. Regions it
+     * marks as cached there are only marked once the emulation thread synchronizes with the GPU
+     * thread, so the rasterizer has to recheck whatever it cached on the GPU thread in
+     * NotifyGPUThreadIdle.
+     */
+    virtual bool SupportsGPUThread() const {
+        return false;
+    }
+
+    /**
+     * Called on the emulation thread once the GPU thread has completed all submitted work, after
+     * the regions marked as cached on the GPU thread have been marked.
+     */
+    virtual void NotifyGPUThreadIdle() {}
+
     /// Notify rasterizer that any caches of the specified region should be flushed to 3DS memory
     virtual void FlushRegion(PAddr addr, u32 size) = 0;
 
@@ -375,6 +375,15 @@ struct TexturingRegs {
         inline unsigned GetAlphaMultiplier() const {
             return (alpha_scale < 3) ? (1 << alpha_scale) : 1;
         }
+
+        /// Returns true if the stage forwards the output of the previous stage unmodified
+        inline bool IsPassThrough() const {
+            return color_op == Operation::Replace && alpha_op == Operation::Replace &&
+                   color_source1 == Source::Previous && alpha_source1 == Source::Previous &&
+                   color_modifier1 == ColorModifier::SourceColor &&
+                   alpha_modifier1 == AlphaModifier::SourceAlpha && GetColorMultiplier() == 1 &&
+                   GetAlphaMultiplier() == 1;
+        }
     };
 
     TevStageConfig tev_stage0;
@@ -14,15 +14,16 @@
 #include "common/logging/log.h"
 #include "common/math_util.h"
 #include "common/microprofile.h"
+#include "common/thread_pool.h"
 #include "common/vector_math.h"
 #include "core/frontend/emu_window.h"
 #include "core/memory.h"
 #include "core/settings.h"
+#include "video_core/morton.h"
 #include "video_core/pica_state.h"
 #include "video_core/renderer_opengl/gl_rasterizer_cache.h"
 #include "video_core/renderer_opengl/gl_state.h"
 #include "video_core/texture/texture_decode.h"
-#include "video_core/utils.h"
 #include "video_core/video_core.h"
 
 struct FormatTuple {
@@ -55,52 +56,32 @@ RasterizerCacheOpenGL::~RasterizerCacheOpenGL() {
     FlushAll();
 }
 
-static void MortonCopyPixels(CachedSurface::PixelFormat pixel_format, u32 width, u32 height,
-                             u32 bytes_per_pixel, u32 gl_bytes_per_pixel, u8* morton_data,
-                             u8* gl_data, bool morton_to_gl) {
-    using PixelFormat = CachedSurface::PixelFormat;
-
-    u8* data_ptrs[2];
-    u32 depth_stencil_shifts[2] = {24, 8};
+Common::ThreadPool* RasterizerCacheOpenGL::GetTextureDecodePool() {
+    if (Settings::values.texture_decode_threads == 1)
+        return nullptr;
 
-    if (morton_to_gl) {
-        std::swap(depth_stencil_shifts[0], depth_stencil_shifts[1]);
+    if (texture_decode_pool == nullptr) {
+        texture_decode_pool = std::make_unique<Common::ThreadPool>(
+            static_cast<size_t>(Settings::values.texture_decode_threads), "TextureDecode");
     }
+    return texture_decode_pool.get();
+}
 
-    if (pixel_format == PixelFormat::D24S8) {
-        for (unsigned y = 0; y < height; ++y) {
-            for (unsigned x = 0; x < width; ++x) {
-                const u32 coarse_y = y & ~7;
-                u32 morton_offset = VideoCore::GetMortonOffset(x, y, bytes_per_pixel) +
-                                    coarse_y * width * bytes_per_pixel;
-                u32 gl_pixel_index = (x + (height - 1 - y) * width) * gl_bytes_per_pixel;
-
-                data_ptrs[morton_to_gl] = morton_data + morton_offset;
-                data_ptrs[!morton_to_gl] = &gl_data[gl_pixel_index];
-
-                // Swap depth and stencil value ordering since 3DS does not match OpenGL
-                u32 depth_stencil;
-                memcpy(&depth_stencil, data_ptrs[1], sizeof(u32));
-                depth_stencil = (depth_stencil << depth_stencil_shifts[0]) |
-                                (depth_stencil >> depth_stencil_shifts[1]);
+static void MortonCopyPixels(CachedSurface::PixelFormat pixel_format, u32 width, u32 height,
+                             u32 bytes_per_pixel, u32 gl_bytes_per_pixel, u8* morton_data,
+                             u8* gl_data, bool morton_to_gl, Common::ThreadPool* pool) {
+    auto info = VideoCore::MortonCopyInfo::Packed(width, height, bytes_per_pixel);
+    info.linear_pixel_stride = gl_bytes_per_pixel;
+    info.linear_stride = width * gl_bytes_per_pixel;
+    // OpenGL stores the rows of textures bottom-up
+    info.flip_vertically = true;
+    // Swap depth and stencil value ordering since 3DS does not match OpenGL
+    info.rotate_pixels = pixel_format == CachedSurface::PixelFormat::D24S8;
 
-                memcpy(data_ptrs[0], &depth_stencil, sizeof(u32));
-            }
-        }
+    if (morton_to_gl) {
+        VideoCore::MortonToLinear(info, morton_data, gl_data, pool);
     } else {
-        for (unsigned y = 0; y < height; ++y) {
-            for (unsigned x = 0; x < width; ++x) {
-                const u32 coarse_y = y & ~7;
-                u32 morton_offset = VideoCore::GetMortonOffset(x, y, bytes_per_pixel) +
-                                    coarse_y * width * bytes_per_pixel;
-                u32 gl_pixel_index = (x + (height - 1 - y) * width) * gl_bytes_per_pixel;
-
-                data_ptrs[morton_to_gl] = morton_data + morton_offset;
-                data_ptrs[!morton_to_gl] = &gl_data[gl_pixel_index];
-
-                memcpy(data_ptrs[0], data_ptrs[1], bytes_per_pixel);
-            }
-        }
+        VideoCore::LinearToMorton(info, morton_data, gl_data, pool);
     }
 }
 
@@ -347,12 +328,11 @@ CachedSurface* RasterizerCacheOpenGL::GetSurface(const CachedSurface& params, bo
                 tex_info.SetDefaultStride();
                 tex_info.physical_address = params.addr;
 
-                for (unsigned y = 0; y < params.height; ++y) {
-                    for (unsigned x = 0; x < params.width; ++x) {
-                        tex_buffer[x + params.width * y] = Pica::Texture::LookupTexture(
-                            texture_src_data, x, params.height - 1 - y, tex_info);
-                    }
-                }
+                // OpenGL expects the rows from bottom to top
+                Pica::Texture::DecodeTexture(
+                    tex_info, texture_src_data,
+                    tex_buffer.data() + params.width * (params.height - 1),
+                    -static_cast<ptrdiff_t>(params.width), GetTextureDecodePool());
 
                 glTexImage2D(GL_TEXTURE_2D, 0, tuple.internal_format, params.width, params.height,
                              0, GL_RGBA, GL_UNSIGNED_BYTE, tex_buffer.data());
@@ -378,7 +358,7 @@ CachedSurface* RasterizerCacheOpenGL::GetSurface(const CachedSurface& params, bo
 
                 MortonCopyPixels(params.pixel_format, params.width, params.height, bytes_per_pixel,
                                  gl_bytes_per_pixel, texture_src_data, temp_fb_depth_buffer_ptr,
-                                 true);
+                                 true, GetTextureDecodePool());
 
                 glTexImage2D(GL_TEXTURE_2D, 0, tuple.internal_format, params.width, params.height,
                              0, tuple.format, tuple.type, temp_fb_depth_buffer.data());
@@ -725,7 +705,7 @@ void RasterizerCacheOpenGL::FlushSurface(CachedSurface* surface) {
             // is necessary.
             MortonCopyPixels(surface->pixel_format, surface->width, surface->height,
                              bytes_per_pixel, bytes_per_pixel, dst_buffer, temp_gl_buffer.data(),
-                             false);
+                             false, GetTextureDecodePool());
         } else {
             // Depth/Stencil formats need special treatment since they aren't sampleable using
             // LookupTexture and can't use RGBA format
@@ -748,7 +728,7 @@ void RasterizerCacheOpenGL::FlushSurface(CachedSurface* surface) {
 
             MortonCopyPixels(surface->pixel_format, surface->width, surface->height,
                              bytes_per_pixel, gl_bytes_per_pixel, dst_buffer, temp_gl_buffer_ptr,
-                             false);
+                             false, GetTextureDecodePool());
         }
     }
 
@@ -25,6 +25,10 @@
 #include "video_core/regs_texturing.h"
 #include "video_core/renderer_opengl/gl_resource_manager.h"
 
+namespace Common {
+class ThreadPool;
+}
+
 namespace MathUtil {
 template <class T>
 struct Rectangle;
@@ -236,4 +240,11 @@ public:
 private:
     SurfaceCache surface_cache;
     OGLFramebuffer transfer_framebuffers[2];
+
+    /// Returns the threads that large textures are decoded with, or nullptr if they are decoded on
+    /// the emulation thread. The threads are only started once a texture is decoded.
+    Common::ThreadPool* GetTextureDecodePool();
+
+    /// Threads that large textures are decoded with before being uploaded
+    std::unique_ptr<Common::ThreadPool> texture_decode_pool;
 };
@@ -2,9 +2,12 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <array>
 #include <cmath>
 #include <cstring>
 #include "common/bit_set.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
 #include "common/microprofile.h"
 #include "video_core/pica_state.h"
@@ -82,6 +85,48 @@ void UnitState::WriteOutput(const ShaderRegs& config, AttributeBuffer& output) {
     }
 }
 
+/// Returns the number of words up to and including the last non-zero one
+template <size_t N>
+static unsigned int GetWrittenLength(const std::array<u32, N>& data) {
+    auto last = std::find_if(data.rbegin(), data.rend(), [](u32 word) { return word != 0; });
+    return static_cast<unsigned int>(data.rend() - last);
+}
+
+void ShaderSetup::MarkShaderDataDirty() {
+    program_code_length = GetWrittenLength(program_code);
+    swizzle_data_length = GetWrittenLength(swizzle_data);
+    program_code_hash_dirty = true;
+    swizzle_data_hash_dirty = true;
+}
+
+u64 ShaderSetup::GetProgramCodeHash() {
+    if (program_code_hash_dirty) {
+        program_code_hash =
+            Common::ComputeHash64(program_code.data(), program_code_length * sizeof(u32));
+        program_code_hash_dirty = false;
+    }
+    return program_code_hash;
+}
+
+u64 ShaderSetup::GetSwizzleDataHash() {
+    if (swizzle_data_hash_dirty) {
+        swizzle_data_hash =
+            Common::ComputeHash64(swizzle_data.data(), swizzle_data_length * sizeof(u32));
+        swizzle_data_hash_dirty = false;
+    }
+    return swizzle_data_hash;
+}
+
+void ShaderEngine::RunBatch(const ShaderSetup& setup, UnitState& state, const ShaderRegs& config,
+                            const AttributeBuffer* inputs, AttributeBuffer* outputs,
+                            unsigned count) const {
+    for (unsigned i = 0; i < count; ++i) {
+        state.LoadInput(config, inputs[i]);
+        Run(setup, state);
+        state.WriteOutput(config, outputs[i]);
+    }
+}
+
 MICROPROFILE_DEFINE(GPU_Shader, "GPU", "Shader", MP_RGB(50, 50, 240));
 
 #ifdef ARCHITECTURE_x86_64
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
 #include <type_traits>
@@ -150,11 +151,58 @@ struct ShaderSetup {
     std::array<u32, MAX_PROGRAM_CODE_LENGTH> program_code;
     std::array<u32, MAX_SWIZZLE_DATA_LENGTH> swizzle_data;
 
+    /**
+     * Writes a word of the program code. Applications commonly upload the same program again
+     * before drawing, so the code hash is only invalidated if the word changes.
+     */
+    void WriteProgramCode(unsigned offset, u32 value) {
+        if (program_code[offset] == value)
+            return;
+        program_code[offset] = value;
+        program_code_length = std::max(program_code_length, offset + 1);
+        program_code_hash_dirty = true;
+    }
+
+    /// Writes a word of the swizzle data, invalidating its hash if the word changes
+    void WriteSwizzleData(unsigned offset, u32 value) {
+        if (swizzle_data[offset] == value)
+            return;
+        swizzle_data[offset] = value;
+        swizzle_data_length = std::max(swizzle_data_length, offset + 1);
+        swizzle_data_hash_dirty = true;
+    }
+
+    /**
+     * Invalidates the hashes after program_code or swizzle_data were modified directly, e.g.
+     * cleared on reset or loaded from a trace. Finds the words written since then.
+     */
+    void MarkShaderDataDirty();
+
+    /// Returns a hash of the program code, which is only recomputed after the code changed
+    u64 GetProgramCodeHash();
+
+    /// Returns a hash of the swizzle data, which is only recomputed after the data changed
+    u64 GetSwizzleDataHash();
+
+    // Only the leading words of program_code and swizzle_data, up to the last non-zero word found
+    // by MarkShaderDataDirty or the last word written since, can be non-zero. The remaining words
+    // are neither hashed nor decoded.
+    unsigned int program_code_length = MAX_PROGRAM_CODE_LENGTH;
+    unsigned int swizzle_data_length = MAX_SWIZZLE_DATA_LENGTH;
+    bool program_code_hash_dirty = true;
+    bool swizzle_data_hash_dirty = true;
+    u64 program_code_hash = 0;
+    u64 swizzle_data_hash = 0;
+
     /// Data private to ShaderEngines
     struct EngineData {
         unsigned int entry_point;
         /// Used by the JIT, points to a compiled shader object.
         const void* cached_shader = nullptr;
+        /// Used by the JIT, points to a compiled batch shader object, if the program has one.
+        const void* cached_batch_shader = nullptr;
+        /// Used by the interpreter, points to the decoded program.
+        const void* decoded_program = nullptr;
     } engine_data;
 };
 
@@ -165,8 +213,10 @@ public:
     /**
      * Performs any shader unit setup that only needs to happen once per shader (as opposed to once
      * per vertex, which would happen within the `Run` function).
+     *
+     * @param output_mask Output registers read after the program. The others may be left unwritten.
      */
-    virtual void SetupBatch(ShaderSetup& setup, unsigned int entry_point) = 0;
+    virtual void SetupBatch(ShaderSetup& setup, unsigned int entry_point, u32 output_mask) = 0;
 
     /**
      * Runs the currently setup shader.
@@ -175,6 +225,21 @@ public:
      * @param state Shader unit state, must be setup with input data before each shader invocation.
      */
     virtual void Run(const ShaderSetup& setup, UnitState& state) const = 0;
+
+    /**
+     * Runs the currently setup shader for several vertices. The default implementation runs them
+     * one at a time.
+     *
+     * @param setup Shader engine state, must be setup with SetupBatch on each shader change.
+     * @param state Shader unit state used by vertices that are run one at a time.
+     * @param config Shader configuration registers corresponding to the unit.
+     * @param inputs Attribute buffers of the input vertices.
+     * @param outputs Attribute buffers receiving the output of each vertex.
+     * @param count Number of vertices.
+     */
+    virtual void RunBatch(const ShaderSetup& setup, UnitState& state, const ShaderRegs& config,
+                          const AttributeBuffer* inputs, AttributeBuffer* outputs,
+                          unsigned count) const;
 };
 
 // TODO(yuriks): Remove and make it non-global state somewhere
@@ -5,7 +5,9 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <memory>
 #include <numeric>
+#include <vector>
 #include <boost/container/static_vector.hpp>
 #include <boost/range/algorithm/fill.hpp>
 #include <nihstro/shader_bytecode.h>
@@ -83,7 +85,7 @@ static void RunInterpreter(const ShaderSetup& setup, UnitState& state, DebugData
     const auto& program_code = setup.program_code;
 
     // Placeholder for invalid inputs
-    static float24 dummy_vec4_float24[4];
+    float24 dummy_vec4_float24[4];
 
     unsigned iteration = 0;
     bool exit_loop = false;
@@ -652,31 +654,671 @@ static void RunInterpreter(const ShaderSetup& setup, UnitState& state, DebugData
     }
 }
 
-void InterpreterEngine::SetupBatch(ShaderSetup& setup, unsigned int entry_point) {
+/// Operation performed by a decoded instruction
+enum class DecodedOp : u8 {
+    ADD,
+    MUL,
+    FLR,
+    MAX,
+    MIN,
+    DP3,
+    DP4,
+    DPH,
+    RCP,
+    RSQ,
+    MOVA,
+    MOV,
+    SGE,
+    SLT,
+    CMP,
+    EX2,
+    LG2,
+    MAD,
+    END,
+    JMPC,
+    JMPU,
+    CALL,
+    CALLU,
+    CALLC,
+    NOP,
+    IFU,
+    IFC,
+    LOOP,
+    Unhandled,
+};
+
+/**
+ * An instruction decoded ahead of time: its operand descriptor is resolved into swizzle selectors
+ * and masks, and the addresses its flow control can transfer to are precomputed.
+ */
+struct DecodedInstruction {
+    DecodedOp op;
+
+    // Arithmetic instructions
+    u8 dest;
+    /// Source registers, in the order the operation uses them
+    std::array<u8, 3> src;
+    /// Address register added to src[relative_src], 0 for none
+    u8 address_register_index;
+    u8 relative_src;
+    /// Bit i enables writing component i of the destination
+    u8 dest_mask;
+    /// Bit i negates src[i]
+    u8 negate_mask;
+    std::array<std::array<u8, 4>, 3> selectors;
+    std::array<Instruction::Common::CompareOpType::Op, 2> compare_op;
+
+    // Flow control instructions
+    Instruction::FlowControlType::Op condition_op;
+    bool refx;
+    bool refy;
+    /// Whether JMPU jumps if the bool uniform is set or if it is cleared
+    bool jump_if;
+    u8 uniform_id;
+    /// Start and end of the code called or jumped to, or of the "if" branch
+    u32 target;
+    u32 target_end;
+    /// Start and end of the "else" branch
+    u32 else_target;
+    u32 else_end;
+    u32 return_address;
+
+    /// Undecoded instruction, for error messages
+    u32 hex;
+};
+
+struct DecodedProgram {
+    /// Decoded instructions, followed by one instruction used for all addresses past the code
+    std::vector<DecodedInstruction> instructions;
+};
+
+static void DecodeSwizzle(DecodedInstruction& decoded, const SwizzlePattern& swizzle) {
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        decoded.selectors[0][comp] = static_cast<u8>(swizzle.GetSelectorSrc1(comp));
+        decoded.selectors[1][comp] = static_cast<u8>(swizzle.GetSelectorSrc2(comp));
+        decoded.selectors[2][comp] = static_cast<u8>(swizzle.GetSelectorSrc3(comp));
+        if (swizzle.DestComponentEnabled(comp))
+            decoded.dest_mask |= 1 << comp;
+    }
+    decoded.negate_mask = (swizzle.negate_src1 ? 1 : 0) | (swizzle.negate_src2 ? 2 : 0) |
+                          (swizzle.negate_src3 ? 4 : 0);
+}
+
+static DecodedInstruction DecodeInstruction(const ShaderSetup& setup, u32 word, u32 offset) {
+    const Instruction instr = {word};
+    const OpCode opcode = instr.opcode.Value();
+
+    DecodedInstruction decoded{};
+    decoded.op = DecodedOp::Unhandled;
+    decoded.hex = instr.hex;
+
+    switch (opcode.GetInfo().type) {
+    case OpCode::Type::Arithmetic: {
+        const bool is_inverted = (0 != (opcode.GetInfo().subtype & OpCode::Info::SrcInversed));
+        DecodeSwizzle(decoded, {setup.swizzle_data[instr.common.operand_desc_id]});
+        decoded.dest = static_cast<u8>(instr.common.dest.Value());
+        decoded.src[0] = static_cast<u8>(instr.common.GetSrc1(is_inverted));
+        decoded.src[1] = static_cast<u8>(instr.common.GetSrc2(is_inverted));
+        decoded.address_register_index = static_cast<u8>(instr.common.address_register_index);
+        decoded.relative_src = is_inverted ? 1 : 0;
+        decoded.compare_op = {instr.common.compare_op.x.Value(), instr.common.compare_op.y.Value()};
+
+        switch (opcode.EffectiveOpCode()) {
+        case OpCode::Id::ADD:
+            decoded.op = DecodedOp::ADD;
+            break;
+        case OpCode::Id::MUL:
+            decoded.op = DecodedOp::MUL;
+            break;
+        case OpCode::Id::FLR:
+            decoded.op = DecodedOp::FLR;
+            break;
+        case OpCode::Id::MAX:
+            decoded.op = DecodedOp::MAX;
+            break;
+        case OpCode::Id::MIN:
+            decoded.op = DecodedOp::MIN;
+            break;
+        case OpCode::Id::DP3:
+            decoded.op = DecodedOp::DP3;
+            break;
+        case OpCode::Id::DP4:
+            decoded.op = DecodedOp::DP4;
+            break;
+        case OpCode::Id::DPH:
+        case OpCode::Id::DPHI:
+            decoded.op = DecodedOp::DPH;
+            break;
+        case OpCode::Id::RCP:
+            decoded.op = DecodedOp::RCP;
+            break;
+        case OpCode::Id::RSQ:
+            decoded.op = DecodedOp::RSQ;
+            break;
+        case OpCode::Id::MOVA:
+            decoded.op = DecodedOp::MOVA;
+            break;
+        case OpCode::Id::MOV:
+            decoded.op = DecodedOp::MOV;
+            break;
+        case OpCode::Id::SGE:
+        case OpCode::Id::SGEI:
+            decoded.op = DecodedOp::SGE;
+            break;
+        case OpCode::Id::SLT:
+        case OpCode::Id::SLTI:
+            decoded.op = DecodedOp::SLT;
+            break;
+        case OpCode::Id::CMP:
+            decoded.op = DecodedOp::CMP;
+            break;
+        case OpCode::Id::EX2:
+            decoded.op = DecodedOp::EX2;
+            break;
+        case OpCode::Id::LG2:
+            decoded.op = DecodedOp::LG2;
+            break;
+        default:
+            break;
+        }
+        break;
+    }
+
+    case OpCode::Type::MultiplyAdd: {
+        if (opcode.EffectiveOpCode() != OpCode::Id::MAD &&
+            opcode.EffectiveOpCode() != OpCode::Id::MADI)
+            break;
+
+        const bool is_inverted = (opcode.EffectiveOpCode() == OpCode::Id::MADI);
+        decoded.op = DecodedOp::MAD;
+        DecodeSwizzle(decoded, {setup.swizzle_data[instr.mad.operand_desc_id]});
+        decoded.dest = static_cast<u8>(instr.mad.dest.Value());
+        decoded.src[0] = static_cast<u8>(instr.mad.GetSrc1(is_inverted));
+        decoded.src[1] = static_cast<u8>(instr.mad.GetSrc2(is_inverted));
+        decoded.src[2] = static_cast<u8>(instr.mad.GetSrc3(is_inverted));
+        decoded.address_register_index = static_cast<u8>(instr.mad.address_register_index);
+        decoded.relative_src = is_inverted ? 2 : 1;
+        break;
+    }
+
+    default: {
+        const u32 dest_offset = instr.flow_control.dest_offset;
+        const u32 num_instructions = instr.flow_control.num_instructions;
+
+        switch (opcode) {
+        case OpCode::Id::END:
+            decoded.op = DecodedOp::END;
+            break;
+
+        case OpCode::Id::NOP:
+            decoded.op = DecodedOp::NOP;
+            break;
+
+        case OpCode::Id::JMPC:
+        case OpCode::Id::JMPU:
+            decoded.op = (opcode == OpCode::Id::JMPC) ? DecodedOp::JMPC : DecodedOp::JMPU;
+            decoded.target = dest_offset;
+            break;
+
+        case OpCode::Id::CALL:
+        case OpCode::Id::CALLU:
+        case OpCode::Id::CALLC:
+            decoded.op = (opcode == OpCode::Id::CALL)
+                             ? DecodedOp::CALL
+                             : (opcode == OpCode::Id::CALLU) ? DecodedOp::CALLU : DecodedOp::CALLC;
+            decoded.target = dest_offset;
+            decoded.target_end = dest_offset + num_instructions;
+            decoded.return_address = offset + 1;
+            break;
+
+        case OpCode::Id::IFU:
+        case OpCode::Id::IFC:
+            decoded.op = (opcode == OpCode::Id::IFU) ? DecodedOp::IFU : DecodedOp::IFC;
+            decoded.target = offset + 1;
+            decoded.target_end = dest_offset;
+            decoded.else_target = dest_offset;
+            decoded.else_end = dest_offset + num_instructions;
+            decoded.return_address = dest_offset + num_instructions;
+            break;
+
+        case OpCode::Id::LOOP:
+            decoded.op = DecodedOp::LOOP;
+            decoded.target = offset + 1;
+            decoded.target_end = dest_offset + 1;
+            decoded.return_address = dest_offset + 1;
+            break;
+
+        default:
+            break;
+        }
+
+        switch (decoded.op) {
+        case DecodedOp::JMPC:
+        case DecodedOp::CALLC:
+        case DecodedOp::IFC:
+            decoded.condition_op = instr.flow_control.op;
+            decoded.refx = instr.flow_control.refx.Value();
+            decoded.refy = instr.flow_control.refy.Value();
+            break;
+        case DecodedOp::JMPU:
+            decoded.jump_if = !(num_instructions & 1);
+            decoded.uniform_id = static_cast<u8>(instr.flow_control.bool_uniform_id);
+            break;
+        case DecodedOp::CALLU:
+        case DecodedOp::IFU:
+            decoded.uniform_id = static_cast<u8>(instr.flow_control.bool_uniform_id);
+            break;
+        case DecodedOp::LOOP:
+            decoded.uniform_id = static_cast<u8>(instr.flow_control.int_uniform_id);
+            break;
+        default:
+            break;
+        }
+        break;
+    }
+    }
+
+    return decoded;
+}
+
+static std::unique_ptr<DecodedProgram> DecodeProgram(const ShaderSetup& setup) {
+    auto program = std::make_unique<DecodedProgram>();
+    program->instructions.reserve(setup.program_code_length + 1);
+    for (u32 offset = 0; offset < setup.program_code_length; ++offset) {
+        program->instructions.push_back(
+            DecodeInstruction(setup, setup.program_code[offset], offset));
+    }
+    // The words past the written code are zero
+    program->instructions.push_back(DecodeInstruction(setup, 0, setup.program_code_length));
+    return program;
+}
+
+/// Runs a program decoded by DecodeProgram. Behaves like RunInterpreter without debug data.
+static void RunDecodedProgram(const DecodedProgram& program, const ShaderSetup& setup,
+                              UnitState& state, unsigned offset) {
+    // TODO: Is there a maximal size for this?
+    boost::container::static_vector<CallStackElement, 16> call_stack;
+    u32 program_counter = offset;
+    const u32 last_instruction = static_cast<u32>(program.instructions.size() - 1);
+
+    state.conditional_code[0] = false;
+    state.conditional_code[1] = false;
+
+    const auto& uniforms = setup.uniforms;
+
+    // Placeholder for invalid operands
+    float24 dummy_vec4_float24[4];
+
+    auto call = [&program_counter, &call_stack](u32 target, u32 target_end, u32 return_address,
+                                                u8 repeat_count, u8 loop_increment) {
+        // -1 to make sure when incrementing the PC we end up at the correct offset
+        program_counter = target - 1;
+        ASSERT(call_stack.size() < call_stack.capacity());
+        call_stack.push_back({target_end, return_address, repeat_count, loop_increment, target});
+    };
+
+    auto evaluate_condition = [&state](const DecodedInstruction& instr) {
+        using Op = Instruction::FlowControlType::Op;
+
+        bool result_x = instr.refx == state.conditional_code[0];
+        bool result_y = instr.refy == state.conditional_code[1];
+
+        switch (instr.condition_op) {
+        case Op::Or:
+            return result_x || result_y;
+        case Op::And:
+            return result_x && result_y;
+        case Op::JustX:
+            return result_x;
+        case Op::JustY:
+            return result_y;
+        default:
+            UNREACHABLE();
+            return false;
+        }
+    };
+
+    auto load_source = [&](const DecodedInstruction& instr, unsigned index, float24(&value)[4]) {
+        u32 reg = instr.src[index];
+        if (index == instr.relative_src && instr.address_register_index != 0)
+            reg += state.address_registers[instr.address_register_index - 1];
+
+        const float24* src;
+        if (reg < 0x10) {
+            src = &state.registers.input[reg].x;
+        } else if (reg < 0x20) {
+            src = &state.registers.temporary[reg - 0x10].x;
+        } else if (reg < 0x20 + 96) {
+            src = &uniforms.f[reg - 0x20].x;
+        } else {
+            src = dummy_vec4_float24;
+        }
+
+        for (unsigned comp = 0; comp < 4; ++comp)
+            value[comp] = src[instr.selectors[index][comp]];
+        if (instr.negate_mask & (1 << index)) {
+            for (unsigned comp = 0; comp < 4; ++comp)
+                value[comp] = -value[comp];
+        }
+    };
+
+    auto write_dest = [&](const DecodedInstruction& instr, const float24(&value)[4]) {
+        float24* dest = (instr.dest < 0x10)
+                            ? &state.registers.output[instr.dest][0]
+                            : (instr.dest < 0x20) ? &state.registers.temporary[instr.dest - 0x10][0]
+                                                  : dummy_vec4_float24;
+        for (unsigned comp = 0; comp < 4; ++comp) {
+            if (instr.dest_mask & (1 << comp))
+                dest[comp] = value[comp];
+        }
+    };
+
+    float24 src1[4];
+    float24 src2[4];
+    float24 src3[4];
+    float24 result[4];
+
+    while (true) {
+        if (!call_stack.empty()) {
+            auto& top = call_stack.back();
+            if (program_counter == top.final_address) {
+                state.address_registers[2] += top.loop_increment;
+
+                if (top.repeat_counter-- == 0) {
+                    program_counter = top.return_address;
+                    call_stack.pop_back();
+                } else {
+                    program_counter = top.loop_address;
+                }
+
+                // TODO: Is "trying again" accurate to hardware?
+                continue;
+            }
+        }
+
+        const DecodedInstruction& instr =
+            program.instructions[std::min(program_counter, last_instruction)];
+
+        switch (instr.op) {
+        case DecodedOp::ADD:
+            load_source(instr, 0, src1);
+            load_source(instr, 1, src2);
+            for (int i = 0; i < 4; ++i)
+                result[i] = src1[i] + src2[i];
+            write_dest(instr, result);
+            break;
+
+        case DecodedOp::MUL:
+            load_source(instr, 0, src1);
+            load_source(instr, 1, src2);
+            for (int i = 0; i < 4; ++i)
+                result[i] = src1[i] * src2[i];
+            write_dest(instr, result);
+            break;
+
+        case DecodedOp::FLR:
+            load_source(instr, 0, src1);
+            for (int i = 0; i < 4; ++i)
+                result[i] = float24::FromFloat32(std::floor(src1[i].ToFloat32()));
+            write_dest(instr, result);
+            break;
+
+        case DecodedOp::MAX:
+            load_source(instr, 0, src1);
+            load_source(instr, 1, src2);
+            // NOTE: Exact form required to match NaN semantics to hardware:
+            //   max(0, NaN) -> NaN
+            //   max(NaN, 0) -> 0
+            for (int i = 0; i < 4; ++i)
+                result[i] = (src1[i] > src2[i]) ? src1[i] : src2[i];
+            write_dest(instr, result);
+            break;
+
+        case DecodedOp::MIN:
+            load_source(instr, 0, src1);
+            load_source(instr, 1, src2);
+            // NOTE: Exact form required to match NaN semantics to hardware:
+            //   min(0, NaN) -> NaN
+            //   min(NaN, 0) -> 0
+            for (int i = 0; i < 4; ++i)
+                result[i] = (src1[i] < src2[i]) ? src1[i] : src2[i];
+            write_dest(instr, result);
+            break;
+
+        case DecodedOp::DP3:
+        case DecodedOp::DP4:
+        case DecodedOp::DPH: {
+            load_source(instr, 0, src1);
+            load_source(instr, 1, src2);
+            if (instr.op == DecodedOp::DPH)
+                src1[3] = float24::FromFloat32(1.0f);
+
+            int num_components = (instr.op == DecodedOp::DP3) ? 3 : 4;
+            float24 dot = std::inner_product(src1, src1 + num_components, src2,
+                                             float24::FromFloat32(0.f));
+            for (int i = 0; i < 4; ++i)
+                result[i] = dot;
+            write_dest(instr, result);
+            break;
+        }
+
+        // Reciprocal
+        case DecodedOp::RCP: {
+            load_source(instr, 0, src1);
+            float24 rcp_res = float24::FromFloat32(1.0f / src1[0].ToFloat32());
+            for (int i = 0; i < 4; ++i)
+                result[i] = rcp_res;
+            write_dest(instr, result);
+            break;
+        }
+
+        // Reciprocal Square Root
+        case DecodedOp::RSQ: {
+            load_source(instr, 0, src1);
+            float24 rsq_res = float24::FromFloat32(1.0f / std::sqrt(src1[0].ToFloat32()));
+            for (int i = 0; i < 4; ++i)
+                result[i] = rsq_res;
+            write_dest(instr, result);
+            break;
+        }
+
+        case DecodedOp::MOVA:
+            load_source(instr, 0, src1);
+            for (int i = 0; i < 2; ++i) {
+                if (!(instr.dest_mask & (1 << i)))
+                    continue;
+
+                // TODO: Figure out how the rounding is done on hardware
+                state.address_registers[i] = static_cast<s32>(src1[i].ToFloat32());
+            }
+            break;
+
+        case DecodedOp::MOV:
+            load_source(instr, 0, src1);
+            write_dest(instr, src1);
+            break;
+
+        case DecodedOp::SGE:
+        case DecodedOp::SLT:
+            load_source(instr, 0, src1);
+            load_source(instr, 1, src2);
+            for (int i = 0; i < 4; ++i) {
+                const bool set =
+                    (instr.op == DecodedOp::SGE) ? (src1[i] >= src2[i]) : (src1[i] < src2[i]);
+                result[i] = set ? float24::FromFloat32(1.0f) : float24::FromFloat32(0.0f);
+            }
+            write_dest(instr, result);
+            break;
+
+        case DecodedOp::CMP:
+            load_source(instr, 0, src1);
+            load_source(instr, 1, src2);
+            for (int i = 0; i < 2; ++i) {
+                switch (instr.compare_op[i]) {
+                case Instruction::Common::CompareOpType::Equal:
+                    state.conditional_code[i] = (src1[i] == src2[i]);
+                    break;
+
+                case Instruction::Common::CompareOpType::NotEqual:
+                    state.conditional_code[i] = (src1[i] != src2[i]);
+                    break;
+
+                case Instruction::Common::CompareOpType::LessThan:
+                    state.conditional_code[i] = (src1[i] < src2[i]);
+                    break;
+
+                case Instruction::Common::CompareOpType::LessEqual:
+                    state.conditional_code[i] = (src1[i] <= src2[i]);
+                    break;
+
+                case Instruction::Common::CompareOpType::GreaterThan:
+                    state.conditional_code[i] = (src1[i] > src2[i]);
+                    break;
+
+                case Instruction::Common::CompareOpType::GreaterEqual:
+                    state.conditional_code[i] = (src1[i] >= src2[i]);
+                    break;
+
+                default:
+                    LOG_ERROR(HW_GPU, "Unknown compare mode %x",
+                              static_cast<int>(instr.compare_op[i]));
+                    break;
+                }
+            }
+            break;
+
+        // EX2 and LG2 only take the first component and write the result to all dest components
+        case DecodedOp::EX2: {
+            load_source(instr, 0, src1);
+            float24 ex2_res = float24::FromFloat32(std::exp2(src1[0].ToFloat32()));
+            for (int i = 0; i < 4; ++i)
+                result[i] = ex2_res;
+            write_dest(instr, result);
+            break;
+        }
+
+        case DecodedOp::LG2: {
+            load_source(instr, 0, src1);
+            float24 lg2_res = float24::FromFloat32(std::log2(src1[0].ToFloat32()));
+            for (int i = 0; i < 4; ++i)
+                result[i] = lg2_res;
+            write_dest(instr, result);
+            break;
+        }
+
+        case DecodedOp::MAD:
+            load_source(instr, 0, src1);
+            load_source(instr, 1, src2);
+            load_source(instr, 2, src3);
+            for (int i = 0; i < 4; ++i)
+                result[i] = src1[i] * src2[i] + src3[i];
+            write_dest(instr, result);
+            break;
+
+        case DecodedOp::END:
+            return;
+
+        case DecodedOp::JMPC:
+            if (evaluate_condition(instr))
+                program_counter = instr.target - 1;
+            break;
+
+        case DecodedOp::JMPU:
+            if (uniforms.b[instr.uniform_id] == instr.jump_if)
+                program_counter = instr.target - 1;
+            break;
+
+        case DecodedOp::CALL:
+            call(instr.target, instr.target_end, instr.return_address, 0, 0);
+            break;
+
+        case DecodedOp::CALLU:
+            if (uniforms.b[instr.uniform_id])
+                call(instr.target, instr.target_end, instr.return_address, 0, 0);
+            break;
+
+        case DecodedOp::CALLC:
+            if (evaluate_condition(instr))
+                call(instr.target, instr.target_end, instr.return_address, 0, 0);
+            break;
+
+        case DecodedOp::NOP:
+            break;
+
+        case DecodedOp::IFU:
+        case DecodedOp::IFC: {
+            const bool condition = (instr.op == DecodedOp::IFU) ? uniforms.b[instr.uniform_id]
+                                                                : evaluate_condition(instr);
+            if (condition) {
+                call(instr.target, instr.target_end, instr.return_address, 0, 0);
+            } else {
+                call(instr.else_target, instr.else_end, instr.return_address, 0, 0);
+            }
+            break;
+        }
+
+        case DecodedOp::LOOP: {
+            const auto& loop_param = uniforms.i[instr.uniform_id];
+            state.address_registers[2] = loop_param.y;
+            call(instr.target, instr.target_end, instr.return_address, loop_param.x, loop_param.z);
+            break;
+        }
+
+        case DecodedOp::Unhandled: {
+            const Instruction raw = {instr.hex};
+            LOG_ERROR(HW_GPU, "Unhandled instruction: 0x%02x (%s): 0x%08x",
+                      (int)raw.opcode.Value().EffectiveOpCode(), raw.opcode.Value().GetInfo().name,
+                      raw.hex);
+            break;
+        }
+        }
+
+        ++program_counter;
+    }
+}
+
+InterpreterEngine::InterpreterEngine() = default;
+InterpreterEngine::~InterpreterEngine() = default;
+
+void InterpreterEngine::SetupBatch(ShaderSetup& setup, unsigned int entry_point,
+                                   u32 output_mask) {
     ASSERT(entry_point < MAX_PROGRAM_CODE_LENGTH);
     setup.engine_data.entry_point = entry_point;
+
+    u64 cache_key = setup.GetProgramCodeHash() ^ setup.GetSwizzleDataHash();
+    auto iter = cache.find(cache_key);
+    if (iter == cache.end()) {
+        // Decoded programs are small, but titles can generate many variants. Dropping all of them
+        // is fine, as every setup is decoded again by the SetupBatch preceding its next run.
+        if (cache.size() >= MAX_CACHED_PROGRAMS)
+            cache.clear();
+        iter = cache.emplace(cache_key, DecodeProgram(setup)).first;
+    }
+    setup.engine_data.decoded_program = iter->second.get();
 }
 
 MICROPROFILE_DECLARE(GPU_Shader);
 
 void InterpreterEngine::Run(const ShaderSetup& setup, UnitState& state) const {
+    ASSERT(setup.engine_data.decoded_program != nullptr);
 
     MICROPROFILE_SCOPE(GPU_Shader);
 
-    DebugData<false> dummy_debug_data;
-    RunInterpreter(setup, state, dummy_debug_data, setup.engine_data.entry_point);
+    RunDecodedProgram(*static_cast<const DecodedProgram*>(setup.engine_data.decoded_program),
+                      setup, state, setup.engine_data.entry_point);
 }
 
 DebugData<true> InterpreterEngine::ProduceDebugInfo(const ShaderSetup& setup,
                                                     const AttributeBuffer& input,
-                                                    const ShaderRegs& config) const {
+                                                    const ShaderRegs& config,
+                                                    unsigned int entry_point) const {
     UnitState state;
     DebugData<true> debug_data;
 
     // Setup input register table
     boost::fill(state.registers.input, Math::Vec4<float24>::AssignToAll(float24::Zero()));
     state.LoadInput(config, input);
-    RunInterpreter(setup, state, debug_data, setup.engine_data.entry_point);
+    RunInterpreter(setup, state, debug_data, entry_point);
     return debug_data;
 }
 
@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include <memory>
+#include <unordered_map>
+#include "common/common_types.h"
 #include "video_core/shader/debug_data.h"
 #include "video_core/shader/shader.h"
 
@@ -11,20 +14,34 @@ namespace Pica {
 
 namespace Shader {
 
+struct DecodedProgram;
+
 class InterpreterEngine final : public ShaderEngine {
 public:
-    void SetupBatch(ShaderSetup& setup, unsigned int entry_point) override;
+    InterpreterEngine();
+    ~InterpreterEngine() override;
+
+    /// Decodes the program, unless a decoded copy of it is cached
+    void SetupBatch(ShaderSetup& setup, unsigned int entry_point, u32 output_mask) override;
     void Run(const ShaderSetup& setup, UnitState& state) const override;
 
     /**
-     * Produce debug information based on the given shader and input vertex
+     * Produce debug information based on the given shader and input vertex. The setup does not
+     * need to be set up with SetupBatch, and is left unchanged.
      * @param setup  Shader engine state
      * @param input  Input vertex into the shader
      * @param config Configuration object for the shader pipeline
+     * @param entry_point Offset of the first instruction to run
      * @return Debug information for this shader with regards to the given vertex
      */
     DebugData<true> ProduceDebugInfo(const ShaderSetup& setup, const AttributeBuffer& input,
-                                     const ShaderRegs& config) const;
+                                     const ShaderRegs& config, unsigned int entry_point) const;
+
+private:
+    static constexpr size_t MAX_CACHED_PROGRAMS = 256;
+
+    /// Decoded programs, by the hash of their code and swizzle data
+    std::unordered_map<u64, std::unique_ptr<DecodedProgram>> cache;
 };
 
 } // namespace
@@ -2,41 +2,263 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include "common/hash.h"
+#include "common/logging/log.h"
 #include "common/microprofile.h"
+#include "common/thread.h"
+#include "core/settings.h"
 #include "video_core/shader/shader.h"
 #include "video_core/shader/shader_jit_x64.h"
+#include "video_core/shader/shader_jit_x64_batch_compiler.h"
 #include "video_core/shader/shader_jit_x64_compiler.h"
+#include "video_core/video_core.h"
 
 namespace Pica {
 namespace Shader {
 
+/// Copy of a program that is compiled on the compile thread, along with the resulting shaders
+struct JitX64Engine::CompileJob {
+    u64 key;
+    u64 batch_key;
+    bool compile_shader;
+    bool compile_batch_shader;
+    unsigned int entry_point;
+    u32 output_mask;
+    std::array<u32, MAX_PROGRAM_CODE_LENGTH> program_code;
+    std::array<u32, MAX_SWIZZLE_DATA_LENGTH> swizzle_data;
+    std::chrono::steady_clock::time_point queue_time;
+
+    std::unique_ptr<JitShader> shader;
+    std::unique_ptr<JitBatchShader> batch_shader;
+};
+
 JitX64Engine::JitX64Engine() = default;
-JitX64Engine::~JitX64Engine() = default;
 
-void JitX64Engine::SetupBatch(ShaderSetup& setup, unsigned int entry_point) {
+JitX64Engine::~JitX64Engine() {
+    if (compile_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(compile_mutex);
+            shutting_down = true;
+        }
+        compile_available.notify_one();
+        compile_thread.join();
+    }
+
+    LOG_DEBUG(HW_GPU, "Shader cache: %llu hits, %llu misses, %llu evictions, %zu bytes of code",
+              static_cast<unsigned long long>(stats.hits),
+              static_cast<unsigned long long>(stats.misses),
+              static_cast<unsigned long long>(stats.evictions), stats.code_size);
+}
+
+template <typename T>
+typename JitX64Engine::Cache<T>::iterator JitX64Engine::AddToCache(Cache<T>& cache, u64 key,
+                                                                   bool batch,
+                                                                   std::unique_ptr<T> shader) {
+    auto iter = cache.find(key);
+    if (iter != cache.end())
+        return iter;
+
+    // Each shader keeps the whole code buffer it was compiled into, not just the emitted code
+    size_t code_size = 0;
+    if (shader != nullptr)
+        code_size = batch ? MAX_BATCH_SHADER_SIZE : MAX_SHADER_SIZE;
+    stats.code_size += code_size;
+    auto lru_position = lru.insert(lru.end(), {key, batch});
+    return cache.emplace(key, CacheEntry<T>{std::move(shader), code_size, lru_position}).first;
+}
+
+void JitX64Engine::EvictColdShaders(u64 key, u64 batch_key) {
+    const size_t max_code_size = static_cast<size_t>(Settings::values.shader_jit_cache_size) << 20;
+    while (stats.code_size > max_code_size && !lru.empty()) {
+        const LruItem item = lru.front();
+        if (item.batch ? item.key == batch_key : item.key == key)
+            break;
+
+        if (item.batch) {
+            auto iter = batch_cache.find(item.key);
+            stats.code_size -= iter->second.code_size;
+            batch_cache.erase(iter);
+        } else {
+            auto iter = cache.find(item.key);
+            stats.code_size -= iter->second.code_size;
+            cache.erase(iter);
+        }
+        lru.pop_front();
+        ++stats.evictions;
+        MICROPROFILE_META_CPU("Shader cache evictions", 1);
+    }
+}
+
+MICROPROFILE_DEFINE(GPU_ShaderCompile, "GPU", "Shader Compile", MP_RGB(100, 100, 240));
+
+void JitX64Engine::CompileThread() {
+    Common::SetCurrentThreadName("ShaderCompile");
+    MicroProfileOnThreadCreate("ShaderCompile");
+
+    std::unique_lock<std::mutex> lock(compile_mutex);
+    while (true) {
+        compile_available.wait(lock, [this] { return shutting_down || !compile_queue.empty(); });
+        if (shutting_down)
+            break;
+
+        std::unique_ptr<CompileJob> job = std::move(compile_queue.front());
+        compile_queue.pop_front();
+        lock.unlock();
+
+        {
+            MICROPROFILE_SCOPE(GPU_ShaderCompile);
+
+            if (job->compile_shader) {
+                job->shader = std::make_unique<JitShader>();
+                job->shader->Compile(&job->program_code, &job->swizzle_data, job->output_mask);
+            }
+            if (job->compile_batch_shader) {
+                job->batch_shader = std::make_unique<JitBatchShader>();
+                if (!job->batch_shader->Compile(&job->program_code, &job->swizzle_data,
+                                                job->entry_point, job->output_mask))
+                    job->batch_shader = nullptr;
+            }
+
+            // Time from queueing the program until it can be used
+            auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - job->queue_time);
+            MICROPROFILE_META_CPU("Compile latency (us)", static_cast<int>(latency.count()));
+        }
+
+        lock.lock();
+        compiled_jobs.push_back(std::move(job));
+    }
+    lock.unlock();
+
+    MicroProfileOnThreadExit();
+}
+
+void JitX64Engine::CollectCompiledShaders() {
+    std::vector<std::unique_ptr<CompileJob>> jobs;
+    {
+        std::lock_guard<std::mutex> lock(compile_mutex);
+        jobs.swap(compiled_jobs);
+    }
+
+    for (auto& job : jobs) {
+        if (job->compile_shader) {
+            pending_shaders.erase(job->key);
+            AddToCache(cache, job->key, false, std::move(job->shader));
+        }
+        if (job->compile_batch_shader) {
+            pending_batch_shaders.erase(job->batch_key);
+            AddToCache(batch_cache, job->batch_key, true, std::move(job->batch_shader));
+        }
+    }
+    pending_jobs -= jobs.size();
+}
+
+void JitX64Engine::SetupBatch(ShaderSetup& setup, unsigned int entry_point, u32 output_mask) {
     ASSERT(entry_point < MAX_PROGRAM_CODE_LENGTH);
     setup.engine_data.entry_point = entry_point;
 
-    u64 code_hash = Common::ComputeHash64(&setup.program_code, sizeof(setup.program_code));
-    u64 swizzle_hash = Common::ComputeHash64(&setup.swizzle_data, sizeof(setup.swizzle_data));
+    if (pending_jobs != 0)
+        CollectCompiledShaders();
+
+    u64 code_hash = setup.GetProgramCodeHash();
+    u64 swizzle_hash = setup.GetSwizzleDataHash();
+
+    // Code that only computes unused outputs is left out, so the outputs are part of the key
+    u64 cache_key =
+        code_hash ^ swizzle_hash ^ Common::ComputeHash64(&output_mask, sizeof(output_mask));
+    // Batch shaders only compile the code reachable from the entry point
+    const std::array<u32, 2> batch_config = {entry_point, output_mask};
+    u64 batch_key = code_hash ^ swizzle_hash ^
+                    Common::ComputeHash64(batch_config.data(), sizeof(batch_config));
 
-    u64 cache_key = code_hash ^ swizzle_hash;
     auto iter = cache.find(cache_key);
+    auto batch_iter = batch_cache.find(batch_key);
     if (iter != cache.end()) {
-        setup.engine_data.cached_shader = iter->second.get();
+        lru.splice(lru.end(), lru, iter->second.lru_position);
+        ++stats.hits;
+        MICROPROFILE_META_CPU("Shader cache hits", 1);
+    }
+    if (batch_iter != batch_cache.end())
+        lru.splice(lru.end(), lru, batch_iter->second.lru_position);
+
+    const bool compile_batch_shader = JitBatchShader::IsSupported() &&
+                                      batch_iter == batch_cache.end() &&
+                                      pending_batch_shaders.count(batch_key) == 0;
+
+    if (VideoCore::g_async_shader_jit_enabled) {
+        const bool compile_shader = iter == cache.end() && pending_shaders.count(cache_key) == 0;
+        if (compile_shader) {
+            ++stats.misses;
+            MICROPROFILE_META_CPU("Shader cache misses", 1);
+        }
+        if (compile_shader || compile_batch_shader) {
+            auto job = std::make_unique<CompileJob>();
+            job->key = cache_key;
+            job->batch_key = batch_key;
+            job->compile_shader = compile_shader;
+            job->compile_batch_shader = compile_batch_shader;
+            job->entry_point = entry_point;
+            job->output_mask = output_mask;
+            job->program_code = setup.program_code;
+            job->swizzle_data = setup.swizzle_data;
+            job->queue_time = std::chrono::steady_clock::now();
+
+            if (compile_shader)
+                pending_shaders.insert(cache_key);
+            if (compile_batch_shader)
+                pending_batch_shaders.insert(batch_key);
+            ++pending_jobs;
+
+            {
+                std::lock_guard<std::mutex> lock(compile_mutex);
+                compile_queue.push_back(std::move(job));
+            }
+            if (!compile_thread.joinable())
+                compile_thread = std::thread(&JitX64Engine::CompileThread, this);
+            compile_available.notify_one();
+        }
+        MICROPROFILE_META_CPU("Shader compile queue", static_cast<int>(pending_jobs));
     } else {
-        auto shader = std::make_unique<JitShader>();
-        shader->Compile(&setup.program_code, &setup.swizzle_data);
-        setup.engine_data.cached_shader = shader.get();
-        cache.emplace_hint(iter, cache_key, std::move(shader));
+        if (iter == cache.end()) {
+            ++stats.misses;
+            MICROPROFILE_META_CPU("Shader cache misses", 1);
+            auto shader = std::make_unique<JitShader>();
+            shader->Compile(&setup.program_code, &setup.swizzle_data, output_mask);
+            iter = AddToCache(cache, cache_key, false, std::move(shader));
+        }
+        if (compile_batch_shader) {
+            auto shader = std::make_unique<JitBatchShader>();
+            if (!shader->Compile(&setup.program_code, &setup.swizzle_data, entry_point,
+                                 output_mask))
+                shader = nullptr;
+            batch_iter = AddToCache(batch_cache, batch_key, true, std::move(shader));
+        }
+    }
+
+    EvictColdShaders(cache_key, batch_key);
+
+    // Until its program has been compiled, the setup runs on the interpreter
+    setup.engine_data.cached_shader = nullptr;
+    setup.engine_data.cached_batch_shader = nullptr;
+    if (iter != cache.end()) {
+        setup.engine_data.cached_shader = iter->second.shader.get();
+        if (batch_iter != batch_cache.end())
+            setup.engine_data.cached_batch_shader = batch_iter->second.shader.get();
+    } else {
+        interpreter.SetupBatch(setup, entry_point, output_mask);
     }
 }
 
 MICROPROFILE_DECLARE(GPU_Shader);
 
 void JitX64Engine::Run(const ShaderSetup& setup, UnitState& state) const {
-    ASSERT(setup.engine_data.cached_shader != nullptr);
+    if (setup.engine_data.cached_shader == nullptr) {
+        interpreter.Run(setup, state);
+        return;
+    }
 
     MICROPROFILE_SCOPE(GPU_Shader);
 
@@ -44,5 +266,37 @@ void JitX64Engine::Run(const ShaderSetup& setup, UnitState& state) const {
     shader->Run(setup, state, setup.engine_data.entry_point);
 }
 
+void JitX64Engine::RunBatch(const ShaderSetup& setup, UnitState& state, const ShaderRegs& config,
+                            const AttributeBuffer* inputs, AttributeBuffer* outputs,
+                            unsigned count) const {
+    const JitBatchShader* batch_shader =
+        static_cast<const JitBatchShader*>(setup.engine_data.cached_batch_shader);
+    if (batch_shader == nullptr || count < 2) {
+        ShaderEngine::RunBatch(setup, state, config, inputs, outputs, count);
+        return;
+    }
+
+    MICROPROFILE_SCOPE(GPU_Shader);
+
+    constexpr unsigned NUM_LANES = BatchUnitState::NUM_LANES;
+    const JitShader* shader = static_cast<const JitShader*>(setup.engine_data.cached_shader);
+    BatchUnitState batch_state{};
+    for (unsigned first = 0; first < count; first += NUM_LANES) {
+        const unsigned lanes = std::min(count - first, NUM_LANES);
+        batch_state.LoadInput(config, inputs + first, lanes);
+        if (batch_shader->Run(setup, batch_state, setup.engine_data.entry_point)) {
+            batch_state.WriteOutput(config, outputs + first, lanes);
+            continue;
+        }
+
+        // The vertices took paths through the program that the batch shader can't mask
+        for (unsigned i = first; i < first + lanes; ++i) {
+            state.LoadInput(config, inputs[i]);
+            shader->Run(setup, state, setup.engine_data.entry_point);
+            state.WriteOutput(config, outputs[i]);
+        }
+    }
+}
+
 } // namespace Shader
 } // namespace Pica
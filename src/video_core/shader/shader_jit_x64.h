@@ -4,26 +4,108 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include "common/common_types.h"
 #include "video_core/shader/shader.h"
+#include "video_core/shader/shader_interpreter.h"
 
 namespace Pica {
 namespace Shader {
 
 class JitShader;
+class JitBatchShader;
 
 class JitX64Engine final : public ShaderEngine {
 public:
     JitX64Engine();
     ~JitX64Engine() override;
 
-    void SetupBatch(ShaderSetup& setup, unsigned int entry_point) override;
+    void SetupBatch(ShaderSetup& setup, unsigned int entry_point, u32 output_mask) override;
     void Run(const ShaderSetup& setup, UnitState& state) const override;
+    void RunBatch(const ShaderSetup& setup, UnitState& state, const ShaderRegs& config,
+                  const AttributeBuffer* inputs, AttributeBuffer* outputs,
+                  unsigned count) const override;
+
+    /// Statistics of the compiled shader cache
+    struct CacheStats {
+        u64 hits = 0;
+        u64 misses = 0;
+        u64 evictions = 0;
+        /// Size of the code buffers reserved by all cached shaders, in bytes
+        size_t code_size = 0;
+    };
+
+    const CacheStats& GetCacheStats() const {
+        return stats;
+    }
 
 private:
-    std::unordered_map<u64, std::unique_ptr<JitShader>> cache;
+    struct CompileJob;
+
+    /// Identifies a cached shader in the LRU list
+    struct LruItem {
+        u64 key;
+        bool batch;
+    };
+    /// Cached shaders ordered from the least to the most recently used one
+    using LruList = std::list<LruItem>;
+
+    template <typename T>
+    struct CacheEntry {
+        std::unique_ptr<T> shader;
+        size_t code_size;
+        LruList::iterator lru_position;
+    };
+
+    template <typename T>
+    using Cache = std::unordered_map<u64, CacheEntry<T>>;
+
+    /// Adds a shader to the cache as the most recently used one, unless the key is already cached
+    template <typename T>
+    typename Cache<T>::iterator AddToCache(Cache<T>& cache, u64 key, bool batch,
+                                           std::unique_ptr<T> shader);
+
+    /**
+     * Evicts the least recently used shaders until the code buffers of the cached shaders fit the
+     * configured size. The shaders with the given keys, which are in use, are kept.
+     */
+    void EvictColdShaders(u64 key, u64 batch_key);
+
+    /// Compiles queued programs until the engine is destroyed
+    void CompileThread();
+    /// Moves the shaders finished by the compile thread into the caches
+    void CollectCompiledShaders();
+
+    Cache<JitShader> cache;
+    /// Batch shaders by program and entry point, null if the program can't run in batches
+    Cache<JitBatchShader> batch_cache;
+    LruList lru;
+    CacheStats stats;
+
+    /// Runs the programs that are still being compiled
+    InterpreterEngine interpreter;
+
+    // Keys of the shaders queued for compilation, only accessed by the emulation thread
+    std::unordered_set<u64> pending_shaders;
+    std::unordered_set<u64> pending_batch_shaders;
+    size_t pending_jobs = 0;
+
+    std::thread compile_thread;
+    std::mutex compile_mutex;
+    std::condition_variable compile_available;
+    /// Jobs waiting for the compile thread, protected by compile_mutex
+    std::deque<std::unique_ptr<CompileJob>> compile_queue;
+    /// Jobs finished by the compile thread, protected by compile_mutex
+    std::vector<std::unique_ptr<CompileJob>> compiled_jobs;
+    bool shutting_down = false;
 };
 
 } // namespace Shader
@@ -0,0 +1,1104 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <nihstro/shader_bytecode.h>
+#include <smmintrin.h>
+#include <xmmintrin.h>
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "common/x64/cpu_detect.h"
+#include "common/x64/xbyak_abi.h"
+#include "common/x64/xbyak_util.h"
+#include "video_core/pica_types.h"
+#include "video_core/shader/shader.h"
+#include "video_core/shader/shader_jit_x64_batch_compiler.h"
+#include "video_core/shader/shader_liveness.h"
+
+using namespace Common::X64;
+using namespace Xbyak::util;
+using Xbyak::Address;
+using Xbyak::Label;
+using Xbyak::Reg32;
+using Xbyak::Reg64;
+using Xbyak::Xmm;
+
+namespace Pica {
+
+namespace Shader {
+
+constexpr unsigned NUM_LANES = BatchUnitState::NUM_LANES;
+
+void BatchUnitState::LoadInput(const ShaderRegs& config, const AttributeBuffer* inputs,
+                               unsigned count) {
+    ASSERT(count > 0 && count <= NUM_LANES);
+    const unsigned max_attribute = config.max_input_attribute_index;
+
+    for (unsigned attr = 0; attr <= max_attribute; ++attr) {
+        __m128 lanes[NUM_LANES];
+        for (unsigned lane = 0; lane < NUM_LANES; ++lane) {
+            const AttributeBuffer& input = inputs[lane < count ? lane : 0];
+            lanes[lane] = _mm_load_ps(reinterpret_cast<const float*>(&input.attr[attr]));
+        }
+        _MM_TRANSPOSE4_PS(lanes[0], lanes[1], lanes[2], lanes[3]);
+
+        Register& reg = registers.input[config.GetRegisterForAttribute(attr)];
+        for (unsigned comp = 0; comp < 4; ++comp)
+            _mm_store_ps(reinterpret_cast<float*>(reg[comp]), lanes[comp]);
+    }
+}
+
+void BatchUnitState::WriteOutput(const ShaderRegs& config, AttributeBuffer* outputs,
+                                 unsigned count) const {
+    ASSERT(count <= NUM_LANES);
+    unsigned int output_i = 0;
+    for (unsigned int reg : Common::BitSet<u32>(config.output_mask)) {
+        __m128 lanes[4];
+        for (unsigned comp = 0; comp < 4; ++comp)
+            lanes[comp] = _mm_load_ps(reinterpret_cast<const float*>(registers.output[reg][comp]));
+        _MM_TRANSPOSE4_PS(lanes[0], lanes[1], lanes[2], lanes[3]);
+
+        for (unsigned lane = 0; lane < count; ++lane)
+            _mm_store_ps(reinterpret_cast<float*>(&outputs[lane].attr[output_i]), lanes[lane]);
+        ++output_i;
+    }
+}
+
+typedef void (JitBatchShader::*JitFunction)(Instruction instr);
+
+static const JitFunction instr_table[64] = {
+    &JitBatchShader::Compile_ADD,   // add
+    &JitBatchShader::Compile_DP3,   // dp3
+    &JitBatchShader::Compile_DP4,   // dp4
+    &JitBatchShader::Compile_DPH,   // dph
+    nullptr,                        // unknown
+    &JitBatchShader::Compile_EX2,   // ex2
+    &JitBatchShader::Compile_LG2,   // lg2
+    nullptr,                        // unknown
+    &JitBatchShader::Compile_MUL,   // mul
+    &JitBatchShader::Compile_SGE,   // sge
+    &JitBatchShader::Compile_SLT,   // slt
+    &JitBatchShader::Compile_FLR,   // flr
+    &JitBatchShader::Compile_MAX,   // max
+    &JitBatchShader::Compile_MIN,   // min
+    &JitBatchShader::Compile_RCP,   // rcp
+    &JitBatchShader::Compile_RSQ,   // rsq
+    nullptr,                        // unknown
+    nullptr,                        // unknown
+    &JitBatchShader::Compile_MOVA,  // mova
+    &JitBatchShader::Compile_MOV,   // mov
+    nullptr,                        // unknown
+    nullptr,                        // unknown
+    nullptr,                        // unknown
+    nullptr,                        // unknown
+    &JitBatchShader::Compile_DPH,   // dphi
+    nullptr,                        // unknown
+    &JitBatchShader::Compile_SGE,   // sgei
+    &JitBatchShader::Compile_SLT,   // slti
+    nullptr,                        // unknown
+    nullptr,                        // unknown
+    nullptr,                        // unknown
+    nullptr,                        // unknown
+    nullptr,                        // unknown
+    &JitBatchShader::Compile_NOP,   // nop
+    &JitBatchShader::Compile_END,   // end
+    nullptr,                        // break
+    &JitBatchShader::Compile_CALL,  // call
+    &JitBatchShader::Compile_CALLC, // callc
+    &JitBatchShader::Compile_CALLU, // callu
+    &JitBatchShader::Compile_IF,    // ifu
+    &JitBatchShader::Compile_IF,    // ifc
+    &JitBatchShader::Compile_LOOP,  // loop
+    nullptr,                        // emit
+    nullptr,                        // sete
+    &JitBatchShader::Compile_JMP,   // jmpc
+    &JitBatchShader::Compile_JMP,   // jmpu
+    &JitBatchShader::Compile_CMP,   // cmp
+    &JitBatchShader::Compile_CMP,   // cmp
+    &JitBatchShader::Compile_MAD,   // madi
+    &JitBatchShader::Compile_MAD,   // madi
+    &JitBatchShader::Compile_MAD,   // madi
+    &JitBatchShader::Compile_MAD,   // madi
+    &JitBatchShader::Compile_MAD,   // madi
+    &JitBatchShader::Compile_MAD,   // madi
+    &JitBatchShader::Compile_MAD,   // madi
+    &JitBatchShader::Compile_MAD,   // madi
+    &JitBatchShader::Compile_MAD,   // mad
+    &JitBatchShader::Compile_MAD,   // mad
+    &JitBatchShader::Compile_MAD,   // mad
+    &JitBatchShader::Compile_MAD,   // mad
+    &JitBatchShader::Compile_MAD,   // mad
+    &JitBatchShader::Compile_MAD,   // mad
+    &JitBatchShader::Compile_MAD,   // mad
+    &JitBatchShader::Compile_MAD,   // mad
+};
+
+// The register assignment follows the scalar JIT where possible. RAX-RDX and XMM0-XMM3 can be used
+// as scratch registers within a compiler function; XMM4-XMM7 hold the components of the result of
+// an instruction until they are written to its destination register. Each XMM register holds one
+// component of a register for all lanes, so conditions and masks are per-lane too.
+
+/// Pointer to the uniform memory
+static const Reg64 SETUP = r9;
+/// Value of RSP after the prologue, used to leave the program from any stack depth
+static const Reg64 STACK_BASE = rbx;
+/// VS loop count register (Multiplied by 16)
+static const Reg32 LOOPCOUNT_REG = r12d;
+/// Current VS loop iteration number
+static const Reg32 LOOPCOUNT = esi;
+/// Number to increment LOOPCOUNT_REG by on each loop iteration (Multiplied by 16)
+static const Reg32 LOOPINC = edi;
+/// Pointer to the BatchUnitState instance
+static const Reg64 STATE = r15;
+/// SIMD scratch register
+static const Xmm SCRATCH = xmm0;
+/// Loaded with a component of the first source operand
+static const Xmm SRC1 = xmm1;
+/// Loaded with a component of the second or third source operand
+static const Xmm SRC2 = xmm2;
+/// Additional scratch register
+static const Xmm SCRATCH2 = xmm3;
+/// Components of the result of the current instruction
+static const Xmm RESULT[4] = {xmm4, xmm5, xmm6, xmm7};
+/// Lanes whose vertex executes the current code, all ones for enabled lanes
+static const Xmm EXEC = xmm11;
+/// Result of the previous CMP instruction for the X-component comparison, per lane
+static const Xmm COND0 = xmm12;
+/// Result of the previous CMP instruction for the Y-component comparison, per lane
+static const Xmm COND1 = xmm13;
+/// Constant vector of [1.0f, 1.0f, 1.0f, 1.0f], used to efficiently set a vector to one
+static const Xmm ONE = xmm14;
+/// Constant vector of [-0.f, -0.f, -0.f, -0.f], used to efficiently negate a vector with XOR
+static const Xmm NEGBIT = xmm15;
+
+// State registers that must not be modified by external functions calls
+static const BitSet32 persistent_regs = BuildRegSet({
+    // Pointers to register blocks
+    SETUP, STATE, STACK_BASE,
+    // Cached registers
+    LOOPCOUNT_REG, EXEC, COND0, COND1,
+    // Constants
+    ONE, NEGBIT,
+    // Loop variables
+    LOOPCOUNT, LOOPINC,
+});
+
+/// Mask of movmskps with all lanes set
+static const int ALL_LANES = (1 << NUM_LANES) - 1;
+
+/// Bound on the code emitted for a single instruction, used to stop before the buffer overflows
+constexpr size_t MAX_INSTRUCTION_SIZE = 4096;
+
+static void LogCritical(const char* msg) {
+    LOG_CRITICAL(HW_GPU, "%s", msg);
+}
+
+void JitBatchShader::Compile_Assert(bool condition, const char* msg) {
+    if (!condition) {
+        mov(ABI_PARAM1, reinterpret_cast<size_t>(msg));
+        CallFarFunction(*this, LogCritical);
+    }
+}
+
+void JitBatchShader::Compile_LoadSrc(Instruction instr, unsigned src_num, SourceRegister src_reg,
+                                     unsigned component, Xmm dest) {
+    const bool is_mad = instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MAD ||
+                        instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MADI;
+    const bool is_inverted =
+        (0 != (instr.opcode.Value().GetInfo().subtype & OpCode::Info::SrcInversed));
+
+    unsigned operand_desc_id;
+    unsigned address_register_index;
+    unsigned offset_src;
+    if (is_mad) {
+        operand_desc_id = instr.mad.operand_desc_id;
+        offset_src = is_inverted ? 3 : 2;
+        address_register_index = instr.mad.address_register_index;
+    } else {
+        operand_desc_id = instr.common.operand_desc_id;
+        offset_src = is_inverted ? 2 : 1;
+        address_register_index = instr.common.address_register_index;
+    }
+    if (src_num != offset_src)
+        address_register_index = 0;
+
+    SwizzlePattern swiz = {(*swizzle_data)[operand_desc_id]};
+    const unsigned selector[] = {
+        static_cast<unsigned>(swiz.GetSelectorSrc1(component)),
+        static_cast<unsigned>(swiz.GetSelectorSrc2(component)),
+        static_cast<unsigned>(swiz.GetSelectorSrc3(component)),
+    };
+    const unsigned sel = selector[src_num - 1];
+
+    // Offset of the selected address register (a0 or a1) of the first lane
+    const size_t address_offset =
+        offsetof(BatchUnitState, address_registers) +
+        (address_register_index == 2 ? sizeof(s32) * NUM_LANES : 0);
+
+    if (src_reg.GetRegisterType() == RegisterType::FloatUniform) {
+        // Uniforms are the same for all lanes and are broadcast, unless the address registers
+        // select a different uniform in each lane
+        const int src_offset = static_cast<int>(
+            ShaderSetup::GetFloatUniformOffset(src_reg.GetIndex()) + sel * sizeof(float24));
+
+        switch (address_register_index) {
+        case 0:
+            movss(dest, dword[SETUP + src_offset]);
+            shufps(dest, dest, _MM_SHUFFLE(0, 0, 0, 0));
+            break;
+        case 3:
+            movss(dest, dword[SETUP + LOOPCOUNT_REG.cvt64() + src_offset]);
+            shufps(dest, dest, _MM_SHUFFLE(0, 0, 0, 0));
+            break;
+        default:
+            for (unsigned lane = 0; lane < NUM_LANES; ++lane) {
+                movsxd(rax, dword[STATE + address_offset + lane * sizeof(s32)]);
+                shl(rax, 4);
+                if (lane == 0)
+                    movss(dest, dword[SETUP + rax + src_offset]);
+                else
+                    insertps(dest, dword[SETUP + rax + src_offset], lane << 4);
+            }
+            break;
+        }
+    } else {
+        const int src_offset = static_cast<int>(BatchUnitState::InputOffset(src_reg) +
+                                                sel * sizeof(float24) * NUM_LANES);
+
+        switch (address_register_index) {
+        case 0:
+            movaps(dest, xword[STATE + src_offset]);
+            break;
+        case 3:
+            // LOOPCOUNT_REG is scaled for Math::Vec4<float24> registers
+            lea(rax, ptr[LOOPCOUNT_REG.cvt64() * NUM_LANES]);
+            movaps(dest, xword[STATE + rax + src_offset]);
+            break;
+        default:
+            for (unsigned lane = 0; lane < NUM_LANES; ++lane) {
+                const int lane_offset = src_offset + static_cast<int>(lane * sizeof(float24));
+                movsxd(rax, dword[STATE + address_offset + lane * sizeof(s32)]);
+                shl(rax, 6); // sizeof(BatchUnitState::Register)
+                if (lane == 0)
+                    movss(dest, dword[STATE + rax + lane_offset]);
+                else
+                    insertps(dest, dword[STATE + rax + lane_offset], lane << 4);
+            }
+            break;
+        }
+    }
+
+    // If the source register should be negated, flip the negative bit using XOR
+    const bool negate[] = {swiz.negate_src1, swiz.negate_src2, swiz.negate_src3};
+    if (negate[src_num - 1]) {
+        xorps(dest, NEGBIT);
+    }
+}
+
+void JitBatchShader::Compile_LoadSrcComponents(Instruction instr, unsigned src_num,
+                                               SourceRegister src_reg, const Xmm* dest) {
+    const unsigned operand_desc_id = (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MAD ||
+                                      instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MADI)
+                                         ? instr.mad.operand_desc_id
+                                         : instr.common.operand_desc_id;
+    SwizzlePattern swiz = {(*swizzle_data)[operand_desc_id]};
+
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        if (swiz.DestComponentEnabled(comp))
+            Compile_LoadSrc(instr, src_num, src_reg, comp, dest[comp]);
+    }
+}
+
+void JitBatchShader::Compile_MaskedStore(const Address& dest, Xmm value, Xmm scratch) {
+    if (mask_depth == 0) {
+        movaps(dest, value);
+        return;
+    }
+
+    // dest ^ ((dest ^ value) & EXEC) keeps dest in the disabled lanes
+    movaps(scratch, value);
+    xorps(scratch, dest);
+    andps(scratch, EXEC);
+    xorps(scratch, dest);
+    movaps(dest, scratch);
+}
+
+void JitBatchShader::Compile_DestEnable(Instruction instr, const Xmm* components) {
+    DestRegister dest;
+    unsigned operand_desc_id;
+    if (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MAD ||
+        instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MADI) {
+        operand_desc_id = instr.mad.operand_desc_id;
+        dest = instr.mad.dest.Value();
+    } else {
+        operand_desc_id = instr.common.operand_desc_id;
+        dest = instr.common.dest.Value();
+    }
+
+    SwizzlePattern swiz = {(*swizzle_data)[operand_desc_id]};
+
+    const size_t dest_offset = BatchUnitState::OutputOffset(dest);
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        if (swiz.DestComponentEnabled(comp)) {
+            Compile_MaskedStore(xword[STATE + dest_offset + comp * sizeof(float24) * NUM_LANES],
+                                components[comp], SCRATCH);
+        }
+    }
+}
+
+void JitBatchShader::Compile_ComponentWise(Instruction instr, SourceRegister src1,
+                                           SourceRegister src2, BinaryOperation operation) {
+    SwizzlePattern swiz = {(*swizzle_data)[instr.common.operand_desc_id]};
+
+    // All components are computed before any is written, as the destination may be a source
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        if (!swiz.DestComponentEnabled(comp))
+            continue;
+
+        Compile_LoadSrc(instr, 1, src1, comp, RESULT[comp]);
+        Compile_LoadSrc(instr, 2, src2, comp, SRC2);
+        ((*this).*operation)(RESULT[comp], SRC2, SCRATCH);
+    }
+
+    Compile_DestEnable(instr, RESULT);
+}
+
+void JitBatchShader::Compile_DotProduct(Instruction instr, SourceRegister src1,
+                                        SourceRegister src2, unsigned num_components,
+                                        bool homogeneous) {
+    for (unsigned comp = 0; comp < num_components; ++comp) {
+        Compile_LoadSrc(instr, 2, src2, comp, SRC2);
+        if (homogeneous && comp == 3) {
+            // The fourth component of src1 is 1.0, which leaves src2 unchanged
+            movaps(RESULT[comp], SRC2);
+        } else {
+            Compile_LoadSrc(instr, 1, src1, comp, RESULT[comp]);
+            Compile_SanitizedMul(RESULT[comp], SRC2, SCRATCH);
+        }
+    }
+
+    // Sum in the same order as the scalar JIT, to produce identical results
+    if (num_components == 3) {
+        addps(RESULT[0], RESULT[1]);
+        addps(RESULT[0], RESULT[2]);
+
+        const Xmm result[] = {RESULT[0], RESULT[0], RESULT[0], RESULT[0]};
+        Compile_DestEnable(instr, result);
+        return;
+    }
+
+    // JitShader::Compile_DP4 adds the pairs of products in a different order for each component,
+    // which decides the sign of a NaN result
+    movaps(SRC1, RESULT[0]);
+    addps(SRC1, RESULT[1]); // x + y
+    movaps(SRC2, RESULT[1]);
+    addps(SRC2, RESULT[0]); // y + x
+    movaps(SCRATCH, RESULT[2]);
+    addps(SCRATCH, RESULT[3]); // z + w
+    movaps(SCRATCH2, RESULT[3]);
+    addps(SCRATCH2, RESULT[2]); // w + z
+
+    const Xmm first[] = {SCRATCH, SCRATCH2, SRC1, SRC2};
+    const Xmm second[] = {SRC2, SRC1, SCRATCH2, SCRATCH};
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        movaps(RESULT[comp], first[comp]);
+        addps(RESULT[comp], second[comp]);
+    }
+
+    Compile_DestEnable(instr, RESULT);
+}
+
+void JitBatchShader::Compile_ExternalFunction(Instruction instr, float (*function)(float)) {
+    const size_t scratch_offset = offsetof(BatchUnitState, scratch);
+
+    Compile_LoadSrc(instr, 1, instr.common.src1, 0, SRC1);
+    movaps(xword[STATE + scratch_offset], SRC1);
+
+    ABI_PushRegistersAndAdjustStack(*this, PersistentCallerSavedRegs(), 0);
+    for (unsigned lane = 0; lane < NUM_LANES; ++lane) {
+        movss(xmm0, dword[STATE + scratch_offset + lane * sizeof(float)]); // ABI_PARAM1
+        CallFarFunction(*this, function);
+        movss(dword[STATE + scratch_offset + lane * sizeof(float)], xmm0); // ABI_RETURN
+    }
+    ABI_PopRegistersAndAdjustStack(*this, PersistentCallerSavedRegs(), 0);
+
+    movaps(SRC1, xword[STATE + scratch_offset]);
+    const Xmm result[] = {SRC1, SRC1, SRC1, SRC1};
+    Compile_DestEnable(instr, result);
+}
+
+void JitBatchShader::Compile_SanitizedMul(Xmm src1, Xmm src2, Xmm scratch) {
+    // See JitShader::Compile_SanitizedMul: 0 * inf must return 0 instead of NaN. Unlike the scalar
+    // version, src2 is preserved.
+    movaps(scratch, src1);
+    cmpordps(scratch, src2);
+
+    mulps(src1, src2);
+
+    // Set SCRATCH2 to mask of (result == NaN)
+    movaps(SCRATCH2, src1);
+    cmpunordps(SCRATCH2, SCRATCH2);
+
+    // Clear components where scratch != SCRATCH2 (i.e. if result is NaN where neither source was
+    // NaN)
+    xorps(scratch, SCRATCH2);
+    andps(src1, scratch);
+}
+
+void JitBatchShader::Compile_Add(Xmm src1, Xmm src2, Xmm scratch) {
+    addps(src1, src2);
+}
+
+void JitBatchShader::Compile_Max(Xmm src1, Xmm src2, Xmm scratch) {
+    // SSE semantics match PICA200 ones: In case of NaN, SRC2 is returned.
+    maxps(src1, src2);
+}
+
+void JitBatchShader::Compile_Min(Xmm src1, Xmm src2, Xmm scratch) {
+    // SSE semantics match PICA200 ones: In case of NaN, SRC2 is returned.
+    minps(src1, src2);
+}
+
+void JitBatchShader::Compile_SetGreaterEqual(Xmm src1, Xmm src2, Xmm scratch) {
+    movaps(scratch, src2);
+    cmpleps(scratch, src1);
+    andps(scratch, ONE);
+    movaps(src1, scratch);
+}
+
+void JitBatchShader::Compile_SetLessThan(Xmm src1, Xmm src2, Xmm scratch) {
+    cmpltps(src1, src2);
+    andps(src1, ONE);
+}
+
+void JitBatchShader::Compile_EvaluateCondition(Instruction instr, Xmm dest) {
+    // Loads the lanes where a condition code equals the given reference value into a register
+    auto compare = [this](Xmm reg, Xmm cond, bool ref) {
+        movaps(reg, cond);
+        if (!ref) {
+            pcmpeqd(SCRATCH, SCRATCH);
+            xorps(reg, SCRATCH);
+        }
+    };
+
+    switch (instr.flow_control.op) {
+    case Instruction::FlowControlType::Or:
+        compare(dest, COND0, instr.flow_control.refx.Value());
+        compare(SCRATCH2, COND1, instr.flow_control.refy.Value());
+        orps(dest, SCRATCH2);
+        break;
+
+    case Instruction::FlowControlType::And:
+        compare(dest, COND0, instr.flow_control.refx.Value());
+        compare(SCRATCH2, COND1, instr.flow_control.refy.Value());
+        andps(dest, SCRATCH2);
+        break;
+
+    case Instruction::FlowControlType::JustX:
+        compare(dest, COND0, instr.flow_control.refx.Value());
+        break;
+
+    case Instruction::FlowControlType::JustY:
+        compare(dest, COND1, instr.flow_control.refy.Value());
+        break;
+    }
+}
+
+void JitBatchShader::Compile_UniformCondition(Instruction instr) {
+    size_t offset = ShaderSetup::GetBoolUniformOffset(instr.flow_control.bool_uniform_id);
+    cmp(byte[SETUP + offset], 0);
+}
+
+void JitBatchShader::Compile_RequireFullMask() {
+    movmskps(eax, EXEC);
+    cmp(eax, ALL_LANES);
+    jne(l_diverged, T_NEAR);
+}
+
+BitSet32 JitBatchShader::PersistentCallerSavedRegs() {
+    return persistent_regs & ABI_ALL_CALLER_SAVED;
+}
+
+void JitBatchShader::Compile_ADD(Instruction instr) {
+    Compile_ComponentWise(instr, instr.common.src1, instr.common.src2,
+                          &JitBatchShader::Compile_Add);
+}
+
+void JitBatchShader::Compile_DP3(Instruction instr) {
+    Compile_DotProduct(instr, instr.common.src1, instr.common.src2, 3, false);
+}
+
+void JitBatchShader::Compile_DP4(Instruction instr) {
+    Compile_DotProduct(instr, instr.common.src1, instr.common.src2, 4, false);
+}
+
+void JitBatchShader::Compile_DPH(Instruction instr) {
+    if (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::DPHI) {
+        Compile_DotProduct(instr, instr.common.src1i, instr.common.src2i, 4, true);
+    } else {
+        Compile_DotProduct(instr, instr.common.src1, instr.common.src2, 4, true);
+    }
+}
+
+void JitBatchShader::Compile_EX2(Instruction instr) {
+    Compile_ExternalFunction(instr, exp2f);
+}
+
+void JitBatchShader::Compile_LG2(Instruction instr) {
+    Compile_ExternalFunction(instr, log2f);
+}
+
+void JitBatchShader::Compile_MUL(Instruction instr) {
+    Compile_ComponentWise(instr, instr.common.src1, instr.common.src2,
+                          &JitBatchShader::Compile_SanitizedMul);
+}
+
+void JitBatchShader::Compile_SGE(Instruction instr) {
+    if (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::SGEI) {
+        Compile_ComponentWise(instr, instr.common.src1i, instr.common.src2i,
+                              &JitBatchShader::Compile_SetGreaterEqual);
+    } else {
+        Compile_ComponentWise(instr, instr.common.src1, instr.common.src2,
+                              &JitBatchShader::Compile_SetGreaterEqual);
+    }
+}
+
+void JitBatchShader::Compile_SLT(Instruction instr) {
+    if (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::SLTI) {
+        Compile_ComponentWise(instr, instr.common.src1i, instr.common.src2i,
+                              &JitBatchShader::Compile_SetLessThan);
+    } else {
+        Compile_ComponentWise(instr, instr.common.src1, instr.common.src2,
+                              &JitBatchShader::Compile_SetLessThan);
+    }
+}
+
+void JitBatchShader::Compile_FLR(Instruction instr) {
+    Compile_LoadSrcComponents(instr, 1, instr.common.src1, RESULT);
+    for (unsigned comp = 0; comp < 4; ++comp)
+        roundps(RESULT[comp], RESULT[comp], _MM_FROUND_FLOOR);
+    Compile_DestEnable(instr, RESULT);
+}
+
+void JitBatchShader::Compile_MAX(Instruction instr) {
+    Compile_ComponentWise(instr, instr.common.src1, instr.common.src2,
+                          &JitBatchShader::Compile_Max);
+}
+
+void JitBatchShader::Compile_MIN(Instruction instr) {
+    Compile_ComponentWise(instr, instr.common.src1, instr.common.src2,
+                          &JitBatchShader::Compile_Min);
+}
+
+void JitBatchShader::Compile_MOVA(Instruction instr) {
+    SwizzlePattern swiz = {(*swizzle_data)[instr.common.operand_desc_id]};
+
+    for (unsigned comp = 0; comp < 2; ++comp) {
+        if (!swiz.DestComponentEnabled(comp))
+            continue;
+
+        // Convert floats to integers using truncation. Unlike the scalar JIT, the address
+        // registers are kept unscaled, as they are scaled differently for uniforms and registers.
+        Compile_LoadSrc(instr, 1, instr.common.src1, comp, SRC1);
+        cvttps2dq(SRC1, SRC1);
+        Compile_MaskedStore(xword[STATE + offsetof(BatchUnitState, address_registers) +
+                                  comp * sizeof(s32) * NUM_LANES],
+                            SRC1, SCRATCH);
+    }
+}
+
+void JitBatchShader::Compile_MOV(Instruction instr) {
+    Compile_LoadSrcComponents(instr, 1, instr.common.src1, RESULT);
+    Compile_DestEnable(instr, RESULT);
+}
+
+void JitBatchShader::Compile_RCP(Instruction instr) {
+    Compile_LoadSrc(instr, 1, instr.common.src1, 0, SRC1);
+
+    // RCPPS uses the same approximation as the RCPSS of the scalar JIT
+    rcpps(SRC1, SRC1);
+
+    const Xmm result[] = {SRC1, SRC1, SRC1, SRC1};
+    Compile_DestEnable(instr, result);
+}
+
+void JitBatchShader::Compile_RSQ(Instruction instr) {
+    Compile_LoadSrc(instr, 1, instr.common.src1, 0, SRC1);
+
+    // RSQRTPS uses the same approximation as the RSQRTSS of the scalar JIT
+    rsqrtps(SRC1, SRC1);
+
+    const Xmm result[] = {SRC1, SRC1, SRC1, SRC1};
+    Compile_DestEnable(instr, result);
+}
+
+void JitBatchShader::Compile_NOP(Instruction instr) {}
+
+void JitBatchShader::Compile_END(Instruction instr) {
+    // Vertices outside the execution mask would continue after the END
+    if (mask_depth > 0)
+        Compile_RequireFullMask();
+
+    mov(rsp, STACK_BASE);
+    mov(eax, 1);
+    ABI_PopRegistersAndAdjustStack(*this, ABI_ALL_CALLEE_SAVED, 8, 16);
+    ret();
+}
+
+void JitBatchShader::Compile_CALL(Instruction instr) {
+    // Subroutines are compiled without execution masks, so every vertex has to call them
+    if (mask_depth > 0)
+        Compile_RequireFullMask();
+
+    // Push offset of the return
+    push(qword, (instr.flow_control.dest_offset + instr.flow_control.num_instructions));
+
+    // Call the subroutine
+    call(instruction_labels[instr.flow_control.dest_offset]);
+
+    // Skip over the return offset that's on the stack
+    add(rsp, 8);
+}
+
+void JitBatchShader::Compile_CALLC(Instruction instr) {
+    Compile_EvaluateCondition(instr, SRC1);
+    if (mask_depth > 0)
+        andps(SRC1, EXEC);
+
+    // Calls are only made if either no vertex or all vertices take them
+    Label b;
+    movmskps(eax, SRC1);
+    test(eax, eax);
+    jz(b, T_NEAR);
+    cmp(eax, ALL_LANES);
+    jne(l_diverged, T_NEAR);
+    Compile_CALL(instr);
+    L(b);
+}
+
+void JitBatchShader::Compile_CALLU(Instruction instr) {
+    Compile_UniformCondition(instr);
+    Label b;
+    jz(b, T_NEAR);
+    Compile_CALL(instr);
+    L(b);
+}
+
+void JitBatchShader::Compile_CMP(Instruction instr) {
+    using Op = Instruction::Common::CompareOpType::Op;
+    const Op ops[] = {instr.common.compare_op.x, instr.common.compare_op.y};
+    const Xmm conds[] = {COND0, COND1};
+
+    // SSE doesn't have greater-than (GT) or greater-equal (GE) comparison operators. You need to
+    // emulate them by swapping the lhs and rhs and using LT and LE. NLT and NLE can't be used here
+    // because they don't match when used with NaNs.
+    static const u8 cmp[] = {CMP_EQ, CMP_NEQ, CMP_LT, CMP_LE, CMP_LT, CMP_LE};
+
+    for (unsigned comp = 0; comp < 2; ++comp) {
+        // Unknown comparisons leave the conditional code unchanged, like the interpreter does
+        if (ops[comp] > Op::GreaterEqual)
+            continue;
+
+        Compile_LoadSrc(instr, 1, instr.common.src1, comp, SRC1);
+        Compile_LoadSrc(instr, 2, instr.common.src2, comp, SRC2);
+
+        const bool invert_op = (ops[comp] == Op::GreaterThan || ops[comp] == Op::GreaterEqual);
+        const Xmm lhs = invert_op ? SRC2 : SRC1;
+        const Xmm rhs = invert_op ? SRC1 : SRC2;
+        cmpps(lhs, rhs, cmp[ops[comp]]);
+
+        if (mask_depth > 0) {
+            xorps(lhs, conds[comp]);
+            andps(lhs, EXEC);
+            xorps(conds[comp], lhs);
+        } else {
+            movaps(conds[comp], lhs);
+        }
+    }
+}
+
+void JitBatchShader::Compile_MAD(Instruction instr) {
+    SwizzlePattern swiz = {(*swizzle_data)[instr.mad.operand_desc_id]};
+    const bool is_madi = instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MADI;
+    const SourceRegister src2 = is_madi ? instr.mad.src2i.Value() : instr.mad.src2.Value();
+    const SourceRegister src3 = is_madi ? instr.mad.src3i.Value() : instr.mad.src3.Value();
+
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        if (!swiz.DestComponentEnabled(comp))
+            continue;
+
+        Compile_LoadSrc(instr, 1, instr.mad.src1, comp, RESULT[comp]);
+        Compile_LoadSrc(instr, 2, src2, comp, SRC2);
+        Compile_SanitizedMul(RESULT[comp], SRC2, SCRATCH);
+        Compile_LoadSrc(instr, 3, src3, comp, SRC2);
+        addps(RESULT[comp], SRC2);
+    }
+
+    Compile_DestEnable(instr, RESULT);
+}
+
+void JitBatchShader::Compile_IF(Instruction instr) {
+    Compile_Assert(instr.flow_control.dest_offset >= program_counter,
+                   "Backwards if-statements not supported");
+    Label l_else, l_endif;
+
+    if (instr.opcode.Value() == OpCode::Id::IFU) {
+        // Uniform conditions are the same for all vertices, compile them like the scalar JIT
+        Compile_UniformCondition(instr);
+        jz(l_else, T_NEAR);
+
+        Compile_Block(instr.flow_control.dest_offset);
+
+        if (instr.flow_control.num_instructions == 0) {
+            L(l_else);
+            return;
+        }
+
+        jmp(l_endif, T_NEAR);
+
+        L(l_else);
+        Compile_Block(instr.flow_control.dest_offset + instr.flow_control.num_instructions);
+
+        L(l_endif);
+        return;
+    }
+
+    // Both branches are executed, each under the mask of the vertices that take it. The enclosing
+    // execution mask and the mask of the "ELSE" branch are kept on the stack, which stays aligned
+    // for calls to external functions.
+    Compile_EvaluateCondition(instr, SRC1);
+    if (mask_depth > 0)
+        andps(SRC1, EXEC);
+    movaps(SRC2, SRC1);
+    andnps(SRC2, EXEC);
+
+    sub(rsp, 32);
+    movaps(xword[rsp], EXEC);
+    movaps(xword[rsp + 16], SRC2);
+    movaps(EXEC, SRC1);
+
+    ++mask_depth;
+
+    // Skip the branches no vertex takes
+    ptest(EXEC, EXEC);
+    jz(l_else, T_NEAR);
+    Compile_Block(instr.flow_control.dest_offset);
+
+    L(l_else);
+    if (instr.flow_control.num_instructions != 0) {
+        movaps(EXEC, xword[rsp + 16]);
+        ptest(EXEC, EXEC);
+        jz(l_endif, T_NEAR);
+        Compile_Block(instr.flow_control.dest_offset + instr.flow_control.num_instructions);
+        L(l_endif);
+    }
+
+    --mask_depth;
+
+    movaps(EXEC, xword[rsp]);
+    add(rsp, 32);
+}
+
+void JitBatchShader::Compile_LOOP(Instruction instr) {
+    Compile_Assert(instr.flow_control.dest_offset >= program_counter,
+                   "Backwards loops not supported");
+    Compile_Assert(!looping, "Nested loops not supported");
+
+    looping = true;
+
+    // aL is shared by all vertices, so a loop must not run for only some of them
+    if (mask_depth > 0)
+        Compile_RequireFullMask();
+
+    // The loop parameters come from an integer uniform, so all vertices iterate the same. See
+    // JitShader::Compile_LOOP.
+    size_t offset = ShaderSetup::GetIntUniformOffset(instr.flow_control.int_uniform_id);
+    mov(LOOPCOUNT, dword[SETUP + offset]);
+    mov(LOOPCOUNT_REG, LOOPCOUNT);
+    shr(LOOPCOUNT_REG, 4);
+    and_(LOOPCOUNT_REG, 0xFF0); // Y-component is the start
+    mov(LOOPINC, LOOPCOUNT);
+    shr(LOOPINC, 12);
+    and_(LOOPINC, 0xFF0);               // Z-component is the incrementer
+    movzx(LOOPCOUNT, LOOPCOUNT.cvt8()); // X-component is iteration count
+    add(LOOPCOUNT, 1);                  // Iteration count is X-component + 1
+
+    Label l_loop_start;
+    L(l_loop_start);
+
+    Compile_Block(instr.flow_control.dest_offset + 1);
+
+    add(LOOPCOUNT_REG, LOOPINC); // Increment LOOPCOUNT_REG by Z-component
+    sub(LOOPCOUNT, 1);           // Increment loop count by 1
+    jnz(l_loop_start, T_NEAR);   // Loop if not equal
+
+    looping = false;
+}
+
+void JitBatchShader::Compile_JMP(Instruction instr) {
+    // AnalyzeFlowControl rejects jumps within conditional blocks, so all vertices execute this
+    Label& b = instruction_labels[instr.flow_control.dest_offset];
+
+    if (instr.opcode.Value() == OpCode::Id::JMPC) {
+        Compile_EvaluateCondition(instr, SRC1);
+
+        // Jump if all vertices do, bail out if only some of them do
+        movmskps(eax, SRC1);
+        cmp(eax, ALL_LANES);
+        je(b, T_NEAR);
+        test(eax, eax);
+        jnz(l_diverged, T_NEAR);
+    } else if (instr.opcode.Value() == OpCode::Id::JMPU) {
+        Compile_UniformCondition(instr);
+
+        bool inverted_condition = (instr.flow_control.num_instructions & 1) != 0;
+        if (inverted_condition) {
+            jz(b, T_NEAR);
+        } else {
+            jnz(b, T_NEAR);
+        }
+    } else {
+        UNREACHABLE();
+    }
+}
+
+void JitBatchShader::Compile_Block(unsigned end) {
+    while (program_counter < end) {
+        Compile_NextInstr();
+    }
+}
+
+void JitBatchShader::Compile_Return() {
+    // Peek return offset on the stack and check if we're at that offset
+    mov(rax, qword[rsp + 8]);
+    cmp(eax, (program_counter));
+
+    // If so, jump back to before CALL
+    Label b;
+    jnz(b, T_NEAR);
+    ret();
+    L(b);
+}
+
+void JitBatchShader::Compile_NextInstr() {
+    if (std::binary_search(return_offsets.begin(), return_offsets.end(), program_counter)) {
+        Compile_Return();
+    }
+
+    const unsigned offset = program_counter++;
+    if (!reachable[offset] || overflowed)
+        return;
+
+    if (getSize() + MAX_INSTRUCTION_SIZE > MAX_BATCH_SHADER_SIZE) {
+        overflowed = true;
+        return;
+    }
+
+    L(instruction_labels[offset]);
+    if (dead_instructions[offset])
+        return;
+
+    Instruction instr = {(*program_code)[offset]};
+
+    OpCode::Id opcode = instr.opcode.Value();
+    auto instr_func = instr_table[static_cast<unsigned>(opcode)];
+
+    if (instr_func) {
+        // JIT the instruction!
+        ((*this).*instr_func)(instr);
+    } else {
+        // Unhandled instruction
+        LOG_CRITICAL(HW_GPU, "Unhandled instruction: 0x%02x (0x%08x)",
+                     instr.opcode.Value().EffectiveOpCode(), instr.hex);
+    }
+}
+
+bool JitBatchShader::AnalyzeFlowControl() {
+    const unsigned program_size = static_cast<unsigned>(program_code->size());
+
+    // Find the reachable instructions with a depth-first search over the successors
+    reachable.assign(program_size, false);
+    return_offsets.clear();
+
+    std::vector<unsigned> pending = {entry_point};
+    auto visit = [&](unsigned offset) {
+        if (offset < program_size && !reachable[offset]) {
+            reachable[offset] = true;
+            pending.push_back(offset);
+        }
+    };
+    reachable[entry_point] = true;
+
+    std::vector<unsigned> jump_targets = {entry_point};
+    std::vector<unsigned> conditional_jumps;
+    std::vector<std::pair<unsigned, unsigned>> conditional_blocks;
+
+    while (!pending.empty()) {
+        const unsigned offset = pending.back();
+        pending.pop_back();
+
+        Instruction instr = {(*program_code)[offset]};
+        const unsigned dest = instr.flow_control.dest_offset;
+        const unsigned num = instr.flow_control.num_instructions;
+
+        switch (instr.opcode.Value()) {
+        case OpCode::Id::END:
+            break;
+
+        case OpCode::Id::JMPC:
+        case OpCode::Id::JMPU:
+            jump_targets.push_back(dest);
+            conditional_jumps.push_back(offset);
+            visit(dest);
+            visit(offset + 1);
+            break;
+
+        case OpCode::Id::CALL:
+        case OpCode::Id::CALLC:
+        case OpCode::Id::CALLU:
+            jump_targets.push_back(dest);
+            return_offsets.push_back(dest + num);
+            visit(dest);
+            visit(offset + 1);
+            break;
+
+        case OpCode::Id::IFC:
+            if (dest <= offset)
+                return false;
+            conditional_blocks.emplace_back(offset, dest + num);
+        // fallthrough
+        case OpCode::Id::IFU:
+            visit(offset + 1);
+            visit(dest);
+            visit(dest + num);
+            break;
+
+        case OpCode::Id::LOOP:
+            visit(offset + 1);
+            visit(dest + 1);
+            break;
+
+        default:
+            visit(offset + 1);
+            break;
+        }
+    }
+
+    // Sort for efficient binary search later
+    std::sort(return_offsets.begin(), return_offsets.end());
+    return_offsets.erase(std::unique(return_offsets.begin(), return_offsets.end()),
+                         return_offsets.end());
+
+    // Execution masks are only maintained for code entered at the start of a conditional block
+    // and left at its end
+    std::vector<bool> masked(program_size, false);
+    for (const auto& block : conditional_blocks) {
+        for (unsigned offset = block.first + 1; offset < std::min(block.second, program_size);
+             ++offset) {
+            masked[offset] = true;
+        }
+    }
+
+    auto is_masked = [&](unsigned offset) { return offset < program_size && masked[offset]; };
+    return std::none_of(jump_targets.begin(), jump_targets.end(), is_masked) &&
+           std::none_of(conditional_jumps.begin(), conditional_jumps.end(), is_masked) &&
+           std::none_of(return_offsets.begin(), return_offsets.end(), is_masked);
+}
+
+bool JitBatchShader::IsSupported() {
+    // Used for ptest, blendps and roundps
+    return Common::GetCPUCaps().sse4_1;
+}
+
+bool JitBatchShader::Compile(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>* program_code_,
+                             const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>* swizzle_data_,
+                             unsigned entry_point_, u32 output_mask) {
+    program_code = program_code_;
+    swizzle_data = swizzle_data_;
+    entry_point = entry_point_;
+
+    // Reset flow control state
+    program = (CompiledShader*)getCurr();
+    program_counter = 0;
+    looping = false;
+    mask_depth = 0;
+    overflowed = false;
+    instruction_labels.fill(Xbyak::Label());
+
+    bool success = AnalyzeFlowControl();
+    if (success) {
+        dead_instructions = FindDeadInstructions(*program_code, *swizzle_data, output_mask);
+
+        // The stack pointer is 8 modulo 16 at the entry of a procedure
+        // We reserve 16 bytes and assign a dummy value to the first 8 bytes, to catch any potential
+        // return checks (see Compile_Return) that happen in shader main routine.
+        ABI_PushRegistersAndAdjustStack(*this, ABI_ALL_CALLEE_SAVED, 8, 16);
+        mov(qword[rsp + 8], 0xFFFFFFFFFFFFFFFFULL);
+        mov(STACK_BASE, rsp);
+
+        mov(SETUP, ABI_PARAM1);
+        mov(STATE, ABI_PARAM2);
+
+        // Zero address/loop registers and conditional codes, enable all lanes
+        xorps(SCRATCH, SCRATCH);
+        movaps(xword[STATE + offsetof(BatchUnitState, address_registers)], SCRATCH);
+        movaps(xword[STATE + offsetof(BatchUnitState, address_registers) + 16], SCRATCH);
+        xor_(LOOPCOUNT_REG, LOOPCOUNT_REG);
+        xorps(COND0, COND0);
+        xorps(COND1, COND1);
+        pcmpeqd(EXEC, EXEC);
+
+        // Used to set a register to one
+        static const __m128 one = {1.f, 1.f, 1.f, 1.f};
+        mov(rax, reinterpret_cast<size_t>(&one));
+        movaps(ONE, xword[rax]);
+
+        // Used to negate registers
+        static const __m128 neg = {-0.f, -0.f, -0.f, -0.f};
+        mov(rax, reinterpret_cast<size_t>(&neg));
+        movaps(NEGBIT, xword[rax]);
+
+        // Jump to start of the shader program
+        jmp(ABI_PARAM3);
+
+        // Compile the reachable part of the program
+        Compile_Block(static_cast<unsigned>(program_code->size()));
+
+        // Vertices that took different paths are rerun by the caller, as are programs that run
+        // off the end of the code
+        L(l_diverged);
+        mov(rsp, STACK_BASE);
+        xor_(eax, eax);
+        ABI_PopRegistersAndAdjustStack(*this, ABI_ALL_CALLEE_SAVED, 8, 16);
+        ret();
+
+        success = !overflowed;
+    }
+
+    // Free memory that's no longer needed
+    program_code = nullptr;
+    swizzle_data = nullptr;
+    reachable.clear();
+    reachable.shrink_to_fit();
+    return_offsets.clear();
+    return_offsets.shrink_to_fit();
+
+    if (!success)
+        return false;
+
+    ready();
+
+    ASSERT_MSG(getSize() <= MAX_BATCH_SHADER_SIZE,
+               "Compiled a batch shader that exceeds the allocated size!");
+    LOG_DEBUG(HW_GPU, "Compiled batch shader size=%zu", getSize());
+    return true;
+}
+
+JitBatchShader::JitBatchShader() : Xbyak::CodeGenerator(MAX_BATCH_SHADER_SIZE) {}
+
+} // namespace Shader
+
+} // namespace Pica
@@ -0,0 +1,247 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <vector>
+#include <nihstro/shader_bytecode.h>
+#include <xbyak.h>
+#include "common/bit_set.h"
+#include "common/common_types.h"
+#include "video_core/shader/shader.h"
+
+using nihstro::Instruction;
+using nihstro::OpCode;
+using nihstro::SwizzlePattern;
+
+namespace Pica {
+
+namespace Shader {
+
+/**
+ * State of a batch of shader units, stored as structure of arrays: each component of a register
+ * is a vector holding the value of that component for every vertex of the batch.
+ */
+struct BatchUnitState {
+    /// Number of vertices processed at once, one per SSE lane
+    static constexpr unsigned NUM_LANES = 4;
+
+    using Register = float24[4][NUM_LANES];
+
+    struct Registers {
+        alignas(16) Register input[16];
+        alignas(16) Register temporary[16];
+        alignas(16) Register output[16];
+    } registers;
+
+    /// The address registers a0 and a1 of each vertex
+    alignas(16) s32 address_registers[2][NUM_LANES];
+
+    /// Spill space for calls to external functions
+    alignas(16) float scratch[NUM_LANES];
+
+    static size_t InputOffset(const SourceRegister& reg) {
+        switch (reg.GetRegisterType()) {
+        case RegisterType::Input:
+            return offsetof(BatchUnitState, registers.input) + reg.GetIndex() * sizeof(Register);
+
+        case RegisterType::Temporary:
+            return offsetof(BatchUnitState, registers.temporary) +
+                   reg.GetIndex() * sizeof(Register);
+
+        default:
+            UNREACHABLE();
+            return 0;
+        }
+    }
+
+    static size_t OutputOffset(const DestRegister& reg) {
+        switch (reg.GetRegisterType()) {
+        case RegisterType::Output:
+            return offsetof(BatchUnitState, registers.output) + reg.GetIndex() * sizeof(Register);
+
+        case RegisterType::Temporary:
+            return offsetof(BatchUnitState, registers.temporary) +
+                   reg.GetIndex() * sizeof(Register);
+
+        default:
+            UNREACHABLE();
+            return 0;
+        }
+    }
+
+    /**
+     * Loads the input registers with up to NUM_LANES vertices. Unused lanes are loaded with the
+     * first vertex, so that they follow the same path through the program.
+     */
+    void LoadInput(const ShaderRegs& config, const AttributeBuffer* inputs, unsigned count);
+
+    /// Writes the output registers of the first count lanes
+    void WriteOutput(const ShaderRegs& config, AttributeBuffer* outputs, unsigned count) const;
+};
+
+/// Memory allocated for each compiled batch shader
+constexpr size_t MAX_BATCH_SHADER_SIZE = MAX_PROGRAM_CODE_LENGTH * 256;
+
+/**
+ * Shader JIT compiler that runs a program for NUM_LANES vertices at once, with the registers in
+ * the structure of arrays layout of BatchUnitState.
+ *
+ * Conditional blocks whose condition differs between vertices are executed under an execution
+ * mask: both branches run, and only the lanes the branch applies to are written. Any other flow
+ * control that diverges, as well as calls, jumps and returns that would leave a masked block, make
+ * the program bail out; the caller then runs these vertices one at a time instead.
+ */
+class JitBatchShader : public Xbyak::CodeGenerator {
+public:
+    JitBatchShader();
+
+    /// Returns whether the host CPU can run batch shaders
+    static bool IsSupported();
+
+    /**
+     * Runs the shader for a batch of vertices.
+     * @return False if the vertices took different paths the compiled code cannot mask
+     */
+    bool Run(const ShaderSetup& setup, BatchUnitState& state, unsigned offset) const {
+        ASSERT(offset == entry_point);
+        return program(&setup, &state, instruction_labels[offset].getAddress());
+    }
+
+    /**
+     * Compiles the part of the program reachable from the given entry point.
+     * @param output_mask Output registers read after the program, instructions that can't affect
+     *                    them are left out
+     * @return False if the program's flow control prevents running it in batches
+     */
+    bool Compile(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>* program_code,
+                 const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>* swizzle_data,
+                 unsigned entry_point, u32 output_mask);
+
+    void Compile_ADD(Instruction instr);
+    void Compile_DP3(Instruction instr);
+    void Compile_DP4(Instruction instr);
+    void Compile_DPH(Instruction instr);
+    void Compile_EX2(Instruction instr);
+    void Compile_LG2(Instruction instr);
+    void Compile_MUL(Instruction instr);
+    void Compile_SGE(Instruction instr);
+    void Compile_SLT(Instruction instr);
+    void Compile_FLR(Instruction instr);
+    void Compile_MAX(Instruction instr);
+    void Compile_MIN(Instruction instr);
+    void Compile_RCP(Instruction instr);
+    void Compile_RSQ(Instruction instr);
+    void Compile_MOVA(Instruction instr);
+    void Compile_MOV(Instruction instr);
+    void Compile_NOP(Instruction instr);
+    void Compile_END(Instruction instr);
+    void Compile_CALL(Instruction instr);
+    void Compile_CALLC(Instruction instr);
+    void Compile_CALLU(Instruction instr);
+    void Compile_IF(Instruction instr);
+    void Compile_LOOP(Instruction instr);
+    void Compile_JMP(Instruction instr);
+    void Compile_CMP(Instruction instr);
+    void Compile_MAD(Instruction instr);
+
+private:
+    void Compile_Block(unsigned end);
+    void Compile_NextInstr();
+
+    /**
+     * Loads one component of a swizzled source operand of all vertices into the given register.
+     * @param src_num Number of the source operand (1 = src1, 2 = src2, 3 = src3)
+     * @param component Component of the operand, after swizzling
+     */
+    void Compile_LoadSrc(Instruction instr, unsigned src_num, SourceRegister src_reg,
+                         unsigned component, Xbyak::Xmm dest);
+
+    /// Loads all components of a source operand that are needed for the enabled dest components
+    void Compile_LoadSrcComponents(Instruction instr, unsigned src_num, SourceRegister src_reg,
+                                   const Xbyak::Xmm* dest);
+
+    /// Writes the components of the instruction's destination enabled by its dest mask
+    void Compile_DestEnable(Instruction instr, const Xbyak::Xmm* components);
+
+    /// Writes a value to the lanes of the execution mask, if code can run under a partial mask
+    void Compile_MaskedStore(const Xbyak::Address& dest, Xbyak::Xmm value, Xbyak::Xmm scratch);
+
+    /// Component-wise operation of two source operands, see Compile_ComponentWise
+    using BinaryOperation = void (JitBatchShader::*)(Xbyak::Xmm src1, Xbyak::Xmm src2,
+                                                     Xbyak::Xmm scratch);
+
+    /// Compiles an instruction that combines the matching components of src1 and src2
+    void Compile_ComponentWise(Instruction instr, SourceRegister src1, SourceRegister src2,
+                               BinaryOperation operation);
+
+    /// Computes the dot product of the first three or four components of the source operands
+    void Compile_DotProduct(Instruction instr, SourceRegister src1, SourceRegister src2,
+                            unsigned num_components, bool homogeneous);
+
+    /// Applies a scalar function of the C library to the first component of src1
+    void Compile_ExternalFunction(Instruction instr, float (*function)(float));
+
+    void Compile_SanitizedMul(Xbyak::Xmm src1, Xbyak::Xmm src2, Xbyak::Xmm scratch);
+    void Compile_Add(Xbyak::Xmm src1, Xbyak::Xmm src2, Xbyak::Xmm scratch);
+    void Compile_Max(Xbyak::Xmm src1, Xbyak::Xmm src2, Xbyak::Xmm scratch);
+    void Compile_Min(Xbyak::Xmm src1, Xbyak::Xmm src2, Xbyak::Xmm scratch);
+    void Compile_SetGreaterEqual(Xbyak::Xmm src1, Xbyak::Xmm src2, Xbyak::Xmm scratch);
+    void Compile_SetLessThan(Xbyak::Xmm src1, Xbyak::Xmm src2, Xbyak::Xmm scratch);
+
+    /// Computes the per-vertex mask of a conditional code condition into the given register
+    void Compile_EvaluateCondition(Instruction instr, Xbyak::Xmm dest);
+    void Compile_UniformCondition(Instruction instr);
+
+    /// Bails out unless all vertices are enabled in the execution mask
+    void Compile_RequireFullMask();
+
+    /// Emits the code to conditionally return from a subroutine invoked by `CALL`
+    void Compile_Return();
+
+    void Compile_Assert(bool condition, const char* msg);
+
+    BitSet32 PersistentCallerSavedRegs();
+
+    /**
+     * Finds the instructions reachable from the entry point and the return offsets of all calls.
+     * @return False if flow control enters or leaves a conditional block other than through its
+     *         start and end
+     */
+    bool AnalyzeFlowControl();
+
+    const std::array<u32, MAX_PROGRAM_CODE_LENGTH>* program_code = nullptr;
+    const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>* swizzle_data = nullptr;
+
+    /// Mapping of Pica VS instructions to pointers in the emitted code
+    std::array<Xbyak::Label, MAX_PROGRAM_CODE_LENGTH> instruction_labels;
+
+    /// Instructions that can be reached from the entry point
+    std::vector<bool> reachable;
+
+    /// Instructions whose results are never read, which are not compiled
+    std::bitset<MAX_PROGRAM_CODE_LENGTH> dead_instructions;
+
+    /// Offsets in code where a return needs to be inserted
+    std::vector<unsigned> return_offsets;
+
+    /// Code that returns false, see Run
+    Xbyak::Label l_diverged;
+
+    unsigned entry_point = 0;
+    unsigned program_counter = 0; ///< Offset of the next instruction to decode
+    bool looping = false;         ///< True if compiling a loop, used to check for nested loops
+    unsigned mask_depth = 0;      ///< Number of enclosing IFC blocks of the compiled code
+    bool overflowed = false;      ///< True if the program did not fit in the code buffer
+
+    using CompiledShader = bool(const void* setup, void* state, const u8* start_addr);
+    CompiledShader* program = nullptr;
+};
+
+} // namespace Shader
+
+} // namespace Pica
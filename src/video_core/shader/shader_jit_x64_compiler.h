@@ -5,6 +5,7 @@
 #pragma once
 
 #include <array>
+#include <bitset>
 #include <cstddef>
 #include <utility>
 #include <vector>
@@ -37,8 +38,13 @@ public:
         program(&setup, &state, instruction_labels[offset].getAddress());
     }
 
+    /**
+     * Compiles the entire program.
+     * @param output_mask Output registers read after the program, instructions that can't affect
+     *                    them are left out
+     */
     void Compile(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>* program_code,
-                 const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>* swizzle_data);
+                 const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>* swizzle_data, u32 output_mask);
 
     void Compile_ADD(Instruction instr);
     void Compile_DP3(Instruction instr);
@@ -113,6 +119,9 @@ private:
     /// Offsets in code where a return needs to be inserted
     std::vector<unsigned> return_offsets;
 
+    /// Instructions whose results are never read, which are not compiled
+    std::bitset<MAX_PROGRAM_CODE_LENGTH> dead_instructions;
+
     unsigned program_counter = 0; ///< Offset of the next instruction to decode
     bool looping = false;         ///< True if compiling a loop, used to check for nested loops
 
@@ -0,0 +1,357 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <vector>
+#include <nihstro/shader_bytecode.h>
+#include "common/common_types.h"
+#include "video_core/shader/shader.h"
+#include "video_core/shader/shader_liveness.h"
+
+using nihstro::Instruction;
+using nihstro::OpCode;
+using nihstro::SwizzlePattern;
+
+namespace Pica {
+
+namespace Shader {
+
+/// Set of components of temporary registers, bit 4 * register + component
+using TemporarySet = u64;
+
+/// Returns the given components (bit i for component i) of all temporary registers
+static TemporarySet ComponentsOfAllTemporaries(unsigned components) {
+    return components * 0x1111111111111111ULL;
+}
+
+/// How an instruction reads and writes registers
+struct RegisterUse {
+    /// Whether the instruction has effects other than writing its destination (MOVA, CMP)
+    bool side_effects = false;
+    /// Whether the instruction can be left out if its destination is dead
+    bool removable = false;
+    /// Whether the destination is an output register read after the program
+    bool writes_live_output = false;
+    /// Destination temporary register, or -1
+    int dest_temporary = -1;
+    /// Components enabled by the dest mask
+    unsigned dest_components = 0;
+    /// Temporaries read to compute each destination component
+    std::array<TemporarySet, 4> component_reads{};
+    /// Temporaries read if any destination component is live
+    TemporarySet reads = 0;
+};
+
+/// Flow control edges of an instruction
+struct Successors {
+    /// Addresses control may continue at, up to two. MAX_PROGRAM_CODE_LENGTH stands for the exit.
+    std::array<u32, 2> targets;
+    unsigned count = 0;
+
+    void Add(u32 address) {
+        targets[count++] = address;
+    }
+};
+
+static TemporarySet SourceReads(u32 reg, bool relative, unsigned components) {
+    if (relative)
+        return ComponentsOfAllTemporaries(components);
+    if (reg >= 0x10 && reg < 0x20)
+        return static_cast<TemporarySet>(components) << (4 * (reg - 0x10));
+    return 0;
+}
+
+static RegisterUse AnalyzeInstruction(Instruction instr,
+                                      const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>& swizzle_data,
+                                      u32 output_mask) {
+    RegisterUse use;
+
+    const OpCode opcode = instr.opcode.Value();
+    std::array<u32, 3> src;
+    unsigned num_srcs;
+    unsigned relative_src;
+    unsigned address_register_index;
+    u32 dest;
+    SwizzlePattern swizzle;
+
+    switch (opcode.GetInfo().type) {
+    case OpCode::Type::Arithmetic: {
+        const bool is_inverted = (0 != (opcode.GetInfo().subtype & OpCode::Info::SrcInversed));
+        src = {instr.common.GetSrc1(is_inverted), instr.common.GetSrc2(is_inverted), 0};
+        num_srcs = 2;
+        relative_src = is_inverted ? 1 : 0;
+        address_register_index = instr.common.address_register_index;
+        dest = instr.common.dest.Value();
+        swizzle.hex = swizzle_data[instr.common.operand_desc_id];
+        break;
+    }
+
+    case OpCode::Type::MultiplyAdd: {
+        if (opcode.EffectiveOpCode() != OpCode::Id::MAD &&
+            opcode.EffectiveOpCode() != OpCode::Id::MADI)
+            return use;
+
+        const bool is_inverted = (opcode.EffectiveOpCode() == OpCode::Id::MADI);
+        src = {instr.mad.GetSrc1(is_inverted), instr.mad.GetSrc2(is_inverted),
+               instr.mad.GetSrc3(is_inverted)};
+        num_srcs = 3;
+        relative_src = is_inverted ? 2 : 1;
+        address_register_index = instr.mad.address_register_index;
+        dest = instr.mad.dest.Value();
+        swizzle.hex = swizzle_data[instr.mad.operand_desc_id];
+        break;
+    }
+
+    default:
+        // Flow control only reads the conditional codes and uniforms
+        return use;
+    }
+
+    // Temporaries read by source operand i for the given components of its swizzled value
+    auto reads = [&](unsigned i, unsigned components) {
+        unsigned selected = 0;
+        for (unsigned comp = 0; comp < 4; ++comp) {
+            if (!(components & (1 << comp)))
+                continue;
+
+            SwizzlePattern::Selector selector;
+            if (i == 0) {
+                selector = swizzle.GetSelectorSrc1(comp);
+            } else if (i == 1) {
+                selector = swizzle.GetSelectorSrc2(comp);
+            } else {
+                selector = swizzle.GetSelectorSrc3(comp);
+            }
+            selected |= 1 << static_cast<unsigned>(selector);
+        }
+        return SourceReads(src[i], i == relative_src && address_register_index != 0, selected);
+    };
+
+    switch (opcode.EffectiveOpCode()) {
+    case OpCode::Id::ADD:
+    case OpCode::Id::MUL:
+    case OpCode::Id::MAX:
+    case OpCode::Id::MIN:
+    case OpCode::Id::SGE:
+    case OpCode::Id::SGEI:
+    case OpCode::Id::SLT:
+    case OpCode::Id::SLTI:
+    case OpCode::Id::MAD:
+    case OpCode::Id::MADI:
+        for (unsigned comp = 0; comp < 4; ++comp) {
+            for (unsigned i = 0; i < num_srcs; ++i)
+                use.component_reads[comp] |= reads(i, 1 << comp);
+        }
+        break;
+
+    case OpCode::Id::FLR:
+    case OpCode::Id::MOV:
+        for (unsigned comp = 0; comp < 4; ++comp)
+            use.component_reads[comp] = reads(0, 1 << comp);
+        break;
+
+    case OpCode::Id::DP3:
+        use.reads = reads(0, 0x7) | reads(1, 0x7);
+        break;
+
+    case OpCode::Id::DP4:
+    case OpCode::Id::DPH:
+    case OpCode::Id::DPHI:
+        use.reads = reads(0, 0xF) | reads(1, 0xF);
+        break;
+
+    case OpCode::Id::RCP:
+    case OpCode::Id::RSQ:
+    case OpCode::Id::EX2:
+    case OpCode::Id::LG2:
+        use.reads = reads(0, 0x1);
+        break;
+
+    case OpCode::Id::MOVA:
+        use.side_effects = true;
+        use.reads = reads(0, 0x3);
+        return use;
+
+    case OpCode::Id::CMP:
+        use.side_effects = true;
+        use.reads = reads(0, 0x3) | reads(1, 0x3);
+        return use;
+
+    default:
+        // Unknown instructions are kept, the compilers report them
+        return use;
+    }
+
+    use.removable = true;
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        if (swizzle.DestComponentEnabled(comp))
+            use.dest_components |= 1 << comp;
+    }
+    if (dest < 0x10) {
+        use.writes_live_output = (output_mask >> dest) & 1;
+    } else if (dest < 0x20) {
+        use.dest_temporary = dest - 0x10;
+    }
+    return use;
+}
+
+static Successors FindSuccessors(Instruction instr, u32 offset) {
+    Successors successors;
+    const u32 dest_offset = instr.flow_control.dest_offset;
+
+    switch (instr.opcode.Value()) {
+    case OpCode::Id::END:
+        successors.Add(MAX_PROGRAM_CODE_LENGTH);
+        break;
+
+    case OpCode::Id::CALL:
+        successors.Add(dest_offset);
+        break;
+
+    case OpCode::Id::JMPC:
+    case OpCode::Id::JMPU:
+    case OpCode::Id::CALLC:
+    case OpCode::Id::CALLU:
+    case OpCode::Id::IFU:
+    case OpCode::Id::IFC:
+        successors.Add(offset + 1);
+        successors.Add(dest_offset);
+        break;
+
+    default:
+        successors.Add(offset + 1);
+        break;
+    }
+    return successors;
+}
+
+std::bitset<MAX_PROGRAM_CODE_LENGTH> FindDeadInstructions(
+    const std::array<u32, MAX_PROGRAM_CODE_LENGTH>& program_code,
+    const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>& swizzle_data, u32 output_mask) {
+    // Address MAX_PROGRAM_CODE_LENGTH stands for leaving the end of the program
+    constexpr u32 EXIT = MAX_PROGRAM_CODE_LENGTH;
+
+    std::vector<RegisterUse> uses(MAX_PROGRAM_CODE_LENGTH);
+    std::vector<Successors> successors(MAX_PROGRAM_CODE_LENGTH);
+
+    // Calls, conditional blocks and loops end when control arrives at their final address. It
+    // then continues at the return address or the start of the loop instead, so arriving at an
+    // address may lead to any of these.
+    std::vector<std::vector<u32>> continuations(EXIT + 1);
+    auto add_continuation = [&](u32 final_address, u32 address) {
+        final_address = std::min(final_address, EXIT);
+        address = std::min(address, EXIT);
+        if (final_address != address)
+            continuations[final_address].push_back(address);
+    };
+
+    for (u32 offset = 0; offset < MAX_PROGRAM_CODE_LENGTH; ++offset) {
+        const Instruction instr = {program_code[offset]};
+        uses[offset] = AnalyzeInstruction(instr, swizzle_data, output_mask);
+        successors[offset] = FindSuccessors(instr, offset);
+
+        const u32 dest_offset = instr.flow_control.dest_offset;
+        const u32 num_instructions = instr.flow_control.num_instructions;
+        switch (instr.opcode.Value()) {
+        case OpCode::Id::CALL:
+        case OpCode::Id::CALLC:
+        case OpCode::Id::CALLU:
+            add_continuation(dest_offset + num_instructions, offset + 1);
+            break;
+        case OpCode::Id::IFU:
+        case OpCode::Id::IFC:
+            add_continuation(dest_offset, dest_offset + num_instructions);
+            break;
+        case OpCode::Id::LOOP:
+            add_continuation(dest_offset + 1, offset + 1);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Components live on arriving at each address
+    std::vector<TemporarySet> live_on_arrival(EXIT + 1, 0);
+
+    // Live components of an instruction's destination, given what is live after it
+    auto live_dest_components = [](const RegisterUse& use, TemporarySet live_out) {
+        if (use.writes_live_output)
+            return use.dest_components;
+        if (use.dest_temporary < 0)
+            return 0u;
+        return use.dest_components &
+               static_cast<unsigned>(live_out >> (4 * use.dest_temporary)) & 0xF;
+    };
+
+    // Solve the backwards dataflow problem by iterating until nothing changes. Arriving at the
+    // exit keeps every component the program reads alive, as it may read them before writing
+    // them in the next invocation.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        TemporarySet read_anywhere = 0;
+
+        for (u32 offset = EXIT + 1; offset-- > 0;) {
+            TemporarySet live = live_on_arrival[EXIT];
+            if (offset < EXIT) {
+                const RegisterUse& use = uses[offset];
+                const Successors& next = successors[offset];
+
+                TemporarySet live_out = 0;
+                for (unsigned i = 0; i < next.count; ++i)
+                    live_out |= live_on_arrival[std::min(next.targets[i], EXIT)];
+
+                const unsigned live_components = live_dest_components(use, live_out);
+                TemporarySet gen = 0;
+                if (use.side_effects || live_components != 0)
+                    gen |= use.reads;
+                for (unsigned comp = 0; comp < 4; ++comp) {
+                    if (live_components & (1 << comp))
+                        gen |= use.component_reads[comp];
+                }
+
+                TemporarySet kill = 0;
+                if (use.dest_temporary >= 0)
+                    kill = static_cast<TemporarySet>(use.dest_components)
+                           << (4 * use.dest_temporary);
+
+                live = gen | (live_out & ~kill);
+                read_anywhere |= gen;
+            }
+
+            for (u32 address : continuations[offset])
+                live |= live_on_arrival[address];
+
+            if (live != live_on_arrival[offset]) {
+                live_on_arrival[offset] = live;
+                changed = true;
+            }
+        }
+
+        if ((read_anywhere | live_on_arrival[EXIT]) != live_on_arrival[EXIT]) {
+            live_on_arrival[EXIT] |= read_anywhere;
+            changed = true;
+        }
+    }
+
+    std::bitset<MAX_PROGRAM_CODE_LENGTH> dead;
+    for (u32 offset = 0; offset < MAX_PROGRAM_CODE_LENGTH; ++offset) {
+        const RegisterUse& use = uses[offset];
+        if (!use.removable)
+            continue;
+
+        TemporarySet live_out = 0;
+        for (unsigned i = 0; i < successors[offset].count; ++i)
+            live_out |= live_on_arrival[std::min(successors[offset].targets[i], EXIT)];
+        if (live_dest_components(use, live_out) == 0)
+            dead.set(offset);
+    }
+    return dead;
+}
+
+} // namespace Shader
+
+} // namespace Pica
@@ -0,0 +1,32 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <bitset>
+#include "common/common_types.h"
+#include "video_core/shader/shader.h"
+
+namespace Pica {
+
+namespace Shader {
+
+/**
+ * Finds the instructions whose results can't reach an output register that is read after the
+ * program, so that compiled code can leave them out. An instruction is dead if it only writes
+ * components of temporary registers that are overwritten before being read, or an output register
+ * outside of output_mask. Temporary registers that the program may read before writing them are
+ * kept alive at its end, as they carry over to the next invocation.
+ *
+ * @param output_mask Output registers read after the program, as in ShaderRegs::output_mask
+ * @return Set of the offsets of dead instructions
+ */
+std::bitset<MAX_PROGRAM_CODE_LENGTH> FindDeadInstructions(
+    const std::array<u32, MAX_PROGRAM_CODE_LENGTH>& program_code,
+    const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>& swizzle_data, u32 output_mask);
+
+} // namespace Shader
+
+} // namespace Pica
@@ -0,0 +1,115 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cmath>
+#include "common/microprofile.h"
+#include "video_core/pica_state.h"
+#include "video_core/regs_framebuffer.h"
+#include "video_core/regs_rasterizer.h"
+#include "video_core/swrasterizer/binner.h"
+
+namespace Pica {
+namespace Rasterizer {
+
+TileBinner::TileBinner(Common::ThreadPool& pool) : pool(pool) {}
+
+void TileBinner::BeginBatch() {
+    const auto& framebuffer = g_state.regs.framebuffer.framebuffer;
+
+    // Triangles that reach beyond the render target end up in the outermost tiles, which extend
+    // to the end of the rasterizer's coordinate range.
+    const unsigned width = std::max<unsigned>(framebuffer.width, 1);
+    const unsigned height = framebuffer.height + 1;
+    tiles_x = std::min((width + TILE_SIZE - 1) / TILE_SIZE, MAX_COORDINATE / TILE_SIZE);
+    tiles_y = std::min((height + TILE_SIZE - 1) / TILE_SIZE, MAX_COORDINATE / TILE_SIZE);
+
+    if (bins.size() < tiles_x * tiles_y)
+        bins.resize(tiles_x * tiles_y);
+}
+
+void TileBinner::AddTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2,
+                             const PipelineState& state) {
+    if (vertices.empty()) {
+        BeginBatch();
+        pipeline_state = state;
+    }
+
+    // Compute the pixel bounding box the same way the rasterizer converts to fixed-point
+    auto ToFix = [](float24 flt) {
+        return static_cast<u16>(static_cast<unsigned short>(std::round(flt.ToFloat32() * 16.0f)));
+    };
+    const u16 x[3] = {ToFix(v0.screenpos.x), ToFix(v1.screenpos.x), ToFix(v2.screenpos.x)};
+    const u16 y[3] = {ToFix(v0.screenpos.y), ToFix(v1.screenpos.y), ToFix(v2.screenpos.y)};
+
+    unsigned min_x = std::min({x[0], x[1], x[2]}) >> 4;
+    unsigned min_y = std::min({y[0], y[1], y[2]}) >> 4;
+    unsigned max_x = (std::max({x[0], x[1], x[2]}) + 0xF) >> 4;
+    unsigned max_y = (std::max({y[0], y[1], y[2]}) + 0xF) >> 4;
+
+    const auto& scissor = g_state.regs.rasterizer.scissor_test;
+    if (scissor.mode == RasterizerRegs::ScissorMode::Include) {
+        min_x = std::max<unsigned>(min_x, scissor.x1);
+        min_y = std::max<unsigned>(min_y, scissor.y1);
+        max_x = std::min<unsigned>(max_x, scissor.x2 + 1);
+        max_y = std::min<unsigned>(max_y, scissor.y2 + 1);
+    }
+
+    if (min_x >= max_x || min_y >= max_y)
+        return;
+
+    const unsigned tile_x0 = std::min(min_x / TILE_SIZE, tiles_x - 1);
+    const unsigned tile_y0 = std::min(min_y / TILE_SIZE, tiles_y - 1);
+    const unsigned tile_x1 = std::min((max_x - 1) / TILE_SIZE, tiles_x - 1);
+    const unsigned tile_y1 = std::min((max_y - 1) / TILE_SIZE, tiles_y - 1);
+
+    const u32 triangle_index = static_cast<u32>(vertices.size() / 3);
+    vertices.push_back(v0);
+    vertices.push_back(v1);
+    vertices.push_back(v2);
+
+    for (unsigned tile_y = tile_y0; tile_y <= tile_y1; ++tile_y) {
+        for (unsigned tile_x = tile_x0; tile_x <= tile_x1; ++tile_x) {
+            const u32 bin_index = tile_y * tiles_x + tile_x;
+            auto& bin = bins[bin_index];
+            if (bin.empty())
+                active_bins.push_back(bin_index);
+            bin.push_back(triangle_index);
+        }
+    }
+}
+
+MICROPROFILE_DEFINE(GPU_BinnedRasterization, "GPU", "Binned Rasterization", MP_RGB(50, 50, 240));
+
+void TileBinner::Flush() {
+    if (vertices.empty())
+        return;
+
+    MICROPROFILE_SCOPE(GPU_BinnedRasterization);
+
+    pool.ParallelFor(active_bins.size(), [this](size_t job) {
+        const u32 bin_index = active_bins[job];
+        const unsigned tile_x = bin_index % tiles_x;
+        const unsigned tile_y = bin_index / tiles_x;
+
+        // The last row and column of tiles also cover everything beyond the render target
+        const MathUtil::Rectangle<u16> region{
+            static_cast<u16>(tile_x * TILE_SIZE), static_cast<u16>(tile_y * TILE_SIZE),
+            static_cast<u16>(tile_x + 1 == tiles_x ? MAX_COORDINATE : (tile_x + 1) * TILE_SIZE),
+            static_cast<u16>(tile_y + 1 == tiles_y ? MAX_COORDINATE : (tile_y + 1) * TILE_SIZE)};
+
+        for (u32 triangle_index : bins[bin_index]) {
+            const Vertex* triangle = &vertices[triangle_index * 3];
+            ProcessTriangle(triangle[0], triangle[1], triangle[2], region, pipeline_state);
+        }
+    });
+
+    for (u32 bin_index : active_bins)
+        bins[bin_index].clear();
+    active_bins.clear();
+    vertices.clear();
+}
+
+} // namespace Rasterizer
+} // namespace Pica
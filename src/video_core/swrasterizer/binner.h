@@ -0,0 +1,68 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "common/common_types.h"
+#include "common/thread_pool.h"
+#include "video_core/swrasterizer/pipeline_state.h"
+#include "video_core/swrasterizer/rasterizer.h"
+
+namespace Pica {
+namespace Rasterizer {
+
+/**
+ * Sorts triangles into screen-space tiles so that they can be rasterized by several threads at
+ * once. Each tile is processed by a single thread, which draws the triangles overlapping it in
+ * submission order, hence per-pixel primitive ordering is the same as with serial rasterization.
+ *
+ * Since rasterization reads the global PICA state, all queued triangles must be flushed before
+ * any register affecting rendering is modified.
+ */
+class TileBinner {
+public:
+    /// Edge length of a tile, in pixels
+    static constexpr unsigned TILE_SIZE = 32;
+
+    /// @param pool Threads used for rasterization, must outlive the binner
+    explicit TileBinner(Common::ThreadPool& pool);
+
+    /**
+     * Queues a screen-space triangle into all tiles its bounding box overlaps. All triangles of a
+     * batch must be submitted with the same pipeline state.
+     */
+    void AddTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2,
+                     const PipelineState& state);
+
+    /// Rasterizes all queued triangles and returns once they have been written to memory
+    void Flush();
+
+    bool HasPendingTriangles() const {
+        return !vertices.empty();
+    }
+
+private:
+    /// Sets up the tile grid for the current render target
+    void BeginBatch();
+
+    Common::ThreadPool& pool;
+
+    /// Pipeline state the queued triangles are rasterized with
+    PipelineState pipeline_state;
+
+    /// Queued triangles, three consecutive entries per triangle
+    std::vector<Vertex> vertices;
+    /// For each tile, the indices of the triangles overlapping it in submission order
+    std::vector<std::vector<u32>> bins;
+    /// Indices of all tiles that have at least one triangle queued
+    std::vector<u32> active_bins;
+
+    unsigned tiles_x = 0;
+    unsigned tiles_y = 0;
+};
+
+} // namespace Rasterizer
+} // namespace Pica
@@ -52,22 +52,24 @@ private:
     Math::Vec4<float24> bias;
 };
 
-static void InitScreenCoordinates(Vertex& vtx) {
-    struct {
-        float24 halfsize_x;
-        float24 offset_x;
-        float24 halfsize_y;
-        float24 offset_y;
-        float24 zscale;
-        float24 offset_z;
-    } viewport;
-
-    const auto& regs = g_state.regs;
-    viewport.halfsize_x = float24::FromRaw(regs.rasterizer.viewport_size_x);
-    viewport.halfsize_y = float24::FromRaw(regs.rasterizer.viewport_size_y);
-    viewport.offset_x = float24::FromFloat32(static_cast<float>(regs.rasterizer.viewport_corner.x));
-    viewport.offset_y = float24::FromFloat32(static_cast<float>(regs.rasterizer.viewport_corner.y));
+/// Viewport transform from normalized device coordinates to screen coordinates
+struct Viewport {
+    float24 halfsize_x;
+    float24 offset_x;
+    float24 halfsize_y;
+    float24 offset_y;
+
+    static Viewport FromRegisters(const RasterizerRegs& regs) {
+        Viewport viewport;
+        viewport.halfsize_x = float24::FromRaw(regs.viewport_size_x);
+        viewport.halfsize_y = float24::FromRaw(regs.viewport_size_y);
+        viewport.offset_x = float24::FromFloat32(static_cast<float>(regs.viewport_corner.x));
+        viewport.offset_y = float24::FromFloat32(static_cast<float>(regs.viewport_corner.y));
+        return viewport;
+    }
+};
 
+static void InitScreenCoordinates(Vertex& vtx, const Viewport& viewport) {
     float24 inv_w = float24::FromFloat32(1.f) / vtx.pos.w;
     vtx.pos.w = inv_w;
     vtx.quat *= inv_w;
@@ -85,7 +87,35 @@ static void InitScreenCoordinates(Vertex& vtx) {
     vtx.screenpos[2] = vtx.pos.z * inv_w;
 }
 
-void ProcessTriangle(const OutputVertex& v0, const OutputVertex& v1, const OutputVertex& v2) {
+// NOTE: We clip against a w=epsilon plane to guarantee that the output has a positive w value.
+// TODO: Not sure if this is a valid approach. Also should probably instead use the smallest
+//       epsilon possible within float24 accuracy.
+static const float24 EPSILON = float24::FromFloat32(0.00001f);
+static const float24 f0 = float24::FromFloat32(0.0);
+static const float24 f1 = float24::FromFloat32(1.0);
+static const std::array<ClippingEdge, 7> clipping_edges = {{
+    {Math::MakeVec(f1, f0, f0, -f1)},                                           // x = +w
+    {Math::MakeVec(-f1, f0, f0, -f1)},                                          // x = -w
+    {Math::MakeVec(f0, f1, f0, -f1)},                                           // y = +w
+    {Math::MakeVec(f0, -f1, f0, -f1)},                                          // y = -w
+    {Math::MakeVec(f0, f0, f1, f0)},                                            // z =  0
+    {Math::MakeVec(f0, f0, -f1, -f1)},                                          // z = -w
+    {Math::MakeVec(f0, f0, f0, -f1), Math::Vec4<float24>(f0, f0, f0, EPSILON)}, // w = EPSILON
+}};
+
+/// Returns a mask with bit i set if the vertex lies outside of clipping_edges[i]
+static unsigned GetOutcode(const Vertex& vertex) {
+    unsigned outcode = 0;
+    for (size_t i = 0; i < clipping_edges.size(); ++i) {
+        if (clipping_edges[i].IsOutSide(vertex))
+            outcode |= 1 << i;
+    }
+    return outcode;
+}
+
+static void ProcessTriangleInternal(const OutputVertex& v0, const OutputVertex& v1,
+                                    const OutputVertex& v2, const Viewport& viewport,
+                                    const TriangleHandler& triangle_handler) {
     using boost::container::static_vector;
 
     // Clipping a planar n-gon against a plane will remove at least 1 vertex and introduces 2 at
@@ -96,6 +126,12 @@ void ProcessTriangle(const OutputVertex& v0, const OutputVertex& v1, const Outpu
     static_vector<Vertex, MAX_VERTICES> buffer_a = {v0, v1, v2};
     static_vector<Vertex, MAX_VERTICES> buffer_b;
 
+    // Triangles entirely outside of one of the planes are discarded right away
+    const unsigned outcodes[3] = {GetOutcode(buffer_a[0]), GetOutcode(buffer_a[1]),
+                                  GetOutcode(buffer_a[2])};
+    if (outcodes[0] & outcodes[1] & outcodes[2])
+        return;
+
     auto FlipQuaternionIfOpposite = [](auto& a, const auto& b) {
         if (Math::Dot(a, b) < float24::Zero())
             a = -a;
@@ -109,29 +145,19 @@ void ProcessTriangle(const OutputVertex& v0, const OutputVertex& v1, const Outpu
     auto* output_list = &buffer_a;
     auto* input_list = &buffer_b;
 
-    // NOTE: We clip against a w=epsilon plane to guarantee that the output has a positive w value.
-    // TODO: Not sure if this is a valid approach. Also should probably instead use the smallest
-    //       epsilon possible within float24 accuracy.
-    static const float24 EPSILON = float24::FromFloat32(0.00001f);
-    static const float24 f0 = float24::FromFloat32(0.0);
-    static const float24 f1 = float24::FromFloat32(1.0);
-    static const std::array<ClippingEdge, 7> clipping_edges = {{
-        {Math::MakeVec(f1, f0, f0, -f1)},                                           // x = +w
-        {Math::MakeVec(-f1, f0, f0, -f1)},                                          // x = -w
-        {Math::MakeVec(f0, f1, f0, -f1)},                                           // y = +w
-        {Math::MakeVec(f0, -f1, f0, -f1)},                                          // y = -w
-        {Math::MakeVec(f0, f0, f1, f0)},                                            // z =  0
-        {Math::MakeVec(f0, f0, -f1, -f1)},                                          // z = -w
-        {Math::MakeVec(f0, f0, f0, -f1), Math::Vec4<float24>(f0, f0, f0, EPSILON)}, // w = EPSILON
-    }};
-
     // TODO: If one vertex lies outside one of the depth clipping planes, some platforms (e.g. Wii)
     //       drop the whole primitive instead of clipping the primitive properly. We should test if
     //       this happens on the 3DS, too.
 
-    // Simple implementation of the Sutherland-Hodgman clipping algorithm.
-    // TODO: Make this less inefficient (currently lots of useless buffering overhead happens here)
-    for (auto edge : clipping_edges) {
+    // Simple implementation of the Sutherland-Hodgman clipping algorithm. Clipping against a plane
+    // that all vertices are inside of leaves the polygon unchanged, so only the planes crossed by
+    // the triangle are considered. Most triangles cross none and skip clipping entirely.
+    const unsigned crossed_edges = outcodes[0] | outcodes[1] | outcodes[2];
+    for (size_t edge_index = 0; edge_index < clipping_edges.size(); ++edge_index) {
+        if (!(crossed_edges & (1 << edge_index)))
+            continue;
+
+        const ClippingEdge& edge = clipping_edges[edge_index];
 
         std::swap(input_list, output_list);
         output_list->clear();
@@ -157,15 +183,15 @@ void ProcessTriangle(const OutputVertex& v0, const OutputVertex& v1, const Outpu
             return;
     }
 
-    InitScreenCoordinates((*output_list)[0]);
-    InitScreenCoordinates((*output_list)[1]);
+    InitScreenCoordinates((*output_list)[0], viewport);
+    InitScreenCoordinates((*output_list)[1], viewport);
 
     for (size_t i = 0; i < output_list->size() - 2; i++) {
         Vertex& vtx0 = (*output_list)[0];
         Vertex& vtx1 = (*output_list)[i + 1];
         Vertex& vtx2 = (*output_list)[i + 2];
 
-        InitScreenCoordinates(vtx2);
+        InitScreenCoordinates(vtx2, viewport);
 
         LOG_TRACE(Render_Software,
                   "Triangle %lu/%lu at position (%.3f, %.3f, %.3f, %.3f), "
@@ -181,10 +207,17 @@ void ProcessTriangle(const OutputVertex& v0, const OutputVertex& v1, const Outpu
                   vtx1.screenpos.z.ToFloat32(), vtx2.screenpos.x.ToFloat32(),
                   vtx2.screenpos.y.ToFloat32(), vtx2.screenpos.z.ToFloat32());
 
-        Rasterizer::ProcessTriangle(vtx0, vtx1, vtx2);
+        triangle_handler(vtx0, vtx1, vtx2);
     }
 }
 
+void ProcessTriangles(const OutputVertex* vertices, size_t num_triangles,
+                      const TriangleHandler& triangle_handler) {
+    const Viewport viewport = Viewport::FromRegisters(g_state.regs.rasterizer);
+    for (size_t i = 0; i < num_triangles; ++i, vertices += 3)
+        ProcessTriangleInternal(vertices[0], vertices[1], vertices[2], viewport, triangle_handler);
+}
+
 } // namespace
 
 } // namespace
@@ -4,17 +4,35 @@
 
 #pragma once
 
+#include <cstddef>
+#include <functional>
+
 namespace Pica {
 
 namespace Shader {
 struct OutputVertex;
 }
 
+namespace Rasterizer {
+struct Vertex;
+}
+
 namespace Clipper {
 
 using Shader::OutputVertex;
 
-void ProcessTriangle(const OutputVertex& v0, const OutputVertex& v1, const OutputVertex& v2);
+using TriangleHandler = std::function<void(
+    const Rasterizer::Vertex& v0, const Rasterizer::Vertex& v1, const Rasterizer::Vertex& v2)>;
+
+/**
+ * Clips a batch of triangles submitted with the same register configuration against the view
+ * volume and calls triangle_handler for each resulting triangle, after converting its vertices to
+ * screen coordinates. State shared by all triangles is only set up once.
+ * @param vertices Vertices of the triangles, three consecutive entries per triangle
+ * @param num_triangles Number of triangles in the batch
+ */
+void ProcessTriangles(const OutputVertex* vertices, size_t num_triangles,
+                      const TriangleHandler& triangle_handler);
 
 } // namespace
 
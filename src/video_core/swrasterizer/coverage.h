@@ -0,0 +1,168 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <algorithm>
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
+#include "common/common_types.h"
+#include "common/vector_math.h"
+
+namespace Pica {
+namespace Rasterizer {
+
+/**
+ * Describes the pixels covered by a counter-clockwise triangle, in the 12.4 fixed point
+ * rasterizer coordinates.
+ */
+struct TriangleCoverage {
+    /// Vertex positions
+    Math::Vec2<int> vtx[3];
+    /// Added to the barycentric coordinates w0, w1 and w2 to implement the filling rules
+    int bias[3];
+    /// Bounding box in whole pixels, with exclusive right and bottom bounds
+    int min_px;
+    int min_py;
+    int max_px;
+    int max_py;
+    /// Remainder modulo 8 of the y coordinates at which rows of framebuffer tiles begin
+    int tile_row_phase;
+};
+
+/// Signed area of the parallelogram spanned by the three points, see SignedArea in rasterizer.cpp
+inline int EdgeFunction(const Math::Vec2<int>& vtx1, const Math::Vec2<int>& vtx2,
+                        const Math::Vec2<int>& point) {
+    return (vtx2.x - vtx1.x) * (point.y - vtx1.y) - (vtx2.y - vtx1.y) * (point.x - vtx1.x);
+}
+
+/**
+ * Calls visit(x, y, w0, w1, w2) for the center of every pixel in the bounding box that is covered
+ * by the triangle, with its 12.4 fixed point coordinates and its barycentric coordinates.
+ *
+ * The bounding box is walked in 8x8 pixel blocks that match the tiles of the framebuffer, so that
+ * the tile cache only converts the pixels of each tile once. Blocks are further split into 2x2
+ * pixel quads: the coverage of all four pixels of a quad is tested at once. The edge functions are
+ * linear, so they are stepped incrementally with exact integer results rather than evaluated from
+ * scratch for every pixel.
+ */
+template <typename Visitor>
+void ForEachCoveredPixel(const TriangleCoverage& triangle, Visitor&& visit) {
+    const auto& vtx = triangle.vtx;
+
+    // Barycentric coordinates w0, w1 and w2 at the center of the topleft bounding box corner,
+    // and how they change when moving one pixel to the right (dx) or down (dy)
+    const Math::Vec2<int> origin = {triangle.min_px * 0x10 + 8, triangle.min_py * 0x10 + 8};
+    const int w0_origin = triangle.bias[0] + EdgeFunction(vtx[1], vtx[2], origin);
+    const int w1_origin = triangle.bias[1] + EdgeFunction(vtx[2], vtx[0], origin);
+    const int w2_origin = triangle.bias[2] + EdgeFunction(vtx[0], vtx[1], origin);
+    const int w0_dx = -(vtx[2].y - vtx[1].y) * 0x10;
+    const int w1_dx = -(vtx[0].y - vtx[2].y) * 0x10;
+    const int w2_dx = -(vtx[1].y - vtx[0].y) * 0x10;
+    const int w0_dy = (vtx[2].x - vtx[1].x) * 0x10;
+    const int w1_dy = (vtx[0].x - vtx[2].x) * 0x10;
+    const int w2_dy = (vtx[1].x - vtx[0].x) * 0x10;
+
+    const int min_px = triangle.min_px;
+    const int min_py = triangle.min_py;
+    const int max_px = triangle.max_px;
+    const int max_py = triangle.max_py;
+
+#ifdef ARCHITECTURE_x86_64
+    // Lane order: (x, y), (x + 1, y), (x, y + 1), (x + 1, y + 1)
+    const __m128i w0_quad_offset = _mm_setr_epi32(0, w0_dx, w0_dy, w0_dx + w0_dy);
+    const __m128i w1_quad_offset = _mm_setr_epi32(0, w1_dx, w1_dy, w1_dx + w1_dy);
+    const __m128i w2_quad_offset = _mm_setr_epi32(0, w2_dx, w2_dy, w2_dx + w2_dy);
+#endif
+
+    const int first_block_x = min_px & ~7;
+    const int first_block_y = min_py - ((min_py - triangle.tile_row_phase) & 7);
+
+    for (int block_y = first_block_y; block_y < max_py; block_y += 8) {
+        for (int block_x = first_block_x; block_x < max_px; block_x += 8) {
+            const int offset_x = block_x - min_px;
+            const int offset_y = block_y - min_py;
+            const int w0_block = w0_origin + offset_x * w0_dx + offset_y * w0_dy;
+            const int w1_block = w1_origin + offset_x * w1_dx + offset_y * w1_dy;
+            const int w2_block = w2_origin + offset_x * w2_dx + offset_y * w2_dy;
+
+            // Skip blocks that lie entirely outside of one of the edges. The largest value of an
+            // edge function within the block is found at one of its corners.
+            auto BlockOutside = [](int w, int dx, int dy) {
+                return w + std::max(0, 7 * dx) + std::max(0, 7 * dy) < 0;
+            };
+            if (BlockOutside(w0_block, w0_dx, w0_dy) || BlockOutside(w1_block, w1_dx, w1_dy) ||
+                BlockOutside(w2_block, w2_dx, w2_dy)) {
+                continue;
+            }
+
+            for (int quad_y = block_y; quad_y < block_y + 8; quad_y += 2) {
+                // Rows of the quad that are inside the bounding box
+                const unsigned row_mask = (quad_y >= min_py && quad_y < max_py ? 0b01 : 0) |
+                                          (quad_y + 1 >= min_py && quad_y + 1 < max_py ? 0b10 : 0);
+                if (row_mask == 0)
+                    continue;
+
+                for (int quad_x = block_x; quad_x < block_x + 8; quad_x += 2) {
+                    const unsigned column_mask =
+                        (quad_x >= min_px && quad_x < max_px ? 0b01 : 0) |
+                        (quad_x + 1 >= min_px && quad_x + 1 < max_px ? 0b10 : 0);
+                    if (column_mask == 0)
+                        continue;
+
+                    const unsigned valid_mask = ((row_mask & 0b01) ? column_mask : 0) |
+                                                ((row_mask & 0b10) ? column_mask << 2 : 0);
+
+                    const int w0 =
+                        w0_block + (quad_x - block_x) * w0_dx + (quad_y - block_y) * w0_dy;
+                    const int w1 =
+                        w1_block + (quad_x - block_x) * w1_dx + (quad_y - block_y) * w1_dy;
+                    const int w2 =
+                        w2_block + (quad_x - block_x) * w2_dx + (quad_y - block_y) * w2_dy;
+
+                    // A pixel is covered if none of its barycentric coordinates is negative, i.e.
+                    // if the sign bit of all three is clear.
+#ifdef ARCHITECTURE_x86_64
+                    const __m128i w0_quad = _mm_add_epi32(_mm_set1_epi32(w0), w0_quad_offset);
+                    const __m128i w1_quad = _mm_add_epi32(_mm_set1_epi32(w1), w1_quad_offset);
+                    const __m128i w2_quad = _mm_add_epi32(_mm_set1_epi32(w2), w2_quad_offset);
+                    const __m128i any_negative =
+                        _mm_or_si128(_mm_or_si128(w0_quad, w1_quad), w2_quad);
+                    const unsigned covered_mask =
+                        ~_mm_movemask_ps(_mm_castsi128_ps(any_negative)) & valid_mask;
+#else
+                    unsigned covered_mask = 0;
+                    for (unsigned lane = 0; lane < 4; ++lane) {
+                        const int lane_offset_x = (lane & 1) ? 1 : 0;
+                        const int lane_offset_y = (lane & 2) ? 1 : 0;
+                        if ((w0 + lane_offset_x * w0_dx + lane_offset_y * w0_dy) >= 0 &&
+                            (w1 + lane_offset_x * w1_dx + lane_offset_y * w1_dy) >= 0 &&
+                            (w2 + lane_offset_x * w2_dx + lane_offset_y * w2_dy) >= 0)
+                            covered_mask |= 1 << lane;
+                    }
+                    covered_mask &= valid_mask;
+#endif
+
+                    // Rasterizer coordinates of the pixel centers, in 12.4 fixed point
+                    const int x = quad_x * 0x10 + 8;
+                    const int y = quad_y * 0x10 + 8;
+
+                    if (covered_mask & 0b0001)
+                        visit(x, y, w0, w1, w2);
+                    if (covered_mask & 0b0010)
+                        visit(x + 0x10, y, w0 + w0_dx, w1 + w1_dx, w2 + w2_dx);
+                    if (covered_mask & 0b0100)
+                        visit(x, y + 0x10, w0 + w0_dy, w1 + w1_dy, w2 + w2_dy);
+                    if (covered_mask & 0b1000)
+                        visit(x + 0x10, y + 0x10, w0 + w0_dx + w0_dy, w1 + w1_dx + w1_dy,
+                              w2 + w2_dx + w2_dy);
+                }
+            }
+        }
+    }
+}
+
+} // namespace Rasterizer
+} // namespace Pica
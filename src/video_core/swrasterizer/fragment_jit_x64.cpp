@@ -0,0 +1,847 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "common/x64/cpu_detect.h"
+#include "common/x64/xbyak_abi.h"
+#include "video_core/regs.h"
+#include "video_core/swrasterizer/fragment_jit_x64.h"
+#include "video_core/swrasterizer/pipeline_state.h"
+
+using namespace Common::X64;
+using namespace Xbyak::util;
+using Xbyak::Reg32;
+using Xbyak::Reg64;
+using Xbyak::Xmm;
+
+namespace Pica {
+namespace Rasterizer {
+
+using TevStageConfig = TexturingRegs::TevStageConfig;
+
+/// Memory allocated for the code of each configuration
+constexpr size_t MAX_FRAGMENT_PROGRAM_SIZE = 8192;
+
+// Registers used by the generated code. Colors are stored as 16-bit components in the order
+// R, G, B, A in the low half of an XMM register.
+
+/// Pointer to the TevInputs of the fragment
+static const Reg64 INPUTS = r10;
+/// Pointer to the output color of the TEV program
+static const Reg64 OUTPUT = r11;
+/// Packed RGBA8 source and destination colors of the blend program
+static const Reg32 SOURCE_COLOR = r10d;
+static const Reg32 DEST_COLOR = r11d;
+
+/// The three (modified) arguments of a TEV stage, in lanes RGB for the color combiner and in lane
+/// A for the alpha combiner
+static const Xmm TEV_ARGS[3] = {xmm0, xmm1, xmm2};
+/// Result of the alpha combiner, when it performs a different operation than the color combiner
+static const Xmm ALPHA_RESULT = xmm3;
+static const Xmm SCRATCH1 = xmm4;
+static const Xmm SCRATCH2 = xmm5;
+static const Xmm COMBINER_OUTPUT = xmm6;
+static const Xmm COMBINER_BUFFER = xmm7;
+static const Xmm NEXT_COMBINER_BUFFER = xmm8;
+static const Xmm ZERO = xmm9;
+/// 255 in every component
+static const Xmm BYTE_MAX = xmm10;
+/// Multiplier used to divide by 255, see CompileDivideBy255
+static const Xmm DIVIDE_BY_255 = xmm11;
+
+// Registers used by the blend program, which also uses SCRATCH1 and SCRATCH2
+static const Xmm SOURCE = xmm0;
+static const Xmm DEST = xmm1;
+static const Xmm SOURCE_FACTOR = xmm2;
+static const Xmm DEST_FACTOR = xmm3;
+static const Xmm BLEND_RESULT = xmm6;
+static const Xmm BLEND_ALPHA_RESULT = xmm7;
+
+/// Registers that have to be preserved across calls to the generated code
+static const BitSet32 PERSISTENT_REGS =
+    ABI_ALL_CALLEE_SAVED & BuildRegSet({xmm0, xmm1, xmm2, xmm3, xmm4, xmm5, xmm6, xmm7, xmm8, xmm9,
+                                        xmm10, xmm11});
+
+/// Replicates a 16-bit value to the four components of a 64-bit constant
+static constexpr u64 Replicate16(u64 value) {
+    return value * 0x0001000100010001ULL;
+}
+
+/// Expands a packed RGBA8 color to 16-bit components
+static u64 ExpandColor(u32 color) {
+    return (color & 0xFF) | (u64((color >> 8) & 0xFF) << 16) | (u64((color >> 16) & 0xFF) << 32) |
+           (u64(color >> 24) << 48);
+}
+
+/// Builds a pshuflw immediate which selects the given components
+static constexpr u8 Shuffle(unsigned r, unsigned g, unsigned b, unsigned a) {
+    return static_cast<u8>(r | (g << 2) | (b << 4) | (a << 6));
+}
+
+/// Number of arguments read by a combiner operation
+static unsigned NumOperands(TevStageConfig::Operation op) {
+    using Operation = TevStageConfig::Operation;
+    switch (op) {
+    case Operation::Replace:
+        return 1;
+    case Operation::Lerp:
+    case Operation::MultiplyThenAdd:
+    case Operation::AddThenMultiply:
+        return 3;
+    default:
+        return 2;
+    }
+}
+
+static bool IsValidSource(TevStageConfig::Source source) {
+    using Source = TevStageConfig::Source;
+    switch (source) {
+    case Source::PrimaryColor:
+    case Source::PrimaryFragmentColor:
+    case Source::SecondaryFragmentColor:
+    case Source::Texture0:
+    case Source::Texture1:
+    case Source::Texture2:
+    case Source::Texture3:
+    case Source::PreviousBuffer:
+    case Source::Constant:
+    case Source::Previous:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool IsValidColorModifier(TevStageConfig::ColorModifier modifier) {
+    using ColorModifier = TevStageConfig::ColorModifier;
+    switch (modifier) {
+    case ColorModifier::SourceColor:
+    case ColorModifier::OneMinusSourceColor:
+    case ColorModifier::SourceAlpha:
+    case ColorModifier::OneMinusSourceAlpha:
+    case ColorModifier::SourceRed:
+    case ColorModifier::OneMinusSourceRed:
+    case ColorModifier::SourceGreen:
+    case ColorModifier::OneMinusSourceGreen:
+    case ColorModifier::SourceBlue:
+    case ColorModifier::OneMinusSourceBlue:
+        return true;
+    default:
+        return false;
+    }
+}
+
+FragmentJitConfig FragmentJitConfig::FromRegisters(const Regs& regs, const PipelineState& state) {
+    FragmentJitConfig config;
+    std::memset(&config, 0, sizeof(config));
+
+    const auto tev_stages = regs.texturing.GetTevStages();
+    config.num_tev_stages = state.num_tev_stages;
+    for (unsigned i = 0; i < state.num_tev_stages; ++i) {
+        config.tev_stages[i].sources_raw = tev_stages[i].sources_raw;
+        config.tev_stages[i].modifiers_raw = tev_stages[i].modifiers_raw;
+        config.tev_stages[i].ops_raw = tev_stages[i].ops_raw;
+        config.tev_stages[i].const_color = tev_stages[i].const_color;
+        config.tev_stages[i].scales_raw = tev_stages[i].scales_raw;
+    }
+    config.combiner_buffer_color = regs.texturing.tev_combiner_buffer_color.raw;
+    config.combiner_buffer_update_rgb =
+        regs.texturing.tev_combiner_buffer_input.update_mask_rgb.Value();
+    config.combiner_buffer_update_a =
+        regs.texturing.tev_combiner_buffer_input.update_mask_a.Value();
+
+    const auto& output_merger = regs.framebuffer.output_merger;
+    if (state.features & PipelineState::AlphaTest) {
+        config.alpha_test_enable = 1;
+        config.alpha_test_func = output_merger.alpha_test.func;
+        config.alpha_test_ref = output_merger.alpha_test.ref;
+    }
+
+    if (output_merger.alphablend_enable) {
+        config.alphablend_enable = 1;
+        config.blend_equation_rgb = output_merger.alpha_blending.blend_equation_rgb;
+        config.blend_equation_a = output_merger.alpha_blending.blend_equation_a;
+        config.factor_source_rgb = output_merger.alpha_blending.factor_source_rgb;
+        config.factor_dest_rgb = output_merger.alpha_blending.factor_dest_rgb;
+        config.factor_source_a = output_merger.alpha_blending.factor_source_a;
+        config.factor_dest_a = output_merger.alpha_blending.factor_dest_a;
+        config.blend_const = output_merger.blend_const.raw;
+    } else {
+        config.logic_op = output_merger.logic_op;
+    }
+
+    config.color_write_mask = (output_merger.red_enable ? 0x000000FF : 0) |
+                              (output_merger.green_enable ? 0x0000FF00 : 0) |
+                              (output_merger.blue_enable ? 0x00FF0000 : 0) |
+                              (output_merger.alpha_enable ? 0xFF000000 : 0);
+
+    return config;
+}
+
+bool FragmentJit::IsSupported(const FragmentJitConfig& config) {
+    if (!Common::GetCPUCaps().sse4_1)
+        return false;
+
+    // Invalid settings are left to the interpreter, which reports them
+    for (unsigned i = 0; i < config.num_tev_stages; ++i) {
+        const auto stage = static_cast<TevStageConfig>(config.tev_stages[i]);
+        using Operation = TevStageConfig::Operation;
+        if (stage.color_op > Operation::AddThenMultiply)
+            return false;
+
+        // The alpha combiner has no dot product, it is unused if the color combiner uses Dot3_RGBA
+        if (stage.color_op != Operation::Dot3_RGBA &&
+            (stage.alpha_op > Operation::AddThenMultiply || stage.alpha_op == Operation::Dot3_RGB ||
+             stage.alpha_op == Operation::Dot3_RGBA))
+            return false;
+
+        if (!IsValidSource(stage.color_source1) || !IsValidSource(stage.color_source2) ||
+            !IsValidSource(stage.color_source3) || !IsValidSource(stage.alpha_source1) ||
+            !IsValidSource(stage.alpha_source2) || !IsValidSource(stage.alpha_source3))
+            return false;
+
+        if (!IsValidColorModifier(stage.color_modifier1) ||
+            !IsValidColorModifier(stage.color_modifier2) ||
+            !IsValidColorModifier(stage.color_modifier3))
+            return false;
+    }
+
+    if (config.alphablend_enable) {
+        const auto max_equation = FramebufferRegs::BlendEquation::Max;
+        const auto max_factor = FramebufferRegs::BlendFactor::SourceAlphaSaturate;
+        if (config.blend_equation_rgb > max_equation || config.blend_equation_a > max_equation ||
+            config.factor_source_rgb > max_factor || config.factor_dest_rgb > max_factor ||
+            config.factor_source_a > max_factor || config.factor_dest_a > max_factor)
+            return false;
+    }
+
+    return true;
+}
+
+FragmentJit::FragmentJit(const FragmentJitConfig& config)
+    : Xbyak::CodeGenerator(MAX_FRAGMENT_PROGRAM_SIZE) {
+    tev_program = getCurr<TevProgram>();
+    CompileTev(config);
+
+    blend_program = getCurr<BlendProgram>();
+    CompileBlend(config);
+
+    ready();
+
+    ASSERT_MSG(getSize() <= MAX_FRAGMENT_PROGRAM_SIZE,
+               "Compiled a fragment program that exceeds the allocated size!");
+    LOG_DEBUG(HW_GPU, "Compiled fragment program size=%zu", getSize());
+}
+
+void FragmentJit::LoadConstant(const Xmm& dest, u64 value) {
+    if (value == 0) {
+        pxor(dest, dest);
+    } else {
+        mov(rax, value);
+        movq(dest, rax);
+    }
+}
+
+void FragmentJit::CompileDivideBy255(const Xmm& dest, const Xmm& magic) {
+    // For all 16-bit x, x / 255 == (x * 0x8081) >> 23
+    pmulhuw(dest, magic);
+    psrlw(dest, 7);
+}
+
+void FragmentJit::CompileTev(const FragmentJitConfig& config) {
+    ABI_PushRegistersAndAdjustStack(*this, PERSISTENT_REGS, 8);
+
+    mov(INPUTS, ABI_PARAM1);
+    mov(OUTPUT, ABI_PARAM2);
+
+    pxor(ZERO, ZERO);
+    LoadConstant(BYTE_MAX, Replicate16(0xFF));
+    LoadConstant(DIVIDE_BY_255, Replicate16(0x8081));
+
+    pxor(COMBINER_OUTPUT, COMBINER_OUTPUT);
+    pxor(COMBINER_BUFFER, COMBINER_BUFFER);
+    LoadConstant(NEXT_COMBINER_BUFFER, ExpandColor(config.combiner_buffer_color));
+
+    for (unsigned i = 0; i < config.num_tev_stages; ++i)
+        CompileTevStage(config, i);
+
+    movdqa(SCRATCH1, COMBINER_OUTPUT);
+    packuswb(SCRATCH1, SCRATCH1);
+    movd(dword[OUTPUT], SCRATCH1);
+
+    CompileAlphaTest(config);
+
+    ABI_PopRegistersAndAdjustStack(*this, PERSISTENT_REGS, 8);
+    ret();
+}
+
+void FragmentJit::CompileTevStage(const FragmentJitConfig& config, unsigned stage_index) {
+    using Operation = TevStageConfig::Operation;
+    const auto stage = static_cast<TevStageConfig>(config.tev_stages[stage_index]);
+
+    // The result of Dot3_RGBA is also used as the alpha output
+    const bool uses_alpha_combiner = stage.color_op != Operation::Dot3_RGBA;
+    const unsigned num_arguments = std::max(
+        NumOperands(stage.color_op), uses_alpha_combiner ? NumOperands(stage.alpha_op) : 0u);
+    for (unsigned i = 0; i < num_arguments; ++i)
+        CompileTevArgument(stage, i, TEV_ARGS[i]);
+
+    // The arguments are copies, so the previous combiner output may be overwritten right away
+    CompileTevOperation(stage.color_op, COMBINER_OUTPUT);
+    if (uses_alpha_combiner && stage.alpha_op != stage.color_op) {
+        CompileTevOperation(stage.alpha_op, ALPHA_RESULT);
+        pblendw(COMBINER_OUTPUT, ALPHA_RESULT, 0b1000);
+    }
+
+    const unsigned color_shift = stage.color_scale < 3 ? stage.color_scale.Value() : 0;
+    const unsigned alpha_shift = stage.alpha_scale < 3 ? stage.alpha_scale.Value() : 0;
+    if (color_shift != alpha_shift) {
+        movdqa(SCRATCH1, COMBINER_OUTPUT);
+        if (color_shift != 0)
+            psllw(COMBINER_OUTPUT, color_shift);
+        if (alpha_shift != 0)
+            psllw(SCRATCH1, alpha_shift);
+        pblendw(COMBINER_OUTPUT, SCRATCH1, 0b1000);
+        pminsw(COMBINER_OUTPUT, BYTE_MAX);
+    } else if (color_shift != 0) {
+        psllw(COMBINER_OUTPUT, color_shift);
+        pminsw(COMBINER_OUTPUT, BYTE_MAX);
+    }
+
+    // The combiner buffer is only observable by the stages that follow
+    if (stage_index + 1 < config.num_tev_stages) {
+        movdqa(COMBINER_BUFFER, NEXT_COMBINER_BUFFER);
+
+        u8 update_mask = 0;
+        if (stage_index < 4 && (config.combiner_buffer_update_rgb & (1 << stage_index)))
+            update_mask |= 0b0111;
+        if (stage_index < 4 && (config.combiner_buffer_update_a & (1 << stage_index)))
+            update_mask |= 0b1000;
+        if (update_mask != 0)
+            pblendw(NEXT_COMBINER_BUFFER, COMBINER_OUTPUT, update_mask);
+    }
+}
+
+void FragmentJit::CompileTevArgument(const TevStageConfig& stage, unsigned argument_index,
+                                     const Xmm& dest) {
+    using ColorModifier = TevStageConfig::ColorModifier;
+    using AlphaModifier = TevStageConfig::AlphaModifier;
+    using Source = TevStageConfig::Source;
+
+    Source color_source, alpha_source;
+    ColorModifier color_modifier;
+    AlphaModifier alpha_modifier;
+    switch (argument_index) {
+    case 0:
+        color_source = stage.color_source1;
+        alpha_source = stage.alpha_source1;
+        color_modifier = stage.color_modifier1;
+        alpha_modifier = stage.alpha_modifier1;
+        break;
+    case 1:
+        color_source = stage.color_source2;
+        alpha_source = stage.alpha_source2;
+        color_modifier = stage.color_modifier2;
+        alpha_modifier = stage.alpha_modifier2;
+        break;
+    default:
+        color_source = stage.color_source3;
+        alpha_source = stage.alpha_source3;
+        color_modifier = stage.color_modifier3;
+        alpha_modifier = stage.alpha_modifier3;
+        break;
+    }
+
+    // Component selected by each modifier. The "one minus" variants have the lowest bit set.
+    u8 color_shuffle;
+    switch (static_cast<ColorModifier>(static_cast<u32>(color_modifier) & ~1u)) {
+    case ColorModifier::SourceColor:
+        color_shuffle = Shuffle(0, 1, 2, 0);
+        break;
+    case ColorModifier::SourceAlpha:
+        color_shuffle = Shuffle(3, 3, 3, 0);
+        break;
+    case ColorModifier::SourceRed:
+        color_shuffle = Shuffle(0, 0, 0, 0);
+        break;
+    case ColorModifier::SourceGreen:
+        color_shuffle = Shuffle(1, 1, 1, 0);
+        break;
+    default:
+        color_shuffle = Shuffle(2, 2, 2, 0);
+        break;
+    }
+
+    static constexpr unsigned alpha_components[] = {3, 0, 1, 2};
+    const u8 alpha_shuffle =
+        Shuffle(0, 0, 0, alpha_components[static_cast<u32>(alpha_modifier) >> 1]);
+
+    if (color_source == alpha_source) {
+        pshuflw(dest, CompileTevSource(color_source, stage.const_color),
+                static_cast<u8>(color_shuffle | alpha_shuffle));
+    } else {
+        pshuflw(dest, CompileTevSource(color_source, stage.const_color), color_shuffle);
+        pshuflw(SCRATCH2, CompileTevSource(alpha_source, stage.const_color), alpha_shuffle);
+        pblendw(dest, SCRATCH2, 0b1000);
+    }
+
+    // 255 - x == x ^ 255 for all 8-bit x
+    const bool invert_color = (static_cast<u32>(color_modifier) & 1) != 0;
+    const bool invert_alpha = (static_cast<u32>(alpha_modifier) & 1) != 0;
+    const u64 invert_mask =
+        (invert_color ? 0x000000FF00FF00FFULL : 0) | (invert_alpha ? 0x00FF000000000000ULL : 0);
+    if (invert_mask != 0) {
+        LoadConstant(SCRATCH1, invert_mask);
+        pxor(dest, SCRATCH1);
+    }
+}
+
+const Xmm& FragmentJit::CompileTevSource(TevStageConfig::Source source, u32 const_color) {
+    using Source = TevStageConfig::Source;
+
+    size_t offset;
+    switch (source) {
+    case Source::Previous:
+        return COMBINER_OUTPUT;
+    case Source::PreviousBuffer:
+        return COMBINER_BUFFER;
+    case Source::Constant:
+        LoadConstant(SCRATCH1, ExpandColor(const_color));
+        return SCRATCH1;
+    case Source::PrimaryColor:
+        offset = offsetof(TevInputs, primary_color);
+        break;
+    case Source::PrimaryFragmentColor:
+        offset = offsetof(TevInputs, primary_fragment_color);
+        break;
+    case Source::SecondaryFragmentColor:
+        offset = offsetof(TevInputs, secondary_fragment_color);
+        break;
+    default:
+        offset = offsetof(TevInputs, texture_color) +
+                 (static_cast<u32>(source) - static_cast<u32>(Source::Texture0)) *
+                     sizeof(Math::Vec4<u8>);
+        break;
+    }
+
+    movd(SCRATCH1, dword[INPUTS + offset]);
+    pmovzxbw(SCRATCH1, SCRATCH1);
+    return SCRATCH1;
+}
+
+void FragmentJit::CompileTevOperation(TevStageConfig::Operation op, const Xmm& dest) {
+    using Operation = TevStageConfig::Operation;
+    const Xmm& arg0 = TEV_ARGS[0];
+    const Xmm& arg1 = TEV_ARGS[1];
+    const Xmm& arg2 = TEV_ARGS[2];
+
+    switch (op) {
+    case Operation::Replace:
+        movdqa(dest, arg0);
+        break;
+
+    case Operation::Modulate:
+        movdqa(dest, arg0);
+        pmullw(dest, arg1);
+        CompileDivideBy255(dest, DIVIDE_BY_255);
+        break;
+
+    case Operation::Add:
+        movdqa(dest, arg0);
+        paddw(dest, arg1);
+        pminsw(dest, BYTE_MAX);
+        break;
+
+    case Operation::AddSigned:
+        movdqa(dest, arg0);
+        paddw(dest, arg1);
+        LoadConstant(SCRATCH1, Replicate16(128));
+        psubw(dest, SCRATCH1);
+        pmaxsw(dest, ZERO);
+        pminsw(dest, BYTE_MAX);
+        break;
+
+    case Operation::Lerp:
+        movdqa(dest, arg0);
+        pmullw(dest, arg2);
+        movdqa(SCRATCH1, arg2);
+        pxor(SCRATCH1, BYTE_MAX);
+        pmullw(SCRATCH1, arg1);
+        paddw(dest, SCRATCH1);
+        CompileDivideBy255(dest, DIVIDE_BY_255);
+        break;
+
+    case Operation::Subtract:
+        movdqa(dest, arg0);
+        psubusw(dest, arg1);
+        break;
+
+    case Operation::MultiplyThenAdd:
+        movdqa(dest, arg0);
+        pmullw(dest, arg1);
+        CompileDivideBy255(dest, DIVIDE_BY_255);
+        paddw(dest, arg2);
+        pminsw(dest, BYTE_MAX);
+        break;
+
+    case Operation::AddThenMultiply:
+        movdqa(dest, arg0);
+        paddw(dest, arg1);
+        pminsw(dest, BYTE_MAX);
+        pmullw(dest, arg2);
+        CompileDivideBy255(dest, DIVIDE_BY_255);
+        break;
+
+    case Operation::Dot3_RGB:
+    case Operation::Dot3_RGBA:
+        // Map both arguments to [-255, 255] and compute the per-component products as 32-bit
+        movdqa(dest, arg0);
+        paddw(dest, dest);
+        psubw(dest, BYTE_MAX);
+        punpcklwd(dest, ZERO);
+        movdqa(SCRATCH1, arg1);
+        paddw(SCRATCH1, SCRATCH1);
+        psubw(SCRATCH1, BYTE_MAX);
+        punpcklwd(SCRATCH1, ZERO);
+        pmaddwd(dest, SCRATCH1);
+
+        // (product + 128) / 256, rounding towards zero like the interpreter
+        mov(eax, 128);
+        movd(SCRATCH1, eax);
+        pshufd(SCRATCH1, SCRATCH1, 0);
+        paddd(dest, SCRATCH1);
+        movdqa(SCRATCH1, dest);
+        psrad(SCRATCH1, 31);
+        psrld(SCRATCH1, 24);
+        paddd(dest, SCRATCH1);
+        psrad(dest, 8);
+
+        // Sum up the RGB components and broadcast the result
+        pblendw(dest, ZERO, 0b11000000);
+        pshufd(SCRATCH1, dest, 0b01001110);
+        paddd(dest, SCRATCH1);
+        pshufd(SCRATCH1, dest, 0b10110001);
+        paddd(dest, SCRATCH1);
+        packssdw(dest, dest);
+        pmaxsw(dest, ZERO);
+        pminsw(dest, BYTE_MAX);
+        break;
+
+    default:
+        UNREACHABLE();
+    }
+}
+
+void FragmentJit::CompileAlphaTest(const FragmentJitConfig& config) {
+    using CompareFunc = FramebufferRegs::CompareFunc;
+
+    if (!config.alpha_test_enable || config.alpha_test_func == CompareFunc::Always) {
+        mov(eax, 1);
+        return;
+    }
+
+    if (config.alpha_test_func == CompareFunc::Never) {
+        xor_(eax, eax);
+        return;
+    }
+
+    pextrw(eax, COMBINER_OUTPUT, 3);
+    cmp(eax, config.alpha_test_ref);
+
+    switch (config.alpha_test_func) {
+    case CompareFunc::Equal:
+        sete(al);
+        break;
+    case CompareFunc::NotEqual:
+        setne(al);
+        break;
+    case CompareFunc::LessThan:
+        setb(al);
+        break;
+    case CompareFunc::LessThanOrEqual:
+        setbe(al);
+        break;
+    case CompareFunc::GreaterThan:
+        seta(al);
+        break;
+    case CompareFunc::GreaterThanOrEqual:
+        setae(al);
+        break;
+    default:
+        UNREACHABLE();
+    }
+    movzx(eax, al);
+}
+
+void FragmentJit::CompileBlend(const FragmentJitConfig& config) {
+    ABI_PushRegistersAndAdjustStack(*this, PERSISTENT_REGS, 8);
+
+    mov(SOURCE_COLOR, ABI_PARAM1.cvt32());
+    mov(DEST_COLOR, ABI_PARAM2.cvt32());
+
+    if (config.alphablend_enable) {
+        movd(SOURCE, SOURCE_COLOR);
+        pmovzxbw(SOURCE, SOURCE);
+        movd(DEST, DEST_COLOR);
+        pmovzxbw(DEST, DEST);
+
+        // Factors are computed for all four components, the alpha component is then replaced if
+        // the alpha factor differs. Both variants agree on the channel each component represents.
+        CompileBlendFactor(config, config.factor_source_rgb, SOURCE_FACTOR);
+        if (config.factor_source_a != config.factor_source_rgb) {
+            CompileBlendFactor(config, config.factor_source_a, BLEND_ALPHA_RESULT);
+            pblendw(SOURCE_FACTOR, BLEND_ALPHA_RESULT, 0b1000);
+        }
+        CompileBlendFactor(config, config.factor_dest_rgb, DEST_FACTOR);
+        if (config.factor_dest_a != config.factor_dest_rgb) {
+            CompileBlendFactor(config, config.factor_dest_a, BLEND_ALPHA_RESULT);
+            pblendw(DEST_FACTOR, BLEND_ALPHA_RESULT, 0b1000);
+        }
+
+        CompileBlendEquation(config.blend_equation_rgb, BLEND_RESULT);
+        if (config.blend_equation_a != config.blend_equation_rgb) {
+            CompileBlendEquation(config.blend_equation_a, BLEND_ALPHA_RESULT);
+            pblendw(BLEND_RESULT, BLEND_ALPHA_RESULT, 0b1000);
+        }
+
+        packuswb(BLEND_RESULT, BLEND_RESULT);
+        movd(eax, BLEND_RESULT);
+    } else {
+        CompileLogicOp(config.logic_op);
+    }
+
+    if (config.color_write_mask != 0xFFFFFFFF) {
+        and_(eax, config.color_write_mask);
+        and_(DEST_COLOR, ~config.color_write_mask);
+        or_(eax, DEST_COLOR);
+    }
+
+    ABI_PopRegistersAndAdjustStack(*this, PERSISTENT_REGS, 8);
+    ret();
+}
+
+void FragmentJit::CompileBlendFactor(const FragmentJitConfig& config,
+                                     FramebufferRegs::BlendFactor factor, const Xmm& dest) {
+    using BlendFactor = FramebufferRegs::BlendFactor;
+
+    const u64 constant = ExpandColor(config.blend_const);
+    const u64 constant_alpha = Replicate16(config.blend_const >> 24);
+
+    switch (factor) {
+    case BlendFactor::Zero:
+        pxor(dest, dest);
+        break;
+    case BlendFactor::One:
+        LoadConstant(dest, Replicate16(0xFF));
+        break;
+    case BlendFactor::SourceColor:
+    case BlendFactor::OneMinusSourceColor:
+        movdqa(dest, SOURCE);
+        break;
+    case BlendFactor::DestColor:
+    case BlendFactor::OneMinusDestColor:
+        movdqa(dest, DEST);
+        break;
+    case BlendFactor::SourceAlpha:
+    case BlendFactor::OneMinusSourceAlpha:
+        pshuflw(dest, SOURCE, Shuffle(3, 3, 3, 3));
+        break;
+    case BlendFactor::DestAlpha:
+    case BlendFactor::OneMinusDestAlpha:
+        pshuflw(dest, DEST, Shuffle(3, 3, 3, 3));
+        break;
+    case BlendFactor::ConstantColor:
+        LoadConstant(dest, constant);
+        break;
+    case BlendFactor::OneMinusConstantColor:
+        LoadConstant(dest, constant ^ Replicate16(0xFF));
+        break;
+    case BlendFactor::ConstantAlpha:
+        LoadConstant(dest, constant_alpha);
+        break;
+    case BlendFactor::OneMinusConstantAlpha:
+        LoadConstant(dest, constant_alpha ^ Replicate16(0xFF));
+        break;
+    case BlendFactor::SourceAlphaSaturate:
+        // min(source alpha, 1 - dest alpha) for RGB, 1 for alpha
+        pshuflw(dest, DEST, Shuffle(3, 3, 3, 3));
+        LoadConstant(SCRATCH1, Replicate16(0xFF));
+        pxor(dest, SCRATCH1);
+        pshuflw(SCRATCH1, SOURCE, Shuffle(3, 3, 3, 3));
+        pminsw(dest, SCRATCH1);
+        mov(eax, 0xFF);
+        pinsrw(dest, eax, 3);
+        break;
+    default:
+        UNREACHABLE();
+    }
+
+    switch (factor) {
+    case BlendFactor::OneMinusSourceColor:
+    case BlendFactor::OneMinusDestColor:
+    case BlendFactor::OneMinusSourceAlpha:
+    case BlendFactor::OneMinusDestAlpha:
+        LoadConstant(SCRATCH1, Replicate16(0xFF));
+        pxor(dest, SCRATCH1);
+        break;
+    default:
+        break;
+    }
+}
+
+void FragmentJit::CompileBlendEquation(FramebufferRegs::BlendEquation equation,
+                                       const Xmm& dest) {
+    using BlendEquation = FramebufferRegs::BlendEquation;
+
+    switch (equation) {
+    case BlendEquation::Add:
+    case BlendEquation::Subtract:
+    case BlendEquation::ReverseSubtract:
+        // Interleave colors and factors to compute source * factor +/- dest * factor in 32 bits
+        movdqa(dest, SOURCE);
+        punpcklwd(dest, DEST);
+        if (equation == BlendEquation::ReverseSubtract) {
+            pxor(SCRATCH1, SCRATCH1);
+            psubw(SCRATCH1, SOURCE_FACTOR);
+        } else {
+            movdqa(SCRATCH1, SOURCE_FACTOR);
+        }
+        if (equation == BlendEquation::Subtract) {
+            pxor(SCRATCH2, SCRATCH2);
+            psubw(SCRATCH2, DEST_FACTOR);
+            punpcklwd(SCRATCH1, SCRATCH2);
+        } else {
+            punpcklwd(SCRATCH1, DEST_FACTOR);
+        }
+        pmaddwd(dest, SCRATCH1);
+
+        // Negative results clamp to zero, and anything above 0xFFFF / 255 clamps to 255 anyway,
+        // so the saturating pack to 16 bits does not change the result.
+        packusdw(dest, dest);
+        LoadConstant(SCRATCH1, Replicate16(0x8081));
+        CompileDivideBy255(dest, SCRATCH1);
+        LoadConstant(SCRATCH1, Replicate16(0xFF));
+        pminsw(dest, SCRATCH1);
+        break;
+
+    case BlendEquation::Min:
+        movdqa(dest, SOURCE);
+        pminsw(dest, DEST);
+        break;
+
+    case BlendEquation::Max:
+        movdqa(dest, SOURCE);
+        pmaxsw(dest, DEST);
+        break;
+
+    default:
+        UNREACHABLE();
+    }
+}
+
+void FragmentJit::CompileLogicOp(FramebufferRegs::LogicOp op) {
+    using LogicOp = FramebufferRegs::LogicOp;
+
+    // The operations are bitwise, so all four channels are processed at once
+    switch (op) {
+    case LogicOp::Clear:
+        xor_(eax, eax);
+        break;
+    case LogicOp::And:
+        mov(eax, SOURCE_COLOR);
+        and_(eax, DEST_COLOR);
+        break;
+    case LogicOp::AndReverse:
+        mov(eax, DEST_COLOR);
+        not_(eax);
+        and_(eax, SOURCE_COLOR);
+        break;
+    case LogicOp::Copy:
+        mov(eax, SOURCE_COLOR);
+        break;
+    case LogicOp::Set:
+        mov(eax, 0xFFFFFFFF);
+        break;
+    case LogicOp::CopyInverted:
+        mov(eax, SOURCE_COLOR);
+        not_(eax);
+        break;
+    case LogicOp::NoOp:
+        mov(eax, DEST_COLOR);
+        break;
+    case LogicOp::Invert:
+        mov(eax, DEST_COLOR);
+        not_(eax);
+        break;
+    case LogicOp::Nand:
+        mov(eax, SOURCE_COLOR);
+        and_(eax, DEST_COLOR);
+        not_(eax);
+        break;
+    case LogicOp::Or:
+        mov(eax, SOURCE_COLOR);
+        or_(eax, DEST_COLOR);
+        break;
+    case LogicOp::Nor:
+        mov(eax, SOURCE_COLOR);
+        or_(eax, DEST_COLOR);
+        not_(eax);
+        break;
+    case LogicOp::Xor:
+        mov(eax, SOURCE_COLOR);
+        xor_(eax, DEST_COLOR);
+        break;
+    case LogicOp::Equiv:
+        mov(eax, SOURCE_COLOR);
+        xor_(eax, DEST_COLOR);
+        not_(eax);
+        break;
+    case LogicOp::AndInverted:
+        mov(eax, SOURCE_COLOR);
+        not_(eax);
+        and_(eax, DEST_COLOR);
+        break;
+    case LogicOp::OrReverse:
+        mov(eax, DEST_COLOR);
+        not_(eax);
+        or_(eax, SOURCE_COLOR);
+        break;
+    case LogicOp::OrInverted:
+        mov(eax, SOURCE_COLOR);
+        not_(eax);
+        or_(eax, DEST_COLOR);
+        break;
+    }
+}
+
+const FragmentJit* FragmentJitCache::Get(const FragmentJitConfig& config) {
+    auto iter = cache.find(config);
+    if (iter != cache.end()) {
+        lru.splice(lru.end(), lru, iter->second.lru_position);
+        return iter->second.program.get();
+    }
+
+    if (cache.size() >= MAX_CACHED_PROGRAMS) {
+        cache.erase(cache.find(*lru.front()));
+        lru.pop_front();
+    }
+
+    // Unsupported configurations are cached too, so they are only checked once
+    std::unique_ptr<FragmentJit> program;
+    if (FragmentJit::IsSupported(config))
+        program = std::make_unique<FragmentJit>(config);
+
+    const FragmentJit* result = program.get();
+    iter = cache.emplace(config, CacheEntry{std::move(program), {}}).first;
+    // Keys stay at the same address while they are in the map, even when it is rehashed
+    iter->second.lru_position = lru.insert(lru.end(), &iter->first);
+    return result;
+}
+
+} // namespace Rasterizer
+} // namespace Pica
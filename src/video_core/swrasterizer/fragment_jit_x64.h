@@ -0,0 +1,199 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <xbyak.h>
+#include "common/common_types.h"
+#include "common/hash.h"
+#include "common/vector_math.h"
+#include "video_core/regs_framebuffer.h"
+#include "video_core/regs_texturing.h"
+
+namespace Pica {
+
+struct Regs;
+
+namespace Rasterizer {
+
+struct PipelineState;
+
+/// Colors that can be selected as TEV sources for a single fragment
+struct TevInputs {
+    Math::Vec4<u8> primary_color;
+    Math::Vec4<u8> primary_fragment_color;
+    Math::Vec4<u8> secondary_fragment_color;
+    Math::Vec4<u8> texture_color[4];
+};
+
+/**
+ * The fragment pipeline state compiled by the fragment JIT. This is the key of the compiled
+ * program cache, hence all state used by the generated code must be captured here. Fields that
+ * do not affect the generated code are left zeroed, so that equivalent configurations compare
+ * (and hash) equal bytewise.
+ */
+struct FragmentJitConfig {
+    /// Construct a FragmentJitConfig from the given register configuration
+    static FragmentJitConfig FromRegisters(const Regs& regs, const PipelineState& state);
+
+    bool operator==(const FragmentJitConfig& other) const {
+        return std::memcmp(this, &other, sizeof(FragmentJitConfig)) == 0;
+    }
+
+    // See PicaShaderConfig::TevStageConfigRaw for why the register structure is not used here.
+    struct TevStageConfigRaw {
+        u32 sources_raw;
+        u32 modifiers_raw;
+        u32 ops_raw;
+        u32 const_color;
+        u32 scales_raw;
+        explicit operator TexturingRegs::TevStageConfig() const noexcept {
+            TexturingRegs::TevStageConfig stage;
+            stage.sources_raw = sources_raw;
+            stage.modifiers_raw = modifiers_raw;
+            stage.ops_raw = ops_raw;
+            stage.const_color = const_color;
+            stage.scales_raw = scales_raw;
+            return stage;
+        }
+    };
+
+    std::array<TevStageConfigRaw, 6> tev_stages;
+    u32 num_tev_stages;
+    u32 combiner_buffer_color;
+    u32 combiner_buffer_update_rgb;
+    u32 combiner_buffer_update_a;
+
+    u32 alpha_test_enable;
+    FramebufferRegs::CompareFunc alpha_test_func;
+    u32 alpha_test_ref;
+
+    u32 alphablend_enable;
+    FramebufferRegs::BlendEquation blend_equation_rgb;
+    FramebufferRegs::BlendEquation blend_equation_a;
+    FramebufferRegs::BlendFactor factor_source_rgb;
+    FramebufferRegs::BlendFactor factor_dest_rgb;
+    FramebufferRegs::BlendFactor factor_source_a;
+    FramebufferRegs::BlendFactor factor_dest_a;
+    u32 blend_const;
+    FramebufferRegs::LogicOp logic_op;
+
+    /// Bytes of the output color that are written to the framebuffer
+    u32 color_write_mask;
+};
+static_assert(std::is_trivially_copyable<FragmentJitConfig>::value,
+              "FragmentJitConfig must be trivially copyable");
+
+} // namespace Rasterizer
+} // namespace Pica
+
+namespace std {
+template <>
+struct hash<Pica::Rasterizer::FragmentJitConfig> {
+    size_t operator()(const Pica::Rasterizer::FragmentJitConfig& k) const {
+        return Common::ComputeHash64(&k, sizeof(Pica::Rasterizer::FragmentJitConfig));
+    }
+};
+} // namespace std
+
+namespace Pica {
+namespace Rasterizer {
+
+/**
+ * Fragment pipeline compiled to x86_64 code. Two functions are generated for each configuration:
+ * one evaluating the TEV stages followed by the alpha test, and one applying blending (or the
+ * logic operation) and the color write mask. Colors are kept as vectors of 16-bit components
+ * throughout, so that all channels of a stage are combined at once.
+ */
+class FragmentJit : public Xbyak::CodeGenerator {
+public:
+    /// Returns whether the configuration can be compiled on the host CPU
+    static bool IsSupported(const FragmentJitConfig& config);
+
+    explicit FragmentJit(const FragmentJitConfig& config);
+
+    /**
+     * Evaluates the TEV stages and the alpha test for one fragment.
+     * @param output Receives the combiner output
+     * @return False if the fragment was discarded by the alpha test
+     */
+    bool RunTev(const TevInputs& inputs, Math::Vec4<u8>& output) const {
+        return tev_program(&inputs, &output);
+    }
+
+    /// Combines the fragment color with the current framebuffer color
+    Math::Vec4<u8> RunBlend(const Math::Vec4<u8>& source, const Math::Vec4<u8>& dest) const {
+        u32 source_raw, dest_raw;
+        std::memcpy(&source_raw, &source, sizeof(u32));
+        std::memcpy(&dest_raw, &dest, sizeof(u32));
+        const u32 result_raw = blend_program(source_raw, dest_raw);
+
+        Math::Vec4<u8> result;
+        std::memcpy(&result, &result_raw, sizeof(u32));
+        return result;
+    }
+
+private:
+    using TevProgram = bool (*)(const TevInputs* inputs, Math::Vec4<u8>* output);
+    using BlendProgram = u32 (*)(u32 source, u32 dest);
+
+    void CompileTev(const FragmentJitConfig& config);
+    void CompileTevStage(const FragmentJitConfig& config, unsigned stage_index);
+    void CompileTevArgument(const TexturingRegs::TevStageConfig& stage, unsigned argument_index,
+                            const Xbyak::Xmm& dest);
+    const Xbyak::Xmm& CompileTevSource(TexturingRegs::TevStageConfig::Source source,
+                                       u32 const_color);
+    void CompileTevOperation(TexturingRegs::TevStageConfig::Operation op,
+                             const Xbyak::Xmm& dest);
+    void CompileAlphaTest(const FragmentJitConfig& config);
+
+    void CompileBlend(const FragmentJitConfig& config);
+    void CompileBlendFactor(const FragmentJitConfig& config, FramebufferRegs::BlendFactor factor,
+                            const Xbyak::Xmm& dest);
+    void CompileBlendEquation(FramebufferRegs::BlendEquation equation, const Xbyak::Xmm& dest);
+    void CompileLogicOp(FramebufferRegs::LogicOp op);
+
+    /// Loads a 64-bit constant into the low half of an XMM register
+    void LoadConstant(const Xbyak::Xmm& dest, u64 value);
+    /// Divides the 16-bit components of dest by 255, rounding down
+    void CompileDivideBy255(const Xbyak::Xmm& dest, const Xbyak::Xmm& magic);
+
+    TevProgram tev_program = nullptr;
+    BlendProgram blend_program = nullptr;
+};
+
+/// Caches compiled fragment programs by their configuration, evicting the least recently used ones
+class FragmentJitCache {
+public:
+    /**
+     * Returns the program for the given configuration, compiling it on first use. Programs
+     * returned by earlier calls may be evicted, so only the returned one may be used afterwards.
+     * @return The program, or nullptr if the configuration has to be interpreted
+     */
+    const FragmentJit* Get(const FragmentJitConfig& config);
+
+private:
+    static constexpr size_t MAX_CACHED_PROGRAMS = 256;
+
+    /// Configurations of the cached programs, from the least to the most recently used one
+    using LruList = std::list<const FragmentJitConfig*>;
+
+    struct CacheEntry {
+        std::unique_ptr<FragmentJit> program;
+        LruList::iterator lru_position;
+    };
+
+    std::unordered_map<FragmentJitConfig, CacheEntry> cache;
+    LruList lru;
+};
+
+} // namespace Rasterizer
+} // namespace Pica
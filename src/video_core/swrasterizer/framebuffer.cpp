@@ -20,205 +20,209 @@
 namespace Pica {
 namespace Rasterizer {
 
-void DrawPixel(int x, int y, const Math::Vec4<u8>& color) {
-    const auto& framebuffer = g_state.regs.framebuffer.framebuffer;
-    const PAddr addr = framebuffer.GetColorBufferPhysicalAddress();
-
-    // Similarly to textures, the render framebuffer is laid out from bottom to top, too.
-    // NOTE: The framebuffer height register contains the actual FB height minus one.
-    y = framebuffer.height - y;
-
-    const u32 coarse_y = y & ~7;
-    u32 bytes_per_pixel =
-        GPU::Regs::BytesPerPixel(GPU::Regs::PixelFormat(framebuffer.color_format.Value()));
-    u32 dst_offset = VideoCore::GetMortonOffset(x, y, bytes_per_pixel) +
-                     coarse_y * framebuffer.width * bytes_per_pixel;
-    u8* dst_pixel = Memory::GetPhysicalPointer(addr) + dst_offset;
-
-    switch (framebuffer.color_format) {
-    case FramebufferRegs::ColorFormat::RGBA8:
-        Color::EncodeRGBA8(color, dst_pixel);
-        break;
+static const Math::Vec4<u8> DecodeUnknownColor(const u8* bytes) {
+    return {0, 0, 0, 0};
+}
 
-    case FramebufferRegs::ColorFormat::RGB8:
-        Color::EncodeRGB8(color, dst_pixel);
-        break;
+static void EncodeUnknownColor(const Math::Vec4<u8>& color, u8* bytes) {}
 
-    case FramebufferRegs::ColorFormat::RGB5A1:
-        Color::EncodeRGB5A1(color, dst_pixel);
-        break;
+static u32 DecodeUnknownDepth(const u8* bytes) {
+    return 0;
+}
 
-    case FramebufferRegs::ColorFormat::RGB565:
-        Color::EncodeRGB565(color, dst_pixel);
-        break;
+static void EncodeUnknownDepth(u32 value, u8* bytes) {}
 
-    case FramebufferRegs::ColorFormat::RGBA4:
-        Color::EncodeRGBA4(color, dst_pixel);
-        break;
+static u32 DecodeD24S8Depth(const u8* bytes) {
+    return Color::DecodeD24S8(bytes).x;
+}
 
-    default:
-        LOG_CRITICAL(Render_Software, "Unknown framebuffer color format %x",
-                     framebuffer.color_format.Value());
-        UNIMPLEMENTED();
-    }
+static u8 DecodeD24S8Stencil(const u8* bytes) {
+    return static_cast<u8>(Color::DecodeD24S8(bytes).y);
 }
 
-const Math::Vec4<u8> GetPixel(int x, int y) {
-    const auto& framebuffer = g_state.regs.framebuffer.framebuffer;
-    const PAddr addr = framebuffer.GetColorBufferPhysicalAddress();
+static u8 DecodeNoStencil(const u8* bytes) {
+    return 0;
+}
 
-    y = framebuffer.height - y;
+static void EncodeNoStencil(u8 value, u8* bytes) {}
 
-    const u32 coarse_y = y & ~7;
-    u32 bytes_per_pixel =
-        GPU::Regs::BytesPerPixel(GPU::Regs::PixelFormat(framebuffer.color_format.Value()));
-    u32 src_offset = VideoCore::GetMortonOffset(x, y, bytes_per_pixel) +
-                     coarse_y * framebuffer.width * bytes_per_pixel;
-    u8* src_pixel = Memory::GetPhysicalPointer(addr) + src_offset;
+Framebuffer::Framebuffer(const FramebufferRegs::FramebufferConfig& config)
+    : color_buffer(Memory::GetPhysicalPointer(config.GetColorBufferPhysicalAddress())),
+      depth_buffer(Memory::GetPhysicalPointer(config.GetDepthBufferPhysicalAddress())),
+      width(config.width), height(config.height) {
 
-    switch (framebuffer.color_format) {
+    switch (config.color_format) {
     case FramebufferRegs::ColorFormat::RGBA8:
-        return Color::DecodeRGBA8(src_pixel);
+        decode_color = Color::DecodeRGBA8;
+        encode_color = Color::EncodeRGBA8;
+        break;
 
     case FramebufferRegs::ColorFormat::RGB8:
-        return Color::DecodeRGB8(src_pixel);
+        decode_color = Color::DecodeRGB8;
+        encode_color = Color::EncodeRGB8;
+        break;
 
     case FramebufferRegs::ColorFormat::RGB5A1:
-        return Color::DecodeRGB5A1(src_pixel);
+        decode_color = Color::DecodeRGB5A1;
+        encode_color = Color::EncodeRGB5A1;
+        break;
 
     case FramebufferRegs::ColorFormat::RGB565:
-        return Color::DecodeRGB565(src_pixel);
+        decode_color = Color::DecodeRGB565;
+        encode_color = Color::EncodeRGB565;
+        break;
 
     case FramebufferRegs::ColorFormat::RGBA4:
-        return Color::DecodeRGBA4(src_pixel);
+        decode_color = Color::DecodeRGBA4;
+        encode_color = Color::EncodeRGBA4;
+        break;
 
     default:
-        LOG_CRITICAL(Render_Software, "Unknown framebuffer color format %x",
-                     framebuffer.color_format.Value());
-        UNIMPLEMENTED();
+        // Reported by CheckFormats
+        decode_color = DecodeUnknownColor;
+        encode_color = EncodeUnknownColor;
+        break;
     }
 
-    return {0, 0, 0, 0};
-}
-
-u32 GetDepth(int x, int y) {
-    const auto& framebuffer = g_state.regs.framebuffer.framebuffer;
-    const PAddr addr = framebuffer.GetDepthBufferPhysicalAddress();
-    u8* depth_buffer = Memory::GetPhysicalPointer(addr);
-
-    y = framebuffer.height - y;
-
-    const u32 coarse_y = y & ~7;
-    u32 bytes_per_pixel = FramebufferRegs::BytesPerDepthPixel(framebuffer.depth_format);
-    u32 stride = framebuffer.width * bytes_per_pixel;
-
-    u32 src_offset = VideoCore::GetMortonOffset(x, y, bytes_per_pixel) + coarse_y * stride;
-    u8* src_pixel = depth_buffer + src_offset;
-
-    switch (framebuffer.depth_format) {
-    case FramebufferRegs::DepthFormat::D16:
-        return Color::DecodeD16(src_pixel);
-    case FramebufferRegs::DepthFormat::D24:
-        return Color::DecodeD24(src_pixel);
-    case FramebufferRegs::DepthFormat::D24S8:
-        return Color::DecodeD24S8(src_pixel).x;
-    default:
-        LOG_CRITICAL(HW_GPU, "Unimplemented depth format %u", framebuffer.depth_format);
-        UNIMPLEMENTED();
-        return 0;
+    if (decode_color != DecodeUnknownColor) {
+        color_bytes_per_pixel =
+            GPU::Regs::BytesPerPixel(GPU::Regs::PixelFormat(config.color_format.Value()));
     }
-}
-
-u8 GetStencil(int x, int y) {
-    const auto& framebuffer = g_state.regs.framebuffer.framebuffer;
-    const PAddr addr = framebuffer.GetDepthBufferPhysicalAddress();
-    u8* depth_buffer = Memory::GetPhysicalPointer(addr);
 
-    y = framebuffer.height - y;
+    decode_stencil = DecodeNoStencil;
+    encode_stencil = EncodeNoStencil;
 
-    const u32 coarse_y = y & ~7;
-    u32 bytes_per_pixel = Pica::FramebufferRegs::BytesPerDepthPixel(framebuffer.depth_format);
-    u32 stride = framebuffer.width * bytes_per_pixel;
+    switch (config.depth_format) {
+    case FramebufferRegs::DepthFormat::D16:
+        decode_depth = Color::DecodeD16;
+        encode_depth = Color::EncodeD16;
+        break;
 
-    u32 src_offset = VideoCore::GetMortonOffset(x, y, bytes_per_pixel) + coarse_y * stride;
-    u8* src_pixel = depth_buffer + src_offset;
+    case FramebufferRegs::DepthFormat::D24:
+        decode_depth = Color::DecodeD24;
+        encode_depth = Color::EncodeD24;
+        break;
 
-    switch (framebuffer.depth_format) {
     case FramebufferRegs::DepthFormat::D24S8:
-        return Color::DecodeD24S8(src_pixel).y;
+        decode_depth = DecodeD24S8Depth;
+        encode_depth = Color::EncodeD24X8;
+        decode_stencil = DecodeD24S8Stencil;
+        encode_stencil = Color::EncodeX24S8;
+        break;
 
     default:
-        LOG_WARNING(
-            HW_GPU,
-            "GetStencil called for function which doesn't have a stencil component (format %u)",
-            framebuffer.depth_format);
-        return 0;
+        // Reported by CheckFormats
+        decode_depth = DecodeUnknownDepth;
+        encode_depth = EncodeUnknownDepth;
+        break;
     }
-}
 
-void SetDepth(int x, int y, u32 value) {
-    const auto& framebuffer = g_state.regs.framebuffer.framebuffer;
-    const PAddr addr = framebuffer.GetDepthBufferPhysicalAddress();
-    u8* depth_buffer = Memory::GetPhysicalPointer(addr);
-
-    y = framebuffer.height - y;
-
-    const u32 coarse_y = y & ~7;
-    u32 bytes_per_pixel = FramebufferRegs::BytesPerDepthPixel(framebuffer.depth_format);
-    u32 stride = framebuffer.width * bytes_per_pixel;
-
-    u32 dst_offset = VideoCore::GetMortonOffset(x, y, bytes_per_pixel) + coarse_y * stride;
-    u8* dst_pixel = depth_buffer + dst_offset;
+    if (decode_depth != DecodeUnknownDepth)
+        depth_bytes_per_pixel = FramebufferRegs::BytesPerDepthPixel(config.depth_format);
+}
 
-    switch (framebuffer.depth_format) {
-    case FramebufferRegs::DepthFormat::D16:
-        Color::EncodeD16(value, dst_pixel);
+void Framebuffer::CheckFormats(const FramebufferRegs::FramebufferConfig& config) {
+    switch (config.color_format) {
+    case FramebufferRegs::ColorFormat::RGBA8:
+    case FramebufferRegs::ColorFormat::RGB8:
+    case FramebufferRegs::ColorFormat::RGB5A1:
+    case FramebufferRegs::ColorFormat::RGB565:
+    case FramebufferRegs::ColorFormat::RGBA4:
         break;
 
-    case FramebufferRegs::DepthFormat::D24:
-        Color::EncodeD24(value, dst_pixel);
+    default:
+        LOG_CRITICAL(Render_Software, "Unknown framebuffer color format %x",
+                     config.color_format.Value());
+        UNIMPLEMENTED();
         break;
+    }
 
+    switch (config.depth_format) {
+    case FramebufferRegs::DepthFormat::D16:
+    case FramebufferRegs::DepthFormat::D24:
     case FramebufferRegs::DepthFormat::D24S8:
-        Color::EncodeD24X8(value, dst_pixel);
         break;
 
     default:
-        LOG_CRITICAL(HW_GPU, "Unimplemented depth format %u", framebuffer.depth_format);
+        LOG_CRITICAL(HW_GPU, "Unimplemented depth format %u", config.depth_format);
         UNIMPLEMENTED();
         break;
     }
 }
 
-void SetStencil(int x, int y, u8 value) {
-    const auto& framebuffer = g_state.regs.framebuffer.framebuffer;
-    const PAddr addr = framebuffer.GetDepthBufferPhysicalAddress();
-    u8* depth_buffer = Memory::GetPhysicalPointer(addr);
+unsigned FramebufferTileCache::SelectTile(unsigned x, unsigned y) {
+    const unsigned offset = framebuffer.GetTileOffset(x, y);
+    if (offset != tile_offset) {
+        Flush();
+        tile_offset = offset;
+    }
+    return framebuffer.GetIndexInTile(x, y);
+}
 
-    y = framebuffer.height - y;
+Math::Vec4<u8> FramebufferTileCache::GetPixel(unsigned x, unsigned y) {
+    const unsigned index = SelectTile(x, y);
+    if (!(color_loaded & (1ull << index))) {
+        color[index] = framebuffer.decode_color(GetColorPointer(index));
+        color_loaded |= 1ull << index;
+    }
+    return color[index];
+}
 
-    const u32 coarse_y = y & ~7;
-    u32 bytes_per_pixel = Pica::FramebufferRegs::BytesPerDepthPixel(framebuffer.depth_format);
-    u32 stride = framebuffer.width * bytes_per_pixel;
+void FramebufferTileCache::DrawPixel(unsigned x, unsigned y, const Math::Vec4<u8>& value) {
+    const unsigned index = SelectTile(x, y);
+    color[index] = value;
+    color_loaded |= 1ull << index;
+    color_dirty |= 1ull << index;
+}
 
-    u32 dst_offset = VideoCore::GetMortonOffset(x, y, bytes_per_pixel) + coarse_y * stride;
-    u8* dst_pixel = depth_buffer + dst_offset;
+u32 FramebufferTileCache::GetDepth(unsigned x, unsigned y) {
+    const unsigned index = SelectTile(x, y);
+    if (!(depth_loaded & (1ull << index))) {
+        depth[index] = framebuffer.decode_depth(GetDepthPointer(index));
+        depth_loaded |= 1ull << index;
+    }
+    return depth[index];
+}
 
-    switch (framebuffer.depth_format) {
-    case Pica::FramebufferRegs::DepthFormat::D16:
-    case Pica::FramebufferRegs::DepthFormat::D24:
-        // Nothing to do
-        break;
+void FramebufferTileCache::SetDepth(unsigned x, unsigned y, u32 value) {
+    const unsigned index = SelectTile(x, y);
+    depth[index] = value;
+    depth_loaded |= 1ull << index;
+    depth_dirty |= 1ull << index;
+}
 
-    case Pica::FramebufferRegs::DepthFormat::D24S8:
-        Color::EncodeX24S8(value, dst_pixel);
-        break;
+u8 FramebufferTileCache::GetStencil(unsigned x, unsigned y) {
+    const unsigned index = SelectTile(x, y);
+    if (!(stencil_loaded & (1ull << index))) {
+        stencil[index] = framebuffer.decode_stencil(GetDepthPointer(index));
+        stencil_loaded |= 1ull << index;
+    }
+    return stencil[index];
+}
 
-    default:
-        LOG_CRITICAL(HW_GPU, "Unimplemented depth format %u", framebuffer.depth_format);
-        UNIMPLEMENTED();
-        break;
+void FramebufferTileCache::SetStencil(unsigned x, unsigned y, u8 value) {
+    const unsigned index = SelectTile(x, y);
+    stencil[index] = value;
+    stencil_loaded |= 1ull << index;
+    stencil_dirty |= 1ull << index;
+}
+
+void FramebufferTileCache::Flush() {
+    for (unsigned index = 0; color_dirty != 0; ++index, color_dirty >>= 1) {
+        if (color_dirty & 1)
+            framebuffer.encode_color(color[index], GetColorPointer(index));
+    }
+    for (unsigned index = 0; depth_dirty != 0; ++index, depth_dirty >>= 1) {
+        if (depth_dirty & 1)
+            framebuffer.encode_depth(depth[index], GetDepthPointer(index));
     }
+    for (unsigned index = 0; stencil_dirty != 0; ++index, stencil_dirty >>= 1) {
+        if (stencil_dirty & 1)
+            framebuffer.encode_stencil(stencil[index], GetDepthPointer(index));
+    }
+
+    color_loaded = depth_loaded = stencil_loaded = 0;
+    tile_offset = ~0u;
 }
 
 u8 PerformStencilAction(FramebufferRegs::StencilAction action, u8 old_stencil, u8 ref) {
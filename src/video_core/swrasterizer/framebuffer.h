@@ -7,16 +7,164 @@
 #include "common/common_types.h"
 #include "common/vector_math.h"
 #include "video_core/regs_framebuffer.h"
+#include "video_core/utils.h"
 
 namespace Pica {
 namespace Rasterizer {
 
-void DrawPixel(int x, int y, const Math::Vec4<u8>& color);
-const Math::Vec4<u8> GetPixel(int x, int y);
-u32 GetDepth(int x, int y);
-u8 GetStencil(int x, int y);
-void SetDepth(int x, int y, u32 value);
-void SetStencil(int x, int y, u8 value);
+/**
+ * Accesses the pixels of the color and depth/stencil buffers of a render target. The buffer
+ * addresses and the conversion functions of the pixel formats are resolved once when it is built
+ * from the registers, hence an access only has to compute the offset of the pixel.
+ *
+ * Pixel coordinates are those of the rasterizer, i.e. the buffers are stored upside down.
+ */
+class Framebuffer {
+public:
+    Framebuffer() = default;
+    /// Unsupported formats are silently treated as black and zero depth, see CheckFormats
+    explicit Framebuffer(const FramebufferRegs::FramebufferConfig& config);
+
+    /**
+     * Reports color and depth formats of the configuration that are not supported. This is done
+     * separately from building a Framebuffer, which happens whenever any register changes, so
+     * that it can be limited to changes of the framebuffer configuration.
+     */
+    static void CheckFormats(const FramebufferRegs::FramebufferConfig& config);
+
+    Math::Vec4<u8> GetPixel(unsigned x, unsigned y) const {
+        return decode_color(GetColorPointer(x, y));
+    }
+
+    void DrawPixel(unsigned x, unsigned y, const Math::Vec4<u8>& color) const {
+        encode_color(color, GetColorPointer(x, y));
+    }
+
+    u32 GetDepth(unsigned x, unsigned y) const {
+        return decode_depth(GetDepthPointer(x, y));
+    }
+
+    void SetDepth(unsigned x, unsigned y, u32 value) const {
+        encode_depth(value, GetDepthPointer(x, y));
+    }
+
+    u8 GetStencil(unsigned x, unsigned y) const {
+        return decode_stencil(GetDepthPointer(x, y));
+    }
+
+    void SetStencil(unsigned x, unsigned y, u8 value) const {
+        encode_stencil(value, GetDepthPointer(x, y));
+    }
+
+    /// Returns the remainder modulo 8 of the y coordinates at which rows of 8x8 tiles begin
+    unsigned GetTileRowPhase() const {
+        return (height + 1) % 8;
+    }
+
+private:
+    friend class FramebufferTileCache;
+
+    using ColorDecoder = const Math::Vec4<u8> (*)(const u8* bytes);
+    using ColorEncoder = void (*)(const Math::Vec4<u8>& color, u8* bytes);
+    using DepthDecoder = u32 (*)(const u8* bytes);
+    using DepthEncoder = void (*)(u32 value, u8* bytes);
+    using StencilDecoder = u8 (*)(const u8* bytes);
+    using StencilEncoder = void (*)(u8 value, u8* bytes);
+
+    /// Returns the offset of the 8x8 tile containing the pixel, in pixels
+    unsigned GetTileOffset(unsigned x, unsigned y) const {
+        y = height - y;
+        return (x & ~7) * 8 + (y & ~7) * width;
+    }
+
+    /// Returns the index of the pixel within its tile, in which pixels are stored in Morton order
+    unsigned GetIndexInTile(unsigned x, unsigned y) const {
+        return VideoCore::MortonInterleave(x, height - y);
+    }
+
+    u8* GetColorPointer(unsigned x, unsigned y) const {
+        return color_buffer +
+               (GetTileOffset(x, y) + GetIndexInTile(x, y)) * color_bytes_per_pixel;
+    }
+
+    u8* GetDepthPointer(unsigned x, unsigned y) const {
+        return depth_buffer +
+               (GetTileOffset(x, y) + GetIndexInTile(x, y)) * depth_bytes_per_pixel;
+    }
+
+    u8* color_buffer = nullptr;
+    u8* depth_buffer = nullptr;
+
+    unsigned width = 0;
+    /// Height minus one, as stored in the register
+    unsigned height = 0;
+
+    unsigned color_bytes_per_pixel = 0;
+    unsigned depth_bytes_per_pixel = 0;
+
+    ColorDecoder decode_color = nullptr;
+    ColorEncoder encode_color = nullptr;
+    DepthDecoder decode_depth = nullptr;
+    DepthEncoder encode_depth = nullptr;
+    StencilDecoder decode_stencil = nullptr;
+    StencilEncoder encode_stencil = nullptr;
+};
+
+/**
+ * Keeps the pixels of one 8x8 tile of a framebuffer in decoded form while it is being drawn to.
+ * Pixels are read from memory when first accessed, and the modified ones are written back when a
+ * pixel of another tile is accessed or when Flush is called. Rasterizing a triangle tile by tile
+ * hence converts each pixel at most once per buffer, however often it is tested and updated.
+ *
+ * Only modified pixels are written back, so caches of different threads may share a tile as long
+ * as they access distinct pixels of it.
+ */
+class FramebufferTileCache {
+public:
+    explicit FramebufferTileCache(const Framebuffer& framebuffer) : framebuffer(framebuffer) {}
+
+    Math::Vec4<u8> GetPixel(unsigned x, unsigned y);
+    void DrawPixel(unsigned x, unsigned y, const Math::Vec4<u8>& color);
+    u32 GetDepth(unsigned x, unsigned y);
+    void SetDepth(unsigned x, unsigned y, u32 value);
+    u8 GetStencil(unsigned x, unsigned y);
+    void SetStencil(unsigned x, unsigned y, u8 value);
+
+    /// Writes all modified pixels back to memory. Must be called before the framebuffer is
+    /// accessed by other means.
+    void Flush();
+
+private:
+    /// Makes the tile containing the pixel the cached one and returns the index of the pixel in it
+    unsigned SelectTile(unsigned x, unsigned y);
+
+    u8* GetColorPointer(unsigned index) const {
+        return framebuffer.color_buffer + (tile_offset + index) * framebuffer.color_bytes_per_pixel;
+    }
+
+    u8* GetDepthPointer(unsigned index) const {
+        return framebuffer.depth_buffer + (tile_offset + index) * framebuffer.depth_bytes_per_pixel;
+    }
+
+    const Framebuffer& framebuffer;
+
+    /// Offset of the cached tile as returned by Framebuffer::GetTileOffset, or ~0 if there is none
+    unsigned tile_offset = ~0u;
+
+    // For each buffer, bit i of the masks tells whether pixel i has been read and whether it has
+    // been modified, respectively.
+    u64 color_loaded = 0;
+    u64 color_dirty = 0;
+    u64 depth_loaded = 0;
+    u64 depth_dirty = 0;
+    u64 stencil_loaded = 0;
+    u64 stencil_dirty = 0;
+
+    Math::Vec4<u8> color[64];
+    u32 depth[64];
+    u8 stencil[64];
+};
+
 u8 PerformStencilAction(FramebufferRegs::StencilAction action, u8 old_stencil, u8 ref);
 
 Math::Vec4<u8> EvaluateBlendEquation(const Math::Vec4<u8>& src, const Math::Vec4<u8>& srcfactor,
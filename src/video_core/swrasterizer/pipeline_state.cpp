@@ -0,0 +1,68 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "video_core/regs.h"
+#include "video_core/swrasterizer/pipeline_state.h"
+
+namespace Pica {
+namespace Rasterizer {
+
+PipelineState PipelineState::FromRegisters(const Regs& regs) {
+    PipelineState state;
+    const auto& output_merger = regs.framebuffer.output_merger;
+
+    state.framebuffer = Framebuffer(regs.framebuffer.framebuffer);
+
+    if (!regs.lighting.disable)
+        state.features |= Lighting;
+
+    if (output_merger.alpha_test.enable &&
+        output_merger.alpha_test.func != FramebufferRegs::CompareFunc::Always)
+        state.features |= AlphaTest;
+
+    if (regs.texturing.fog_mode == TexturingRegs::FogMode::Fog)
+        state.features |= Fog;
+
+    if (output_merger.stencil_test.enable &&
+        regs.framebuffer.framebuffer.depth_format == FramebufferRegs::DepthFormat::D24S8)
+        state.features |= StencilTest;
+
+    if (output_merger.depth_test_enable &&
+        output_merger.depth_test_func != FramebufferRegs::CompareFunc::Always)
+        state.features |= DepthTest;
+
+    // Additive blending with factors One and Zero as well as the Copy logic operation write the
+    // source color unmodified, so the framebuffer only needs to be read for other configurations.
+    bool writes_source_color;
+    if (output_merger.alphablend_enable) {
+        const auto& params = output_merger.alpha_blending;
+        writes_source_color =
+            params.blend_equation_rgb == FramebufferRegs::BlendEquation::Add &&
+            params.blend_equation_a == FramebufferRegs::BlendEquation::Add &&
+            params.factor_source_rgb == FramebufferRegs::BlendFactor::One &&
+            params.factor_source_a == FramebufferRegs::BlendFactor::One &&
+            params.factor_dest_rgb == FramebufferRegs::BlendFactor::Zero &&
+            params.factor_dest_a == FramebufferRegs::BlendFactor::Zero;
+    } else {
+        writes_source_color = output_merger.logic_op == FramebufferRegs::LogicOp::Copy;
+    }
+
+    const bool writes_all_channels = output_merger.red_enable && output_merger.green_enable &&
+                                     output_merger.blue_enable && output_merger.alpha_enable;
+
+    if (!writes_source_color || !writes_all_channels)
+        state.features |= DestinationRead;
+
+    // Stages at the end of the chain that only forward the previous result have no effect. The
+    // first stage is always kept since it defines the initial combiner output.
+    const auto tev_stages = regs.texturing.GetTevStages();
+    state.num_tev_stages = static_cast<unsigned>(tev_stages.size());
+    while (state.num_tev_stages > 1 && tev_stages[state.num_tev_stages - 1].IsPassThrough())
+        --state.num_tev_stages;
+
+    return state;
+}
+
+} // namespace Rasterizer
+} // namespace Pica
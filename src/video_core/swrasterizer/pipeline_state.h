@@ -0,0 +1,62 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common_types.h"
+#include "video_core/swrasterizer/framebuffer.h"
+
+namespace Pica {
+
+struct Regs;
+
+namespace Rasterizer {
+
+struct DecodedTexture;
+class FragmentJit;
+
+/**
+ * Summarizes which parts of the fragment pipeline are active for the current PICA configuration.
+ * It is derived from the registers once per draw and used as a key to select a rasterizer
+ * specialization that has all disabled stages compiled out, so the per-pixel code does not need to
+ * branch on them.
+ */
+struct PipelineState {
+    enum Feature : u32 {
+        Lighting = 1 << 0,
+        /// Alpha test with a comparison function other than Always
+        AlphaTest = 1 << 1,
+        Fog = 1 << 2,
+        /// Stencil test enabled on a framebuffer with a stencil buffer
+        StencilTest = 1 << 3,
+        /// Depth test with a comparison function other than Always
+        DepthTest = 1 << 4,
+        /// Blending, logic operation or color write mask that depends on the framebuffer color
+        DestinationRead = 1 << 5,
+    };
+
+    /// Number of distinct values of the feature mask
+    static constexpr u32 NUM_FEATURE_COMBINATIONS = 1 << 6;
+
+    /// Derives the pipeline state from the given register configuration
+    static PipelineState FromRegisters(const Regs& regs);
+
+    /// Combination of Feature flags
+    u32 features = 0;
+
+    /// Number of TEV stages to evaluate, excluding trailing stages that just pass through
+    unsigned num_tev_stages = 6;
+
+    /// Compiled TEV and blend stages, or nullptr if they are interpreted
+    const FragmentJit* jit = nullptr;
+
+    /// Decoded texels of the enabled texture units 0-2, or nullptr if they are sampled directly
+    const DecodedTexture* textures[3] = {};
+
+    /// The render target
+    Framebuffer framebuffer;
+};
+
+} // namespace Rasterizer
+} // namespace Pica
@@ -4,12 +4,16 @@
 
 #pragma once
 
+#include "common/common_types.h"
+#include "common/math_util.h"
 #include "video_core/shader/shader.h"
 
 namespace Pica {
 
 namespace Rasterizer {
 
+struct PipelineState;
+
 struct Vertex : Shader::OutputVertex {
     Vertex(const OutputVertex& v) : OutputVertex(v) {}
 
@@ -43,7 +47,23 @@ struct Vertex : Shader::OutputVertex {
     }
 };
 
-void ProcessTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2);
+/// Largest pixel coordinate representable in the rasterizer's 12.4 fixed-point format
+constexpr u16 MAX_COORDINATE = 0xFFF;
+
+/**
+ * Rasterizes a triangle.
+ * @param state Fragment pipeline state derived from the current register configuration
+ */
+void ProcessTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2,
+                     const PipelineState& state);
+
+/**
+ * Rasterizes a triangle, only touching the pixels inside the given region. The region is given in
+ * whole pixels of the rasterizer coordinate system (i.e. before flipping the framebuffer
+ * vertically), with exclusive right and bottom bounds.
+ */
+void ProcessTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2,
+                     const MathUtil::Rectangle<u16>& region, const PipelineState& state);
 
 } // namespace Rasterizer
 
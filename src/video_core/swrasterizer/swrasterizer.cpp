@@ -2,14 +2,152 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include "common/thread_pool.h"
+#include "core/settings.h"
+#include "video_core/pica_state.h"
+#include "video_core/swrasterizer/binner.h"
 #include "video_core/swrasterizer/clipper.h"
+#ifdef ARCHITECTURE_x86_64
+#include "video_core/swrasterizer/fragment_jit_x64.h"
+#endif
+#include "video_core/swrasterizer/rasterizer.h"
 #include "video_core/swrasterizer/swrasterizer.h"
+#include "video_core/swrasterizer/texture_cache.h"
+#include "video_core/video_core.h"
 
 namespace VideoCore {
 
+SWRasterizer::SWRasterizer() {
+    if (Settings::values.sw_rasterizer_threads != 1) {
+        thread_pool = std::make_unique<Common::ThreadPool>(
+            static_cast<size_t>(Settings::values.sw_rasterizer_threads), "SWRasterizer");
+        binner = std::make_unique<Pica::Rasterizer::TileBinner>(*thread_pool);
+    }
+    texture_cache = std::make_unique<Pica::Rasterizer::TextureCache>(thread_pool.get());
+#ifdef ARCHITECTURE_x86_64
+    fragment_jit_cache = std::make_unique<Pica::Rasterizer::FragmentJitCache>();
+#endif
+}
+
+SWRasterizer::~SWRasterizer() {
+    FlushTriangles();
+}
+
 void SWRasterizer::AddTriangle(const Pica::Shader::OutputVertex& v0,
                                const Pica::Shader::OutputVertex& v1,
                                const Pica::Shader::OutputVertex& v2) {
-    Pica::Clipper::ProcessTriangle(v0, v1, v2);
+    queued_vertices.push_back(v0);
+    queued_vertices.push_back(v1);
+    queued_vertices.push_back(v2);
+}
+
+void SWRasterizer::DrawTriangles() {
+    FlushTriangles();
+
+    // The rasterizer writes to memory directly, so textures rendered to are invalidated here
+    const auto& framebuffer = Pica::g_state.regs.framebuffer.framebuffer;
+    const u32 num_pixels = framebuffer.GetWidth() * framebuffer.GetHeight();
+    texture_cache->InvalidateRegion(
+        framebuffer.GetColorBufferPhysicalAddress(),
+        num_pixels * Pica::FramebufferRegs::BytesPerColorPixel(framebuffer.color_format));
+    texture_cache->InvalidateRegion(
+        framebuffer.GetDepthBufferPhysicalAddress(),
+        num_pixels * Pica::FramebufferRegs::BytesPerDepthPixel(framebuffer.depth_format));
+    pipeline_state_dirty = true;
+}
+
+void SWRasterizer::NotifyPicaRegistersChanging() {
+    // Triangles are only ever queued after syncing the registers, by the register write that
+    // triggers a draw (or submits an immediate-mode vertex), which does not affect rendering state
+    // itself. Flushing here hence rasterizes every batch with the exact state it was submitted
+    // with, before any further register write can modify it.
+    FlushTriangles();
+
+    pipeline_state_dirty = true;
+}
+
+void SWRasterizer::SyncPicaRegisters(const Pica::DirtyGroupSet& dirty) {
+    pipeline_state_dirty = true;
+}
+
+void SWRasterizer::FlushAll() {
+    FlushTriangles();
+}
+
+void SWRasterizer::FlushRegion(PAddr addr, u32 size) {
+    FlushTriangles();
+}
+
+void SWRasterizer::FlushAndInvalidateRegion(PAddr addr, u32 size) {
+    FlushTriangles();
+
+    texture_cache->InvalidateRegion(addr, size);
+    pipeline_state_dirty = true;
+}
+
+void SWRasterizer::NotifyGPUThreadIdle() {
+    texture_cache->VerifyDeferredTextures();
+}
+
+void SWRasterizer::UpdatePipelineState() {
+    const auto& regs = Pica::g_state.regs;
+
+    const auto& framebuffer = regs.framebuffer.framebuffer;
+    if (framebuffer.color_format != checked_color_format ||
+        framebuffer.depth_format != checked_depth_format) {
+        Pica::Rasterizer::Framebuffer::CheckFormats(framebuffer);
+        checked_color_format = framebuffer.color_format;
+        checked_depth_format = framebuffer.depth_format;
+    }
+
+    pipeline_state = Pica::Rasterizer::PipelineState::FromRegisters(regs);
+
+    // Nothing references cached textures anymore, as all triangles have been rasterized
+    texture_cache->Trim();
+    const auto textures = regs.texturing.GetTextures();
+    for (unsigned i = 0; i < 3; ++i) {
+        if (!textures[i].enabled)
+            continue;
+        const auto info = Pica::Texture::TextureInfo::FromPicaRegister(textures[i].config,
+                                                                       textures[i].format);
+        pipeline_state.textures[i] = texture_cache->Get(info);
+    }
+
+#ifdef ARCHITECTURE_x86_64
+    if (VideoCore::g_fragment_jit_enabled) {
+        pipeline_state.jit = fragment_jit_cache->Get(
+            Pica::Rasterizer::FragmentJitConfig::FromRegisters(regs, pipeline_state));
+    }
+#endif
+}
+
+void SWRasterizer::FlushTriangles() {
+    using Pica::Rasterizer::Vertex;
+
+    if (!queued_vertices.empty()) {
+        if (pipeline_state_dirty) {
+            UpdatePipelineState();
+            pipeline_state_dirty = false;
+        }
+
+        const size_t num_triangles = queued_vertices.size() / 3;
+        if (binner) {
+            Pica::Clipper::ProcessTriangles(
+                queued_vertices.data(), num_triangles,
+                [this](const Vertex& vtx0, const Vertex& vtx1, const Vertex& vtx2) {
+                    binner->AddTriangle(vtx0, vtx1, vtx2, pipeline_state);
+                });
+        } else {
+            Pica::Clipper::ProcessTriangles(
+                queued_vertices.data(), num_triangles,
+                [this](const Vertex& vtx0, const Vertex& vtx1, const Vertex& vtx2) {
+                    Pica::Rasterizer::ProcessTriangle(vtx0, vtx1, vtx2, pipeline_state);
+                });
+        }
+        queued_vertices.clear();
+    }
+
+    if (binner && binner->HasPendingTriangles())
+        binner->Flush();
 }
 }
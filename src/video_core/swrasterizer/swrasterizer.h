@@ -4,24 +4,79 @@
 
 #pragma once
 
+#include <memory>
+#include <vector>
 #include "common/common_types.h"
 #include "video_core/rasterizer_interface.h"
+#include "video_core/regs_framebuffer.h"
+#include "video_core/shader/shader.h"
+#include "video_core/swrasterizer/pipeline_state.h"
+
+namespace Common {
+class ThreadPool;
+}
 
 namespace Pica {
-namespace Shader {
-struct OutputVertex;
+namespace Rasterizer {
+class FragmentJitCache;
+class TextureCache;
+class TileBinner;
 }
 }
 
 namespace VideoCore {
 
 class SWRasterizer : public RasterizerInterface {
+public:
+    SWRasterizer();
+    ~SWRasterizer() override;
+
     void AddTriangle(const Pica::Shader::OutputVertex& v0, const Pica::Shader::OutputVertex& v1,
                      const Pica::Shader::OutputVertex& v2) override;
-    void DrawTriangles() override {}
-    void NotifyPicaRegisterChanged(u32 id) override {}
-    void FlushAll() override {}
-    void FlushRegion(PAddr addr, u32 size) override {}
-    void FlushAndInvalidateRegion(PAddr addr, u32 size) override {}
+    void DrawTriangles() override;
+    void NotifyPicaRegistersChanging() override;
+    void SyncPicaRegisters(const Pica::DirtyGroupSet& dirty) override;
+    void FlushAll() override;
+    void FlushRegion(PAddr addr, u32 size) override;
+    void FlushAndInvalidateRegion(PAddr addr, u32 size) override;
+
+    bool SupportsGPUThread() const override {
+        return true;
+    }
+
+    void NotifyGPUThreadIdle() override;
+
+private:
+    /// Derives the pipeline state from the current register configuration
+    void UpdatePipelineState();
+
+    /// Clips and rasterizes all queued triangles and returns once they have been drawn
+    void FlushTriangles();
+
+    /// Triangles submitted since the last flush, three consecutive vertices per triangle. They
+    /// are all clipped in one batch since they share the same register configuration.
+    std::vector<Pica::Shader::OutputVertex> queued_vertices;
+
+    /// Only used when rasterizing with multiple threads, shared with texture decoding
+    std::unique_ptr<Common::ThreadPool> thread_pool;
+    std::unique_ptr<Pica::Rasterizer::TileBinner> binner;
+
+    /// Decoded textures sampled by the rasterizer
+    std::unique_ptr<Pica::Rasterizer::TextureCache> texture_cache;
+
+    /// Fragment pipeline state of the current register configuration, rebuilt lazily
+    Pica::Rasterizer::PipelineState pipeline_state;
+    bool pipeline_state_dirty = true;
+
+    /// Framebuffer formats that were last checked for support, starting out with supported ones
+    Pica::FramebufferRegs::ColorFormat checked_color_format =
+        Pica::FramebufferRegs::ColorFormat::RGBA8;
+    Pica::FramebufferRegs::DepthFormat checked_depth_format =
+        Pica::FramebufferRegs::DepthFormat::D16;
+
+#ifdef ARCHITECTURE_x86_64
+    /// Compiled fragment programs, indexed by their configuration
+    std::unique_ptr<Pica::Rasterizer::FragmentJitCache> fragment_jit_cache;
+#endif
 };
 }
@@ -0,0 +1,126 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "common/hash.h"
+#include "common/microprofile.h"
+#include "core/hw/gpu.h"
+#include "core/memory.h"
+#include "video_core/swrasterizer/texture_cache.h"
+
+namespace Pica {
+namespace Rasterizer {
+
+/// Decoded texels are released once they take up more memory than this
+constexpr size_t MAX_CACHED_SIZE = 64 * 1024 * 1024;
+
+MICROPROFILE_DEFINE(GPU_TextureDecode, "GPU", "Texture Decode", MP_RGB(100, 100, 255));
+
+size_t TextureCache::KeyHash::operator()(const Key& key) const {
+    return Common::ComputeHash64(&key, sizeof(Key));
+}
+
+TextureCache::~TextureCache() {
+    for (auto& pair : cache)
+        Invalidate(pair.second);
+}
+
+const DecodedTexture* TextureCache::Get(const Texture::TextureInfo& info) {
+    // Textures are made up of 8x8 tiles, anything else is left to the regular lookup
+    if (info.format > TexturingRegs::TextureFormat::ETC1A4 || info.width == 0 ||
+        info.height == 0 || info.width % 8 != 0 || info.height % 8 != 0 ||
+        info.stride != static_cast<ptrdiff_t>(Texture::CalculateTileSize(info.format) *
+                                              (info.width / 8))) {
+        return nullptr;
+    }
+
+    const Key key = {info.physical_address, info.width, info.height, info.format};
+    Entry& entry = cache[key];
+    if (entry.valid)
+        return &entry.texture;
+
+    const u8* source = Memory::GetPhysicalPointer(info.physical_address);
+    if (source == nullptr)
+        return nullptr;
+
+    const u32 size = static_cast<u32>(info.stride * (info.height / 8));
+    const u64 hash = Common::ComputeHash64(source, size);
+
+    // A texture seen for the first time has no texels yet
+    if (entry.texture.texels.empty() || hash != entry.hash) {
+        MICROPROFILE_SCOPE(GPU_TextureDecode);
+
+        if (entry.texture.texels.empty()) {
+            entry.texture.info = info;
+            entry.texture.texels.resize(info.width * info.height);
+            entry.size = size;
+            cached_size += entry.texture.texels.size() * sizeof(Math::Vec4<u8>);
+        }
+        Texture::DecodeTexture(info, source, entry.texture.texels.data(), info.width, pool);
+        entry.hash = hash;
+    }
+
+    Memory::RasterizerMarkRegionCached(info.physical_address, entry.size, 1);
+    entry.valid = true;
+    if (GPU::IsGPUThread())
+        deferred_textures.push_back(key);
+    return &entry.texture;
+}
+
+void TextureCache::InvalidateRegion(PAddr addr, u32 size) {
+    for (auto& pair : cache) {
+        Entry& entry = pair.second;
+        const PAddr entry_addr = pair.first.address;
+        if (entry.valid && addr < entry_addr + entry.size && entry_addr < addr + size)
+            Invalidate(entry);
+    }
+}
+
+void TextureCache::Trim() {
+    if (cached_size <= MAX_CACHED_SIZE)
+        return;
+
+    // Textures that have been modified are the least likely to be used again
+    for (auto it = cache.begin(); it != cache.end();) {
+        if (!it->second.valid) {
+            cached_size -= it->second.texture.texels.size() * sizeof(Math::Vec4<u8>);
+            it = cache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (cached_size <= MAX_CACHED_SIZE)
+        return;
+
+    for (auto& pair : cache)
+        Invalidate(pair.second);
+    cache.clear();
+    cached_size = 0;
+}
+
+void TextureCache::VerifyDeferredTextures() {
+    for (const Key& key : deferred_textures) {
+        // Textures may have been invalidated or trimmed since
+        auto iter = cache.find(key);
+        if (iter == cache.end() || !iter->second.valid)
+            continue;
+
+        Entry& entry = iter->second;
+        const u8* source = Memory::GetPhysicalPointer(key.address);
+        if (source == nullptr || Common::ComputeHash64(source, entry.size) != entry.hash)
+            Invalidate(entry);
+    }
+    deferred_textures.clear();
+}
+
+void TextureCache::Invalidate(Entry& entry) {
+    if (!entry.valid)
+        return;
+
+    Memory::RasterizerMarkRegionCached(entry.texture.info.physical_address, entry.size, -1);
+    entry.valid = false;
+}
+
+} // namespace Rasterizer
+} // namespace Pica
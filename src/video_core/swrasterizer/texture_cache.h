@@ -0,0 +1,116 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+#include "common/common_types.h"
+#include "common/vector_math.h"
+#include "video_core/regs_texturing.h"
+#include "video_core/texture/texture_decode.h"
+
+namespace Common {
+class ThreadPool;
+}
+
+namespace Pica {
+namespace Rasterizer {
+
+/// A texture decoded to linear RGBA8 texels
+struct DecodedTexture {
+    Texture::TextureInfo info;
+
+    /// Texels in the coordinate space of Texture::LookupTexture, row by row
+    std::vector<Math::Vec4<u8>> texels;
+
+    Math::Vec4<u8> Lookup(unsigned int x, unsigned int y) const {
+        return texels[y * info.width + x];
+    }
+};
+
+/**
+ * Keeps the textures sampled by the software rasterizer in decoded form, so that a texture only
+ * has to go through Morton deinterleaving and format conversion once rather than for every sample.
+ *
+ * Cached textures are registered with Memory::RasterizerMarkRegionCached, hence any write to their
+ * memory reaches InvalidateRegion through the rasterizer's FlushAndInvalidateRegion hook. An
+ * invalidated texture keeps its decoded texels along with a hash of the data they were decoded
+ * from: if the data turns out unchanged on the next use, it is revalidated without decoding.
+ *
+ * On the GPU thread, marking regions as cached is deferred until the emulation thread
+ * synchronizes, so textures that became valid there are checked again at that point.
+ */
+class TextureCache {
+public:
+    /// @param pool If not null, threads that large textures are decoded with
+    explicit TextureCache(Common::ThreadPool* pool = nullptr) : pool(pool) {}
+    ~TextureCache();
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    /**
+     * Returns the decoded texture, decoding it if it is not cached or was modified.
+     * The result remains valid until the next call to Trim.
+     * @return The decoded texture, or nullptr if the texture can not be cached
+     */
+    const DecodedTexture* Get(const Texture::TextureInfo& info);
+
+    /// Marks all textures that overlap the given region as modified
+    void InvalidateRegion(PAddr addr, u32 size);
+
+    /// Releases textures if the cache has grown too large. Invalidates all pointers from Get.
+    void Trim();
+
+    /**
+     * Rechecks the textures decoded or revalidated on the GPU thread, whose memory was not yet
+     * marked as cached while it was running, and invalidates those that have been modified since.
+     * Must be called on the emulation thread after the deferred marks have been applied.
+     */
+    void VerifyDeferredTextures();
+
+private:
+    struct Key {
+        PAddr address;
+        u32 width;
+        u32 height;
+        TexturingRegs::TextureFormat format;
+
+        bool operator==(const Key& other) const {
+            return address == other.address && width == other.width && height == other.height &&
+                   format == other.format;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+        DecodedTexture texture;
+        /// Size of the encoded texture in emulated memory
+        u32 size = 0;
+        /// Hash of the encoded texture data the texels were decoded from
+        u64 hash = 0;
+        /// Whether the memory region is registered as cached, i.e. the texels are up to date
+        bool valid = false;
+    };
+
+    void Invalidate(Entry& entry);
+
+    Common::ThreadPool* pool;
+
+    std::unordered_map<Key, Entry, KeyHash> cache;
+
+    /// Total size of all decoded texels in bytes
+    size_t cached_size = 0;
+
+    /// Textures that became valid on the GPU thread since the last VerifyDeferredTextures
+    std::vector<Key> deferred_textures;
+};
+
+} // namespace Rasterizer
+} // namespace Pica
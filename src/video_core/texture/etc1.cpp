@@ -23,8 +23,8 @@ union ETC1Tile {
     u64 raw;
 
     // Each of these two is a collection of 16 bits (one per lookup value)
-    BitField<0, 16, u64> table_subindexes;
-    BitField<16, 16, u64> negation_flags;
+    BitField<ETC1_TABLE_SUBINDEX_SHIFT, 16, u64> table_subindexes;
+    BitField<ETC1_NEGATION_FLAG_SHIFT, 16, u64> negation_flags;
 
     unsigned GetTableSubIndex(unsigned index) const {
         return (table_subindexes >> index) & 1;
@@ -34,7 +34,7 @@ union ETC1Tile {
         return ((negation_flags >> index) & 1) == 1;
     }
 
-    BitField<32, 1, u64> flip;
+    BitField<ETC1_FLIP_SHIFT, 1, u64> flip;
     BitField<33, 1, u64> differential_mode;
 
     BitField<34, 3, u64> table_index_2;
@@ -63,19 +63,14 @@ union ETC1Tile {
         BitField<60, 4, u64> r1;
     } separate;
 
-    const Math::Vec3<u8> GetRGB(unsigned int x, unsigned int y) const {
-        int texel = 4 * x + y;
-
-        if (flip)
-            std::swap(x, y);
-
-        // Lookup base value
+    /// Base color of the left (or, if flipped, bottom) half for index 0 and the other for index 1
+    Math::Vec3<int> GetBaseColor(unsigned int half) const {
         Math::Vec3<int> ret;
         if (differential_mode) {
             ret.r() = static_cast<int>(differential.r);
             ret.g() = static_cast<int>(differential.g);
             ret.b() = static_cast<int>(differential.b);
-            if (x >= 2) {
+            if (half == 1) {
                 ret.r() += static_cast<int>(differential.dr);
                 ret.g() += static_cast<int>(differential.dg);
                 ret.b() += static_cast<int>(differential.db);
@@ -84,7 +79,7 @@ union ETC1Tile {
             ret.g() = Color::Convert5To8(ret.g());
             ret.b() = Color::Convert5To8(ret.b());
         } else {
-            if (x < 2) {
+            if (half == 0) {
                 ret.r() = Color::Convert4To8(static_cast<u8>(separate.r1));
                 ret.g() = Color::Convert4To8(static_cast<u8>(separate.g1));
                 ret.b() = Color::Convert4To8(static_cast<u8>(separate.b1));
@@ -94,6 +89,17 @@ union ETC1Tile {
                 ret.b() = Color::Convert4To8(static_cast<u8>(separate.b2));
             }
         }
+        return ret;
+    }
+
+    const Math::Vec3<u8> GetRGB(unsigned int x, unsigned int y) const {
+        int texel = 4 * x + y;
+
+        if (flip)
+            std::swap(x, y);
+
+        // Lookup base value
+        Math::Vec3<int> ret = GetBaseColor(x < 2 ? 0 : 1);
 
         // Add modifier
         unsigned table_index =
@@ -118,5 +124,39 @@ Math::Vec3<u8> SampleETC1Subtile(u64 value, unsigned int x, unsigned int y) {
     return tile.GetRGB(x, y);
 }
 
+void GetETC1SubtileHalves(u64 value, ETC1SubtileHalf* halves) {
+    const ETC1Tile tile{value};
+    for (unsigned int half = 0; half < 2; ++half) {
+        const Math::Vec3<int> base_color = tile.GetBaseColor(half);
+        const auto& modifiers =
+            etc1_modifier_table[half == 0 ? tile.table_index_1 : tile.table_index_2];
+        halves[half] = {{static_cast<u8>(base_color.r()), static_cast<u8>(base_color.g()),
+                         static_cast<u8>(base_color.b())},
+                        {modifiers[0], modifiers[1]}};
+    }
+}
+
+void DecodeETC1Subtile(u64 value, Math::Vec3<u8>* texels) {
+    const ETC1Tile tile{value};
+    ETC1SubtileHalf halves[2];
+    GetETC1SubtileHalves(value, halves);
+
+    for (unsigned int y = 0; y < 4; ++y) {
+        for (unsigned int x = 0; x < 4; ++x) {
+            const unsigned int texel = 4 * x + y;
+            const ETC1SubtileHalf& half = halves[((tile.flip ? y : x) < 2) ? 0 : 1];
+
+            int modifier = half.modifiers[tile.GetTableSubIndex(texel)];
+            if (tile.GetNegationFlag(texel))
+                modifier *= -1;
+
+            const u8* base = half.base_color;
+            texels[x + 4 * y] = {static_cast<u8>(MathUtil::Clamp(base[0] + modifier, 0, 255)),
+                                 static_cast<u8>(MathUtil::Clamp(base[1] + modifier, 0, 255)),
+                                 static_cast<u8>(MathUtil::Clamp(base[2] + modifier, 0, 255))};
+        }
+    }
+}
+
 } // namespace Texture
 } // namespace Pica
@@ -12,5 +12,38 @@ namespace Texture {
 
 Math::Vec3<u8> SampleETC1Subtile(u64 value, unsigned int x, unsigned int y);
 
+/**
+ * The parameters shared by all texels of one half of an ETC1 subtile. The texel at x, y belongs to
+ * half 0 if x < 2 (or y < 2 for flipped subtiles) and to half 1 otherwise.
+ *
+ * This is plain data, as it is used by decoders that are compiled for other instruction sets and
+ * must not call inline functions of shared headers.
+ */
+struct ETC1SubtileHalf {
+    /// R, G and B components of the base color
+    u8 base_color[3];
+    /// Magnitudes of the modifiers selected by the table subindex of a texel
+    u8 modifiers[2];
+};
+
+/// Stores the parameters of both halves of the subtile in halves[0] and halves[1]
+void GetETC1SubtileHalves(u64 value, ETC1SubtileHalf* halves);
+
+// Layout of the per-texel fields of a subtile, for decoders that extract them directly. Texels are
+// numbered 4 * x + y.
+
+/// Bit of the first texel's table subindex, the other texels follow
+constexpr unsigned int ETC1_TABLE_SUBINDEX_SHIFT = 0;
+/// Bit of the first texel's negation flag, the other texels follow
+constexpr unsigned int ETC1_NEGATION_FLAG_SHIFT = 16;
+/// Bit that is set if the halves of a subtile are split horizontally
+constexpr unsigned int ETC1_FLIP_SHIFT = 32;
+
+/**
+ * Decodes all texels of a 4x4 ETC1 subtile at once.
+ * @param texels Receives the 16 texels, indexed by x + 4 * y
+ */
+void DecodeETC1Subtile(u64 value, Math::Vec3<u8>* texels);
+
 } // namespace Texture
 } // namespace Pica
@@ -2,17 +2,26 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include "common/assert.h"
 #include "common/color.h"
 #include "common/logging/log.h"
 #include "common/math_util.h"
 #include "common/swap.h"
+#include "common/thread_pool.h"
 #include "common/vector_math.h"
 #include "video_core/regs_texturing.h"
 #include "video_core/texture/etc1.h"
 #include "video_core/texture/texture_decode.h"
+#include "video_core/texture/texture_decode_x64.h"
 #include "video_core/utils.h"
 
+#ifdef ARCHITECTURE_x86_64
+#include "common/x64/cpu_detect.h"
+#endif
+
 using TextureFormat = Pica::TexturingRegs::TextureFormat;
 
 namespace Pica {
@@ -21,6 +30,9 @@ namespace Texture {
 constexpr size_t TILE_SIZE = 8 * 8;
 constexpr size_t ETC1_SUBTILES = 2 * 2;
 
+/// Textures smaller than this are always decoded on the calling thread
+constexpr unsigned int MIN_PARALLEL_DECODE_TEXELS = 128 * 128;
+
 size_t CalculateTileSize(TextureFormat format) {
     switch (format) {
     case TextureFormat::RGBA8:
@@ -212,6 +224,197 @@ Math::Vec4<u8> LookupTexelInTile(const u8* source, unsigned int x, unsigned int
     }
 }
 
+template <TextureFormat format>
+static void DecodeTileGeneric(const u8* source, u32* texels) {
+    TextureInfo info;
+    info.format = format;
+    for (unsigned int y = 0; y < 8; ++y) {
+        for (unsigned int x = 0; x < 8; ++x) {
+            const Math::Vec4<u8> texel = LookupTexelInTile(source, x, y, info, false);
+            std::memcpy(&texels[VideoCore::MortonInterleave(x, y)], &texel, sizeof(u32));
+        }
+    }
+}
+
+template <bool has_alpha>
+static void DecodeETC1Tile(const u8* source, u32* texels) {
+    constexpr size_t subtile_size = has_alpha ? 16 : 8;
+
+    // The four 4x4 subtiles are stored in the same order as the quadrants of a Morton-order tile
+    for (unsigned int subtile = 0; subtile < ETC1_SUBTILES; ++subtile) {
+        const u8* subtile_ptr = source + subtile * subtile_size;
+
+        u64_le packed_alpha = 0;
+        if (has_alpha) {
+            memcpy(&packed_alpha, subtile_ptr, sizeof(u64));
+            subtile_ptr += sizeof(u64);
+        }
+
+        u64_le subtile_data;
+        memcpy(&subtile_data, subtile_ptr, sizeof(u64));
+
+        Math::Vec3<u8> colors[16];
+        DecodeETC1Subtile(subtile_data, colors);
+
+        for (unsigned int y = 0; y < 4; ++y) {
+            for (unsigned int x = 0; x < 4; ++x) {
+                u8 alpha = 255;
+                if (has_alpha)
+                    alpha = Color::Convert4To8((packed_alpha >> (4 * (x * 4 + y))) & 0xF);
+
+                const Math::Vec4<u8> texel = Math::MakeVec(colors[x + 4 * y], alpha);
+                std::memcpy(&texels[subtile * 16 + VideoCore::MortonInterleave(x, y)], &texel,
+                            sizeof(u32));
+            }
+        }
+    }
+}
+
+/// Number of valid TextureFormat values
+constexpr size_t NUM_TEXTURE_FORMATS = static_cast<size_t>(TextureFormat::ETC1A4) + 1;
+
+/// Returns the decoder for the format that uses the instruction set, or nullptr if there is none or
+/// the host does not support the instruction set
+static MortonTileDecoder GetMortonTileDecoder(TileDecoderISA isa, TextureFormat format) {
+    static const std::array<MortonTileDecoder, NUM_TEXTURE_FORMATS> generic_decoders = {{
+        DecodeTileGeneric<TextureFormat::RGBA8>,
+        DecodeTileGeneric<TextureFormat::RGB8>,
+        DecodeTileGeneric<TextureFormat::RGB5A1>,
+        DecodeTileGeneric<TextureFormat::RGB565>,
+        DecodeTileGeneric<TextureFormat::RGBA4>,
+        DecodeTileGeneric<TextureFormat::IA8>,
+        DecodeTileGeneric<TextureFormat::RG8>,
+        DecodeTileGeneric<TextureFormat::I8>,
+        DecodeTileGeneric<TextureFormat::A8>,
+        DecodeTileGeneric<TextureFormat::IA4>,
+        DecodeTileGeneric<TextureFormat::I4>,
+        DecodeTileGeneric<TextureFormat::A4>,
+        DecodeETC1Tile<false>,
+        DecodeETC1Tile<true>,
+    }};
+
+    const size_t index = static_cast<size_t>(format);
+    if (index >= NUM_TEXTURE_FORMATS)
+        return nullptr;
+
+    switch (isa) {
+    case TileDecoderISA::Generic:
+        return generic_decoders[index];
+#ifdef ARCHITECTURE_x86_64
+    case TileDecoderISA::SSE41:
+        return Common::GetCPUCaps().sse4_1 ? GetMortonTileDecoderSSE41(format) : nullptr;
+    case TileDecoderISA::AVX2:
+        return Common::GetCPUCaps().avx2 ? GetMortonTileDecoderAVX2(format) : nullptr;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+static std::array<MortonTileDecoder, NUM_TEXTURE_FORMATS> BuildMortonTileDecoders() {
+    std::array<MortonTileDecoder, NUM_TEXTURE_FORMATS> decoders{};
+    for (size_t i = 0; i < decoders.size(); ++i) {
+        // Prefer the widest vector instructions supported by the host
+        for (TileDecoderISA isa :
+             {TileDecoderISA::AVX2, TileDecoderISA::SSE41, TileDecoderISA::Generic}) {
+            decoders[i] = GetMortonTileDecoder(isa, static_cast<TextureFormat>(i));
+            if (decoders[i])
+                break;
+        }
+    }
+    return decoders;
+}
+
+static MortonTileDecoder GetMortonTileDecoder(TextureFormat format) {
+    static const std::array<MortonTileDecoder, NUM_TEXTURE_FORMATS> decoders =
+        BuildMortonTileDecoders();
+
+    const size_t index = static_cast<size_t>(format);
+    return index < decoders.size() ? decoders[index] : nullptr;
+}
+
+/// Stores the texels of a Morton-order tile in rows of dest, which are dest_stride texels apart
+static void DeswizzleTile(const u32* texels, Math::Vec4<u8>* dest, ptrdiff_t dest_stride) {
+    // Horizontally adjacent pairs of texels are consecutive in Morton order
+    for (unsigned int y = 0; y < 8; ++y) {
+        for (unsigned int x = 0; x < 8; x += 2) {
+            std::memcpy(&dest[y * dest_stride + x], &texels[VideoCore::MortonInterleave(x, y)],
+                        2 * sizeof(u32));
+        }
+    }
+}
+
+void DecodeTile8x8(TextureFormat format, const u8* source, Math::Vec4<u8>* dest) {
+    const MortonTileDecoder decode = GetMortonTileDecoder(format);
+    if (decode == nullptr) {
+        LOG_ERROR(HW_GPU, "Unknown texture format: %x", (u32)format);
+        std::fill_n(dest, TILE_SIZE, Math::Vec4<u8>{0, 0, 0, 0});
+        return;
+    }
+
+    alignas(16) u32 texels[TILE_SIZE];
+    decode(source, texels);
+    DeswizzleTile(texels, dest, 8);
+}
+
+bool DecodeTile8x8(TileDecoderISA isa, TextureFormat format, const u8* source,
+                   Math::Vec4<u8>* dest) {
+    const MortonTileDecoder decode = GetMortonTileDecoder(isa, format);
+    if (decode == nullptr)
+        return false;
+
+    alignas(16) u32 texels[TILE_SIZE];
+    decode(source, texels);
+    DeswizzleTile(texels, dest, 8);
+    return true;
+}
+
+void DecodeTexture(const TextureInfo& info, const u8* source, Math::Vec4<u8>* dest,
+                   ptrdiff_t dest_stride, Common::ThreadPool* pool) {
+    const MortonTileDecoder decode = GetMortonTileDecoder(info.format);
+    if (decode == nullptr) {
+        LOG_ERROR(HW_GPU, "Unknown texture format: %x", (u32)info.format);
+        return;
+    }
+
+    const size_t tile_size = CalculateTileSize(info.format);
+    const auto decode_row = [&](size_t row) {
+        alignas(16) u32 texels[TILE_SIZE];
+
+        const unsigned int y = static_cast<unsigned int>(row * 8);
+        const u8* tile = source + row * info.stride;
+        for (unsigned int x = 0; x < info.width; x += 8, tile += tile_size) {
+            decode(tile, texels);
+
+            Math::Vec4<u8>* dest_tile = dest + y * dest_stride + x;
+            if (x + 8 <= info.width && y + 8 <= info.height) {
+                DeswizzleTile(texels, dest_tile, dest_stride);
+                continue;
+            }
+
+            // Partial tile at the edge of a texture whose size is not a multiple of 8
+            for (unsigned int fine_y = 0; fine_y < std::min(8u, info.height - y); ++fine_y) {
+                for (unsigned int fine_x = 0; fine_x < std::min(8u, info.width - x); ++fine_x) {
+                    std::memcpy(&dest_tile[fine_y * dest_stride + fine_x],
+                                &texels[VideoCore::MortonInterleave(fine_x, fine_y)],
+                                sizeof(u32));
+                }
+            }
+        }
+    };
+
+    // Rows of tiles are independent of each other, but handing them to other threads only pays off
+    // once there is enough work to outweigh waking them up
+    const size_t num_rows = (info.height + 7) / 8;
+    if (pool != nullptr && pool->GetThreadCount() > 1 &&
+        info.width * info.height >= MIN_PARALLEL_DECODE_TEXELS) {
+        pool->ParallelFor(num_rows, decode_row);
+    } else {
+        for (size_t row = 0; row < num_rows; ++row)
+            decode_row(row);
+    }
+}
+
 TextureInfo TextureInfo::FromPicaRegister(const TexturingRegs::TextureConfig& config,
                                           const TexturingRegs::TextureFormat& format) {
     TextureInfo info;
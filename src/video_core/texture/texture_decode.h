@@ -8,6 +8,10 @@
 #include "common/vector_math.h"
 #include "video_core/regs_texturing.h"
 
+namespace Common {
+class ThreadPool;
+}
+
 namespace Pica {
 namespace Texture {
 
@@ -56,5 +60,47 @@ Math::Vec4<u8> LookupTexture(const u8* source, unsigned int x, unsigned int y,
 Math::Vec4<u8> LookupTexelInTile(const u8* source, unsigned int x, unsigned int y,
                                  const TextureInfo& info, bool disable_alpha);
 
+/**
+ * Decodes all texels of a single 8x8 texture tile to RGBA8, using vector instructions if the host
+ * supports them.
+ *
+ * @param format Format of the tile.
+ * @param source Pointer to the beginning of the tile.
+ * @param dest Receives 64 texels, the one at in-tile coordinates x, y (as passed to
+ *             LookupTexelInTile) at index x + 8 * y.
+ */
+void DecodeTile8x8(TexturingRegs::TextureFormat format, const u8* source, Math::Vec4<u8>* dest);
+
+/// Instruction sets that tile decoders are implemented with
+enum class TileDecoderISA {
+    Generic,
+    SSE41,
+    AVX2,
+};
+
+/**
+ * Decodes a tile like DecodeTile8x8, but only with the decoder implemented with the given
+ * instruction set. This allows every decoder that the host can run to be tested.
+ *
+ * @return false if there is no such decoder for the format or the host does not support the
+ *         instruction set, in which case dest is left untouched.
+ */
+bool DecodeTile8x8(TileDecoderISA isa, TexturingRegs::TextureFormat format, const u8* source,
+                   Math::Vec4<u8>* dest);
+
+/**
+ * Decodes a whole texture to RGBA8, producing the same texels as LookupTexture.
+ *
+ * @param info TextureInfo describing the texture setup.
+ * @param source Source pointer to read data from.
+ * @param dest Receives the texel at coordinates x, y at dest[x + y * dest_stride].
+ * @param dest_stride Distance between rows of dest in texels. A negative stride can be used to
+ *                    store the rows in the opposite order.
+ * @param pool If given, large textures are decoded by all threads of the pool. Must only be
+ *             passed from the thread that owns the pool.
+ */
+void DecodeTexture(const TextureInfo& info, const u8* source, Math::Vec4<u8>* dest,
+                   ptrdiff_t dest_stride, Common::ThreadPool* pool = nullptr);
+
 } // namespace Texture
 } // namespace Pica
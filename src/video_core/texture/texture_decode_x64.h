@@ -0,0 +1,33 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common_types.h"
+#include "video_core/regs_texturing.h"
+
+namespace Pica {
+namespace Texture {
+
+// The decoders are implemented in files that are compiled with code generation for their
+// instruction set enabled. These must not define or call inline functions of shared headers, as
+// the linker may pick their copy for callers that run on hosts without that instruction set.
+
+/**
+ * Decodes the 64 texels of an 8x8 tile to RGBA8, keeping them in the Morton order they are stored
+ * in. Each texel is written as the bytes R, G, B, A.
+ */
+using MortonTileDecoder = void (*)(const u8* source, u32* texels);
+
+/**
+ * Returns the decoder for the format that requires SSE4.1, or nullptr if there is none.
+ * Implemented in a separate file that is compiled with SSE4.1 code generation enabled.
+ */
+MortonTileDecoder GetMortonTileDecoderSSE41(TexturingRegs::TextureFormat format);
+
+/// Returns the decoder for the format that requires AVX2, or nullptr if there is none
+MortonTileDecoder GetMortonTileDecoderAVX2(TexturingRegs::TextureFormat format);
+
+} // namespace Texture
+} // namespace Pica
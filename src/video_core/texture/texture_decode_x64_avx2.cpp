@@ -0,0 +1,114 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <immintrin.h>
+#include "video_core/texture/texture_decode_x64.h"
+
+using TextureFormat = Pica::TexturingRegs::TextureFormat;
+
+namespace Pica {
+namespace Texture {
+
+// Only the formats that need arithmetic per channel gain from the wider vectors, the others are
+// bound by memory bandwidth and are left to the SSE4.1 decoders.
+
+static __m256i Load(const u8* source) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source));
+}
+
+static void Store(u32* texels, __m256i value) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(texels), value);
+}
+
+/// Expands 4-bit values in the low bits of each 32-bit component to 8 bits
+static __m256i Expand4(__m256i value) {
+    return _mm256_or_si256(value, _mm256_slli_epi32(value, 4));
+}
+
+/// Expands 5-bit values in the low bits of each 32-bit component to 8 bits
+static __m256i Expand5(__m256i value) {
+    return _mm256_or_si256(_mm256_slli_epi32(value, 3), _mm256_srli_epi32(value, 2));
+}
+
+/// Expands 6-bit values in the low bits of each 32-bit component to 8 bits
+static __m256i Expand6(__m256i value) {
+    return _mm256_or_si256(_mm256_slli_epi32(value, 2), _mm256_srli_epi32(value, 4));
+}
+
+/// Combines 8-bit channels in the low bits of each 32-bit component to RGBA8 texels
+static __m256i PackRGBA(__m256i r, __m256i g, __m256i b, __m256i a) {
+    return _mm256_or_si256(_mm256_or_si256(r, _mm256_slli_epi32(g, 8)),
+                           _mm256_or_si256(_mm256_slli_epi32(b, 16), _mm256_slli_epi32(a, 24)));
+}
+
+static void DecodeRGBA8(const u8* source, u32* texels) {
+    // Texels are stored as A, B, G, R
+    const __m256i shuffle =
+        _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6,
+                         5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    for (int i = 0; i < 64; i += 8)
+        Store(texels + i, _mm256_shuffle_epi8(Load(source + i * 4), shuffle));
+}
+
+/// Calls decode with each group of eight 16-bit texels zero-extended to 32 bits
+template <typename Func>
+static void Decode16(const u8* source, u32* texels, Func decode) {
+    for (int i = 0; i < 64; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2));
+        Store(texels + i, decode(_mm256_cvtepu16_epi32(v)));
+    }
+}
+
+static void DecodeRGB5A1(const u8* source, u32* texels) {
+    const __m256i mask = _mm256_set1_epi32(0x1F);
+    const __m256i one = _mm256_set1_epi32(1);
+    Decode16(source, texels, [&](__m256i v) {
+        const __m256i r = Expand5(_mm256_srli_epi32(v, 11));
+        const __m256i g = Expand5(_mm256_and_si256(_mm256_srli_epi32(v, 6), mask));
+        const __m256i b = Expand5(_mm256_and_si256(_mm256_srli_epi32(v, 1), mask));
+        const __m256i a = _mm256_and_si256(_mm256_cmpeq_epi32(_mm256_and_si256(v, one), one),
+                                           _mm256_set1_epi32(0xFF));
+        return PackRGBA(r, g, b, a);
+    });
+}
+
+static void DecodeRGB565(const u8* source, u32* texels) {
+    const __m256i alpha = _mm256_set1_epi32(0xFF000000);
+    Decode16(source, texels, [&](__m256i v) {
+        const __m256i r = Expand5(_mm256_srli_epi32(v, 11));
+        const __m256i g =
+            Expand6(_mm256_and_si256(_mm256_srli_epi32(v, 5), _mm256_set1_epi32(0x3F)));
+        const __m256i b = Expand5(_mm256_and_si256(v, _mm256_set1_epi32(0x1F)));
+        return _mm256_or_si256(PackRGBA(r, g, b, _mm256_setzero_si256()), alpha);
+    });
+}
+
+static void DecodeRGBA4(const u8* source, u32* texels) {
+    const __m256i mask = _mm256_set1_epi32(0xF);
+    Decode16(source, texels, [&](__m256i v) {
+        const __m256i r = Expand4(_mm256_srli_epi32(v, 12));
+        const __m256i g = Expand4(_mm256_and_si256(_mm256_srli_epi32(v, 8), mask));
+        const __m256i b = Expand4(_mm256_and_si256(_mm256_srli_epi32(v, 4), mask));
+        const __m256i a = Expand4(_mm256_and_si256(v, mask));
+        return PackRGBA(r, g, b, a);
+    });
+}
+
+MortonTileDecoder GetMortonTileDecoderAVX2(TextureFormat format) {
+    switch (format) {
+    case TextureFormat::RGBA8:
+        return DecodeRGBA8;
+    case TextureFormat::RGB5A1:
+        return DecodeRGB5A1;
+    case TextureFormat::RGB565:
+        return DecodeRGB565;
+    case TextureFormat::RGBA4:
+        return DecodeRGBA4;
+    default:
+        return nullptr;
+    }
+}
+
+} // namespace Texture
+} // namespace Pica
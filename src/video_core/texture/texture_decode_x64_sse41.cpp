@@ -0,0 +1,338 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <smmintrin.h>
+#include "video_core/texture/etc1.h"
+#include "video_core/texture/texture_decode_x64.h"
+
+using TextureFormat = Pica::TexturingRegs::TextureFormat;
+
+namespace Pica {
+namespace Texture {
+
+// All decoders produce four texels per 128-bit vector and store the 64 texels of a tile in
+// sixteen vectors.
+
+static __m128i Load(const u8* source) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+}
+
+static void Store(u32* texels, __m128i value) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(texels), value);
+}
+
+static __m128i OpaqueAlpha() {
+    return _mm_set1_epi32(0xFF000000);
+}
+
+/// Expands 4-bit values in the low bits of each 32-bit component to 8 bits
+static __m128i Expand4(__m128i value) {
+    return _mm_or_si128(value, _mm_slli_epi32(value, 4));
+}
+
+/// Expands 5-bit values in the low bits of each 32-bit component to 8 bits
+static __m128i Expand5(__m128i value) {
+    return _mm_or_si128(_mm_slli_epi32(value, 3), _mm_srli_epi32(value, 2));
+}
+
+/// Expands 6-bit values in the low bits of each 32-bit component to 8 bits
+static __m128i Expand6(__m128i value) {
+    return _mm_or_si128(_mm_slli_epi32(value, 2), _mm_srli_epi32(value, 4));
+}
+
+/// Combines 8-bit channels in the low bits of each 32-bit component to RGBA8 texels
+static __m128i PackRGBA(__m128i r, __m128i g, __m128i b, __m128i a) {
+    return _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)),
+                        _mm_or_si128(_mm_slli_epi32(b, 16), _mm_slli_epi32(a, 24)));
+}
+
+static void DecodeRGBA8(const u8* source, u32* texels) {
+    // Texels are stored as A, B, G, R
+    const __m128i shuffle = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    for (int i = 0; i < 64; i += 4)
+        Store(texels + i, _mm_shuffle_epi8(Load(source + i * 4), shuffle));
+}
+
+static void DecodeRGB8(const u8* source, u32* texels) {
+    // Texels are stored as B, G, R. Each group of 48 bytes holds 16 texels.
+    const __m128i shuffle =
+        _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    const __m128i alpha = OpaqueAlpha();
+    for (int i = 0; i < 64; i += 16, source += 48) {
+        const __m128i v0 = Load(source);
+        const __m128i v1 = Load(source + 16);
+        const __m128i v2 = Load(source + 32);
+        const __m128i groups[4] = {v0, _mm_alignr_epi8(v1, v0, 12), _mm_alignr_epi8(v2, v1, 8),
+                                   _mm_srli_si128(v2, 4)};
+        for (int j = 0; j < 4; ++j)
+            Store(texels + i + j * 4, _mm_or_si128(_mm_shuffle_epi8(groups[j], shuffle), alpha));
+    }
+}
+
+/// Calls decode with each group of four 16-bit texels zero-extended to 32 bits
+template <typename Func>
+static void Decode16(const u8* source, u32* texels, Func decode) {
+    for (int i = 0; i < 64; i += 8) {
+        const __m128i v = Load(source + i * 2);
+        Store(texels + i, decode(_mm_cvtepu16_epi32(v)));
+        Store(texels + i + 4, decode(_mm_cvtepu16_epi32(_mm_srli_si128(v, 8))));
+    }
+}
+
+static void DecodeRGB5A1(const u8* source, u32* texels) {
+    const __m128i mask = _mm_set1_epi32(0x1F);
+    const __m128i one = _mm_set1_epi32(1);
+    Decode16(source, texels, [&](__m128i v) {
+        const __m128i r = Expand5(_mm_srli_epi32(v, 11));
+        const __m128i g = Expand5(_mm_and_si128(_mm_srli_epi32(v, 6), mask));
+        const __m128i b = Expand5(_mm_and_si128(_mm_srli_epi32(v, 1), mask));
+        const __m128i a = _mm_and_si128(_mm_cmpeq_epi32(_mm_and_si128(v, one), one),
+                                        _mm_set1_epi32(0xFF));
+        return PackRGBA(r, g, b, a);
+    });
+}
+
+static void DecodeRGB565(const u8* source, u32* texels) {
+    const __m128i alpha = OpaqueAlpha();
+    Decode16(source, texels, [&](__m128i v) {
+        const __m128i r = Expand5(_mm_srli_epi32(v, 11));
+        const __m128i g = Expand6(_mm_and_si128(_mm_srli_epi32(v, 5), _mm_set1_epi32(0x3F)));
+        const __m128i b = Expand5(_mm_and_si128(v, _mm_set1_epi32(0x1F)));
+        return _mm_or_si128(PackRGBA(r, g, b, _mm_setzero_si128()), alpha);
+    });
+}
+
+static void DecodeRGBA4(const u8* source, u32* texels) {
+    const __m128i mask = _mm_set1_epi32(0xF);
+    Decode16(source, texels, [&](__m128i v) {
+        const __m128i r = Expand4(_mm_srli_epi32(v, 12));
+        const __m128i g = Expand4(_mm_and_si128(_mm_srli_epi32(v, 8), mask));
+        const __m128i b = Expand4(_mm_and_si128(_mm_srli_epi32(v, 4), mask));
+        const __m128i a = Expand4(_mm_and_si128(v, mask));
+        return PackRGBA(r, g, b, a);
+    });
+}
+
+/// Decodes formats with two bytes per texel by rearranging the bytes of each texel
+static void Shuffle16(const u8* source, u32* texels, __m128i shuffle, __m128i constant) {
+    for (int i = 0; i < 64; i += 8) {
+        const __m128i v = Load(source + i * 2);
+        Store(texels + i, _mm_or_si128(_mm_shuffle_epi8(v, shuffle), constant));
+        Store(texels + i + 4,
+              _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(v, 8), shuffle), constant));
+    }
+}
+
+static void DecodeIA8(const u8* source, u32* texels) {
+    // Texels are stored as A, I
+    const __m128i shuffle = _mm_setr_epi8(1, 1, 1, 0, 3, 3, 3, 2, 5, 5, 5, 4, 7, 7, 7, 6);
+    Shuffle16(source, texels, shuffle, _mm_setzero_si128());
+}
+
+static void DecodeRG8(const u8* source, u32* texels) {
+    // Texels are stored as G, R
+    const __m128i shuffle =
+        _mm_setr_epi8(1, 0, -1, -1, 3, 2, -1, -1, 5, 4, -1, -1, 7, 6, -1, -1);
+    Shuffle16(source, texels, shuffle, OpaqueAlpha());
+}
+
+/// Decodes 16 texels with one byte each, given as a vector, by broadcasting the byte to the
+/// channels selected by the shuffle mask (which is relative to the first of four texels)
+static void Shuffle8(__m128i v, u32* texels, __m128i shuffle, __m128i constant) {
+    const __m128i four = _mm_set1_epi8(4);
+    for (int j = 0; j < 4; ++j) {
+        Store(texels + j * 4, _mm_or_si128(_mm_shuffle_epi8(v, shuffle), constant));
+        // Unused lanes have their high bit set, which adding 4 does not change
+        shuffle = _mm_add_epi8(shuffle, four);
+    }
+}
+
+static __m128i IntensityShuffle() {
+    return _mm_setr_epi8(0, 0, 0, -128, 1, 1, 1, -128, 2, 2, 2, -128, 3, 3, 3, -128);
+}
+
+static __m128i AlphaShuffle() {
+    return _mm_setr_epi8(-128, -128, -128, 0, -128, -128, -128, 1, -128, -128, -128, 2, -128,
+                         -128, -128, 3);
+}
+
+static void DecodeI8(const u8* source, u32* texels) {
+    for (int i = 0; i < 64; i += 16)
+        Shuffle8(Load(source + i), texels + i, IntensityShuffle(), OpaqueAlpha());
+}
+
+static void DecodeA8(const u8* source, u32* texels) {
+    for (int i = 0; i < 64; i += 16)
+        Shuffle8(Load(source + i), texels + i, AlphaShuffle(), _mm_setzero_si128());
+}
+
+static void DecodeIA4(const u8* source, u32* texels) {
+    // Intensity is stored in the high nibble, alpha in the low nibble
+    const __m128i mask = _mm_set1_epi32(0xF);
+    for (int i = 0; i < 64; i += 4) {
+        u32 raw;
+        std::memcpy(&raw, source + i, sizeof(raw));
+        const __m128i v = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(raw));
+        const __m128i intensity = Expand4(_mm_srli_epi32(v, 4));
+        const __m128i alpha = Expand4(_mm_and_si128(v, mask));
+        Store(texels + i, PackRGBA(intensity, intensity, intensity, alpha));
+    }
+}
+
+/// Splits 16 bytes holding 32 texels with 4 bits each (low nibble first) into two vectors with
+/// 16 texels of 8 bits each
+static void Expand4BitTexels(__m128i v, __m128i& low, __m128i& high) {
+    const __m128i mask = _mm_set1_epi8(0xF);
+    const __m128i lo_nibbles = _mm_and_si128(v, mask);
+    const __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+    low = _mm_unpacklo_epi8(lo_nibbles, hi_nibbles);
+    high = _mm_unpackhi_epi8(lo_nibbles, hi_nibbles);
+    // The values are at most 15, so shifting the 16-bit lanes does not carry into other texels
+    low = _mm_or_si128(low, _mm_slli_epi16(low, 4));
+    high = _mm_or_si128(high, _mm_slli_epi16(high, 4));
+}
+
+static void DecodeI4(const u8* source, u32* texels) {
+    for (int i = 0; i < 64; i += 32) {
+        __m128i low, high;
+        Expand4BitTexels(Load(source + i / 2), low, high);
+        Shuffle8(low, texels + i, IntensityShuffle(), OpaqueAlpha());
+        Shuffle8(high, texels + i + 16, IntensityShuffle(), OpaqueAlpha());
+    }
+}
+
+static void DecodeA4(const u8* source, u32* texels) {
+    for (int i = 0; i < 64; i += 32) {
+        __m128i low, high;
+        Expand4BitTexels(Load(source + i / 2), low, high);
+        Shuffle8(low, texels + i, AlphaShuffle(), _mm_setzero_si128());
+        Shuffle8(high, texels + i + 16, AlphaShuffle(), _mm_setzero_si128());
+    }
+}
+
+/// Returns the four colors an ETC1 texel of the half can take, in the order +small, +large, -small,
+/// -large, with the given alpha
+static __m128i ETC1Candidates(const ETC1SubtileHalf& half, u8 alpha) {
+    const u8 small = half.modifiers[0];
+    const u8 large = half.modifiers[1];
+    const __m128i base = _mm_set1_epi32(half.base_color[0] | (half.base_color[1] << 8) |
+                                        (half.base_color[2] << 16) | (alpha << 24));
+    const __m128i modifiers = _mm_setr_epi8(small, small, small, 0, large, large, large, 0, small,
+                                            small, small, 0, large, large, large, 0);
+    return _mm_blend_epi16(_mm_adds_epu8(base, modifiers), _mm_subs_epu8(base, modifiers), 0xF0);
+}
+
+template <bool has_alpha>
+static void DecodeETC1(const u8* source, u32* texels) {
+    constexpr size_t subtile_size = has_alpha ? 16 : 8;
+
+    // ETC1 numbers the texels of a 4x4 subtile as 4 * x + y. This maps Morton order to that index.
+    const __m128i etc1_index =
+        _mm_setr_epi8(0, 4, 1, 5, 8, 12, 9, 13, 2, 6, 3, 7, 10, 14, 11, 15);
+    // Byte and bit holding the table subindex of each texel in Morton order
+    const __m128i subindex_byte = _mm_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1);
+    const __m128i bit = _mm_shuffle_epi8(
+        _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0),
+        _mm_and_si128(etc1_index, _mm_set1_epi8(7)));
+    const __m128i negation_byte =
+        _mm_add_epi8(subindex_byte, _mm_set1_epi8(ETC1_NEGATION_FLAG_SHIFT / 8));
+    const __m128i component_offsets =
+        _mm_setr_epi8(0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3);
+
+    // The four 4x4 subtiles are stored in the same order as the quadrants of a Morton-order tile
+    for (int subtile = 0; subtile < 4; ++subtile, source += subtile_size, texels += 16) {
+        const u8* data = has_alpha ? source + 8 : source;
+        u64 value;
+        std::memcpy(&value, data, sizeof(u64));
+
+        ETC1SubtileHalf halves[2];
+        GetETC1SubtileHalves(value, halves);
+        const u8 base_alpha = has_alpha ? 0 : 0xFF;
+        const __m128i candidates[2] = {ETC1Candidates(halves[0], base_alpha),
+                                       ETC1Candidates(halves[1], base_alpha)};
+
+        // Select a candidate for each texel: bit 0 is the table subindex, bit 1 the negation flag
+        const __m128i flags = _mm_cvtsi32_si128(static_cast<int>(value));
+        const __m128i subindex = _mm_cmpeq_epi8(
+            _mm_and_si128(_mm_shuffle_epi8(flags, subindex_byte), bit), bit);
+        const __m128i negation = _mm_cmpeq_epi8(
+            _mm_and_si128(_mm_shuffle_epi8(flags, negation_byte), bit), bit);
+        const __m128i candidate_index = _mm_or_si128(_mm_and_si128(subindex, _mm_set1_epi8(1)),
+                                                     _mm_and_si128(negation, _mm_set1_epi8(2)));
+
+        __m128i alpha = _mm_setzero_si128();
+        if (has_alpha) {
+            // 4-bit alpha values in ETC1 texel order, two per byte with the lower index first
+            const __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(source));
+            const __m128i nibble_mask = _mm_set1_epi8(0xF);
+            const __m128i nibbles =
+                _mm_unpacklo_epi8(_mm_and_si128(packed, nibble_mask),
+                                  _mm_and_si128(_mm_srli_epi16(packed, 4), nibble_mask));
+            alpha = _mm_shuffle_epi8(nibbles, etc1_index);
+            alpha = _mm_or_si128(alpha, _mm_slli_epi16(alpha, 4));
+        }
+
+        const bool flip = (value >> ETC1_FLIP_SHIFT) & 1;
+        for (int i = 0; i < 4; ++i) {
+            // Each group of four texels in Morton order lies within a single half of the subtile
+            const int half = flip ? (i >> 1) : (i & 1);
+
+            const __m128i texel_index =
+                _mm_setr_epi8(4 * i, 4 * i, 4 * i, 4 * i, 4 * i + 1, 4 * i + 1, 4 * i + 1,
+                              4 * i + 1, 4 * i + 2, 4 * i + 2, 4 * i + 2, 4 * i + 2, 4 * i + 3,
+                              4 * i + 3, 4 * i + 3, 4 * i + 3);
+            const __m128i byte_index = _mm_or_si128(
+                _mm_slli_epi16(_mm_shuffle_epi8(candidate_index, texel_index), 2),
+                component_offsets);
+            __m128i result = _mm_shuffle_epi8(candidates[half], byte_index);
+
+            if (has_alpha) {
+                const __m128i alpha_index =
+                    _mm_setr_epi8(-128, -128, -128, 4 * i, -128, -128, -128, 4 * i + 1, -128,
+                                  -128, -128, 4 * i + 2, -128, -128, -128, 4 * i + 3);
+                result = _mm_or_si128(result, _mm_shuffle_epi8(alpha, alpha_index));
+            }
+            Store(texels + 4 * i, result);
+        }
+    }
+}
+
+MortonTileDecoder GetMortonTileDecoderSSE41(TextureFormat format) {
+    switch (format) {
+    case TextureFormat::RGBA8:
+        return DecodeRGBA8;
+    case TextureFormat::RGB8:
+        return DecodeRGB8;
+    case TextureFormat::RGB5A1:
+        return DecodeRGB5A1;
+    case TextureFormat::RGB565:
+        return DecodeRGB565;
+    case TextureFormat::RGBA4:
+        return DecodeRGBA4;
+    case TextureFormat::IA8:
+        return DecodeIA8;
+    case TextureFormat::RG8:
+        return DecodeRG8;
+    case TextureFormat::I8:
+        return DecodeI8;
+    case TextureFormat::A8:
+        return DecodeA8;
+    case TextureFormat::IA4:
+        return DecodeIA4;
+    case TextureFormat::I4:
+        return DecodeI4;
+    case TextureFormat::A4:
+        return DecodeA4;
+    case TextureFormat::ETC1:
+        return DecodeETC1<false>;
+    case TextureFormat::ETC1A4:
+        return DecodeETC1<true>;
+    default:
+        return nullptr;
+    }
+}
+
+} // namespace Texture
+} // namespace Pica
@@ -13,9 +13,29 @@
 #include "video_core/regs_pipeline.h"
 #include "video_core/shader/shader.h"
 #include "video_core/vertex_loader.h"
+#include "video_core/video_core.h"
+#ifdef ARCHITECTURE_x86_64
+#include "video_core/vertex_loader_jit_x64.h"
+#endif // ARCHITECTURE_x86_64
 
 namespace Pica {
 
+#ifdef ARCHITECTURE_x86_64
+static std::unique_ptr<VertexLoaderJitCache> jit_cache;
+#endif // ARCHITECTURE_x86_64
+
+/// Size of a single attribute component in memory
+static u32 GetComponentSize(PipelineRegs::VertexAttributeFormat format) {
+    switch (format) {
+    case PipelineRegs::VertexAttributeFormat::FLOAT:
+        return 4;
+    case PipelineRegs::VertexAttributeFormat::SHORT:
+        return 2;
+    default:
+        return 1;
+    }
+}
+
 void VertexLoader::Setup(const PipelineRegs& regs) {
     ASSERT_MSG(!is_setup, "VertexLoader is not intended to be setup more than once.");
 
@@ -82,15 +102,9 @@ void VertexLoader::LoadVertex(u32 base_address, int index, int vertex,
                 base_address + vertex_attribute_sources[i] + vertex_attribute_strides[i] * vertex;
 
             if (g_debug_context && Pica::g_debug_context->recorder) {
-                memory_accesses.AddAccess(
-                    source_addr,
-                    vertex_attribute_elements[i] *
-                        ((vertex_attribute_formats[i] == PipelineRegs::VertexAttributeFormat::FLOAT)
-                             ? 4
-                             : (vertex_attribute_formats[i] ==
-                                PipelineRegs::VertexAttributeFormat::SHORT)
-                                   ? 2
-                                   : 1));
+                memory_accesses.AddAccess(source_addr,
+                                          vertex_attribute_elements[i] *
+                                              GetComponentSize(vertex_attribute_formats[i]));
             }
 
             switch (vertex_attribute_formats[i]) {
@@ -157,4 +171,70 @@ void VertexLoader::LoadVertex(u32 base_address, int index, int vertex,
     }
 }
 
+bool VertexLoader::SetupCompiledLoader(u32 base_address, u32 min_vertex, u32 max_vertex) {
+    ASSERT_MSG(is_setup, "A VertexLoader needs to be setup before loading vertices.");
+
+    jit = nullptr;
+
+#ifdef ARCHITECTURE_x86_64
+    if (!VideoCore::g_shader_jit_enabled || !VertexLoaderJit::IsSupported())
+        return false;
+
+    VertexLoaderJitConfig config{};
+    config.num_total_attributes = num_total_attributes;
+
+    for (int i = 0; i < num_total_attributes; ++i) {
+        jit_sources.pointers[i] = nullptr;
+
+        if (vertex_attribute_elements[i] == 0) {
+            config.is_default[i] = vertex_attribute_is_default[i];
+            continue;
+        }
+
+        // The compiled loader addresses the data of all vertices relative to a single host
+        // pointer. Both ends of the range being mapped contiguously is taken as proof that the
+        // range lies within one memory region.
+        const u32 size =
+            vertex_attribute_elements[i] * GetComponentSize(vertex_attribute_formats[i]);
+        const u32 first = base_address + vertex_attribute_sources[i] +
+                          vertex_attribute_strides[i] * min_vertex;
+        const u32 last = base_address + vertex_attribute_sources[i] +
+                         vertex_attribute_strides[i] * max_vertex + size - 1;
+        const u8* first_pointer = Memory::GetPhysicalPointer(first);
+        const u8* last_pointer = Memory::GetPhysicalPointer(last);
+        if (first_pointer == nullptr || last_pointer == nullptr ||
+            last_pointer - first_pointer != static_cast<ptrdiff_t>(last - first))
+            return false;
+
+        jit_sources.pointers[i] = first_pointer;
+        config.elements[i] = vertex_attribute_elements[i];
+        config.formats[i] = vertex_attribute_formats[i];
+        config.strides[i] = vertex_attribute_strides[i];
+    }
+    jit_sources.first_vertex = min_vertex;
+
+    if (jit_cache == nullptr)
+        jit_cache = std::make_unique<VertexLoaderJitCache>();
+    jit = jit_cache->Get(config);
+    return true;
+#else
+    return false;
+#endif // ARCHITECTURE_x86_64
+}
+
+void VertexLoader::LoadVertices(const u32* vertices, size_t count,
+                                Shader::AttributeBuffer* inputs) const {
+    ASSERT_MSG(jit != nullptr, "LoadVertices requires a successful SetupCompiledLoader.");
+
+#ifdef ARCHITECTURE_x86_64
+    jit->Run(jit_sources, vertices, count, inputs);
+#endif // ARCHITECTURE_x86_64
+}
+
+void VertexLoader::ClearCompiledLoaders() {
+#ifdef ARCHITECTURE_x86_64
+    jit_cache = nullptr;
+#endif // ARCHITECTURE_x86_64
+}
+
 } // namespace Pica
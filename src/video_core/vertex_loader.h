@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include "common/common_types.h"
 #include "video_core/regs_pipeline.h"
 
@@ -14,6 +15,16 @@ namespace Shader {
 struct AttributeBuffer;
 }
 
+class VertexLoaderJit;
+
+/// Host memory the attributes of a draw are loaded from by a compiled vertex loader
+struct VertexLoaderJitSources {
+    /// Host pointer to the data of first_vertex, for each attribute loaded from memory
+    std::array<const u8*, 16> pointers;
+    /// Lowest vertex index that may be loaded
+    u32 first_vertex;
+};
+
 class VertexLoader {
 public:
     VertexLoader() = default;
@@ -25,6 +36,20 @@ public:
     void LoadVertex(u32 base_address, int index, int vertex, Shader::AttributeBuffer& input,
                     DebugUtils::MemoryAccessTracker& memory_accesses);
 
+    /**
+     * Prepares loading the vertices in the given index range with a compiled loader. This requires
+     * the shader JIT to be enabled and the attribute data of all those vertices to be contiguous
+     * in host memory.
+     * @return Whether LoadVertices can be used for this range
+     */
+    bool SetupCompiledLoader(u32 base_address, u32 min_vertex, u32 max_vertex);
+
+    /// Loads the given vertices with the loader prepared by SetupCompiledLoader
+    void LoadVertices(const u32* vertices, size_t count, Shader::AttributeBuffer* inputs) const;
+
+    /// Frees all compiled loaders
+    static void ClearCompiledLoaders();
+
     int GetNumTotalAttributes() const {
         return num_total_attributes;
     }
@@ -37,6 +62,9 @@ private:
     std::array<bool, 16> vertex_attribute_is_default;
     int num_total_attributes = 0;
     bool is_setup = false;
+
+    const VertexLoaderJit* jit = nullptr;
+    VertexLoaderJitSources jit_sources;
 };
 
 } // namespace Pica
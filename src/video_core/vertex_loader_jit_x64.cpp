@@ -0,0 +1,194 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstddef>
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "common/x64/cpu_detect.h"
+#include "common/x64/xbyak_abi.h"
+#include "video_core/pica_state.h"
+#include "video_core/shader/shader.h"
+#include "video_core/vertex_loader_jit_x64.h"
+
+using namespace Common::X64;
+using namespace Xbyak::util;
+using Xbyak::Label;
+using Xbyak::Reg64;
+using Xbyak::Xmm;
+
+namespace Pica {
+
+using VertexAttributeFormat = PipelineRegs::VertexAttributeFormat;
+
+/// Memory allocated for the code of each configuration
+constexpr size_t MAX_VERTEX_LOADER_SIZE = 4096;
+
+// Registers used by the generated code. Only caller-saved registers are used, so nothing has to
+// be preserved across calls.
+
+/// Pointer to the VertexLoaderJitSources of the draw
+static const Reg64 SOURCES = r10;
+/// Pointer to the index of the current vertex
+static const Reg64 VERTICES = r11;
+/// Number of vertices left to load
+static const Reg64 COUNT = r8;
+/// Pointer to the AttributeBuffer of the current vertex
+static const Reg64 OUTPUT = r9;
+/// Index of the current vertex, relative to the first vertex of the draw
+static const Reg64 VERTEX = rax;
+/// Address of the attribute being loaded
+static const Reg64 ADDRESS = rcx;
+static const Reg64 SCRATCH = rdx;
+/// Attribute being loaded
+static const Xmm ATTRIBUTE = xmm0;
+/// (0, 0, 0, 1), the value of components that are not loaded
+static const Xmm DEFAULT_COMPONENTS = xmm1;
+
+bool VertexLoaderJit::IsSupported() {
+    // Used for the conversion of integer components and for blendps
+    return Common::GetCPUCaps().sse4_1;
+}
+
+VertexLoaderJit::VertexLoaderJit(const VertexLoaderJitConfig& config)
+    : Xbyak::CodeGenerator(MAX_VERTEX_LOADER_SIZE) {
+    program = getCurr<Program>();
+
+    mov(SOURCES, ABI_PARAM1);
+    mov(VERTICES, ABI_PARAM2);
+    mov(COUNT, ABI_PARAM3);
+    mov(OUTPUT, ABI_PARAM4);
+
+    mov(SCRATCH.cvt32(), 0x3F800000); // 1.0f
+    movd(DEFAULT_COMPONENTS, SCRATCH.cvt32());
+    pshufd(DEFAULT_COMPONENTS, DEFAULT_COMPONENTS, 0x15);
+
+    Label end, loop;
+    test(COUNT, COUNT);
+    jz(end, T_NEAR);
+
+    L(loop);
+    mov(VERTEX.cvt32(), dword[VERTICES]);
+    sub(VERTEX.cvt32(), dword[SOURCES + offsetof(VertexLoaderJitSources, first_vertex)]);
+
+    for (unsigned i = 0; i < config.num_total_attributes; ++i) {
+        const size_t output_offset = i * sizeof(Math::Vec4<float24>);
+
+        if (config.elements[i] != 0) {
+            imul(ADDRESS, VERTEX, config.strides[i]);
+            add(ADDRESS, qword[SOURCES + i * sizeof(const u8*)]);
+            CompileLoadAttribute(config.formats[i], config.elements[i]);
+
+            // Components that are not loaded are (0, 0, 0, 1). The loads above leave the unused
+            // lanes zeroed, hence only the fourth component needs to be set.
+            if (config.elements[i] < 4)
+                blendps(ATTRIBUTE, DEFAULT_COMPONENTS, 0x8);
+            movaps(xword[OUTPUT + output_offset], ATTRIBUTE);
+        } else if (config.is_default[i]) {
+            mov(SCRATCH, reinterpret_cast<uintptr_t>(&g_state.input_default_attributes.attr[i]));
+            movaps(ATTRIBUTE, xword[SCRATCH]);
+            movaps(xword[OUTPUT + output_offset], ATTRIBUTE);
+        }
+        // Attributes that are neither loaded nor default keep their value, like LoadVertex does
+    }
+
+    add(VERTICES, sizeof(u32));
+    add(OUTPUT, sizeof(Shader::AttributeBuffer));
+    dec(COUNT);
+    jnz(loop, T_NEAR);
+
+    L(end);
+    ret();
+
+    ready();
+
+    ASSERT_MSG(getSize() <= MAX_VERTEX_LOADER_SIZE,
+               "Compiled a vertex loader that exceeds the allocated size!");
+    LOG_DEBUG(HW_GPU, "Compiled vertex loader size=%zu", getSize());
+}
+
+void VertexLoaderJit::CompileLoadAttribute(VertexAttributeFormat format, u32 elements) {
+    // Components are loaded into the low lanes of ATTRIBUTE with the remaining lanes zeroed, taking
+    // care not to read past the attribute
+    switch (format) {
+    case VertexAttributeFormat::FLOAT:
+        switch (elements) {
+        case 1:
+            movss(ATTRIBUTE, dword[ADDRESS]);
+            break;
+        case 2:
+            movq(ATTRIBUTE, qword[ADDRESS]);
+            break;
+        case 3:
+            movq(ATTRIBUTE, qword[ADDRESS]);
+            insertps(ATTRIBUTE, dword[ADDRESS + 8], 0x20);
+            break;
+        default:
+            movups(ATTRIBUTE, xword[ADDRESS]);
+            break;
+        }
+        // Floats are stored as they are, like float24::FromFloat32 does
+        return;
+
+    case VertexAttributeFormat::SHORT:
+        switch (elements) {
+        case 1:
+            movzx(SCRATCH.cvt32(), word[ADDRESS]);
+            movd(ATTRIBUTE, SCRATCH.cvt32());
+            break;
+        case 2:
+            movd(ATTRIBUTE, dword[ADDRESS]);
+            break;
+        case 3:
+            movd(ATTRIBUTE, dword[ADDRESS]);
+            pinsrw(ATTRIBUTE, word[ADDRESS + 4], 2);
+            break;
+        default:
+            movq(ATTRIBUTE, qword[ADDRESS]);
+            break;
+        }
+        pmovsxwd(ATTRIBUTE, ATTRIBUTE);
+        break;
+
+    case VertexAttributeFormat::BYTE:
+    case VertexAttributeFormat::UBYTE:
+        switch (elements) {
+        case 1:
+            movzx(SCRATCH.cvt32(), byte[ADDRESS]);
+            movd(ATTRIBUTE, SCRATCH.cvt32());
+            break;
+        case 2:
+            movzx(SCRATCH.cvt32(), word[ADDRESS]);
+            movd(ATTRIBUTE, SCRATCH.cvt32());
+            break;
+        case 3:
+            movzx(SCRATCH.cvt32(), word[ADDRESS]);
+            movd(ATTRIBUTE, SCRATCH.cvt32());
+            pinsrb(ATTRIBUTE, byte[ADDRESS + 2], 2);
+            break;
+        default:
+            movd(ATTRIBUTE, dword[ADDRESS]);
+            break;
+        }
+        if (format == VertexAttributeFormat::BYTE)
+            pmovsxbd(ATTRIBUTE, ATTRIBUTE);
+        else
+            pmovzxbd(ATTRIBUTE, ATTRIBUTE);
+        break;
+    }
+
+    cvtdq2ps(ATTRIBUTE, ATTRIBUTE);
+}
+
+const VertexLoaderJit* VertexLoaderJitCache::Get(const VertexLoaderJitConfig& config) {
+    auto iter = cache.find(config);
+    if (iter != cache.end())
+        return iter->second.get();
+
+    auto loader = std::make_unique<VertexLoaderJit>(config);
+    const VertexLoaderJit* result = loader.get();
+    cache.emplace_hint(iter, config, std::move(loader));
+    return result;
+}
+
+} // namespace Pica
@@ -0,0 +1,102 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <xbyak.h>
+#include "common/common_types.h"
+#include "common/hash.h"
+#include "video_core/regs_pipeline.h"
+#include "video_core/vertex_loader.h"
+
+namespace Pica {
+
+namespace Shader {
+struct AttributeBuffer;
+}
+
+/**
+ * The attribute layout compiled by the vertex loader JIT. This is the key of the compiled loader
+ * cache; fields of attributes that are not loaded from memory are left zeroed, so that equivalent
+ * configurations compare (and hash) equal bytewise.
+ */
+struct VertexLoaderJitConfig {
+    bool operator==(const VertexLoaderJitConfig& other) const {
+        return std::memcmp(this, &other, sizeof(VertexLoaderJitConfig)) == 0;
+    }
+
+    u32 num_total_attributes;
+    /// Number of components loaded from memory, 0 for attributes that are not loaded
+    std::array<u32, 16> elements;
+    std::array<PipelineRegs::VertexAttributeFormat, 16> formats;
+    std::array<u32, 16> strides;
+    std::array<bool, 16> is_default;
+};
+static_assert(std::is_trivially_copyable<VertexLoaderJitConfig>::value,
+              "VertexLoaderJitConfig must be trivially copyable");
+
+} // namespace Pica
+
+namespace std {
+template <>
+struct hash<Pica::VertexLoaderJitConfig> {
+    size_t operator()(const Pica::VertexLoaderJitConfig& k) const {
+        return Common::ComputeHash64(&k, sizeof(Pica::VertexLoaderJitConfig));
+    }
+};
+} // namespace std
+
+namespace Pica {
+
+/**
+ * Vertex attribute loader compiled to x86_64 code. The generated code loads every attribute of a
+ * list of vertices, converting each one to four floats with a handful of SSE instructions instead
+ * of a per-component switch on the attribute format.
+ */
+class VertexLoaderJit : public Xbyak::CodeGenerator {
+public:
+    /// Returns whether the host CPU can run compiled loaders
+    static bool IsSupported();
+
+    explicit VertexLoaderJit(const VertexLoaderJitConfig& config);
+
+    /**
+     * Loads the attributes of the given vertices.
+     * @param sources Memory holding the attribute data of all given vertices
+     * @param vertices Indices of the vertices to load
+     * @param count Number of vertices to load
+     * @param inputs Receives the attributes of each vertex
+     */
+    void Run(const VertexLoaderJitSources& sources, const u32* vertices, size_t count,
+             Shader::AttributeBuffer* inputs) const {
+        program(&sources, vertices, count, inputs);
+    }
+
+private:
+    using Program = void (*)(const VertexLoaderJitSources* sources, const u32* vertices,
+                             size_t count, Shader::AttributeBuffer* inputs);
+
+    /// Loads the components of an attribute from memory and converts them to floats
+    void CompileLoadAttribute(PipelineRegs::VertexAttributeFormat format, u32 elements);
+
+    Program program = nullptr;
+};
+
+/// Caches compiled vertex loaders by their attribute layout
+class VertexLoaderJitCache {
+public:
+    /// Returns the loader for the given configuration, compiling it on first use
+    const VertexLoaderJit* Get(const VertexLoaderJitConfig& config);
+
+private:
+    std::unordered_map<VertexLoaderJitConfig, std::unique_ptr<VertexLoaderJit>> cache;
+};
+
+} // namespace Pica
@@ -19,6 +19,9 @@ std::unique_ptr<RendererBase> g_renderer; ///< Renderer plugin
 
 std::atomic<bool> g_hw_renderer_enabled;
 std::atomic<bool> g_shader_jit_enabled;
+std::atomic<bool> g_async_shader_jit_enabled;
+std::atomic<bool> g_async_gpu_enabled;
+std::atomic<bool> g_fragment_jit_enabled;
 std::atomic<bool> g_vsync_enabled;
 std::atomic<bool> g_toggle_framelimit_enabled;
 
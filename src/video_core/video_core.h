@@ -22,6 +22,9 @@ extern EmuWindow* g_emu_window;                  ///< Emu window
 // qt ui)
 extern std::atomic<bool> g_hw_renderer_enabled;
 extern std::atomic<bool> g_shader_jit_enabled;
+extern std::atomic<bool> g_async_shader_jit_enabled;
+extern std::atomic<bool> g_async_gpu_enabled;
+extern std::atomic<bool> g_fragment_jit_enabled;
 extern std::atomic<bool> g_toggle_framelimit_enabled;
 
 /// Start the video core